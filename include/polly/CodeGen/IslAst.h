@@ -43,6 +43,10 @@ class IslAst;
 class MemoryAccess;
 struct Dependences;
 
+/// The number of loop iterations a parallel loop nest has to execute to be
+/// run thread parallel, checked at run time. Zero disables the check.
+extern unsigned PollyParallelMinWork;
+
 class IslAst {
 public:
   static IslAst create(Scop &Scop, const Dependences &D);
@@ -89,8 +93,10 @@ public:
     /// Construct and initialize the payload.
     IslAstUserPayload()
         : IsInnermost(false), IsInnermostParallel(false),
-          IsOutermostParallel(false), IsReductionParallel(false),
-          MinimalDependenceDistance(nullptr), Build(nullptr) {}
+          IsOutermostParallel(false), IsCollapsed(false), IsDoacross(false),
+          DoacrossDistance(0), IsReductionParallel(false),
+          MinimalDependenceDistance(nullptr),
+          Build(nullptr), ReductionLocations(nullptr) {}
 
     /// Cleanup all isl structs on destruction.
     ~IslAstUserPayload();
@@ -104,6 +110,18 @@ public:
     /// Flag to mark outermost parallel loops.
     bool IsOutermostParallel;
 
+    /// Flag to mark parallel loops collapsed into the surrounding thread
+    /// parallel loop.
+    bool IsCollapsed;
+
+    /// Flag to mark loops executed thread parallel with their consecutive
+    /// iterations synchronized in the loop nested in them.
+    bool IsDoacross;
+
+    /// The distance, in iterations of the nested loop, iteration i of a
+    /// doacross loop stays behind iteration i - 1.
+    long DoacrossDistance;
+
     /// Flag to mark parallel loops which break reductions.
     bool IsReductionParallel;
 
@@ -115,6 +133,10 @@ public:
 
     /// Set of accesses which break reduction dependences.
     MemoryAccessSet BrokenReductions;
+
+    /// The array elements the broken reductions accumulate into, if they can
+    /// be privatized for a thread parallel execution of the loop.
+    isl_union_map *ReductionLocations;
   };
 
 private:
@@ -155,6 +177,19 @@ public:
   /// Is this loop an innermost parallel loop?
   static bool isInnermostParallel(__isl_keep isl_ast_node *Node);
 
+  /// Is this loop a doacross loop?
+  static bool isDoacross(__isl_keep isl_ast_node *Node);
+
+  /// Get the distance a doacross loop synchronizes its iterations with.
+  static long getDoacrossDistance(__isl_keep isl_ast_node *Node);
+
+  /// Is this loop collapsed into the surrounding thread parallel loop?
+  static bool isCollapsed(__isl_keep isl_ast_node *Node);
+
+  /// Get the number of perfectly nested loops, starting with the thread
+  /// parallel loop @p Node, that are executed as one parallel loop.
+  static unsigned getNumCollapsedLoops(__isl_keep isl_ast_node *Node);
+
   /// Is this loop a reduction parallel loop?
   static bool isReductionParallel(__isl_keep isl_ast_node *Node);
 
@@ -171,6 +206,14 @@ public:
   /// Get the nodes broken reductions or a nullptr if not available.
   static MemoryAccessSet *getBrokenReductions(__isl_keep isl_ast_node *Node);
 
+  /// Get the array elements the broken reductions of the node accumulate
+  /// into, or a nullptr if they cannot be privatized.
+  ///
+  /// The elements are given as a function of the schedule at the node, which
+  /// does not depend on the node's own dimension.
+  static __isl_give isl_union_map *
+  getReductionLocations(__isl_keep isl_ast_node *Node);
+
   /// Get the nodes build context or a nullptr if not available.
   static __isl_give isl_ast_build *getBuild(__isl_keep isl_ast_node *Node);
 
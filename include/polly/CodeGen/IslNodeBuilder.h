@@ -18,7 +18,9 @@
 #include "polly/CodeGen/LoopGenerators.h"
 #include "polly/ScopInfo.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "isl/ctx.h"
@@ -98,6 +100,10 @@ public:
   void create(__isl_take isl_ast_node *Node);
 
   /// Allocate memory for all new arrays created by Polly.
+  ///
+  /// With -polly-scratch-buffers, the arrays are taken from the per-thread
+  /// scratch buffers of the ScratchRuntime at the start of the SCoP, which
+  /// are reused by later executions of the SCoP.
   void allocateNewArrays(BBPair StartExitBlocks);
 
   /// Preload all memory loads that are invariant.
@@ -165,6 +171,22 @@ protected:
   /// A collection of all parallel subfunctions that have been created.
   SmallVector<Function *, 8> ParallelSubfunctions;
 
+  /// The reduction arrays privatized in the parallel subfunction that is
+  /// currently generated.
+  SmallPtrSet<const ScopArrayInfo *, 4> PrivateReductionArrays;
+
+  /// A scratch buffer of the ScratchRuntime.
+  struct ScratchBufferTy {
+    /// The global variable whose address identifies the buffer.
+    Value *Key;
+
+    /// The size of the buffer in bytes.
+    uint64_t Size;
+  };
+
+  /// The new arrays that are allocated as scratch buffers.
+  MapVector<const ScopArrayInfo *, ScratchBufferTy> ScratchBuffers;
+
   /// Generate code for a given SCEV*
   ///
   /// This function generates code for a given SCEV expression. It generated
@@ -306,13 +328,142 @@ protected:
   bool preloadInvariantEquivClass(InvariantEquivClassTy &IAClass);
 
   void createForVector(__isl_take isl_ast_node *For, int VectorWidth);
-  void createForSequential(__isl_take isl_ast_node *For, bool KnownParallel);
+
+  /// The synchronization of an iteration of a doacross loop.
+  ///
+  /// Every iteration of a doacross loop publishes in its Post slot the last
+  /// iteration of the nested loop it finished. Before iteration j of the
+  /// nested loop, it waits until the preceding iteration published at least
+  /// j + Distance in the Wait slot.
+  struct DoacrossSync {
+    Value *Wait;
+    Value *Post;
+    long Distance;
+  };
+
+  /// Create LLVM-IR that executes a for node sequentially.
+  ///
+  /// @param For           The FOR isl_ast_node for which code is generated.
+  /// @param KnownParallel The loop is known to be parallel.
+  /// @param Sync          If not nullptr, the iterations of the loop are
+  ///                      synchronized with the iteration of the surrounding
+  ///                      doacross loop that precedes the current one.
+  void createForSequential(__isl_take isl_ast_node *For, bool KnownParallel,
+                           const DoacrossSync *Sync = nullptr);
 
   /// Create LLVM-IR that executes a for node thread parallel.
   ///
   /// @param For The FOR isl_ast_node for which code is generated.
   void createForParallel(__isl_take isl_ast_node *For);
 
+  /// Create LLVM-IR that executes a for node thread parallel if it has enough
+  /// work, as given by -polly-parallel-min-work, and sequential otherwise.
+  ///
+  /// @param For The FOR isl_ast_node for which code is generated.
+  void createForParallelIfProfitable(__isl_take isl_ast_node *For);
+
+  /// Create the number of iterations of the loop @p For.
+  ///
+  /// @return The number of iterations as a 64 bit integer.
+  Value *createLoopTripCount(__isl_keep isl_ast_node *For);
+
+  /// Map the iterators of the loops collapsed into a thread parallel loop to
+  /// their values in the loop body.
+  ///
+  /// @param SubFn The parallel subfunction.
+  /// @param IV    The induction variable of the linearized iteration space.
+  /// @param Loops The collapsed loops, outermost first.
+  void createCollapsedIterators(Function *SubFn, Value *IV,
+                                ArrayRef<isl_ast_node *> Loops);
+
+  /// Create the number of iterations executed by the loop nest @p For.
+  ///
+  /// The iterations of the perfectly nested loops whose bounds do not depend
+  /// on the loops of the nest are counted, the others are assumed to execute
+  /// once.
+  ///
+  /// @param For The outermost for node of the loop nest.
+  ///
+  /// @return The number of iterations as a 64 bit integer.
+  Value *createLoopNestWork(__isl_keep isl_ast_node *For);
+
+  /// A reduction broken by a thread parallel loop.
+  ///
+  /// Every thread accumulates into a private copy of the reduced element and
+  /// stores its result in its own slot of Partials. The partial results are
+  /// combined into the Shared element once the threads are joined.
+  struct PrivateReduction {
+    const ScopArrayInfo *SAI;
+    MemoryAccess::ReductionType Type;
+    Value *Shared;
+    Value *Partials;
+  };
+
+  /// Create the partial results of the reductions broken by @p For.
+  ///
+  /// @param For        The parallel for node.
+  /// @param NumThreads The number of threads of the parallel loop.
+  /// @param Reductions The privatized reductions are returned here.
+  void createReductionPartials(__isl_keep isl_ast_node *For, Value *NumThreads,
+                               SmallVectorImpl<PrivateReduction> &Reductions);
+
+  /// Create the thread private copies of @p Reductions in @p SubFn.
+  ///
+  /// The copies start with the identity of the reduction and are stored to the
+  /// partial result of the thread when it leaves the subfunction. Accesses to
+  /// the reduction arrays are redirected to the copies.
+  ///
+  /// @param SubFn           The parallel subfunction.
+  /// @param ParallelLoopGen The generator of the subfunction.
+  /// @param Reductions      The privatized reductions.
+  /// @param NewValues       The values passed to the subfunction.
+  void createPrivateReductions(Function *SubFn,
+                               ParallelLoopGenerator &ParallelLoopGen,
+                               ArrayRef<PrivateReduction> Reductions,
+                               ValueMapT &NewValues);
+
+  /// Get the scratch buffer of @p SAI for the calling thread.
+  ///
+  /// The buffer is reused by all executions of the SCoP in the thread. The
+  /// call is emitted at the current insert point of the builder.
+  ///
+  /// @return The buffer, casted to a pointer to the element type of @p SAI.
+  Value *createScratchBufferCall(const ScopArrayInfo *SAI);
+
+  /// Create thread private scratch buffers in @p SubFn.
+  ///
+  /// The scratch buffers of the arrays that are written in the parallel loop
+  /// @p For and not accessed outside of it are taken from the arena of each
+  /// thread. Accesses to the arrays are redirected to them. All other arrays
+  /// use the buffer obtained before the parallel loop, which is shared by the
+  /// threads.
+  ///
+  /// @param For   The parallel for node.
+  /// @param SubFn The parallel subfunction.
+  void createPrivateScratchBuffers(__isl_keep isl_ast_node *For,
+                                   Function *SubFn);
+
+  /// Combine the partial results of @p Reductions in a tree.
+  ///
+  /// @param NumThreads The number of partial results of each reduction.
+  /// @param Reductions The privatized reductions.
+  void createReductionCombine(Value *NumThreads,
+                              ArrayRef<PrivateReduction> Reductions);
+
+  /// Create the progress slots of the iterations of the doacross loop @p For.
+  ///
+  /// The first slot belongs to the iteration before the first one and is
+  /// marked finished, the others are marked not started.
+  ///
+  /// @return The slots, to be freed after the loop.
+  Value *createDoacrossProgress(__isl_keep isl_ast_node *For);
+
+  /// Wait until the progress in @p Wait reaches @p Target.
+  void createDoacrossWait(Value *Wait, Value *Target);
+
+  /// Publish @p Progress in @p Post.
+  void createDoacrossPost(Value *Post, Value *Progress);
+
   /// Create new access functions for modified memory accesses.
   ///
   /// In case the access function of one of the memory references in the Stmt
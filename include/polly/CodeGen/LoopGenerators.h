@@ -65,7 +65,11 @@ Value *createLoop(Value *LowerBound, Value *UpperBound, Value *Stride,
 ///      iterations) are distributed between them and make sure each has access
 ///      to the struct holding all needed values.
 ///
-/// At the moment we support only one parallel runtime, OpenMP.
+/// The parallel runtime is OpenMP, either the GNU library (libgomp) or the
+/// LLVM library (libomp), see -polly-omp-backend. The iterations are
+/// distributed as given by -polly-scheduling. With the LLVM library and static
+/// scheduling, every thread computes its blocks of iterations once, without a
+/// runtime call per block.
 ///
 /// If we parallelize the outer loop of the following loop nest,
 ///
@@ -169,6 +173,15 @@ public:
   /// @returns A true value if the work item is not empty.
   Value *createCallGetWorkItem(Value *LBPtr, Value *UBPtr);
 
+  /// Create the number of threads the worker threads are spawned with.
+  ///
+  /// This is the number given on the command line or, if none is given, a
+  /// runtime library call to get the maximal number of threads.
+  Value *createNumThreads();
+
+  /// Create a runtime library call to get the number of the calling thread.
+  Value *createCallGetThreadNum();
+
   /// Create a runtime library call to allow cleanup of the thread.
   ///
   /// @note This function is called right before the thread will exit the
@@ -192,7 +205,11 @@ public:
                                Value *Struct, ValueMapT &VMap);
 
   /// Create the definition of the parallel subfunction.
-  Function *createSubFnDefinition();
+  ///
+  /// @param UseKMP Create the microtask signature of the LLVM OpenMP runtime,
+  ///               which takes the thread ids and the loop bounds in front of
+  ///               the struct.
+  Function *createSubFnDefinition(bool UseKMP = false);
 
   /// Create the parallel subfunction.
   ///
@@ -208,6 +225,54 @@ public:
   Value *createSubFn(Value *Stride, AllocaInst *Struct,
                      SetVector<Value *> UsedValues, ValueMapT &VMap,
                      Function **SubFn);
+
+  /// Create the parallel subfunction for the LLVM OpenMP runtime.
+  ///
+  /// The loop bounds and the stride are arguments of the subfunction.
+  ///
+  /// @see createSubFn
+  Value *createSubFnKMP(AllocaInst *Struct, SetVector<Value *> UsedValues,
+                        ValueMapT &VMap, Function **SubFn);
+
+  /// Return the source location passed to the LLVM OpenMP runtime.
+  GlobalVariable *getOrCreateIdentKMP();
+
+  /// Create a call to the LLVM OpenMP runtime to get the global thread id.
+  Value *createCallGlobalThreadNumKMP();
+
+  /// Create a call to the LLVM OpenMP runtime to run @p SubFn in parallel.
+  ///
+  /// The call returns once all threads finished the subfunction.
+  ///
+  /// @param SubFn      The subfunction which holds the loop body.
+  /// @param SubFnParam The struct filled with the outside values.
+  /// @param LB         The lower bound for the loop we parallelize.
+  /// @param UB         The inclusive upper bound of the loop.
+  /// @param Stride     The stride of the loop we parallelize.
+  void createCallForkKMP(Function *SubFn, Value *SubFnParam, Value *LB,
+                         Value *UB, Value *Stride);
+
+  /// Create a call to compute the first block of iterations of a thread.
+  ///
+  /// The block is stored in @p LBPtr and @p UBPtr, the distance to the next
+  /// block of the thread in @p StridePtr.
+  Value *createCallStaticInitKMP(Value *GTid, Value *IsLastPtr, Value *LBPtr,
+                                 Value *UBPtr, Value *StridePtr,
+                                 Value *Stride);
+
+  /// Create a call to end the static scheduling of a thread.
+  void createCallStaticFiniKMP(Value *GTid);
+
+  /// Create a call to set up the dynamic scheduling of the loop.
+  void createCallDispatchInitKMP(Value *GTid, Value *LB, Value *UB,
+                                 Value *Stride);
+
+  /// Create a call to get the next block of iterations of a thread.
+  ///
+  /// @returns A true value if the block is not empty.
+  Value *createCallDispatchNextKMP(Value *GTid, Value *IsLastPtr,
+                                   Value *LBPtr, Value *UBPtr,
+                                   Value *StridePtr);
 };
 } // end namespace polly
 #endif
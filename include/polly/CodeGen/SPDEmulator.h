@@ -0,0 +1,76 @@
+//===- SPDEmulator.h - host emulation of SPD kernels ------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file generates a host function computing the same streams as the SPD
+// kernel printed by SPDPrinter. The CPU backend of the SPD runtime calls it
+// instead of an FPGA, so offloaded code can be tested without hardware.
+//
+// The generated function has the signature
+//   void kernelN_emu(float *InStream, float *OutStream,
+//                    float *BroadcastStream, float *Params,
+//                    int64_t *Domain, int64_t StreamSize)
+// where StreamSize is the number of floats in the stream (see
+// SPDStreamInfo::getAllocSize()), Params holds one 32-bit word per kernel
+// parameter and Domain the start/end/size of each dimension when the attr
+// is generated on the device. The planes of a separate stream follow each
+// other in InStream and OutStream.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef POLLY_SPD_EMULATOR
+#define POLLY_SPD_EMULATOR
+
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include "polly/CodeGen/SPDIR.h"
+
+using namespace llvm;
+
+namespace polly {
+
+class SPDEmulator {
+public:
+  SPDEmulator(SPDIR *I, Module &M);
+
+  Function *getFunction() const { return EmuFunc; }
+
+  // emulates a chain by running the emulators of its stages one after the
+  // other, with the streams in between relaid out on the host
+  static Function *createChainEmulator(SPDChain *C,
+                                       std::vector<Function *> &Stages,
+                                       Module &M);
+
+private:
+  SPDEmulator() = delete;
+  Value *getStreamElement(Value *Stream, Value *Idx, const SPDStreamInfo *SI,
+                          int Offset);
+  Value *emitRead(SPDInstr *I);
+  Value *emitBroadcastRead(SPDInstr *I);
+  Value *emitParam(const SPDParamInfo *PI, Value *Params);
+  Value *emitDomainAttr(Value *Domain);
+  void emitWrite(SPDInstr *I);
+  void emitInstruction(SPDInstr *I);
+  Value *getEmulatedValue(Value *V);
+
+  SPDIR *IR;
+  Function *EmuFunc;
+  IRBuilder<> IRB;
+
+  Value *InStream;
+  Value *OutStream;
+  Value *BroadcastStream;
+  Value *NumElems;
+  Value *Pos;
+  Value *InAttr;
+  Value *InDomain;
+  ValueToValueMapTy ValueMap;
+};
+} // namespace polly
+
+#endif // POLLY_SPD_EMULATOR
@@ -14,11 +14,14 @@
 #ifndef POLLY_SPD_IR_H
 #define POLLY_SPD_IR_H
 
+#include "llvm/ADT/DenseMap.h"
 #include <cstdint>
 #include <vector>
 #include <map>
+#include <string>
 
 namespace llvm {
+class Constant;
 class Instruction;
 class Value;
 class LoopInfo;
@@ -46,30 +49,45 @@ public:
   Instruction *getLLVMInstr() const { return LLVMInstr; }
   MemoryAccess *getMemoryAccess() const;
   int64_t getStreamOffset() const { return StreamOffset; }
+  // value of a read from a constant array, nullptr otherwise
+  Constant *getConstantValue() const { return ConstantValue; }
 // FIXME temporary, meybe not necessary
   const ScopStmt *getStmt() const { return ParentStmt; }
 
 private:
   int64_t StreamOffset;
+  Constant *ConstantValue;
   Instruction *LLVMInstr;
   const ScopStmt *ParentStmt;
   const SPDIR *ParentIR;
 
   SPDInstr() = delete;
   SPDInstr(Instruction *I, const ScopStmt *Stmt, SPDIR *IR,
-           int64_t SO)
-    : StreamOffset(SO), LLVMInstr(I),
+           int64_t SO, Constant *CV = nullptr)
+    : StreamOffset(SO), ConstantValue(CV), LLVMInstr(I),
       ParentStmt(Stmt), ParentIR(IR) {}
 };
 
 class SPDArrayInfo {
 public:
-  SPDArrayInfo(Value *V, int O);
+  // Stream:    one value per stream element, interleaved into the bulk stream
+  // Broadcast: lower rank than the kernel, indexed by the innermost
+  //            dimensions only; sent once and replayed for every row
+  // Constant:  constant table read with constant subscripts; every read is
+  //            folded into a literal of the kernel
+  enum ArrayKind { Stream, Broadcast, Constant };
+
+  SPDArrayInfo(Value *V, int O, ArrayKind K = Stream);
 
   int getOffset() const { return Offset; }
+  ArrayKind getKind() const { return Kind; }
   bool equal(Value *V) const { return V == LLVMValue; }
   int getNumDims() const { return DimSizeList.size(); }
+  uint64_t getNumElements() const;
   Value *getArrayRef() const { return LLVMValue; }
+  // sent run-length encoded, see -polly-spd-compress-arrays
+  bool isCompressed() const { return Compressed; }
+  void setCompressed() { Compressed = true; }
 
   typedef std::vector<std::uint64_t>::const_iterator const_iterator;
   const_iterator begin() const { return DimSizeList.begin(); }
@@ -79,6 +97,8 @@ public:
 
 private:
   int Offset;
+  ArrayKind Kind;
+  bool Compressed;
   Value *LLVMValue;
   std::vector<std::uint64_t> DimSizeList;
 };
@@ -120,20 +140,44 @@ private:
   std::vector<uint64_t> StrideList;
 };
 
+// loop-invariant scalar (argument of the extracted function, load of a
+// scalar global or, with -polly-spd-constant-params, a floating-point
+// literal) held in a kernel register and set by the host before the kernel
+// runs
+class SPDParamInfo {
+public:
+  SPDParamInfo(Value *V, int I) : LLVMValue(V), Index(I) {}
+
+  Value *getValue() const { return LLVMValue; }
+  int getIndex() const { return Index; }
+  std::string getName() const;
+
+private:
+  Value *LLVMValue;
+  int Index;
+};
+
 class SPDStreamInfo {
 public:
-  SPDStreamInfo(uint32_t NumArrays, int NumDims, uint64_t *L);
+  SPDStreamInfo(uint32_t NumArrays, int NumDims, uint64_t *L,
+                bool HasAttr = true, bool Separate = false);
 
+  // number of words per stream element, one per array plus the attr
   uint32_t getStride() const { return Stride; }
+  // every word of the element has its own stream (-polly-spd-layout=separate):
+  // word k of element i is at [k * NumElements + i] instead of
+  // [i * Stride + k], each plane is moved through its own channel
+  bool isSeparate() const { return Separate; }
   int getNumDims() const { return DimSizeList.size(); }
-  uint64_t getAllocSize() const {
+  uint64_t getNumElements() const {
     uint64_t Size = 1;
     for (auto Iter = begin(); Iter != end(); Iter++) {
       Size *= *Iter;
     }
 
-    return Size * getStride();
+    return Size;
   }
+  uint64_t getAllocSize() const { return getNumElements() * getStride(); }
   uint64_t getSize(int i) const { return DimSizeList[i]; }
 
   typedef std::vector<std::uint64_t>::const_iterator const_iterator;
@@ -142,6 +186,7 @@ public:
 
 private:
   uint32_t Stride;
+  bool Separate;
   std::vector<std::uint64_t> DimSizeList;
 };
 
@@ -166,17 +211,49 @@ public:
       delete AI;
     }
 
+    for (SPDArrayInfo *AI : BroadcastAccesses) {
+      delete AI;
+    }
+
+    for (SPDArrayInfo *AI : ConstantAccesses) {
+      delete AI;
+    }
+
+    for (SPDParamInfo *PI : Params) {
+      delete PI;
+    }
+
     delete ReadStream;
     delete WriteStream;
+    delete BroadcastStream;
   }
 
   int getKernelNum() const { return KernelNum; }
+  // module instantiating the kernel: kernelN, UC<k>_kernelN when it is
+  // unrolled and RLE_kernelN when its inputs pass the decoders (see
+  // SPDPrinter)
+  const std::string &getModuleName() const { return ModuleName; }
+  void setModuleName(const std::string &Name) { ModuleName = Name; }
+  // the write predicate is computed on the device from position counters
+  // (-polly-spd-device-attr), the streams carry no attr word
+  bool hasDeviceAttr() const { return DeviceAttr; }
+  // the read and write streams are split into one stream per array
+  // (-polly-spd-layout=separate)
+  bool hasSeparateStreams() const { return ReadStream->isSeparate(); }
+  // some input arrays are sent run-length encoded
+  bool hasCompressedArrays() const;
 
   bool has(Instruction *I) const;
 
   typedef std::vector<SPDInstr *>::const_iterator instr_iterator;
   instr_iterator instr_begin() const { return InstrList.begin(); }
   instr_iterator instr_end() const { return InstrList.end(); }
+  uint64_t getNumInstrs() const { return NumInstrs; }
+  // the instructions refer to the statement of the Scop, which does not
+  // outlive the analysis of the extracted function. They are dropped once the
+  // kernel is printed and emulated, the layout and the number of instructions
+  // are kept for the host code.
+  void releaseInstrs();
 
   typedef std::vector<SPDArrayInfo *>::const_iterator const_iterator;
   const_iterator read_begin() const { return ReadAccesses.begin(); };
@@ -185,34 +262,162 @@ public:
   const_iterator write_begin() const { return WriteAccesses.begin(); };
   const_iterator write_end() const { return WriteAccesses.end(); };
   int getNumWrites() const { return WriteAccesses.size(); }
+  const_iterator broadcast_begin() const { return BroadcastAccesses.begin(); }
+  const_iterator broadcast_end() const { return BroadcastAccesses.end(); }
+  int getNumBroadcasts() const { return BroadcastAccesses.size(); }
+
+  typedef std::vector<SPDParamInfo *>::const_iterator param_iterator;
+  param_iterator param_begin() const { return Params.begin(); }
+  param_iterator param_end() const { return Params.end(); }
+  int getNumParams() const { return Params.size(); }
+  // nullptr if V is not a kernel parameter
+  const SPDParamInfo *getParamInfo(Value *V) const {
+    auto Iter = ParamTable.find(V);
+    return (Iter == ParamTable.end()) ? nullptr : Iter->second;
+  }
 
   SPDStreamInfo *getReadStream() const { return ReadStream; }
   SPDStreamInfo *getWriteStream() const { return WriteStream; }
+  // nullptr if the kernel has no broadcast arrays
+  SPDStreamInfo *getBroadcastStream() const { return BroadcastStream; }
 
-  const SPDArrayInfo *getArrayInfo(Value *V) { return ArrayInfoTable[V]; }
+  const SPDArrayInfo *getArrayInfo(Value *V) const {
+    auto Iter = ArrayInfoTable.find(V);
+    return (Iter == ArrayInfoTable.end()) ? nullptr : Iter->second;
+  }
   SPDDomainInfo *getDomainInfo() const { return DI; }
 
+  // largest distance (in stream elements) between a read and the element
+  // currently computed, i.e. the halo a partial stream has to carry
+  uint64_t getMaxStreamOffset() const { return MaxStreamOffset; }
+
+  // number of columns of a tile of the stream, 0 if the stream is not tiled
+  // (see -polly-spd-tile-width)
+  uint64_t getTileWidth() const { return TileWidth; }
+  // number of columns of the arrays
+  uint64_t getGridWidth() const { return GridWidth; }
+  // largest column distance between a read and the element currently
+  // computed, neighbouring tiles overlap by this number of columns
+  uint64_t getColumnHalo() const { return ColumnHalo; }
+
+  // returns the base address of the only streamed array read by V,
+  // nullptr otherwise. Results are cached, the operand trees of a large
+  // kernel share most of their nodes.
+  Value *getUniqueMemRead(Value *V, const ScopStmt *Stmt) const;
+
+  // number of bits the integer operator I is synthesized with, the width of
+  // its type if its value range is unknown (see SPDRangeAnalysis)
+  unsigned getBitWidth(Instruction *I) const;
+
   void dump() const;
 
 private:
   int KernelNum;
+  std::string ModuleName;
+  bool DeviceAttr;
+  uint64_t NumInstrs;
+  uint64_t MaxStreamOffset;
+  uint64_t TileWidth;
+  uint64_t GridWidth;
+  uint64_t ColumnHalo;
   SPDDomainInfo *DI;
   std::vector<SPDInstr *> InstrList;
+  DenseMap<Instruction *, SPDInstr *> InstrIndex;
+  mutable DenseMap<Value *, Value *> UniqueMemReadCache;
+  DenseMap<Instruction *, unsigned> BitWidths;
   std::vector<SPDArrayInfo *> ReadAccesses;
   std::vector<SPDArrayInfo *> WriteAccesses;
+  std::vector<SPDArrayInfo *> BroadcastAccesses;
+  std::vector<SPDArrayInfo *> ConstantAccesses;
   SPDStreamInfo *ReadStream;
   SPDStreamInfo *WriteStream;
+  SPDStreamInfo *BroadcastStream;
   std::map<Value *, SPDArrayInfo *> ArrayInfoTable;
+  std::vector<SPDParamInfo *> Params;
+  std::map<Value *, SPDParamInfo *> ParamTable;
 
   bool reads(Value *V) const;
   bool writes(Value *V) const;
-  void addReadAccess(const MemoryAccess *MA, int &Offset);
+  SPDArrayInfo::ArrayKind getReadKind(const MemoryAccess *MA) const;
+  void addReadAccess(const MemoryAccess *MA, int &Offset,
+                     int &BroadcastOffset);
   void addWriteAccess(const MemoryAccess *MA, int &Offset);
   void createReadStreamInfo();
   void createWriteStreamInfo();
+  void createBroadcastStreamInfo();
   std::vector<long> getLoopTripCounts(const ScopStmt &Stmt) const;
   void generateWriteDomain(const ScopStmt &Stmt);
+  void tileStreams(const ScopStmt &Stmt);
+  void selectCompressedArrays();
   void removeDeadInstrs();
+  Value *computeUniqueMemRead(Value *V, const ScopStmt *Stmt) const;
+  uint64_t computeMaxStreamOffset() const;
+  void addParam(Value *V);
+  void collectParams();
+  void computeBitWidths(const Scop &S, ScalarEvolution &SE);
+};
+// Kernels of the extracted loops sharing a region number, executed back to
+// back on the device: the Main_Out of a stage feeds the Main_In of the next
+// one. A single kernel is a chain of one stage.
+//
+// The chain reads the input stream of its first stage. Its output stream
+// holds every array written by a stage, taken from the last stage writing it.
+//
+// The stages of earlier extracted functions have released their instructions
+// (see SPDIR::releaseInstrs), the chain only uses their layout.
+class SPDChain {
+public:
+  SPDChain(std::vector<SPDIR *> &S, uint64_t R);
+
+  ~SPDChain() {
+    for (SPDArrayInfo *AI : WriteAccesses) {
+      delete AI;
+    }
+
+    delete WriteStream;
+  }
+
+  uint64_t getRegionNumber() const { return RegionNumber; }
+  int getNumStages() const { return Stages.size(); }
+  SPDIR *getStage(int i) const { return Stages[i]; }
+  SPDIR *getFirstStage() const { return Stages.front(); }
+  bool hasDeviceAttr() const { return getFirstStage()->hasDeviceAttr(); }
+  bool hasSeparateStreams() const {
+    return getFirstStage()->hasSeparateStreams();
+  }
+
+  SPDStreamInfo *getReadStream() const {
+    return getFirstStage()->getReadStream();
+  }
+  SPDStreamInfo *getWriteStream() const { return WriteStream; }
+
+  typedef std::vector<SPDArrayInfo *>::const_iterator const_iterator;
+  const_iterator write_begin() const { return WriteAccesses.begin(); };
+  const_iterator write_end() const { return WriteAccesses.end(); };
+  int getNumWrites() const { return WriteAccesses.size(); }
+  // stage producing the i-th array of the output stream
+  int getWriteStage(int i) const { return WriteStages[i]; }
+
+  // last stage before Stage writing V, -1 if V comes from the input stream
+  int getWriter(Value *V, int Stage) const;
+
+  uint64_t getTileWidth() const { return getFirstStage()->getTileWidth(); }
+  uint64_t getGridWidth() const { return getFirstStage()->getGridWidth(); }
+
+  // the halos of the stages add up
+  uint64_t getMaxStreamOffset() const;
+  uint64_t getColumnHalo() const;
+
+  // false, with a remark, if the device cannot stream the stages back to
+  // back
+  bool verify() const;
+
+private:
+  uint64_t RegionNumber;
+  std::vector<SPDIR *> Stages;
+  std::vector<SPDArrayInfo *> WriteAccesses;
+  std::vector<int> WriteStages;
+  SPDStreamInfo *WriteStream;
 };
 } // end namespace polly
 
@@ -43,20 +43,32 @@ public:
 
 private:
   SPDPrinter() = delete;
-  void emitInParams(uint64_t VL);
+  void emitInParams(uint64_t VL, bool Encoded);
   void emitOutParams(uint64_t VL);
-  void emitModuleDecl(std::string &KernelName, uint64_t VL);
+  void emitBroadcastParams(uint64_t VL);
+  void emitBroadcastArgs(uint64_t VL);
+  void emitRegParams();
+  void emitRegArgs();
+  void emitDomainParams();
+  void emitDomainArgs();
+  void emitDomainAttr(uint64_t VL);
+  void emitModuleDecl(std::string &KernelName, uint64_t VL,
+                      bool Encoded = false);
   void emitConstantInt(ConstantInt *CI);
   void emitConstantFP(ConstantFP *CFP);
+  void emitConstant(Constant *C);
   unsigned getValueNum(Value *V);
   void emitValue(Value *V, uint64_t VL);
   void emitOpcode(unsigned Opcode);
   void emitEQUPrefix();
   void emitHDLPrefix();
+  void emitBroadcastRead(SPDInstr *I, uint64_t VL);
   void emitInstruction(SPDInstr *Instr, uint64_t VL);
   void emitUnrollModule(std::string &UnrolledKernelName,
                         std::string &KernelName,
                         uint64_t VL, uint64_t UC);
+  void emitFrontEndModule(std::string &FrontEndName,
+                          std::string &KernelName, uint64_t VL);
 
   raw_fd_ostream *OS;
   SPDIR *IR;
@@ -67,6 +79,21 @@ private:
   CalcInstrMapTy CalcInstrMap;
   MemInstrMapTy MemInstrMap;
 };
+// emits chainN.spd connecting the kernels of a chain, N is the region number
+class SPDChainPrinter {
+public:
+  SPDChainPrinter(SPDChain *C, uint64_t VL);
+
+private:
+  SPDChainPrinter() = delete;
+  std::string getSignalName(Value *V, int Stage, uint64_t Lane) const;
+  void emitModuleDecl(std::string &ChainName, uint64_t VL);
+  void emitDomainArgs();
+  void emitStage(int Stage, uint64_t VL);
+
+  raw_fd_ostream *OS;
+  SPDChain *Chain;
+};
 } // namespace polly
 
 #endif // POLLY_SPD_PRINTER
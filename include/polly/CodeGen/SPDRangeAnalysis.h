@@ -0,0 +1,56 @@
+//===--- SPDRangeAnalysis.h - Value ranges of SPD kernels -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Value range analysis of the integer instructions of an SPD kernel.
+//
+// Affine values get their range from the statement domain and the context of
+// the Scop, the others from the ranges of their operands. The ranges give the
+// smallest width an integer operator of the kernel can be synthesized with.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef POLLY_SPD_RANGE_ANALYSIS_H
+#define POLLY_SPD_RANGE_ANALYSIS_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/ConstantRange.h"
+
+namespace llvm {
+class ScalarEvolution;
+class Value;
+} // namespace llvm
+
+using namespace llvm;
+
+namespace polly {
+class Scop;
+class ScopStmt;
+
+class SPDRangeAnalysis {
+public:
+  SPDRangeAnalysis(const Scop &S, ScalarEvolution &SE) : S(S), SE(SE) {}
+
+  // range of the integer value V, the full set if nothing is known
+  ConstantRange getRange(Value *V, const ScopStmt *Stmt);
+
+  // number of bits needed to hold every value of R, with a sign bit if R
+  // has negative values
+  static unsigned getBitWidth(const ConstantRange &R);
+
+private:
+  const Scop &S;
+  ScalarEvolution &SE;
+  DenseMap<Value *, ConstantRange> RangeCache;
+
+  ConstantRange computeRange(Value *V, const ScopStmt *Stmt);
+  ConstantRange getAffineRange(Value *V, const ScopStmt *Stmt);
+};
+} // end namespace polly
+
+#endif // POLLY_SPD_RANGE_ANALYSIS_H
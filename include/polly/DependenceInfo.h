@@ -126,6 +126,24 @@ struct Dependences {
                   __isl_take isl_union_map *Deps,
                   __isl_give isl_pw_aff **MinDistancePtr = nullptr) const;
 
+  /// Check if the second innermost dimension of a partial schedule can be
+  /// executed as a doacross loop wrt to @p Deps.
+  ///
+  /// The iterations of a doacross loop run in parallel, but iteration i waits
+  /// before iteration j of the innermost dimension until iteration i - 1
+  /// finished iteration j + Distance. Iteration i - k then finished iteration
+  /// j + k * Distance, which respects the dependences carried by the doacross
+  /// loop whose distance in the innermost dimension is at least -Distance.
+  ///
+  /// @param Schedule The subset of the schedule space that we want to check.
+  /// @param Deps     The dependences @p Schedule needs to respect.
+  /// @param Distance The smallest non-negative distance that respects @p Deps.
+  ///
+  /// @return Returns true, if the distance in the innermost dimension of the
+  ///         dependences carried by the doacross loop is bounded from below.
+  bool isDoacross(__isl_keep isl_union_map *Schedule,
+                  __isl_take isl_union_map *Deps, long *Distance) const;
+
   /// Check if a new schedule is valid.
   ///
   /// @param S             The current SCoP.
@@ -20,8 +20,10 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/PassManager.h"
 #include <map>
+#include <vector>
 
 namespace llvm {
+class CallInst;
 class Instruction;
 class Function;
 } // namespace llvm
@@ -31,6 +33,19 @@ using namespace llvm;
 namespace polly {
 class Scop;
 class ScopInfo;
+class SPDIR;
+
+// extracted loop waiting for the other kernels of its region
+struct SPDKernel {
+  SPDIR *IR;
+  CallInst *Caller;
+  uint64_t VectorLength;
+  uint64_t SwitchInOut;
+  Function *Emulator;
+};
+
+// region numbers are local to the function calling the kernels
+typedef std::pair<Function *, uint64_t> SPDRegion;
 
 struct HostCodeGeneration : public FunctionPass {
   static char ID;
@@ -39,14 +54,24 @@ struct HostCodeGeneration : public FunctionPass {
 
   bool doInitialization(Module &M) override;
   bool runOnFunction(Function &F) override;
+  bool doFinalization(Module &M) override;
   void getAnalysisUsage(AnalysisUsage &AU) const override;
 
 private:
-  std::map<uint64_t, Instruction *> RegionBeginMap;
-  std::map<uint64_t, Instruction *> RegionEndMap;
+  std::map<SPDRegion, Instruction *> RegionBeginMap;
+  std::map<SPDRegion, Instruction *> RegionEndMap;
+  // number of kernel calls of a region, computed by LoopExtraction
+  std::map<SPDRegion, CallInst *> RegionNumCallsMap;
+  // extracted loops sharing a region number are chained on the device
+  std::map<SPDRegion, unsigned> RegionKernelCount;
+  std::map<SPDRegion, std::vector<SPDKernel>> PendingKernels;
 
   uint64_t getRegionNumber(Instruction *Instr) const;
   const Scop *getScopFromInstr(Instruction *Instr, ScopInfo *SI) const;
+  // without InRegion the kernel streams its arrays around its own call
+  // instead of between the region begin and end
+  void createHostCode(uint64_t RegionNumber, std::vector<SPDKernel> &Kernels,
+                      bool InRegion = true);
 };
 } // end namespace polly
 
@@ -17,6 +17,8 @@
 #define POLLY_LOOP_EXTRACTION_H
 
 #include "llvm/Analysis/LoopPass.h"
+#include <string>
+#include <vector>
 
 namespace llvm {
 class Loop;
@@ -25,6 +27,31 @@ class Loop;
 using namespace llvm;
 
 namespace polly {
+// Offload parameters of a loop. They are given by the llvm.loop metadata of
+// the loop,
+//   !{!"spd.offload.region", i64 R}
+//   !{!"spd.offload.vector_length", i64 VL}
+//   !{!"spd.offload.unroll_count", i64 UC}
+//   !{!"spd.offload.switch_inout", i64 S}
+// (all but the region are optional), which a front end pragma or
+// -polly-spd-loops-file attaches, or by a __spd_loop(R, VL, UC, S) call at the
+// beginning of the loop header.
+struct SPDLoopDirective {
+  uint64_t RegionNumber = 0;
+  uint64_t VectorLength = 1;
+  uint64_t UnrollCount = 1;
+  uint64_t SwitchInOut = 0;
+};
+
+// loop of -polly-spd-loops-file, selected by the name of its header block
+// and/or the line it starts at
+struct SPDLoopFileEntry {
+  std::string Function;
+  std::string Header;
+  unsigned Line = 0;
+  SPDLoopDirective Directive;
+};
+
 struct LoopExtraction : public LoopPass {
   static char ID;
   unsigned NumLoops;
@@ -32,8 +59,16 @@ struct LoopExtraction : public LoopPass {
   LoopExtraction(unsigned N = ~0)
     : LoopPass(ID), NumLoops(N) {}
 
+  bool doInitialization(Loop *L, LPPassManager &LPM) override;
   bool runOnLoop(Loop *L, LPPassManager &) override;
   void getAnalysisUsage(AnalysisUsage &AU) const override;
+
+private:
+  bool LoopsFileLoaded = false;
+  std::vector<SPDLoopFileEntry> LoopsFile;
+
+  void loadLoopsFile();
+  void applyLoopsFile(Loop *L);
 };
 } // end namespace polly
 
@@ -43,20 +43,34 @@ struct MacroKernelParamsTy {
 };
 
 namespace polly {
+/// Parameters of a cache level.
+///
+/// Parameters, which determine the tile sizes of the cache model. A level
+/// with a size of zero is unknown.
+///
+struct CacheLevelTy {
+  int Size = 0;
+  int Associativity = 0;
+  int LineSize = 0;
+};
+
 /// Additional parameters of the schedule optimizer.
 ///
-/// Target Transform Info and the SCoP dependencies used by the schedule
-/// optimizer.
+/// Target Transform Info, the SCoP dependencies and the first two cache
+/// levels of the target used by the schedule optimizer.
 ///
 struct OptimizerAdditionalInfoTy {
   const llvm::TargetTransformInfo *TTI;
   const Dependences *D;
+  CacheLevelTy L1;
+  CacheLevelTy L2;
 };
 
 /// Parameters of the matrix multiplication operands.
 ///
 /// Parameters, which describe access relations that represent operands of the
-/// matrix multiplication.
+/// matrix multiplication. In case of a tensor contraction, i, j and k are the
+/// loop dimensions that form the matrix multiplication kernel.
 ///
 struct MatMulInfoTy {
   MemoryAccess *A = nullptr;
@@ -279,6 +293,42 @@ private:
   static isl_schedule_node *standardBandOpts(__isl_take isl_schedule_node *Node,
                                              void *User);
 
+  /// Prevectorize the innermost coincident member of the band @p Node.
+  ///
+  /// @param Node The band to prevectorize, if vectorization is enabled.
+  static __isl_give isl_schedule_node *
+  prevectInnermostCoincident(__isl_take isl_schedule_node *Node);
+
+  /// Check if this node is the band of an iterative stencil.
+  ///
+  /// The outermost member of the band is the time loop, which carries
+  /// dependences with a non-zero distance along the second member, the
+  /// outermost spatial loop. Within the band, the dependence distances of
+  /// each time step along this spatial loop are bounded by a slope, such that
+  /// the band can be tiled with diamonds.
+  ///
+  /// @param Node The band node to check.
+  /// @param D    The SCoP dependencies.
+  /// @return     The smallest slope of the diamond faces, in spatial
+  ///             iterations per time step, or 0 if this is not a stencil band.
+  static int getDiamondTilingSlope(__isl_keep isl_schedule_node *Node,
+                                   const polly::Dependences *D);
+
+  /// Tile an iterative stencil with diamonds.
+  ///
+  /// The time loop and the outermost spatial loop are skewed to the two faces
+  /// of the diamonds and tiled along them, the other spatial loops are tiled
+  /// rectangularly. The tiles are executed in wavefronts, where each
+  /// wavefront is a parallel loop and the diamonds of the first time steps
+  /// start concurrently. Each tile executes several time steps on a block of
+  /// data, which stays in the cache.
+  ///
+  /// @param Node  The band node that passed getDiamondTilingSlope.
+  /// @param Slope The slope of the diamond faces.
+  /// @returns     The transformed schedule.
+  static __isl_give isl_schedule_node *
+  applyDiamondTiling(__isl_take isl_schedule_node *Node, int Slope);
+
   /// Check if this node contains a partial schedule that could
   ///        probably be optimized with analytical modeling.
   ///
@@ -296,6 +346,11 @@ private:
   /// If this is the case, we could try to use an approach that is similar to
   /// the one used to get close-to-peak performance of matrix multiplications.
   ///
+  /// With -polly-pattern-matching-based-tensor-contractions, tensor
+  /// contractions, which, in particular, include batched and transposed
+  /// matrix multiplications, are also accepted and mapped onto the same
+  /// kernel.
+  ///
   /// @param Node The node to check.
   /// @param D    The SCoP dependencies.
   /// @param MMI  Parameters of the matrix multiplication operands.
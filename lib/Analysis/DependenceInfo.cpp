@@ -29,12 +29,15 @@
 #include <isl/aff.h>
 #include <isl/ctx.h>
 #include <isl/flow.h>
+#include <isl/ilp.h>
+#include <isl/local_space.h>
 #include <isl/map.h>
 #include <isl/options.h>
 #include <isl/schedule.h>
 #include <isl/set.h>
 #include <isl/union_map.h>
 #include <isl/union_set.h>
+#include <isl/val.h>
 
 using namespace polly;
 using namespace llvm;
@@ -835,6 +838,59 @@ bool Dependences::isParallel(isl_union_map *Schedule, isl_union_map *Deps,
   return false;
 }
 
+bool Dependences::isDoacross(isl_union_map *Schedule, isl_union_map *Deps,
+                             long *Distance) const {
+  isl_set *Deltas, *Carried;
+  isl_map *ScheduleDeps;
+  unsigned Dimension;
+
+  Deps = isl_union_map_apply_range(Deps, isl_union_map_copy(Schedule));
+  Deps = isl_union_map_apply_domain(Deps, isl_union_map_copy(Schedule));
+
+  *Distance = 0;
+  if (isl_union_map_is_empty(Deps)) {
+    isl_union_map_free(Deps);
+    return true;
+  }
+
+  ScheduleDeps = isl_map_from_union_map(Deps);
+  if (isl_map_dim(ScheduleDeps, isl_dim_out) < 2) {
+    isl_map_free(ScheduleDeps);
+    return false;
+  }
+  Dimension = isl_map_dim(ScheduleDeps, isl_dim_out) - 2;
+
+  for (unsigned i = 0; i < Dimension; i++)
+    ScheduleDeps = isl_map_equate(ScheduleDeps, isl_dim_out, i, isl_dim_in, i);
+
+  // [0, ..., 0, +, *] - The dependences carried by the doacross loop
+  Deltas = isl_map_deltas(ScheduleDeps);
+  Carried = isl_set_lower_bound_si(Deltas, isl_dim_set, Dimension, 1);
+  Carried = isl_set_project_out(Carried, isl_dim_set, 0, Dimension + 1);
+
+  if (isl_set_is_empty(Carried)) {
+    isl_set_free(Carried);
+    return true;
+  }
+
+  // Iteration j of the innermost dimension depends on iteration j - d of an
+  // earlier iteration of the doacross loop, where d is the inner distance.
+  // The wait thus needs to cover the largest negated inner distance, while
+  // dependences with a large positive inner distance are satisfied anyway.
+  isl_aff *Inner = isl_aff_var_on_domain(
+      isl_local_space_from_space(isl_set_get_space(Carried)), isl_dim_set, 0);
+  Inner = isl_aff_neg(Inner);
+  isl_val *MaxDistance = isl_set_max_val(Carried, Inner);
+  isl_aff_free(Inner);
+  isl_set_free(Carried);
+
+  bool IsBounded = isl_val_is_int(MaxDistance);
+  if (IsBounded)
+    *Distance = std::max(0l, isl_val_get_num_si(MaxDistance));
+  isl_val_free(MaxDistance);
+  return IsBounded;
+}
+
 static void printDependencyMap(raw_ostream &OS, __isl_keep isl_union_map *DM) {
   if (DM)
     OS << DM << "\n";
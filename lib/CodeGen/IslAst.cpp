@@ -57,6 +57,34 @@ static cl::opt<bool>
                   cl::desc("Generate thread parallel code (isl codegen only)"),
                   cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
 
+unsigned polly::PollyParallelMinWork;
+static cl::opt<unsigned, true> XPollyParallelMinWork(
+    "polly-parallel-min-work",
+    cl::desc("The minimal number of iterations of a parallel loop nest, "
+             "checked at run time, to execute it thread parallel "
+             "(0 = always parallel)"),
+    cl::location(PollyParallelMinWork), cl::init(0), cl::ZeroOrMore,
+    cl::cat(PollyCategory));
+
+static cl::opt<bool> PollyParallelReductions(
+    "polly-parallel-reductions",
+    cl::desc("Generate thread parallel code for loops that break reductions, "
+             "using thread private partial results"),
+    cl::Hidden, cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<unsigned> PollyParallelCollapse(
+    "polly-parallel-collapse",
+    cl::desc("The maximal number of perfectly nested parallel loops collapsed "
+             "into one thread parallel loop"),
+    cl::Hidden, cl::init(1), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<bool> PollyParallelDoacross(
+    "polly-parallel-doacross",
+    cl::desc("Generate thread parallel code for loops with dependences of a "
+             "bounded distance in the loop nested in them, synchronizing "
+             "consecutive iterations"),
+    cl::Hidden, cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
 static cl::opt<bool> PrintAccesses("polly-ast-print-accesses",
                                    cl::desc("Print memory access functions"),
                                    cl::init(false), cl::ZeroOrMore,
@@ -83,7 +111,9 @@ namespace polly {
 struct AstBuildUserInfo {
   /// Construct and initialize the helper struct for AST creation.
   AstBuildUserInfo()
-      : Deps(nullptr), InParallelFor(false), LastForNodeId(nullptr) {}
+      : Deps(nullptr), InParallelFor(false), LastForNodeId(nullptr),
+        CollapseForNodeId(nullptr), NumCollapsedLoops(0),
+        DoacrossForNodeId(nullptr), DoacrossPayload(nullptr) {}
 
   /// The dependence information used for the parallelism check.
   const Dependences *Deps;
@@ -93,6 +123,20 @@ struct AstBuildUserInfo {
 
   /// The last iterator id created for the current SCoP.
   isl_id *LastForNodeId;
+
+  /// The iterator id of the innermost loop collapsed into the surrounding
+  /// thread parallel loop, or the parallel loop itself.
+  isl_id *CollapseForNodeId;
+
+  /// The number of loops collapsed into the thread parallel loop, including
+  /// the parallel loop itself.
+  unsigned NumCollapsedLoops;
+
+  /// The iterator id and the payload of the last loop that is not parallel
+  /// and may be executed as a doacross loop, depending on the loop nested in
+  /// it.
+  isl_id *DoacrossForNodeId;
+  IslAstUserPayload *DoacrossPayload;
 };
 } // namespace polly
 
@@ -104,6 +148,7 @@ static void freeIslAstUserPayload(void *Ptr) {
 IslAstInfo::IslAstUserPayload::~IslAstUserPayload() {
   isl_ast_build_free(Build);
   isl_pw_aff_free(MinimalDependenceDistance);
+  isl_union_map_free(ReductionLocations);
 }
 
 /// Print a string @p str in a single line using @p Printer.
@@ -163,15 +208,101 @@ static isl_printer *cbPrintFor(__isl_take isl_printer *Printer,
   if (IslAstInfo::isInnermostParallel(Node))
     Printer = printLine(Printer, SimdPragmaStr + BrokenReductionsStr);
 
-  if (IslAstInfo::isExecutedInParallel(Node))
-    Printer = printLine(Printer, OmpPragmaStr);
-  else if (IslAstInfo::isOutermostParallel(Node))
+  if (IslAstInfo::isExecutedInParallel(Node)) {
+    unsigned NumLoops = IslAstInfo::getNumCollapsedLoops(Node);
+    std::string CollapseStr =
+        NumLoops > 1 ? " collapse(" + std::to_string(NumLoops) + ")" : "";
+    if (IslAstInfo::isDoacross(Node))
+      CollapseStr = " ordered(2) depend(sink: -1, +" +
+                    std::to_string(IslAstInfo::getDoacrossDistance(Node)) +
+                    ")";
+    Printer =
+        printLine(Printer, OmpPragmaStr + CollapseStr + BrokenReductionsStr);
+  } else if (IslAstInfo::isOutermostParallel(Node))
     Printer = printLine(Printer, KnownParallelStr + BrokenReductionsStr);
 
   isl_pw_aff_free(DD);
   return isl_ast_node_for_print(Node, Printer, Options);
 }
 
+/// Compute the array elements the broken reductions of a loop accumulate into.
+///
+/// @p Schedule maps the statements executed in the loop to the schedule at the
+/// loop, whose innermost dimension is the loop itself. The result maps this
+/// schedule space, where the loop dimension is left unconstrained, to the
+/// element of each reduction array. If an array is accessed at more than one
+/// element during the execution of the loop, or by accesses that are not
+/// reductions of the same kind, the reductions cannot be privatized and a
+/// nullptr is returned.
+static __isl_give isl_union_map *
+computeReductionLocations(__isl_keep isl_union_map *Schedule,
+                          const IslAstInfo::MemoryAccessSet &Reductions) {
+  SmallDenseMap<const ScopArrayInfo *, MemoryAccess::ReductionType, 4> Arrays;
+  for (MemoryAccess *MA : Reductions)
+    Arrays[MA->getLatestScopArrayInfo()] = MA->getReductionType();
+
+  const Scop *S = (*Reductions.begin())->getStatement()->getParent();
+  isl_union_map *Locations =
+      isl_union_map_empty(isl_union_map_get_space(Schedule));
+  isl_space *ScheduleSpace = nullptr;
+  bool Privatizable = true;
+
+  for (const ScopStmt &Stmt : *S) {
+    isl_union_map *StmtSchedule = isl_union_map_intersect_domain(
+        isl_union_map_copy(Schedule),
+        isl_union_set_from_set(Stmt.getDomain()));
+    if (isl_union_map_is_empty(StmtSchedule)) {
+      isl_union_map_free(StmtSchedule);
+      continue;
+    }
+
+    isl_map *StmtMap = isl_map_from_union_map(StmtSchedule);
+    unsigned LoopDim = isl_map_dim(StmtMap, isl_dim_out) - 1;
+    if (!ScheduleSpace)
+      ScheduleSpace = isl_space_range(isl_map_get_space(StmtMap));
+
+    for (MemoryAccess *MA : Stmt) {
+      auto It = Arrays.find(MA->getLatestScopArrayInfo());
+      if (It == Arrays.end())
+        continue;
+
+      if (!MA->isLatestArrayKind() || MA->getReductionType() != It->second) {
+        Privatizable = false;
+        break;
+      }
+
+      isl_map *Location =
+          isl_map_apply_range(isl_map_reverse(isl_map_copy(StmtMap)),
+                              MA->getLatestAccessRelation());
+      Location = isl_map_project_out(Location, isl_dim_in, LoopDim, 1);
+      Location = isl_map_add_dims(Location, isl_dim_in, 1);
+      Locations = isl_union_map_add_map(Locations, Location);
+    }
+    isl_map_free(StmtMap);
+
+    if (!Privatizable)
+      break;
+  }
+
+  for (auto &Array : Arrays) {
+    if (!Privatizable)
+      break;
+
+    isl_space *Space = isl_space_map_from_domain_and_range(
+        isl_space_copy(ScheduleSpace), Array.first->getSpace());
+    isl_map *Location = isl_union_map_extract_map(Locations, Space);
+    Privatizable = isl_map_is_single_valued(Location) == isl_bool_true;
+    isl_map_free(Location);
+  }
+
+  isl_space_free(ScheduleSpace);
+  if (Privatizable)
+    return Locations;
+
+  isl_union_map_free(Locations);
+  return nullptr;
+}
+
 /// Check if the current scheduling dimension is parallel.
 ///
 /// In case the dimension is parallel we also check if any reduction
@@ -213,6 +344,11 @@ static bool astScheduleDimIsParallel(__isl_keep isl_ast_build *Build,
       NodeInfo->BrokenReductions.insert(MaRedPair.first);
   }
 
+  if (PollyParallel && PollyParallelReductions &&
+      !NodeInfo->BrokenReductions.empty())
+    NodeInfo->ReductionLocations =
+        computeReductionLocations(Schedule, NodeInfo->BrokenReductions);
+
   isl_union_map_free(Schedule);
   return true;
 }
@@ -230,16 +366,87 @@ static __isl_give isl_id *astBuildBeforeFor(__isl_keep isl_ast_build *Build,
   IslAstUserPayload *Payload = new IslAstUserPayload();
   isl_id *Id = isl_id_alloc(isl_ast_build_get_ctx(Build), "", Payload);
   Id = isl_id_set_free_user(Id, freeIslAstUserPayload);
+  isl_id *ParentId = BuildInfo->LastForNodeId;
   BuildInfo->LastForNodeId = Id;
 
+  // The loop nested in a doacross candidate determines whether the dependences
+  // carried by the candidate can be kept by synchronizing its iterations.
+  if (!BuildInfo->InParallelFor && ParentId &&
+      ParentId == BuildInfo->DoacrossForNodeId) {
+    isl_union_map *Schedule = isl_ast_build_get_schedule(Build);
+    isl_union_map *Deps = BuildInfo->Deps->getDependences(
+        Dependences::TYPE_RAW | Dependences::TYPE_WAW | Dependences::TYPE_WAR |
+        Dependences::TYPE_RED);
+    IslAstUserPayload *Doacross = BuildInfo->DoacrossPayload;
+    Doacross->IsDoacross = BuildInfo->Deps->isDoacross(
+        Schedule, Deps, &Doacross->DoacrossDistance);
+    BuildInfo->InParallelFor = Doacross->IsDoacross;
+    isl_union_map_free(Schedule);
+  }
+
   // Test for parallelism only if we are not already inside a parallel loop
-  if (!BuildInfo->InParallelFor)
+  if (!BuildInfo->InParallelFor) {
     BuildInfo->InParallelFor = Payload->IsOutermostParallel =
         astScheduleDimIsParallel(Build, BuildInfo->Deps, Payload);
+    if (Payload->IsOutermostParallel) {
+      BuildInfo->CollapseForNodeId = Id;
+      BuildInfo->NumCollapsedLoops = 1;
+    } else if (PollyParallel && PollyParallelDoacross &&
+               BuildInfo->Deps->hasValidDependences()) {
+      BuildInfo->DoacrossForNodeId = Id;
+      BuildInfo->DoacrossPayload = Payload;
+    }
+  } else if (ParentId && ParentId == BuildInfo->CollapseForNodeId &&
+             BuildInfo->NumCollapsedLoops < PollyParallelCollapse) {
+    // The first loop nested in the last collapsed loop is collapsed as well if
+    // it is parallel. Parallel execution of the collapsed iteration space must
+    // not break reductions the surrounding thread parallel loop keeps intact.
+    Payload->IsCollapsed =
+        astScheduleDimIsParallel(Build, BuildInfo->Deps, Payload) &&
+        !Payload->IsReductionParallel;
+    if (Payload->IsCollapsed) {
+      BuildInfo->CollapseForNodeId = Id;
+      BuildInfo->NumCollapsedLoops++;
+    }
+  }
 
   return Id;
 }
 
+/// Test the outermost loops in @p Body for parallelism.
+///
+/// The loops nested in a doacross candidate are not tested while the candidate
+/// is assumed to run as doacross loop. If the candidate turns out not to be
+/// one, the outermost parallel loops in its body are detected here, using the
+/// build environment stored in their payload.
+static void detectParallelLoopsIn(__isl_keep isl_ast_node *Body,
+                                  const Dependences *D) {
+  isl_ast_node_foreach_descendant_top_down(
+      Body,
+      [](isl_ast_node *Node, void *User) -> isl_bool {
+        if (isl_ast_node_get_type(Node) != isl_ast_node_for)
+          return isl_bool_true;
+
+        auto *D = static_cast<const Dependences *>(User);
+        IslAstUserPayload *Payload = IslAstInfo::getNodePayload(Node);
+        if (Payload->IsInnermost && Payload->IsInnermostParallel) {
+          Payload->IsOutermostParallel = true;
+          return isl_bool_false;
+        }
+
+        Payload->MinimalDependenceDistance =
+            isl_pw_aff_free(Payload->MinimalDependenceDistance);
+        Payload->ReductionLocations =
+            isl_union_map_free(Payload->ReductionLocations);
+        Payload->IsOutermostParallel =
+            astScheduleDimIsParallel(Payload->Build, D, Payload);
+        if (Payload->IsOutermostParallel && Payload->IsInnermost)
+          Payload->IsInnermostParallel = true;
+        return Payload->IsOutermostParallel ? isl_bool_false : isl_bool_true;
+      },
+      const_cast<Dependences *>(D));
+}
+
 // This method is executed after the construction of a for node.
 //
 // It performs the following actions:
@@ -264,7 +471,7 @@ astBuildAfterFor(__isl_take isl_ast_node *Node, __isl_keep isl_ast_build *Build,
   // tested for parallelism. Test them here to ensure we check all innermost
   // loops for parallelism.
   if (Payload->IsInnermost && BuildInfo->InParallelFor) {
-    if (Payload->IsOutermostParallel) {
+    if (Payload->IsOutermostParallel || Payload->IsCollapsed) {
       Payload->IsInnermostParallel = true;
     } else {
       if (PollyVectorizerChoice == VECTORIZER_NONE)
@@ -272,8 +479,27 @@ astBuildAfterFor(__isl_take isl_ast_node *Node, __isl_keep isl_ast_build *Build,
             astScheduleDimIsParallel(Build, BuildInfo->Deps, Payload);
     }
   }
-  if (Payload->IsOutermostParallel)
+  if (Payload->IsOutermostParallel) {
     BuildInfo->InParallelFor = false;
+    BuildInfo->CollapseForNodeId = nullptr;
+    BuildInfo->NumCollapsedLoops = 0;
+  }
+
+  // The synchronization of a doacross loop is generated in the loop nested in
+  // it, which needs to be its body. Otherwise, the loops in the body that
+  // were skipped by the parallelism detection are tested now.
+  if (Payload->IsDoacross) {
+    BuildInfo->InParallelFor = false;
+    isl_ast_node *Body = isl_ast_node_for_get_body(Node);
+    Payload->IsDoacross = isl_ast_node_get_type(Body) == isl_ast_node_for;
+    if (!Payload->IsDoacross)
+      detectParallelLoopsIn(Body, BuildInfo->Deps);
+    isl_ast_node_free(Body);
+  }
+  if (Id == BuildInfo->DoacrossForNodeId) {
+    BuildInfo->DoacrossForNodeId = nullptr;
+    BuildInfo->DoacrossPayload = nullptr;
+  }
 
   isl_id_free(Id);
   return Node;
@@ -511,6 +737,35 @@ bool IslAstInfo::isOutermostParallel(__isl_keep isl_ast_node *Node) {
   return Payload && Payload->IsOutermostParallel;
 }
 
+bool IslAstInfo::isDoacross(__isl_keep isl_ast_node *Node) {
+  IslAstUserPayload *Payload = getNodePayload(Node);
+  return Payload && Payload->IsDoacross;
+}
+
+long IslAstInfo::getDoacrossDistance(__isl_keep isl_ast_node *Node) {
+  IslAstUserPayload *Payload = getNodePayload(Node);
+  return Payload ? Payload->DoacrossDistance : 0;
+}
+
+bool IslAstInfo::isCollapsed(__isl_keep isl_ast_node *Node) {
+  IslAstUserPayload *Payload = getNodePayload(Node);
+  return Payload && Payload->IsCollapsed;
+}
+
+unsigned IslAstInfo::getNumCollapsedLoops(__isl_keep isl_ast_node *Node) {
+  unsigned NumLoops = 1;
+  isl_ast_node *Body = isl_ast_node_for_get_body(Node);
+  while (isl_ast_node_get_type(Body) == isl_ast_node_for &&
+         isCollapsed(Body)) {
+    NumLoops++;
+    isl_ast_node *Child = isl_ast_node_for_get_body(Body);
+    isl_ast_node_free(Body);
+    Body = Child;
+  }
+  isl_ast_node_free(Body);
+  return NumLoops;
+}
+
 bool IslAstInfo::isReductionParallel(__isl_keep isl_ast_node *Node) {
   IslAstUserPayload *Payload = getNodePayload(Node);
   return Payload && Payload->IsReductionParallel;
@@ -524,16 +779,19 @@ bool IslAstInfo::isExecutedInParallel(__isl_keep isl_ast_node *Node) {
   // Do not parallelize innermost loops.
   //
   // Parallelizing innermost loops is often not profitable, especially if
-  // they have a low number of iterations.
-  //
-  // TODO: Decide this based on the number of loop iterations that will be
-  //       executed. This can possibly require run-time checks, which again
-  //       raises the question of both run-time check overhead and code size
-  //       costs.
-  if (!PollyParallelForce && isInnermost(Node))
+  // they have a low number of iterations. With a minimal amount of work
+  // checked at run time, the code generation falls back to the sequential
+  // loop for low iteration counts instead.
+  if (!PollyParallelForce && PollyParallelMinWork == 0 && isInnermost(Node))
     return false;
 
-  return isOutermostParallel(Node) && !isReductionParallel(Node);
+  if (!isOutermostParallel(Node) && !isDoacross(Node))
+    return false;
+
+  // Loops that break reductions are run in parallel if every thread can
+  // accumulate into a private copy of the reduction arrays.
+  return !isReductionParallel(Node) ||
+         getNodePayload(Node)->ReductionLocations != nullptr;
 }
 
 __isl_give isl_union_map *
@@ -555,6 +813,12 @@ IslAstInfo::getBrokenReductions(__isl_keep isl_ast_node *Node) {
   return Payload ? &Payload->BrokenReductions : nullptr;
 }
 
+__isl_give isl_union_map *
+IslAstInfo::getReductionLocations(__isl_keep isl_ast_node *Node) {
+  IslAstUserPayload *Payload = getNodePayload(Node);
+  return Payload ? isl_union_map_copy(Payload->ReductionLocations) : nullptr;
+}
+
 isl_ast_build *IslAstInfo::getBuild(__isl_keep isl_ast_node *Node) {
   IslAstUserPayload *Payload = getNodePayload(Node);
   return Payload ? Payload->Build : nullptr;
@@ -32,6 +32,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Support/CommandLine.h"
@@ -78,6 +79,13 @@ static cl::opt<int> PollyTargetFirstLevelCacheLineSize(
     cl::desc("The size of the first level cache line size specified in bytes."),
     cl::Hidden, cl::init(64), cl::ZeroOrMore, cl::cat(PollyCategory));
 
+static cl::opt<bool> PollyScratchBuffers(
+    "polly-scratch-buffers",
+    cl::desc("Allocate the arrays created by Polly as per-thread scratch "
+             "buffers of the ScratchRuntime, which are reused by later "
+             "executions of the SCoP"),
+    cl::Hidden, cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
 __isl_give isl_ast_expr *
 IslNodeBuilder::getUpperBound(__isl_keep isl_ast_node *For,
                               ICmpInst::Predicate &Predicate) {
@@ -222,7 +230,7 @@ isl_stat addReferencesFromStmt(const ScopStmt *Stmt, void *UserPtr,
 
   if (Stmt->isBlockStmt())
     findReferencesInBlock(References, Stmt, Stmt->getBasicBlock());
-  else {
+  else if (!Stmt->isCopyStmt()) {
     assert(Stmt->isRegionStmt() &&
            "Stmt was neither block nor region statement");
     for (const BasicBlock *BB : Stmt->getRegion()->blocks())
@@ -231,12 +239,21 @@ isl_stat addReferencesFromStmt(const ScopStmt *Stmt, void *UserPtr,
 
   for (auto &Access : *Stmt) {
     if (Access->isArrayKind()) {
-      auto *BasePtr = Access->getScopArrayInfo()->getBasePtr();
-      if (Instruction *OpInst = dyn_cast<Instruction>(BasePtr))
-        if (Stmt->getParent()->contains(OpInst))
-          continue;
-
-      References.Values.insert(BasePtr);
+      // Accesses redirected to a new array, e.g., to the packed arrays of the
+      // matrix multiplication, also need its base pointer. Accesses of copy
+      // statements only have a new access relation.
+      SmallVector<const ScopArrayInfo *, 2> Arrays;
+      if (!Stmt->isCopyStmt())
+        Arrays.push_back(Access->getScopArrayInfo());
+      Arrays.push_back(Access->getLatestScopArrayInfo());
+      for (const ScopArrayInfo *SAI : Arrays) {
+        auto *BasePtr = SAI->getBasePtr();
+        if (Instruction *OpInst = dyn_cast<Instruction>(BasePtr))
+          if (Stmt->getParent()->contains(OpInst))
+            continue;
+
+        References.Values.insert(BasePtr);
+      }
       continue;
     }
 
@@ -466,7 +483,8 @@ void IslNodeBuilder::createForVector(__isl_take isl_ast_node *For,
 }
 
 void IslNodeBuilder::createForSequential(__isl_take isl_ast_node *For,
-                                         bool KnownParallel) {
+                                         bool KnownParallel,
+                                         const DoacrossSync *Sync) {
   isl_ast_node *Body;
   isl_ast_expr *Init, *Inc, *Iterator, *UB;
   isl_id *IteratorID;
@@ -518,8 +536,18 @@ void IslNodeBuilder::createForSequential(__isl_take isl_ast_node *For,
                   Predicate, &Annotator, Parallel, UseGuardBB);
   IDToValue[IteratorID] = IV;
 
+  Type *Int64Ty = Builder.getInt64Ty();
+  if (Sync)
+    createDoacrossWait(
+        Sync->Wait,
+        Builder.CreateAdd(Builder.CreateSExtOrTrunc(IV, Int64Ty),
+                          ConstantInt::get(Int64Ty, Sync->Distance)));
+
   create(Body);
 
+  if (Sync)
+    createDoacrossPost(Sync->Post, Builder.CreateSExtOrTrunc(IV, Int64Ty));
+
   Annotator.popLoop(Parallel);
 
   IDToValue.erase(IDToValue.find(IteratorID));
@@ -575,6 +603,297 @@ static void removeSubFuncFromDomTree(Function *F, DominatorTree &DT) {
     DT.eraseNode(BB);
 }
 
+/// Return the identity of the reduction @p RT on values of type @p Ty.
+static Constant *getReductionIdentity(MemoryAccess::ReductionType RT,
+                                      Type *Ty) {
+  switch (RT) {
+  case MemoryAccess::RT_ADD:
+  case MemoryAccess::RT_BOR:
+  case MemoryAccess::RT_BXOR:
+    return Constant::getNullValue(Ty);
+  case MemoryAccess::RT_MUL:
+    if (Ty->isFloatingPointTy())
+      return ConstantFP::get(Ty, 1.0);
+    return ConstantInt::get(Ty, 1);
+  case MemoryAccess::RT_BAND:
+    return Constant::getAllOnesValue(Ty);
+  case MemoryAccess::RT_NONE:
+    break;
+  }
+  llvm_unreachable("Requested the identity of a non-reduction");
+}
+
+/// Create the reduction @p RT of @p LHS and @p RHS.
+static Value *createReductionOp(PollyIRBuilder &Builder,
+                                MemoryAccess::ReductionType RT, Value *LHS,
+                                Value *RHS) {
+  bool IsFP = LHS->getType()->isFloatingPointTy();
+  switch (RT) {
+  case MemoryAccess::RT_ADD:
+    return IsFP ? Builder.CreateFAdd(LHS, RHS, "polly.red.add")
+                : Builder.CreateAdd(LHS, RHS, "polly.red.add");
+  case MemoryAccess::RT_MUL:
+    return IsFP ? Builder.CreateFMul(LHS, RHS, "polly.red.mul")
+                : Builder.CreateMul(LHS, RHS, "polly.red.mul");
+  case MemoryAccess::RT_BOR:
+    return Builder.CreateOr(LHS, RHS, "polly.red.or");
+  case MemoryAccess::RT_BXOR:
+    return Builder.CreateXor(LHS, RHS, "polly.red.xor");
+  case MemoryAccess::RT_BAND:
+    return Builder.CreateAnd(LHS, RHS, "polly.red.and");
+  case MemoryAccess::RT_NONE:
+    break;
+  }
+  llvm_unreachable("Requested the operator of a non-reduction");
+}
+
+void IslNodeBuilder::createReductionPartials(
+    __isl_keep isl_ast_node *For, Value *NumThreads,
+    SmallVectorImpl<PrivateReduction> &Reductions) {
+  isl_union_map *Locations = IslAstInfo::getReductionLocations(For);
+  isl_ast_build *Build = IslAstInfo::getBuild(For);
+  auto *BrokenReductions = IslAstInfo::getBrokenReductions(For);
+  isl_space *ScheduleSpace = isl_ast_build_get_schedule_space(Build);
+
+  // Visit the arrays in a fixed order to generate deterministic code.
+  for (const ScopArrayInfo *SAI : S.arrays()) {
+    auto MAIt = std::find_if(BrokenReductions->begin(), BrokenReductions->end(),
+                             [SAI](MemoryAccess *MA) {
+                               return MA->getLatestScopArrayInfo() == SAI;
+                             });
+    if (MAIt == BrokenReductions->end())
+      continue;
+
+    // The element the reduction accumulates into does not depend on the
+    // parallel loop, so its address is computed once in front of it.
+    isl_space *Space = isl_space_map_from_domain_and_range(
+        isl_space_copy(ScheduleSpace), SAI->getSpace());
+    isl_pw_multi_aff *Location = isl_pw_multi_aff_from_map(
+        isl_union_map_extract_map(Locations, Space));
+    isl_ast_expr *Access =
+        isl_ast_build_access_from_pw_multi_aff(Build, Location);
+    Value *Shared = ExprBuilder.create(isl_ast_expr_address_of(Access));
+
+    Type *Ty = SAI->getElementType();
+    Value *Partials =
+        Builder.CreateAlloca(Ty, NumThreads, "polly.par.partials");
+    Reductions.push_back({SAI, (*MAIt)->getReductionType(), Shared, Partials});
+  }
+
+  isl_space_free(ScheduleSpace);
+  isl_union_map_free(Locations);
+
+  // Threads that do not take part in the loop leave their partial result
+  // untouched, hence all of them start with the identity.
+  BasicBlock *ExitBB;
+  Value *Zero = ConstantInt::get(NumThreads->getType(), 0);
+  Value *One = ConstantInt::get(NumThreads->getType(), 1);
+  Value *Thread =
+      createLoop(Zero, Builder.CreateSub(NumThreads, One), One, Builder, LI, DT,
+                 ExitBB, ICmpInst::ICMP_SLE);
+  for (PrivateReduction &R : Reductions) {
+    Type *Ty = R.SAI->getElementType();
+    Builder.CreateStore(getReductionIdentity(R.Type, Ty),
+                        Builder.CreateGEP(R.Partials, Thread));
+  }
+  Builder.SetInsertPoint(&*ExitBB->getFirstInsertionPt());
+}
+
+void IslNodeBuilder::createPrivateReductions(
+    Function *SubFn, ParallelLoopGenerator &ParallelLoopGen,
+    ArrayRef<PrivateReduction> Reductions, ValueMapT &NewValues) {
+  auto InsertPoint = Builder.GetInsertPoint();
+  BasicBlock &EntryBB = SubFn->getEntryBlock();
+  ReturnInst *Ret = nullptr;
+  for (BasicBlock &BB : *SubFn)
+    if ((Ret = dyn_cast<ReturnInst>(BB.getTerminator())))
+      break;
+  assert(Ret && "Parallel subfunction without return");
+
+  for (const PrivateReduction &R : Reductions) {
+    Type *Ty = R.SAI->getElementType();
+    Value *Private =
+        new AllocaInst(Ty, DL.getAllocaAddrSpace(), nullptr,
+                       "polly.par.private." + R.SAI->getName(),
+                       &*EntryBB.getFirstInsertionPt());
+
+    Builder.SetInsertPoint(EntryBB.getTerminator());
+    Builder.CreateStore(getReductionIdentity(R.Type, Ty), Private);
+
+    Builder.SetInsertPoint(Ret);
+    Value *Slot = Builder.CreateGEP(NewValues[R.Partials],
+                                    ParallelLoopGen.createCallGetThreadNum());
+    Builder.CreateStore(Builder.CreateLoad(Private), Slot);
+
+    // Accesses to the array are generated as accesses to its base pointer,
+    // see createNewAccesses().
+    ValueMap[R.SAI->getBasePtr()] = Private;
+    PrivateReductionArrays.insert(R.SAI);
+  }
+
+  Builder.SetInsertPoint(&*InsertPoint);
+}
+
+/// Collect the statements executed in the subtree of @p Node.
+static void collectStatements(__isl_keep isl_ast_node *Node,
+                              SmallPtrSetImpl<ScopStmt *> &Stmts) {
+  isl_ast_node_foreach_descendant_top_down(
+      Node,
+      [](isl_ast_node *Node, void *User) -> isl_bool {
+        if (isl_ast_node_get_type(Node) != isl_ast_node_user)
+          return isl_bool_true;
+
+        auto &Stmts = *static_cast<SmallPtrSetImpl<ScopStmt *> *>(User);
+        isl::ast_expr Expr = give(isl_ast_node_user_get_expr(Node));
+        isl::ast_expr StmtExpr = give(isl_ast_expr_get_op_arg(Expr.keep(), 0));
+        isl::id Id = give(isl_ast_expr_get_id(StmtExpr.keep()));
+
+        Stmts.insert(static_cast<ScopStmt *>(isl_id_get_user(Id.keep())));
+        return isl_bool_true;
+      },
+      &Stmts);
+}
+
+void IslNodeBuilder::createPrivateScratchBuffers(__isl_keep isl_ast_node *For,
+                                                 Function *SubFn) {
+  if (ScratchBuffers.empty())
+    return;
+
+  // The iterations of a parallel loop do not depend on each other, so an
+  // array that is only accessed in the loop is written and read within the
+  // same iteration. Arrays that are accessed outside of the loop as well,
+  // e.g., packed by a parallel copy loop and read by the kernel after it,
+  // remain shared by all threads.
+  SmallPtrSet<ScopStmt *, 8> Stmts;
+  collectStatements(For, Stmts);
+
+  SmallPtrSet<const ScopArrayInfo *, 4> Written, Shared;
+  for (ScopStmt &Stmt : S)
+    for (MemoryAccess *MA : Stmt) {
+      if (!MA->isLatestArrayKind())
+        continue;
+      const ScopArrayInfo *SAI = MA->getLatestScopArrayInfo();
+      if (!Stmts.count(&Stmt))
+        Shared.insert(SAI);
+      else if (MA->isMustWrite())
+        Written.insert(SAI);
+    }
+
+  auto InsertPoint = Builder.GetInsertPoint();
+  Builder.SetInsertPoint(SubFn->getEntryBlock().getTerminator());
+  for (auto &Buffer : ScratchBuffers) {
+    const ScopArrayInfo *SAI = Buffer.first;
+    if (Written.count(SAI) && !Shared.count(SAI))
+      ValueMap[SAI->getBasePtr()] = createScratchBufferCall(SAI);
+  }
+  Builder.SetInsertPoint(&*InsertPoint);
+}
+
+void IslNodeBuilder::createReductionCombine(
+    Value *NumThreads, ArrayRef<PrivateReduction> Reductions) {
+  Type *Ty = NumThreads->getType();
+  Value *Zero = ConstantInt::get(Ty, 0);
+  Value *One = ConstantInt::get(Ty, 1);
+
+  // for (Level = 0; Level < ceil(log2(NumThreads)); Level++)
+  //   for (T = 0; T + 2^Level < NumThreads; T += 2^(Level + 1))
+  //     Partials[T] = Partials[T] op Partials[T + 2^Level]
+  Function *Ctlz = Intrinsic::getDeclaration(
+      Builder.GetInsertBlock()->getModule(), Intrinsic::ctlz, Ty);
+  Value *LeadingZeros = Builder.CreateCall(
+      Ctlz, {Builder.CreateSub(NumThreads, One), Builder.getFalse()});
+  Value *NumLevels = Builder.CreateSub(
+      ConstantInt::get(Ty, Ty->getIntegerBitWidth()), LeadingZeros,
+      "polly.red.levels");
+
+  BasicBlock *LevelExitBB, *PairExitBB;
+  Value *Level =
+      createLoop(Zero, Builder.CreateSub(NumLevels, One), One, Builder, LI, DT,
+                 LevelExitBB, ICmpInst::ICMP_SLE);
+  Value *Distance = Builder.CreateShl(One, Level, "polly.red.distance");
+  Value *UB = Builder.CreateSub(Builder.CreateSub(NumThreads, Distance), One);
+  Value *Thread = createLoop(Zero, UB, Builder.CreateShl(Distance, 1), Builder,
+                             LI, DT, PairExitBB, ICmpInst::ICMP_SLE);
+  Value *Other = Builder.CreateAdd(Thread, Distance);
+  for (const PrivateReduction &R : Reductions) {
+    Value *Slot = Builder.CreateGEP(R.Partials, Thread);
+    Value *LHS = Builder.CreateLoad(Slot);
+    Value *RHS = Builder.CreateLoad(Builder.CreateGEP(R.Partials, Other));
+    Builder.CreateStore(createReductionOp(Builder, R.Type, LHS, RHS), Slot);
+  }
+
+  Builder.SetInsertPoint(&*LevelExitBB->getFirstInsertionPt());
+  for (const PrivateReduction &R : Reductions) {
+    Value *Shared = Builder.CreateLoad(R.Shared);
+    Value *Result = Builder.CreateLoad(R.Partials);
+    Builder.CreateStore(createReductionOp(Builder, R.Type, Shared, Result),
+                        R.Shared);
+  }
+}
+
+/// Check whether @p Expr references one of the loop iterators @p Iterators.
+static bool referencesIterator(__isl_keep isl_ast_expr *Expr,
+                               const SmallPtrSetImpl<isl_id *> &Iterators) {
+  switch (isl_ast_expr_get_type(Expr)) {
+  case isl_ast_expr_id: {
+    isl_id *Id = isl_ast_expr_get_id(Expr);
+    bool Found = Iterators.count(Id);
+    isl_id_free(Id);
+    return Found;
+  }
+  case isl_ast_expr_op:
+    for (int i = 0; i < isl_ast_expr_get_op_n_arg(Expr); i++) {
+      isl_ast_expr *Arg = isl_ast_expr_get_op_arg(Expr, i);
+      bool Found = referencesIterator(Arg, Iterators);
+      isl_ast_expr_free(Arg);
+      if (Found)
+        return true;
+    }
+    return false;
+  default:
+    return false;
+  }
+}
+
+/// Collect the loops collapsed into the thread parallel loop @p For.
+///
+/// @p Loops starts with @p For, followed by the perfectly nested loops that
+/// are executed as part of its iteration space. A loop whose bounds depend on
+/// one of the loops it is nested in is not collapsed.
+static void
+collectCollapsedLoops(__isl_keep isl_ast_node *For,
+                      SmallVectorImpl<isl_ast_node *> &Loops) {
+  unsigned NumLoops = IslAstInfo::getNumCollapsedLoops(For);
+  SmallPtrSet<isl_id *, 4> Iterators;
+  isl_ast_node *Loop = isl_ast_node_copy(For);
+  while (true) {
+    isl_ast_expr *Iterator = isl_ast_node_for_get_iterator(Loop);
+    Iterators.insert(isl_ast_expr_get_id(Iterator));
+    isl_ast_expr_free(Iterator);
+    Loops.push_back(Loop);
+    if (Loops.size() == NumLoops)
+      break;
+
+    Loop = isl_ast_node_for_get_body(Loop);
+    isl_ast_expr *Init = isl_ast_node_for_get_init(Loop);
+    isl_ast_expr *Cond = isl_ast_node_for_get_cond(Loop);
+    isl_ast_expr *Inc = isl_ast_node_for_get_inc(Loop);
+    bool IsInvariant = !referencesIterator(Init, Iterators) &&
+                       !referencesIterator(Cond, Iterators) &&
+                       !referencesIterator(Inc, Iterators);
+    isl_ast_expr_free(Init);
+    isl_ast_expr_free(Cond);
+    isl_ast_expr_free(Inc);
+    if (!IsInvariant) {
+      isl_ast_node_free(Loop);
+      break;
+    }
+  }
+
+  for (isl_id *Id : Iterators)
+    isl_id_free(Id);
+}
+
 void IslNodeBuilder::createForParallel(__isl_take isl_ast_node *For) {
   isl_ast_node *Body;
   isl_ast_expr *Init, *Inc, *Iterator, *UB;
@@ -621,6 +940,33 @@ void IslNodeBuilder::createForParallel(__isl_take isl_ast_node *For) {
   if (MaxType != ValueInc->getType())
     ValueInc = Builder.CreateSExt(ValueInc, MaxType);
 
+  // The loops collapsed into this loop are executed as one loop over their
+  // linearized iteration space, which is de-linearized in the subfunction.
+  SmallVector<isl_ast_node *, 4> CollapsedLoops;
+  collectCollapsedLoops(For, CollapsedLoops);
+  if (CollapsedLoops.size() > 1) {
+    Value *NumIterations = nullptr;
+    for (isl_ast_node *Loop : CollapsedLoops) {
+      Value *TripCount = createLoopTripCount(Loop);
+      NumIterations =
+          NumIterations
+              ? Builder.CreateMul(NumIterations, TripCount,
+                                  "polly.par.collapsedIterations")
+              : TripCount;
+    }
+    ValueLB = ConstantInt::get(NumIterations->getType(), 0);
+    ValueUB = Builder.CreateSub(NumIterations,
+                                ConstantInt::get(NumIterations->getType(), 1));
+    ValueInc = ConstantInt::get(NumIterations->getType(), 1);
+
+    isl_ast_node_free(Body);
+    Body = isl_ast_node_for_get_body(CollapsedLoops.back());
+  }
+
+  Value *Progress = nullptr;
+  if (IslAstInfo::isDoacross(For))
+    Progress = createDoacrossProgress(For);
+
   BasicBlock::iterator LoopBody;
 
   SetVector<Value *> SubtreeValues;
@@ -643,6 +989,23 @@ void IslNodeBuilder::createForParallel(__isl_take isl_ast_node *For) {
   ValueMapT NewValues;
   ParallelLoopGenerator ParallelLoopGen(Builder, LI, DT, DL);
 
+  // Reductions broken by the loop are accumulated per thread. The partial
+  // results live on the stack of the spawning thread until they are combined.
+  SmallVector<PrivateReduction, 4> Reductions;
+  Value *NumThreads = nullptr;
+  Value *StackPtr = nullptr;
+  if (IslAstInfo::isReductionParallel(For)) {
+    Module *M = Builder.GetInsertBlock()->getModule();
+    StackPtr = Builder.CreateCall(
+        Intrinsic::getDeclaration(M, Intrinsic::stacksave), {});
+    NumThreads = ParallelLoopGen.createNumThreads();
+    createReductionPartials(For, NumThreads, Reductions);
+    for (PrivateReduction &R : Reductions)
+      SubtreeValues.insert(R.Partials);
+  }
+  if (Progress)
+    SubtreeValues.insert(Progress);
+
   IV = ParallelLoopGen.createParallelLoop(ValueLB, ValueUB, ValueInc,
                                           SubtreeValues, NewValues, &LoopBody);
   BasicBlock::iterator AfterLoop = Builder.GetInsertPoint();
@@ -656,7 +1019,16 @@ void IslNodeBuilder::createForParallel(__isl_take isl_ast_node *For) {
   IslExprBuilder::IDToValueTy IDToValueCopy = IDToValue;
 
   updateValues(NewValues);
-  IDToValue[IteratorID] = IV;
+  if (CollapsedLoops.size() > 1)
+    createCollapsedIterators(LoopBody->getFunction(), IV, CollapsedLoops);
+  else
+    IDToValue[IteratorID] = IV;
+  createPrivateReductions(LoopBody->getFunction(), ParallelLoopGen, Reductions,
+                          NewValues);
+  // The iterations of a doacross loop depend on each other and share all
+  // arrays.
+  if (!Progress)
+    createPrivateScratchBuffers(For, LoopBody->getFunction());
 
   ValueMapT NewValuesReverse;
 
@@ -665,24 +1037,288 @@ void IslNodeBuilder::createForParallel(__isl_take isl_ast_node *For) {
 
   Annotator.addAlternativeAliasBases(NewValuesReverse);
 
-  create(Body);
+  if (Progress) {
+    // The iterations are numbered from one in their progress slots.
+    Type *Int64Ty = Builder.getInt64Ty();
+    auto BodyStart = Builder.GetInsertPoint();
+    BasicBlock &EntryBB = LoopBody->getFunction()->getEntryBlock();
+    Builder.SetInsertPoint(EntryBB.getTerminator());
+    Value *LB = Builder.CreateSExtOrTrunc(
+        ExprBuilder.create(isl_ast_node_for_get_init(For)), Int64Ty);
+    Value *Inc = Builder.CreateSExtOrTrunc(
+        ExprBuilder.create(isl_ast_node_for_get_inc(For)), Int64Ty);
+    Builder.SetInsertPoint(&*BodyStart);
+    Value *Slot = Builder.CreateSDiv(
+        Builder.CreateSub(Builder.CreateSExtOrTrunc(IV, Int64Ty), LB), Inc);
+    Value *Slots = NewValues[Progress];
+
+    DoacrossSync Sync;
+    Sync.Wait = Builder.CreateGEP(Slots, Slot, "polly.par.waitSlot");
+    Sync.Post =
+        Builder.CreateGEP(Slots, Builder.CreateAdd(Slot, Builder.getInt64(1)),
+                          "polly.par.postSlot");
+    Sync.Distance = IslAstInfo::getDoacrossDistance(For);
+    createForSequential(Body, false, &Sync);
+    createDoacrossPost(Sync.Post, Builder.getInt64(INT64_MAX));
+  } else {
+    create(Body);
+  }
 
   Annotator.resetAlternativeAliasBases();
   // Restore the original values.
   ValueMap = ValueMapCopy;
   IDToValue = IDToValueCopy;
+  PrivateReductionArrays.clear();
 
   Builder.SetInsertPoint(&*AfterLoop);
   removeSubFuncFromDomTree((*LoopBody).getParent()->getParent(), DT);
 
+  if (!Reductions.empty())
+    createReductionCombine(NumThreads, Reductions);
+  if (StackPtr) {
+    Module *M = Builder.GetInsertBlock()->getModule();
+    Builder.CreateCall(Intrinsic::getDeclaration(M, Intrinsic::stackrestore),
+                       StackPtr);
+  }
+  if (Progress)
+    CallInst::CreateFree(Progress, &*Builder.GetInsertPoint());
+
   for (const Loop *L : Loops)
     OutsideLoopIterations.erase(L);
 
+  for (isl_ast_node *Loop : CollapsedLoops)
+    isl_ast_node_free(Loop);
   isl_ast_node_free(For);
   isl_ast_expr_free(Iterator);
   isl_id_free(IteratorID);
 }
 
+Value *IslNodeBuilder::createDoacrossProgress(__isl_keep isl_ast_node *For) {
+  Type *Int64Ty = Builder.getInt64Ty();
+  Value *One = ConstantInt::get(Int64Ty, 1);
+  Value *NumIterations = createLoopTripCount(For);
+
+  // The slots are on the heap, as doacross loops commonly have more
+  // iterations than fit on the stack.
+  Instruction *Progress = CallInst::CreateMalloc(
+      &*Builder.GetInsertPoint(), DL.getIntPtrType(Builder.getContext()),
+      Int64Ty, ConstantInt::get(Int64Ty, DL.getTypeAllocSize(Int64Ty)),
+      Builder.CreateAdd(NumIterations, One), nullptr, "polly.par.progress");
+  Builder.CreateStore(Builder.getInt64(INT64_MAX), Progress);
+
+  BasicBlock *ExitBB;
+  Value *Slot = createLoop(One, NumIterations, One, Builder, LI, DT, ExitBB,
+                           ICmpInst::ICMP_SLE);
+  Builder.CreateStore(Builder.getInt64(INT64_MIN),
+                      Builder.CreateGEP(Progress, Slot));
+  Builder.SetInsertPoint(&*ExitBB->getFirstInsertionPt());
+
+  return Progress;
+}
+
+void IslNodeBuilder::createDoacrossWait(Value *Wait, Value *Target) {
+  Function *F = Builder.GetInsertBlock()->getParent();
+  BasicBlock *BeforeBB = Builder.GetInsertBlock();
+  BasicBlock *ReadyBB =
+      SplitBlock(BeforeBB, &*Builder.GetInsertPoint(), &DT, &LI);
+  ReadyBB->setName("polly.par.ready");
+  BasicBlock *WaitBB =
+      BasicBlock::Create(F->getContext(), "polly.par.wait", F, ReadyBB);
+
+  BeforeBB->getTerminator()->setSuccessor(0, WaitBB);
+  DT.addNewBlock(WaitBB, BeforeBB);
+  DT.changeImmediateDominator(ReadyBB, WaitBB);
+
+  Loop *OuterLoop = LI.getLoopFor(BeforeBB);
+  Loop *WaitLoop = new Loop();
+  if (OuterLoop)
+    OuterLoop->addChildLoop(WaitLoop);
+  else
+    LI.addTopLevelLoop(WaitLoop);
+  WaitLoop->addBasicBlockToLoop(WaitBB, LI);
+
+  // Spin until the preceding iteration published the progress, its writes are
+  // visible after the acquiring load.
+  Builder.SetInsertPoint(WaitBB);
+  LoadInst *Progress = Builder.CreateAlignedLoad(Wait, 8, "polly.par.progress");
+  Progress->setAtomic(AtomicOrdering::Acquire);
+  Value *IsReady = Builder.CreateICmpSGE(Progress, Target, "polly.par.isReady");
+  Builder.CreateCondBr(IsReady, ReadyBB, WaitBB);
+
+  Builder.SetInsertPoint(&ReadyBB->front());
+}
+
+void IslNodeBuilder::createDoacrossPost(Value *Post, Value *Progress) {
+  StoreInst *Store = Builder.CreateAlignedStore(Progress, Post, 8);
+  Store->setAtomic(AtomicOrdering::Release);
+}
+
+void IslNodeBuilder::createCollapsedIterators(
+    Function *SubFn, Value *IV, ArrayRef<isl_ast_node *> Loops) {
+  auto InsertPoint = Builder.GetInsertPoint();
+
+  // The bounds do not change during the execution of the subfunction and are
+  // computed once on its entry.
+  SmallVector<Value *, 4> LBs, Incs, TripCounts;
+  Builder.SetInsertPoint(SubFn->getEntryBlock().getTerminator());
+  for (isl_ast_node *Loop : Loops) {
+    Type *Ty = IV->getType();
+    LBs.push_back(Builder.CreateSExtOrTrunc(
+        ExprBuilder.create(isl_ast_node_for_get_init(Loop)), Ty));
+    Incs.push_back(Builder.CreateSExtOrTrunc(
+        ExprBuilder.create(isl_ast_node_for_get_inc(Loop)), Ty));
+    TripCounts.push_back(
+        Builder.CreateSExtOrTrunc(createLoopTripCount(Loop), Ty));
+  }
+
+  // The innermost loop varies fastest in the linearized iteration space.
+  Builder.SetInsertPoint(&*InsertPoint);
+  Value *Remainder = IV;
+  for (unsigned i = Loops.size(); i-- > 0;) {
+    Value *Index = Remainder;
+    if (i > 0) {
+      Index = Builder.CreateURem(Remainder, TripCounts[i]);
+      Remainder = Builder.CreateUDiv(Remainder, TripCounts[i]);
+    }
+
+    isl_ast_expr *Iterator = isl_ast_node_for_get_iterator(Loops[i]);
+    isl_id *IteratorID = isl_ast_expr_get_id(Iterator);
+    IDToValue[IteratorID] = Builder.CreateNSWAdd(
+        LBs[i], Builder.CreateNSWMul(Index, Incs[i]), "polly.par.collapsedIV");
+    isl_id_free(IteratorID);
+    isl_ast_expr_free(Iterator);
+  }
+}
+
+Value *IslNodeBuilder::createLoopTripCount(__isl_keep isl_ast_node *For) {
+  Type *Int64Ty = Builder.getInt64Ty();
+  Value *Zero = ConstantInt::get(Int64Ty, 0);
+  Value *One = ConstantInt::get(Int64Ty, 1);
+
+  CmpInst::Predicate Predicate;
+  isl_ast_expr *Init = isl_ast_node_for_get_init(For);
+  isl_ast_expr *Inc = isl_ast_node_for_get_inc(For);
+  isl_ast_expr *UB = getUpperBound(For, Predicate);
+
+  Value *ValueLB = Builder.CreateSExtOrTrunc(ExprBuilder.create(Init), Int64Ty);
+  Value *ValueUB = Builder.CreateSExtOrTrunc(ExprBuilder.create(UB), Int64Ty);
+  Value *ValueInc = Builder.CreateSExtOrTrunc(ExprBuilder.create(Inc), Int64Ty);
+  if (Predicate == CmpInst::ICMP_SLT)
+    ValueUB = Builder.CreateSub(ValueUB, One);
+
+  // (UB - LB) / Inc + 1 iterations, none if the upper bound is below the
+  // lower bound.
+  Value *Iterations = Builder.CreateAdd(
+      Builder.CreateSDiv(Builder.CreateSub(ValueUB, ValueLB), ValueInc), One);
+  return Builder.CreateSelect(Builder.CreateICmpSLT(ValueUB, ValueLB), Zero,
+                              Iterations);
+}
+
+Value *IslNodeBuilder::createLoopNestWork(__isl_keep isl_ast_node *For) {
+  Value *One = ConstantInt::get(Builder.getInt64Ty(), 1);
+  Value *Work = nullptr;
+  SmallPtrSet<isl_id *, 4> Iterators;
+
+  isl_ast_node *Node = isl_ast_node_copy(For);
+  while (true) {
+    if (isl_ast_node_get_type(Node) == isl_ast_node_mark) {
+      isl_ast_node *Child = isl_ast_node_mark_get_node(Node);
+      isl_ast_node_free(Node);
+      Node = Child;
+      continue;
+    }
+    if (isl_ast_node_get_type(Node) != isl_ast_node_for)
+      break;
+
+    CmpInst::Predicate Predicate;
+    isl_ast_expr *Init = isl_ast_node_for_get_init(Node);
+    isl_ast_expr *Inc = isl_ast_node_for_get_inc(Node);
+    isl_ast_expr *UB = getUpperBound(Node, Predicate);
+    bool IsInvariant = !referencesIterator(Init, Iterators) &&
+                       !referencesIterator(Inc, Iterators) &&
+                       !referencesIterator(UB, Iterators);
+    isl_ast_expr_free(Init);
+    isl_ast_expr_free(Inc);
+    isl_ast_expr_free(UB);
+    if (!IsInvariant)
+      break;
+
+    Value *Iterations = createLoopTripCount(Node);
+    Work = Work ? Builder.CreateMul(Work, Iterations, "polly.par.work")
+                : Iterations;
+
+    isl_ast_expr *Iterator = isl_ast_node_for_get_iterator(Node);
+    Iterators.insert(isl_ast_expr_get_id(Iterator));
+    isl_ast_expr_free(Iterator);
+
+    isl_ast_node *Body = isl_ast_node_for_get_body(Node);
+    isl_ast_node_free(Node);
+    Node = Body;
+  }
+  isl_ast_node_free(Node);
+
+  for (isl_id *Id : Iterators)
+    isl_id_free(Id);
+
+  return Work ? Work : One;
+}
+
+void IslNodeBuilder::createForParallelIfProfitable(
+    __isl_take isl_ast_node *For) {
+  Value *Work = createLoopNestWork(For);
+  Value *MinWork = ConstantInt::get(Work->getType(), PollyParallelMinWork);
+
+  // Decide at compile time if the work is known.
+  if (auto *ConstWork = dyn_cast<ConstantInt>(Work)) {
+    if (ConstWork->getZExtValue() >= PollyParallelMinWork)
+      createForParallel(For);
+    else
+      createForSequential(For, false);
+    return;
+  }
+
+  Function *F = Builder.GetInsertBlock()->getParent();
+  LLVMContext &Context = F->getContext();
+
+  BasicBlock *CondBB = SplitBlock(Builder.GetInsertBlock(),
+                                  &*Builder.GetInsertPoint(), &DT, &LI);
+  CondBB->setName("polly.par.checkWork");
+  BasicBlock *MergeBB = SplitBlock(CondBB, &CondBB->front(), &DT, &LI);
+  MergeBB->setName("polly.par.merge");
+  BasicBlock *ParallelBB =
+      BasicBlock::Create(Context, "polly.par.parallel", F);
+  BasicBlock *SequentialBB =
+      BasicBlock::Create(Context, "polly.par.sequential", F);
+
+  DT.addNewBlock(ParallelBB, CondBB);
+  DT.addNewBlock(SequentialBB, CondBB);
+  DT.changeImmediateDominator(MergeBB, CondBB);
+
+  Loop *L = LI.getLoopFor(CondBB);
+  if (L) {
+    L->addBasicBlockToLoop(ParallelBB, LI);
+    L->addBasicBlockToLoop(SequentialBB, LI);
+  }
+
+  CondBB->getTerminator()->eraseFromParent();
+
+  Builder.SetInsertPoint(CondBB);
+  Value *HasWork = Builder.CreateICmpSGE(Work, MinWork, "polly.par.hasWork");
+  Builder.CreateCondBr(HasWork, ParallelBB, SequentialBB);
+  Builder.SetInsertPoint(ParallelBB);
+  Builder.CreateBr(MergeBB);
+  Builder.SetInsertPoint(SequentialBB);
+  Builder.CreateBr(MergeBB);
+
+  Builder.SetInsertPoint(&ParallelBB->front());
+  createForParallel(isl_ast_node_copy(For));
+
+  Builder.SetInsertPoint(&SequentialBB->front());
+  createForSequential(For, false);
+
+  Builder.SetInsertPoint(&MergeBB->front());
+}
+
 /// Return whether any of @p Node's statements contain partial accesses.
 ///
 /// Partial accesses are not supported by Polly's vector code generator.
@@ -723,7 +1359,10 @@ void IslNodeBuilder::createFor(__isl_take isl_ast_node *For) {
   }
 
   if (IslAstInfo::isExecutedInParallel(For)) {
-    createForParallel(For);
+    if (PollyParallelMinWork > 0)
+      createForParallelIfProfitable(For);
+    else
+      createForParallel(For);
     return;
   }
   createForSequential(For, false);
@@ -787,6 +1426,18 @@ IslNodeBuilder::createNewAccesses(ScopStmt *Stmt,
   Stmt->setAstBuild(Build);
 
   for (auto *MA : *Stmt) {
+    // Accesses to a privatized reduction array address the private copy of
+    // the thread, which the base pointer of the array is mapped to.
+    auto *SAI = MA->getLatestScopArrayInfo();
+    if (MA->isLatestArrayKind() && PrivateReductionArrays.count(SAI)) {
+      auto *BaseExpr = isl_ast_expr_from_id(SAI->getBasePtrId());
+      auto *AccessExpr = isl_ast_expr_access(
+          BaseExpr, isl_ast_expr_list_alloc(S.getIslCtx(), 0));
+      NewAccesses =
+          isl_id_to_ast_expr_set(NewAccesses, MA->getId(), AccessExpr);
+      continue;
+    }
+
     if (!MA->hasNewAccessRelation()) {
       if (PollyGenerateExpressions) {
         if (!MA->isAffine())
@@ -1425,7 +2076,22 @@ void IslNodeBuilder::allocateNewArrays(BBPair StartExitBlocks) {
       ArraySizeInt *= UnsignedDimSize;
     }
 
-    if (SAI->isOnHeap()) {
+    if (PollyScratchBuffers) {
+      Module *M = Builder.GetInsertBlock()->getModule();
+      Type *Int8Ty = Builder.getInt8Ty();
+      auto *Key = new GlobalVariable(*M, Int8Ty, false,
+                                     GlobalValue::PrivateLinkage,
+                                     ConstantInt::get(Int8Ty, 0),
+                                     "polly.scratch.key." + SAI->getName());
+      ScratchBuffers[SAI] = {Key, ArraySizeInt * SAI->getElemSizeInBytes()};
+
+      // Get the buffer of the thread at polly.start, it is released by the
+      // runtime.
+      auto IP = Builder.saveIP();
+      Builder.SetInsertPoint(std::get<0>(StartExitBlocks)->getTerminator());
+      SAI->setBasePtr(createScratchBufferCall(SAI));
+      Builder.restoreIP(IP);
+    } else if (SAI->isOnHeap()) {
       LLVMContext &Ctx = NewArrayType->getContext();
 
       // Get the IntPtrTy from the Datalayout
@@ -1462,6 +2128,28 @@ void IslNodeBuilder::allocateNewArrays(BBPair StartExitBlocks) {
   }
 }
 
+Value *IslNodeBuilder::createScratchBufferCall(const ScopArrayInfo *SAI) {
+  const std::string Name = "polly_getScratchBuffer";
+  Module *M = Builder.GetInsertBlock()->getModule();
+  Function *F = M->getFunction(Name);
+
+  // If F is not available, declare it.
+  if (!F) {
+    GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
+    Type *Params[] = {Builder.getInt8PtrTy(), Builder.getInt64Ty(),
+                      Builder.getInt64Ty()};
+    FunctionType *Ty = FunctionType::get(Builder.getInt8PtrTy(), Params, false);
+    F = Function::Create(Ty, Linkage, Name, M);
+  }
+
+  ScratchBufferTy Buffer = ScratchBuffers.lookup(SAI);
+  Value *Args[] = {Buffer.Key, Builder.getInt64(Buffer.Size),
+                   Builder.getInt64(PollyTargetFirstLevelCacheLineSize)};
+  Value *Ptr = Builder.CreateCall(F, Args, "polly.scratch." + SAI->getName());
+  return Builder.CreateBitCast(Ptr, SAI->getElementType()->getPointerTo(),
+                               SAI->getName());
+}
+
 bool IslNodeBuilder::preloadInvariantLoads() {
 
   auto &InvariantEquivClasses = S.getInvariantAccesses();
@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "polly/CodeGen/LoopGenerators.h"
+#include "polly/Options.h"
 #include "polly/ScopDetection.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/DataLayout.h"
@@ -28,6 +29,73 @@ static cl::opt<int>
                     cl::desc("Number of threads to use (0 = auto)"), cl::Hidden,
                     cl::init(0));
 
+namespace {
+/// The OpenMP runtime library the parallel loops are generated for.
+enum class OpenMPBackend { GNU, LLVM };
+
+/// The distribution of the iterations of a parallel loop to the threads.
+enum class OpenMPScheduling { Static, Dynamic, Guided, Runtime };
+
+/// Scheduling types of the LLVM OpenMP runtime (enum sched_type of kmp.h).
+enum KMPScheduleType {
+  KMPStaticChunked = 33,
+  KMPStatic = 34,
+  KMPDynamicChunked = 35,
+  KMPGuidedChunked = 36,
+  KMPRuntime = 37
+};
+} // namespace
+
+static cl::opt<OpenMPBackend> PollyOmpBackend(
+    "polly-omp-backend", cl::desc("The OpenMP library parallel loops call"),
+    cl::values(clEnumValN(OpenMPBackend::GNU, "GNU", "GNU OpenMP (libgomp)"),
+               clEnumValN(OpenMPBackend::LLVM, "LLVM",
+                          "LLVM OpenMP (libomp)")),
+    cl::Hidden, cl::init(OpenMPBackend::GNU), cl::ZeroOrMore,
+    cl::cat(PollyCategory));
+
+static cl::opt<OpenMPScheduling> PollyScheduling(
+    "polly-scheduling",
+    cl::desc("The scheduling of the iterations of parallel loops"),
+    cl::values(clEnumValN(OpenMPScheduling::Static, "static",
+                          "Fixed partitions, no runtime call per chunk"),
+               clEnumValN(OpenMPScheduling::Dynamic, "dynamic",
+                          "Chunks fetched by the threads on demand"),
+               clEnumValN(OpenMPScheduling::Guided, "guided",
+                          "Dynamic with decreasing chunk sizes"),
+               clEnumValN(OpenMPScheduling::Runtime, "runtime",
+                          "Taken from OMP_SCHEDULE at run time")),
+    cl::Hidden, cl::init(OpenMPScheduling::Runtime), cl::ZeroOrMore,
+    cl::cat(PollyCategory));
+
+static cl::opt<int> PollyChunkSize(
+    "polly-scheduling-chunksize",
+    cl::desc("The chunk size of static, dynamic and guided scheduling (0 = "
+             "one partition per thread for static, 1 otherwise)"),
+    cl::Hidden, cl::init(0), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+/// Return the suffix of the libgomp loop functions for the scheduling.
+static const char *getGOMPScheduleName() {
+  switch (PollyScheduling) {
+  case OpenMPScheduling::Static:
+    return "static";
+  case OpenMPScheduling::Dynamic:
+    return "dynamic";
+  case OpenMPScheduling::Guided:
+    return "guided";
+  case OpenMPScheduling::Runtime:
+    return "runtime";
+  }
+  llvm_unreachable("Unknown OpenMP scheduling");
+}
+
+/// Return the chunk size passed to the runtime library.
+static int getChunkSize() {
+  if (PollyChunkSize > 0)
+    return PollyChunkSize;
+  return PollyScheduling == OpenMPScheduling::Static ? 0 : 1;
+}
+
 // We generate a loop of either of the following structures:
 //
 //              BeforeBB                      BeforeBB
@@ -149,16 +217,25 @@ Value *ParallelLoopGenerator::createParallelLoop(
     Value *LB, Value *UB, Value *Stride, SetVector<Value *> &UsedValues,
     ValueMapT &Map, BasicBlock::iterator *LoopBody) {
   Function *SubFn;
+  bool UseKMP = PollyOmpBackend == OpenMPBackend::LLVM;
 
   AllocaInst *Struct = storeValuesIntoStruct(UsedValues);
   BasicBlock::iterator BeforeLoop = Builder.GetInsertPoint();
-  Value *IV = createSubFn(Stride, Struct, UsedValues, Map, &SubFn);
+  Value *IV = UseKMP ? createSubFnKMP(Struct, UsedValues, Map, &SubFn)
+                     : createSubFn(Stride, Struct, UsedValues, Map, &SubFn);
   *LoopBody = Builder.GetInsertPoint();
   Builder.SetInsertPoint(&*BeforeLoop);
 
   Value *SubFnParam = Builder.CreateBitCast(Struct, Builder.getInt8PtrTy(),
                                             "polly.par.userContext");
 
+  // The LLVM OpenMP runtime takes inclusive bounds and returns once all
+  // threads finished the subfunction.
+  if (UseKMP) {
+    createCallForkKMP(SubFn, SubFnParam, LB, UB, Stride);
+    return IV;
+  }
+
   // Add one as the upper bound provided by OpenMP is a < comparison
   // whereas the codegenForSequential function creates a <= comparison.
   UB = Builder.CreateAdd(UB, ConstantInt::get(LongType, 1));
@@ -174,7 +251,10 @@ Value *ParallelLoopGenerator::createParallelLoop(
 void ParallelLoopGenerator::createCallSpawnThreads(Value *SubFn,
                                                    Value *SubFnParam, Value *LB,
                                                    Value *UB, Value *Stride) {
-  const std::string Name = "GOMP_parallel_loop_runtime_start";
+  // Only the non-runtime schedules take a chunk size.
+  bool HasChunkSize = PollyScheduling != OpenMPScheduling::Runtime;
+  const std::string Name = std::string("GOMP_parallel_loop_") +
+                           getGOMPScheduleName() + "_start";
 
   Function *F = M->getFunction(Name);
 
@@ -182,27 +262,34 @@ void ParallelLoopGenerator::createCallSpawnThreads(Value *SubFn,
   if (!F) {
     GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
 
-    Type *Params[] = {PointerType::getUnqual(FunctionType::get(
-                          Builder.getVoidTy(), Builder.getInt8PtrTy(), false)),
-                      Builder.getInt8PtrTy(),
-                      Builder.getInt32Ty(),
-                      LongType,
-                      LongType,
-                      LongType};
+    SmallVector<Type *, 7> Params = {
+        PointerType::getUnqual(FunctionType::get(
+            Builder.getVoidTy(), Builder.getInt8PtrTy(), false)),
+        Builder.getInt8PtrTy(),
+        Builder.getInt32Ty(),
+        LongType,
+        LongType,
+        LongType};
+    if (HasChunkSize)
+      Params.push_back(LongType);
 
     FunctionType *Ty = FunctionType::get(Builder.getVoidTy(), Params, false);
     F = Function::Create(Ty, Linkage, Name, M);
   }
 
   Value *NumberOfThreads = Builder.getInt32(PollyNumThreads);
-  Value *Args[] = {SubFn, SubFnParam, NumberOfThreads, LB, UB, Stride};
+  SmallVector<Value *, 7> Args = {SubFn, SubFnParam, NumberOfThreads,
+                                  LB,    UB,         Stride};
+  if (HasChunkSize)
+    Args.push_back(ConstantInt::get(LongType, getChunkSize()));
 
   Builder.CreateCall(F, Args);
 }
 
 Value *ParallelLoopGenerator::createCallGetWorkItem(Value *LBPtr,
                                                     Value *UBPtr) {
-  const std::string Name = "GOMP_loop_runtime_next";
+  const std::string Name =
+      std::string("GOMP_loop_") + getGOMPScheduleName() + "_next";
 
   Function *F = M->getFunction(Name);
 
@@ -237,6 +324,43 @@ void ParallelLoopGenerator::createCallJoinThreads() {
   Builder.CreateCall(F, {});
 }
 
+Value *ParallelLoopGenerator::createNumThreads() {
+  if (PollyNumThreads > 0)
+    return ConstantInt::get(LongType, PollyNumThreads);
+
+  const std::string Name = "omp_get_max_threads";
+
+  Function *F = M->getFunction(Name);
+
+  // If F is not available, declare it.
+  if (!F) {
+    GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
+
+    FunctionType *Ty = FunctionType::get(Builder.getInt32Ty(), false);
+    F = Function::Create(Ty, Linkage, Name, M);
+  }
+
+  Value *Return = Builder.CreateCall(F, {});
+  return Builder.CreateSExt(Return, LongType, "polly.par.numThreads");
+}
+
+Value *ParallelLoopGenerator::createCallGetThreadNum() {
+  const std::string Name = "omp_get_thread_num";
+
+  Function *F = M->getFunction(Name);
+
+  // If F is not available, declare it.
+  if (!F) {
+    GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
+
+    FunctionType *Ty = FunctionType::get(Builder.getInt32Ty(), false);
+    F = Function::Create(Ty, Linkage, Name, M);
+  }
+
+  Value *Return = Builder.CreateCall(F, {});
+  return Builder.CreateSExt(Return, LongType, "polly.par.threadNum");
+}
+
 void ParallelLoopGenerator::createCallCleanupThread() {
   const std::string Name = "GOMP_loop_end_nowait";
 
@@ -253,9 +377,251 @@ void ParallelLoopGenerator::createCallCleanupThread() {
   Builder.CreateCall(F, {});
 }
 
-Function *ParallelLoopGenerator::createSubFnDefinition() {
+GlobalVariable *ParallelLoopGenerator::getOrCreateIdentKMP() {
+  const std::string Name = "polly.par.ident";
+
+  if (GlobalVariable *Ident = M->getGlobalVariable(Name, true))
+    return Ident;
+
+  StructType *IdentTy = M->getTypeByName("struct.ident_t");
+
+  // If the type is not available, declare it.
+  if (!IdentTy) {
+    Type *Members[] = {Builder.getInt32Ty(), Builder.getInt32Ty(),
+                       Builder.getInt32Ty(), Builder.getInt32Ty(),
+                       Builder.getInt8PtrTy()};
+    IdentTy =
+        StructType::create(M->getContext(), Members, "struct.ident_t", false);
+  }
+
+  // The source location is not known, the format is the one of clang.
+  Constant *Location = ConstantDataArray::getString(
+      M->getContext(), ";unknown;unknown;0;0;;");
+  GlobalVariable *LocationStr = new GlobalVariable(
+      *M, Location->getType(), true, GlobalValue::PrivateLinkage, Location,
+      "polly.par.ident.str");
+  LocationStr->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+
+  // The flags are KMP_IDENT_KMPC, the call comes from compiled code.
+  Constant *Members[] = {
+      Builder.getInt32(0), Builder.getInt32(2), Builder.getInt32(0),
+      Builder.getInt32(0),
+      ConstantExpr::getPointerCast(LocationStr, Builder.getInt8PtrTy())};
+  return new GlobalVariable(*M, IdentTy, true, GlobalValue::PrivateLinkage,
+                            ConstantStruct::get(IdentTy, Members), Name);
+}
+
+Value *ParallelLoopGenerator::createCallGlobalThreadNumKMP() {
+  const std::string Name = "__kmpc_global_thread_num";
+
+  Function *F = M->getFunction(Name);
+
+  // If F is not available, declare it.
+  if (!F) {
+    GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
+
+    Type *Params[] = {getOrCreateIdentKMP()->getType()};
+
+    FunctionType *Ty = FunctionType::get(Builder.getInt32Ty(), Params, false);
+    F = Function::Create(Ty, Linkage, Name, M);
+  }
+
+  return Builder.CreateCall(F, {getOrCreateIdentKMP()}, "polly.par.gtid");
+}
+
+void ParallelLoopGenerator::createCallForkKMP(Function *SubFn,
+                                              Value *SubFnParam, Value *LB,
+                                              Value *UB, Value *Stride) {
+  GlobalVariable *Ident = getOrCreateIdentKMP();
+
+  // Without a thread count the runtime uses its default, OMP_NUM_THREADS.
+  if (PollyNumThreads > 0) {
+    const std::string Name = "__kmpc_push_num_threads";
+
+    Function *F = M->getFunction(Name);
+
+    // If F is not available, declare it.
+    if (!F) {
+      GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
+
+      Type *Params[] = {Ident->getType(), Builder.getInt32Ty(),
+                        Builder.getInt32Ty()};
+
+      FunctionType *Ty = FunctionType::get(Builder.getVoidTy(), Params, false);
+      F = Function::Create(Ty, Linkage, Name, M);
+    }
+
+    Value *Args[] = {Ident, createCallGlobalThreadNumKMP(),
+                     Builder.getInt32(PollyNumThreads)};
+    Builder.CreateCall(F, Args);
+  }
+
+  const std::string Name = "__kmpc_fork_call";
+
+  Function *F = M->getFunction(Name);
+
+  // The microtask takes the global and the bound thread id, followed by the
+  // variadic arguments of the fork call.
+  Type *TidPtrTy = Builder.getInt32Ty()->getPointerTo();
+  PointerType *MicroTy = PointerType::getUnqual(FunctionType::get(
+      Builder.getVoidTy(), {TidPtrTy, TidPtrTy}, true));
+
+  // If F is not available, declare it.
+  if (!F) {
+    GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
+
+    Type *Params[] = {Ident->getType(), Builder.getInt32Ty(), MicroTy};
+
+    FunctionType *Ty = FunctionType::get(Builder.getVoidTy(), Params, true);
+    F = Function::Create(Ty, Linkage, Name, M);
+  }
+
+  Value *Args[] = {Ident,
+                   Builder.getInt32(4),
+                   Builder.CreateBitCast(SubFn, MicroTy),
+                   LB,
+                   UB,
+                   Stride,
+                   SubFnParam};
+  Builder.CreateCall(F, Args);
+}
+
+Value *ParallelLoopGenerator::createCallStaticInitKMP(Value *GTid,
+                                                      Value *IsLastPtr,
+                                                      Value *LBPtr,
+                                                      Value *UBPtr,
+                                                      Value *StridePtr,
+                                                      Value *Stride) {
+  GlobalVariable *Ident = getOrCreateIdentKMP();
+  const std::string Name = "__kmpc_for_static_init_8";
+
+  Function *F = M->getFunction(Name);
+
+  // If F is not available, declare it.
+  if (!F) {
+    GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
+
+    Type *Params[] = {Ident->getType(),         Builder.getInt32Ty(),
+                      Builder.getInt32Ty(),     IsLastPtr->getType(),
+                      LongType->getPointerTo(), LongType->getPointerTo(),
+                      LongType->getPointerTo(), LongType,
+                      LongType};
+
+    FunctionType *Ty = FunctionType::get(Builder.getVoidTy(), Params, false);
+    F = Function::Create(Ty, Linkage, Name, M);
+  }
+
+  // Without a chunk size, every thread gets one block of iterations.
+  int ChunkSize = getChunkSize();
+  int ScheduleType = ChunkSize > 0 ? KMPStaticChunked : KMPStatic;
+  Value *Args[] = {Ident,
+                   GTid,
+                   Builder.getInt32(ScheduleType),
+                   IsLastPtr,
+                   LBPtr,
+                   UBPtr,
+                   StridePtr,
+                   Stride,
+                   ConstantInt::get(LongType, std::max(ChunkSize, 1))};
+  return Builder.CreateCall(F, Args);
+}
+
+void ParallelLoopGenerator::createCallStaticFiniKMP(Value *GTid) {
+  GlobalVariable *Ident = getOrCreateIdentKMP();
+  const std::string Name = "__kmpc_for_static_fini";
+
+  Function *F = M->getFunction(Name);
+
+  // If F is not available, declare it.
+  if (!F) {
+    GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
+
+    Type *Params[] = {Ident->getType(), Builder.getInt32Ty()};
+
+    FunctionType *Ty = FunctionType::get(Builder.getVoidTy(), Params, false);
+    F = Function::Create(Ty, Linkage, Name, M);
+  }
+
+  Builder.CreateCall(F, {Ident, GTid});
+}
+
+void ParallelLoopGenerator::createCallDispatchInitKMP(Value *GTid, Value *LB,
+                                                      Value *UB,
+                                                      Value *Stride) {
+  GlobalVariable *Ident = getOrCreateIdentKMP();
+  const std::string Name = "__kmpc_dispatch_init_8";
+
+  Function *F = M->getFunction(Name);
+
+  // If F is not available, declare it.
+  if (!F) {
+    GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
+
+    Type *Params[] = {Ident->getType(), Builder.getInt32Ty(),
+                      Builder.getInt32Ty(), LongType,
+                      LongType,         LongType,
+                      LongType};
+
+    FunctionType *Ty = FunctionType::get(Builder.getVoidTy(), Params, false);
+    F = Function::Create(Ty, Linkage, Name, M);
+  }
+
+  int ScheduleType = KMPRuntime;
+  if (PollyScheduling == OpenMPScheduling::Dynamic)
+    ScheduleType = KMPDynamicChunked;
+  else if (PollyScheduling == OpenMPScheduling::Guided)
+    ScheduleType = KMPGuidedChunked;
+
+  Value *Args[] = {Ident,
+                   GTid,
+                   Builder.getInt32(ScheduleType),
+                   LB,
+                   UB,
+                   Stride,
+                   ConstantInt::get(LongType, getChunkSize())};
+  Builder.CreateCall(F, Args);
+}
+
+Value *ParallelLoopGenerator::createCallDispatchNextKMP(Value *GTid,
+                                                        Value *IsLastPtr,
+                                                        Value *LBPtr,
+                                                        Value *UBPtr,
+                                                        Value *StridePtr) {
+  GlobalVariable *Ident = getOrCreateIdentKMP();
+  const std::string Name = "__kmpc_dispatch_next_8";
+
+  Function *F = M->getFunction(Name);
+
+  // If F is not available, declare it.
+  if (!F) {
+    GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
+
+    Type *Params[] = {Ident->getType(),         Builder.getInt32Ty(),
+                      IsLastPtr->getType(),     LongType->getPointerTo(),
+                      LongType->getPointerTo(), LongType->getPointerTo()};
+
+    FunctionType *Ty = FunctionType::get(Builder.getInt32Ty(), Params, false);
+    F = Function::Create(Ty, Linkage, Name, M);
+  }
+
+  Value *Args[] = {Ident, GTid, IsLastPtr, LBPtr, UBPtr, StridePtr};
+  Value *Return = Builder.CreateCall(F, Args);
+  return Builder.CreateICmpNE(Return, Builder.getInt32(0),
+                              "polly.par.hasNextScheduleBlock");
+}
+
+Function *ParallelLoopGenerator::createSubFnDefinition(bool UseKMP) {
   Function *F = Builder.GetInsertBlock()->getParent();
   std::vector<Type *> Arguments(1, Builder.getInt8PtrTy());
+
+  // The LLVM OpenMP runtime passes the thread ids first and the bounds of the
+  // loop as the arguments of the fork call.
+  if (UseKMP) {
+    Type *TidPtrTy = Builder.getInt32Ty()->getPointerTo();
+    Arguments = {TidPtrTy, TidPtrTy, LongType, LongType, LongType,
+                 Builder.getInt8PtrTy()};
+  }
+
   FunctionType *FT = FunctionType::get(Builder.getVoidTy(), Arguments, false);
   Function *SubFn = Function::Create(FT, Function::InternalLinkage,
                                      F->getName() + "_polly_subfn", M);
@@ -270,6 +636,13 @@ Function *ParallelLoopGenerator::createSubFnDefinition() {
   SubFn->addFnAttr(PollySkipFnAttr);
 
   Function::arg_iterator AI = SubFn->arg_begin();
+  if (UseKMP) {
+    (AI++)->setName("polly.par.global_tid");
+    (AI++)->setName("polly.par.bound_tid");
+    (AI++)->setName("polly.par.lb");
+    (AI++)->setName("polly.par.ub");
+    (AI++)->setName("polly.par.stride");
+  }
   AI->setName("polly.par.userContext");
 
   return SubFn;
@@ -379,3 +752,127 @@ Value *ParallelLoopGenerator::createSubFn(Value *Stride, AllocaInst *StructData,
 
   return IV;
 }
+
+Value *ParallelLoopGenerator::createSubFnKMP(AllocaInst *StructData,
+                                             SetVector<Value *> Data,
+                                             ValueMapT &Map,
+                                             Function **SubFnPtr) {
+  BasicBlock *PrevBB, *HeaderBB, *ExitBB, *CheckNextBB, *PreHeaderBB, *AfterBB;
+  Value *IsLastPtr, *LBPtr, *UBPtr, *StridePtr, *UserContext, *HasNextSchedule,
+      *LB, *UB, *IV;
+  Function *SubFn = createSubFnDefinition(/* UseKMP */ true);
+  LLVMContext &Context = SubFn->getContext();
+  bool IsStatic = PollyScheduling == OpenMPScheduling::Static;
+  // Without a chunk size, the runtime assigns a single block of iterations to
+  // every thread. The stride it returns is the trip count, which is not
+  // scaled by the increment, so there is no next block to run.
+  bool IsSingleBlock = IsStatic && getChunkSize() == 0;
+
+  Function::arg_iterator AI = SubFn->arg_begin();
+  Value *GTidPtr = &*AI;
+  std::advance(AI, 2);
+  Value *LoopLB = &*(AI++);
+  Value *LoopUB = &*(AI++);
+  Value *LoopStride = &*(AI++);
+  Value *Param = &*AI;
+
+  // Store the previous basic block.
+  PrevBB = Builder.GetInsertBlock();
+
+  // Create basic blocks.
+  HeaderBB = BasicBlock::Create(Context, "polly.par.setup", SubFn);
+  ExitBB = BasicBlock::Create(Context, "polly.par.exit", SubFn);
+  CheckNextBB = BasicBlock::Create(Context, "polly.par.checkNext", SubFn);
+  PreHeaderBB = BasicBlock::Create(Context, "polly.par.loadIVBounds", SubFn);
+
+  DT.addNewBlock(HeaderBB, PrevBB);
+  DT.addNewBlock(ExitBB, HeaderBB);
+  DT.addNewBlock(CheckNextBB, HeaderBB);
+  DT.addNewBlock(PreHeaderBB, HeaderBB);
+
+  // Fill up basic block HeaderBB.
+  Builder.SetInsertPoint(HeaderBB);
+  IsLastPtr = Builder.CreateAlloca(Builder.getInt32Ty(), nullptr,
+                                   "polly.par.lastIterPtr");
+  LBPtr = Builder.CreateAlloca(LongType, nullptr, "polly.par.LBPtr");
+  UBPtr = Builder.CreateAlloca(LongType, nullptr, "polly.par.UBPtr");
+  StridePtr = Builder.CreateAlloca(LongType, nullptr, "polly.par.StridePtr");
+  UserContext = Builder.CreateBitCast(Param, StructData->getType(),
+                                      "polly.par.userContext");
+
+  extractValuesFromStruct(Data, StructData->getAllocatedType(), UserContext,
+                          Map);
+
+  Value *GTid = Builder.CreateLoad(GTidPtr, "polly.par.global_tid");
+  Value *Stride = nullptr;
+  if (IsStatic) {
+    // The runtime narrows the bounds to the first block of iterations of this
+    // thread and returns the distance to its next block.
+    Builder.CreateStore(Builder.getInt32(0), IsLastPtr);
+    Builder.CreateStore(LoopLB, LBPtr);
+    Builder.CreateStore(LoopUB, UBPtr);
+    Builder.CreateStore(ConstantInt::get(LongType, 1), StridePtr);
+    createCallStaticInitKMP(GTid, IsLastPtr, LBPtr, UBPtr, StridePtr,
+                            LoopStride);
+    if (!IsSingleBlock)
+      Stride = Builder.CreateLoad(StridePtr, "polly.par.blockStride");
+  } else {
+    createCallDispatchInitKMP(GTid, LoopLB, LoopUB, LoopStride);
+  }
+  Builder.CreateBr(CheckNextBB);
+
+  // Add code to check if another set of iterations will be executed. The
+  // bounds of the LLVM OpenMP runtime are inclusive.
+  Builder.SetInsertPoint(CheckNextBB);
+  if (IsStatic) {
+    LB = Builder.CreateLoad(LBPtr, "polly.par.LB");
+    Value *BlockUB = Builder.CreateLoad(UBPtr, "polly.par.blockUB");
+    Value *IsLastBlock =
+        Builder.CreateICmpSLT(LoopUB, BlockUB, "polly.par.isLastBlock");
+    UB = Builder.CreateSelect(IsLastBlock, LoopUB, BlockUB, "polly.par.UB");
+    HasNextSchedule =
+        Builder.CreateICmpSLE(LB, UB, "polly.par.hasNextScheduleBlock");
+  } else {
+    HasNextSchedule =
+        createCallDispatchNextKMP(GTid, IsLastPtr, LBPtr, UBPtr, StridePtr);
+  }
+  Builder.CreateCondBr(HasNextSchedule, PreHeaderBB, ExitBB);
+
+  // Add code to load the iv bounds for this set of iterations.
+  Builder.SetInsertPoint(PreHeaderBB);
+  if (!IsStatic) {
+    LB = Builder.CreateLoad(LBPtr, "polly.par.LB");
+    UB = Builder.CreateLoad(UBPtr, "polly.par.UB");
+  }
+  Instruction *Next = Builder.CreateBr(IsSingleBlock ? ExitBB : CheckNextBB);
+
+  // With chunked static scheduling, the next block of iterations of this
+  // thread is Stride iterations ahead.
+  if (IsStatic && !IsSingleBlock) {
+    Builder.SetInsertPoint(Next);
+    Value *NextLB = Builder.CreateAdd(Builder.CreateLoad(LBPtr), Stride,
+                                      "polly.par.nextLB");
+    Next = cast<Instruction>(NextLB)->getPrevNode();
+    Builder.CreateStore(NextLB, LBPtr);
+    Value *NextUB = Builder.CreateAdd(Builder.CreateLoad(UBPtr), Stride,
+                                      "polly.par.nextUB");
+    Builder.CreateStore(NextUB, UBPtr);
+  }
+
+  Builder.SetInsertPoint(Next);
+  IV = createLoop(LB, UB, LoopStride, Builder, LI, DT, AfterBB,
+                  ICmpInst::ICMP_SLE, nullptr, true, /* UseGuard */ false);
+
+  BasicBlock::iterator LoopBody = Builder.GetInsertPoint();
+
+  // Add code to terminate this subfunction.
+  Builder.SetInsertPoint(ExitBB);
+  if (IsStatic)
+    createCallStaticFiniKMP(GTid);
+  Builder.CreateRetVoid();
+
+  Builder.SetInsertPoint(&*LoopBody);
+  *SubFnPtr = SubFn;
+
+  return IV;
+}
@@ -0,0 +1,444 @@
+//===- SPDEmulator.cpp - host emulation of SPD kernels --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file generates a host function computing the same streams as the SPD
+// kernel printed by SPDPrinter.
+//
+//===----------------------------------------------------------------------===//
+
+#include "polly/ScopInfo.h"
+#include "polly/CodeGen/SPDEmulator.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+using namespace polly;
+
+// word Offset of element Idx, the words of a separate stream are planes of
+// PlaneSize elements (PlaneSize is nullptr for interleaved streams)
+static Value *getStreamElement(IRBuilder<> &IRB, Value *Stream, Value *Idx,
+                               uint32_t Stride, int Offset,
+                               Value *PlaneSize = nullptr) {
+  Value *Addr;
+  if (PlaneSize != nullptr) {
+    Addr = IRB.CreateMul(PlaneSize, IRB.getInt64(Offset));
+    Addr = IRB.CreateAdd(Addr, Idx);
+  }
+  else {
+    Addr = IRB.CreateMul(Idx, IRB.getInt64(Stride));
+    Addr = IRB.CreateAdd(Addr, IRB.getInt64(Offset));
+  }
+
+  return IRB.CreateGEP(Stream, Addr);
+}
+
+// the words of a stream are 32 bits wide, elements of integer arrays are
+// accessed with their bit pattern
+static Value *castStreamElement(IRBuilder<> &IRB, Value *Ptr, Type *Ty) {
+  return IRB.CreatePointerCast(Ptr, Ty->getPointerTo());
+}
+
+// Dst[i * DstStride + DstOffset] = Src[i * SrcStride + SrcOffset], both
+// streams have the layout given by Separate
+static void createCopyLoop(IRBuilder<> &IRB, Value *Src, uint32_t SrcStride,
+                           int SrcOffset, Value *Dst, uint32_t DstStride,
+                           int DstOffset, Value *NumElems, bool Separate) {
+  Function *F = IRB.GetInsertBlock()->getParent();
+  LLVMContext &Ctx = F->getContext();
+  BasicBlock *PreBB = IRB.GetInsertBlock();
+  BasicBlock *LoopBB = BasicBlock::Create(Ctx, "copy", F);
+  BasicBlock *ExitBB = BasicBlock::Create(Ctx, "copy.exit", F);
+  IRB.CreateCondBr(IRB.CreateICmpSGT(NumElems, IRB.getInt64(0)),
+                   LoopBB, ExitBB);
+
+  IRB.SetInsertPoint(LoopBB);
+  PHINode *Idx = IRB.CreatePHI(IRB.getInt64Ty(), 2, "i");
+  Idx->addIncoming(IRB.getInt64(0), PreBB);
+  Value *PlaneSize = Separate ? NumElems : nullptr;
+  Value *Elmt = IRB.CreateLoad(getStreamElement(IRB, Src, Idx, SrcStride,
+                                                SrcOffset, PlaneSize));
+  IRB.CreateStore(Elmt, getStreamElement(IRB, Dst, Idx, DstStride, DstOffset,
+                                         PlaneSize));
+  Value *NextIdx = IRB.CreateAdd(Idx, IRB.getInt64(1));
+  Idx->addIncoming(NextIdx, LoopBB);
+  IRB.CreateCondBr(IRB.CreateICmpSLT(NextIdx, NumElems), LoopBB, ExitBB);
+
+  IRB.SetInsertPoint(ExitBB);
+}
+
+static Value *createStreamAlloc(IRBuilder<> &IRB, Module &M,
+                                Value *NumElems, uint32_t Stride) {
+  Value *Malloc = M.getOrInsertFunction("malloc", IRB.getInt8PtrTy(),
+                                        IRB.getInt64Ty());
+  Value *Size = IRB.CreateMul(NumElems, IRB.getInt64(Stride * sizeof(float)));
+  Value *Ptr = IRB.CreateCall(Malloc, {Size});
+  return IRB.CreatePointerCast(Ptr, Type::getFloatPtrTy(M.getContext()));
+}
+
+static void createStreamFree(IRBuilder<> &IRB, Module &M, Value *Stream) {
+  Value *Free = M.getOrInsertFunction("free", IRB.getVoidTy(),
+                                      IRB.getInt8PtrTy());
+  IRB.CreateCall(Free, {IRB.CreatePointerCast(Stream, IRB.getInt8PtrTy())});
+}
+
+Value *SPDEmulator::getStreamElement(Value *Stream, Value *Idx,
+                                     const SPDStreamInfo *SI, int Offset) {
+  return ::getStreamElement(IRB, Stream, Idx, SI->getStride(), Offset,
+                            SI->isSeparate() ? NumElems : nullptr);
+}
+
+// mRowBroadcast replays the row for every stream element, positions outside
+// of the row read pConstWord(0)
+Value *SPDEmulator::emitBroadcastRead(SPDInstr *I) {
+  MemoryAccess *MA = I->getMemoryAccess();
+  const SPDArrayInfo *AI = IR->getArrayInfo(MA->getOriginalBaseAddr());
+  Value *RowLength = IRB.getInt64(AI->getNumElements());
+
+  Value *Idx = IRB.CreateURem(Pos, RowLength);
+  Idx = IRB.CreateAdd(Idx, IRB.getInt64(I->getStreamOffset()));
+  Value *InRange = IRB.CreateAnd(IRB.CreateICmpSGE(Idx, IRB.getInt64(0)),
+                                 IRB.CreateICmpSLT(Idx, RowLength));
+  Idx = IRB.CreateSelect(InRange, Idx, IRB.getInt64(0));
+  Value *Ptr = getStreamElement(BroadcastStream, Idx,
+                                IR->getBroadcastStream(), AI->getOffset());
+  Value *Elmt
+    = IRB.CreateLoad(castStreamElement(IRB, Ptr,
+                                       I->getLLVMInstr()->getType()));
+  return IRB.CreateSelect(InRange, Elmt,
+                          Constant::getNullValue(Elmt->getType()));
+}
+
+// parameters arrive as 32-bit words, integers as their bit pattern
+Value *SPDEmulator::emitParam(const SPDParamInfo *PI, Value *Params) {
+  Value *Word
+    = IRB.CreateLoad(IRB.CreateGEP(Params, IRB.getInt64(PI->getIndex())));
+  Type *Ty = PI->getValue()->getType();
+  if (Ty->isFloatTy()) {
+    return Word;
+  }
+  else if (Ty->isDoubleTy()) {
+    return IRB.CreateFPExt(Word, Ty);
+  }
+  else if (Ty->isIntegerTy()) {
+    Value *Bits = IRB.CreateBitCast(Word, IRB.getInt32Ty());
+    return IRB.CreateSExtOrTrunc(Bits, Ty);
+  }
+
+  llvm_unreachable("unsupported parameter type");
+}
+
+// emulates mDomainAttr: the position of the element in each dimension is
+// compared against the domain registers
+Value *SPDEmulator::emitDomainAttr(Value *Domain) {
+  int NumDims = IR->getDomainInfo()->getNumDims();
+  Value *Idx = Pos;
+  Value *Cond = IRB.getTrue();
+  for (int i = 0; i < NumDims; i++) {
+    Value *Start = IRB.CreateLoad(IRB.CreateGEP(Domain, IRB.getInt64(3 * i)));
+    Value *End
+      = IRB.CreateLoad(IRB.CreateGEP(Domain, IRB.getInt64(3 * i + 1)));
+    Value *Size
+      = IRB.CreateLoad(IRB.CreateGEP(Domain, IRB.getInt64(3 * i + 2)));
+
+    Value *DimIdx = IRB.CreateURem(Idx, Size);
+    Idx = IRB.CreateUDiv(Idx, Size);
+    Cond = IRB.CreateAnd(Cond, IRB.CreateICmpSGE(DimIdx, Start));
+    Cond = IRB.CreateAnd(Cond, IRB.CreateICmpSLE(DimIdx, End));
+  }
+
+  return Cond;
+}
+
+// mStreamForward/mStreamBackward fill the positions outside of the stream
+// with pConstWord(0), so reads beyond the stream boundary return 0
+Value *SPDEmulator::emitRead(SPDInstr *I) {
+  if (I->getConstantValue() != nullptr) {
+    return I->getConstantValue();
+  }
+
+  MemoryAccess *MA = I->getMemoryAccess();
+  const SPDArrayInfo *AI = IR->getArrayInfo(MA->getOriginalBaseAddr());
+  if (AI->getKind() == SPDArrayInfo::Broadcast) {
+    return emitBroadcastRead(I);
+  }
+
+  SPDStreamInfo *SI = IR->getReadStream();
+  Type *Ty = I->getLLVMInstr()->getType();
+  int64_t StreamOffset = I->getStreamOffset();
+
+  if (StreamOffset == 0) {
+    Value *Ptr = getStreamElement(InStream, Pos, SI, AI->getOffset());
+    return IRB.CreateLoad(castStreamElement(IRB, Ptr, Ty));
+  }
+
+  Value *Idx = IRB.CreateAdd(Pos, IRB.getInt64(StreamOffset));
+  Value *InRange = IRB.CreateAnd(IRB.CreateICmpSGE(Idx, IRB.getInt64(0)),
+                                 IRB.CreateICmpSLT(Idx, NumElems));
+  Idx = IRB.CreateSelect(InRange, Idx, Pos);
+  Value *Ptr = getStreamElement(InStream, Idx, SI, AI->getOffset());
+  Value *Elmt = IRB.CreateLoad(castStreamElement(IRB, Ptr, Ty));
+  return IRB.CreateSelect(InRange, Elmt,
+                          Constant::getNullValue(Elmt->getType()));
+}
+
+// emulates "EQU out = mux(orig, value, iattr[0])"
+void SPDEmulator::emitWrite(SPDInstr *I) {
+  Instruction *Instr = I->getLLVMInstr();
+  Value *UniqueMemRead = IR->getUniqueMemRead(Instr->getOperand(0),
+                                              I->getStmt());
+  if (UniqueMemRead == nullptr) {
+    llvm_unreachable("cannot find a original value for masking output");
+  }
+
+  const SPDArrayInfo *RAI = IR->getArrayInfo(UniqueMemRead);
+  Type *Ty = Instr->getOperand(0)->getType();
+  Value *Orig
+    = IRB.CreateLoad(castStreamElement(
+        IRB, getStreamElement(InStream, Pos, IR->getReadStream(),
+                              RAI->getOffset()), Ty));
+
+  Value *Result = IRB.CreateSelect(InDomain,
+                                   getEmulatedValue(Instr->getOperand(0)),
+                                   Orig);
+
+  MemoryAccess *MA = I->getMemoryAccess();
+  const SPDArrayInfo *WAI = IR->getArrayInfo(MA->getOriginalBaseAddr());
+  IRB.CreateStore(Result,
+                  castStreamElement(
+                    IRB, getStreamElement(OutStream, Pos,
+                                          IR->getWriteStream(),
+                                          WAI->getOffset()), Ty));
+}
+
+Value *SPDEmulator::getEmulatedValue(Value *V) {
+  auto Iter = ValueMap.find(V);
+  if (Iter != ValueMap.end()) {
+    return Iter->second;
+  }
+
+  if (isa<Constant>(V)) {
+    return V;
+  }
+
+  llvm_unreachable("unsupported value in SPD kernel");
+}
+
+void SPDEmulator::emitInstruction(SPDInstr *I) {
+  Instruction *Instr = I->getLLVMInstr();
+  if (Instr->mayReadFromMemory()) {
+    ValueMap[Instr] = emitRead(I);
+  }
+  else if (Instr->mayWriteToMemory()) {
+    emitWrite(I);
+  }
+  else if (Instr->isBinaryOp()) {
+    Instruction *NewInstr = Instr->clone();
+    for (unsigned i = 0; i < NewInstr->getNumOperands(); i++) {
+      NewInstr->setOperand(i, getEmulatedValue(Instr->getOperand(i)));
+    }
+
+    IRB.Insert(NewInstr);
+    ValueMap[Instr] = NewInstr;
+  }
+  else {
+    llvm_unreachable("unsupported instruction");
+  }
+}
+
+SPDEmulator::SPDEmulator(SPDIR *I, Module &M)
+  : IR(I), IRB(M.getContext()) {
+  LLVMContext &Ctx = M.getContext();
+  Type *FloatPtrTy = Type::getFloatPtrTy(Ctx);
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+  Type *Int64PtrTy = Type::getInt64PtrTy(Ctx);
+
+  std::string FuncName("kernel");
+  FuncName += std::to_string(IR->getKernelNum()) + "_emu";
+  FunctionType *FT
+    = FunctionType::get(Type::getVoidTy(Ctx),
+                        {FloatPtrTy, FloatPtrTy, FloatPtrTy, FloatPtrTy,
+                         Int64PtrTy, Int64Ty},
+                        false);
+  EmuFunc = Function::Create(FT, Function::InternalLinkage, FuncName, &M);
+
+  auto AI = EmuFunc->arg_begin();
+  InStream = &*AI++;
+  InStream->setName("instream");
+  OutStream = &*AI++;
+  OutStream->setName("outstream");
+  BroadcastStream = &*AI++;
+  BroadcastStream->setName("bcaststream");
+  Value *Params = &*AI++;
+  Params->setName("params");
+  Value *Domain = &*AI++;
+  Domain->setName("domain");
+  Value *StreamSize = &*AI;
+  StreamSize->setName("streamsize");
+
+  BasicBlock *EntryBB = BasicBlock::Create(Ctx, "entry", EmuFunc);
+  BasicBlock *LoopBB = BasicBlock::Create(Ctx, "loop", EmuFunc);
+  BasicBlock *ExitBB = BasicBlock::Create(Ctx, "exit", EmuFunc);
+
+  uint32_t InStride = IR->getReadStream()->getStride();
+  uint32_t OutStride = IR->getWriteStream()->getStride();
+
+  IRB.SetInsertPoint(EntryBB);
+  for (auto Iter = IR->param_begin(); Iter != IR->param_end(); Iter++) {
+    const SPDParamInfo *PI = *Iter;
+    ValueMap[PI->getValue()] = emitParam(PI, Params);
+  }
+
+  NumElems = IRB.CreateUDiv(StreamSize, IRB.getInt64(InStride), "numelems");
+  IRB.CreateCondBr(IRB.CreateICmpSGT(NumElems, IRB.getInt64(0)),
+                   LoopBB, ExitBB);
+
+  IRB.SetInsertPoint(LoopBB);
+  PHINode *PosPHI = IRB.CreatePHI(Int64Ty, 2, "pos");
+  PosPHI->addIncoming(IRB.getInt64(0), EntryBB);
+  Pos = PosPHI;
+
+  if (IR->hasDeviceAttr()) {
+    InAttr = nullptr;
+    InDomain = emitDomainAttr(Domain);
+  }
+  else {
+// last elmt is attr
+    InAttr = IRB.CreateLoad(getStreamElement(InStream, Pos,
+                                             IR->getReadStream(),
+                                             InStride - 1), "iattr");
+    Value *Bits = IRB.CreateBitCast(InAttr, IRB.getInt32Ty());
+    InDomain = IRB.CreateICmpNE(IRB.CreateAnd(Bits, IRB.getInt32(1)),
+                                IRB.getInt32(0));
+  }
+
+  for (auto Iter = IR->instr_begin(); Iter != IR->instr_end(); Iter++) {
+    emitInstruction(*Iter);
+  }
+
+// DRCT (oattr) = (iattr)
+  if (InAttr != nullptr) {
+    IRB.CreateStore(InAttr, getStreamElement(OutStream, Pos,
+                                             IR->getWriteStream(),
+                                             OutStride - 1));
+  }
+
+  Value *NextPos = IRB.CreateAdd(Pos, IRB.getInt64(1), "pos.next");
+  PosPHI->addIncoming(NextPos, LoopBB);
+  IRB.CreateCondBr(IRB.CreateICmpSLT(NextPos, NumElems), LoopBB, ExitBB);
+
+  IRB.SetInsertPoint(ExitBB);
+  IRB.CreateRetVoid();
+}
+
+Function *SPDEmulator::createChainEmulator(SPDChain *C,
+                                           std::vector<Function *> &Stages,
+                                           Module &M) {
+  LLVMContext &Ctx = M.getContext();
+  std::string FuncName("chain");
+  FuncName += std::to_string(C->getRegionNumber()) + "_emu";
+  Function *Func = Function::Create(Stages.front()->getFunctionType(),
+                                    Function::InternalLinkage, FuncName, &M);
+
+  auto AI = Func->arg_begin();
+  Value *InStream = &*AI++;
+  InStream->setName("instream");
+  Value *OutStream = &*AI++;
+  OutStream->setName("outstream");
+  Value *BroadcastStream = &*AI++;
+  BroadcastStream->setName("bcaststream");
+  Value *Params = &*AI++;
+  Params->setName("params");
+  Value *Domain = &*AI++;
+  Domain->setName("domain");
+  Value *StreamSize = &*AI;
+  StreamSize->setName("streamsize");
+
+  IRBuilder<> IRB(BasicBlock::Create(Ctx, "entry", Func));
+  uint32_t ChainInStride = C->getReadStream()->getStride();
+  Value *NumElems = IRB.CreateUDiv(StreamSize, IRB.getInt64(ChainInStride),
+                                   "numelems");
+
+  std::vector<Value *> StageOut;
+  std::vector<Value *> Temps;
+  for (int i = 0; i < C->getNumStages(); i++) {
+    SPDIR *IR = C->getStage(i);
+    uint32_t InStride = IR->getReadStream()->getStride();
+    uint32_t OutStride = IR->getWriteStream()->getStride();
+
+    Value *StageIn = InStream;
+    if (i > 0) {
+      StageIn = createStreamAlloc(IRB, M, NumElems, InStride);
+      Temps.push_back(StageIn);
+      for (auto Iter = IR->read_begin(); Iter != IR->read_end(); Iter++) {
+        Value *V = (*Iter)->getArrayRef();
+        int Writer = C->getWriter(V, i);
+        Value *Src = InStream;
+        SPDIR *SrcIR = C->getFirstStage();
+        uint32_t SrcStride = SrcIR->getReadStream()->getStride();
+        if (Writer >= 0) {
+          Src = StageOut[Writer];
+          SrcIR = C->getStage(Writer);
+          SrcStride = SrcIR->getWriteStream()->getStride();
+        }
+
+        createCopyLoop(IRB, Src, SrcStride,
+                       SrcIR->getArrayInfo(V)->getOffset(),
+                       StageIn, InStride, (*Iter)->getOffset(), NumElems,
+                       C->hasSeparateStreams());
+      }
+
+// last elmt is attr
+      if (!C->hasDeviceAttr()) {
+        SPDIR *PrevIR = C->getStage(i - 1);
+        uint32_t PrevStride = PrevIR->getWriteStream()->getStride();
+        createCopyLoop(IRB, StageOut[i - 1], PrevStride, PrevStride - 1,
+                       StageIn, InStride, InStride - 1, NumElems,
+                       C->hasSeparateStreams());
+      }
+    }
+
+    Value *Out = createStreamAlloc(IRB, M, NumElems, OutStride);
+    Temps.push_back(Out);
+    StageOut.push_back(Out);
+
+    Value *Size = IRB.CreateMul(NumElems, IRB.getInt64(InStride));
+    IRB.CreateCall(Stages[i], {StageIn, Out, BroadcastStream, Params, Domain,
+                               Size});
+  }
+
+  uint32_t Stride = C->getWriteStream()->getStride();
+  int Idx = 0;
+  for (auto Iter = C->write_begin(); Iter != C->write_end(); Iter++) {
+    int Writer = C->getWriteStage(Idx);
+    SPDIR *SrcIR = C->getStage(Writer);
+    const SPDArrayInfo *SrcAI = SrcIR->getArrayInfo((*Iter)->getArrayRef());
+    createCopyLoop(IRB, StageOut[Writer],
+                   SrcIR->getWriteStream()->getStride(), SrcAI->getOffset(),
+                   OutStream, Stride, (*Iter)->getOffset(), NumElems,
+                   C->hasSeparateStreams());
+    Idx++;
+  }
+
+  if (!C->hasDeviceAttr()) {
+    SPDIR *LastIR = C->getStage(C->getNumStages() - 1);
+    uint32_t LastStride = LastIR->getWriteStream()->getStride();
+    createCopyLoop(IRB, StageOut.back(), LastStride, LastStride - 1,
+                   OutStream, Stride, Stride - 1, NumElems,
+                   C->hasSeparateStreams());
+  }
+
+  for (Value *Temp : Temps) {
+    createStreamFree(IRB, M, Temp);
+  }
+
+  IRB.CreateRetVoid();
+  return Func;
+}
@@ -13,25 +13,84 @@
 
 #include "isl/map.h"
 #include "isl/set.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Value.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+#include "polly/Options.h"
 #include "polly/ScopInfo.h"
 #include "polly/CodeGen/SPDIR.h"
 #include "polly/CodeGen/SPDPrinter.h"
+#include "polly/CodeGen/SPDRangeAnalysis.h"
+#include <algorithm>
 #include <vector>
 
-// FIXME for test
-#include "isl/id.h"
-#include <iostream>
-#include <cstdio>
-
 using namespace llvm;
 using namespace polly;
 
+static cl::opt<bool> SPDConstantParams(
+    "polly-spd-constant-params",
+    cl::desc("Pass floating-point literals of SPD kernels as runtime "
+             "parameters instead of synthesizing them into the datapath"),
+    cl::Hidden, cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<bool> SPDDeviceAttr(
+    "polly-spd-device-attr",
+    cl::desc("Generate the SPD write domain on the device instead of "
+             "streaming an attr word per element"),
+    cl::Hidden, cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<unsigned> SPDTileWidth(
+    "polly-spd-tile-width",
+    cl::desc("Stream 2-D SPD kernels wider than the given number of columns "
+             "as overlapping column tiles of that width (0 = no tiling)"),
+    cl::Hidden, cl::init(0), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+enum SPDLayoutKind { SPD_LAYOUT_INTERLEAVED, SPD_LAYOUT_SEPARATE };
+
+static cl::opt<SPDLayoutKind> SPDLayout(
+    "polly-spd-layout",
+    cl::desc("Layout of the arrays in the SPD read and write streams"),
+    cl::values(clEnumValN(SPD_LAYOUT_INTERLEAVED, "interleaved",
+                          "One stream, the arrays interleaved per element"),
+               clEnumValN(SPD_LAYOUT_SEPARATE, "separate",
+                          "One stream and channel per array")),
+    cl::Hidden, cl::init(SPD_LAYOUT_INTERLEAVED), cl::ZeroOrMore,
+    cl::cat(PollyCategory));
+
+static cl::list<std::string> SPDCompressArrays(
+    "polly-spd-compress-arrays",
+    cl::desc("Send the given input arrays of SPD kernels run-length encoded "
+             "(untiled kernels with -polly-spd-layout=separate only)"),
+    cl::Hidden, cl::ZeroOrMore, cl::CommaSeparated, cl::cat(PollyCategory));
+
+static cl::opt<bool> SPDNarrowIntOps(
+    "polly-spd-narrow-int-ops",
+    cl::desc("Synthesize the integer operators of SPD kernels with the "
+             "width of their value range instead of their type"),
+    cl::Hidden, cl::init(true), cl::ZeroOrMore, cl::cat(PollyCategory));
+
 static int KernelNumCount = 0;
 
+static bool isArrayRef(Value *BaseAddr) {
+  return BaseAddr->getType()->getPointerElementType()->isArrayTy();
+}
+
+// reads of scalar globals are loop invariant and become kernel parameters
+static bool isScalarRead(Instruction *I, const ScopStmt &Stmt) {
+  if (!I->mayReadFromMemory()) {
+    return false;
+  }
+
+  MemoryAccess *MA = Stmt.getArrayAccessOrNULLFor(I);
+  return (MA != nullptr) && !isArrayRef(MA->getOriginalBaseAddr());
+}
+
 SPDInstr *SPDInstr::get(Instruction *I,
                         const ScopStmt *Stmt, SPDIR *IR) {
   if (I->mayWriteToMemory()) {
@@ -41,9 +100,27 @@ SPDInstr *SPDInstr::get(Instruction *I,
   if (I->mayReadFromMemory()) {
     MemoryAccess *MA = Stmt->getArrayAccessOrNULLFor(I);
     const SPDArrayInfo *AI = IR->getArrayInfo(MA->getOriginalBaseAddr());
+    if (AI->getKind() == SPDArrayInfo::Constant) {
+      GlobalVariable *GV = cast<GlobalVariable>(AI->getArrayRef());
+      Constant *CV = GV->getInitializer();
+      for (unsigned i = 0; i < MA->getNumSubscripts(); i++) {
+        const SCEVConstant *Idx = cast<SCEVConstant>(MA->getSubscript(i));
+        CV = CV->getAggregateElement(Idx->getValue());
+      }
+
+      assert((CV != nullptr) && "constant array read out of bounds");
+      return new SPDInstr(I, Stmt, IR, 0, CV);
+    }
+
+// rows of a tiled stream are as wide as a tile
+    std::vector<uint64_t> DimSizeList(AI->begin(), AI->end());
+    if (IR->getTileWidth() != 0) {
+      DimSizeList[0] = IR->getTileWidth();
+    }
+
     std::vector<int64_t> DimAccList;
     int64_t DimAcc = 1;
-    for (uint64_t DimSize : *AI) {
+    for (uint64_t DimSize : DimSizeList) {
       DimAccList.push_back(DimAcc);
       DimAcc *= DimSize;
     }
@@ -124,7 +201,8 @@ MemoryAccess *SPDInstr::getMemoryAccess() const {
   return ParentStmt->getArrayAccessOrNULLFor(LLVMInstr);
 }
 
-SPDArrayInfo::SPDArrayInfo(Value *V, int O) : Offset(O), LLVMValue(V) {
+SPDArrayInfo::SPDArrayInfo(Value *V, int O, ArrayKind K)
+  : Offset(O), Kind(K), Compressed(false), LLVMValue(V) {
   if (!isa<GlobalVariable>(V)) {
     llvm_unreachable("MemoryAccess must be a global variable");
   }
@@ -143,27 +221,53 @@ SPDArrayInfo::SPDArrayInfo(Value *V, int O) : Offset(O), LLVMValue(V) {
     T = ATy->getElementType();
   } while (T->isArrayTy());
 
-  if (!T->isFloatTy()) {
-    llvm_unreachable("MemoryAccess must be an array of float");
+// the stream words are 32 bits, integer arrays keep their bit pattern
+  if (!T->isFloatTy() && !T->isIntegerTy(32)) {
+    llvm_unreachable("MemoryAccess must be an array of float or i32");
+  }
+}
+
+uint64_t SPDArrayInfo::getNumElements() const {
+  uint64_t NumElements = 1;
+  for (uint64_t DimSize : DimSizeList) {
+    NumElements *= DimSize;
   }
+
+  return NumElements;
 }
 
 void SPDArrayInfo::dump() const {
   LLVMValue->dump();
   for (int i = 0; i < getNumDims(); i++) {
-    std::cerr << DimSizeList[i] << "\n";
+    errs() << DimSizeList[i] << "\n";
   }
 }
 
-SPDStreamInfo::SPDStreamInfo(uint32_t NumArrays, int NumDims, uint64_t *L)
-  : Stride(NumArrays + 1) { // last elmt is attr
+std::string SPDParamInfo::getName() const {
+  if (LLVMValue->hasName()) {
+    return LLVMValue->getName().str();
+  }
+
+// FIXME requires unique prefix
+  return "xxxp" + std::to_string(Index);
+}
+
+SPDStreamInfo::SPDStreamInfo(uint32_t NumArrays, int NumDims, uint64_t *L,
+                             bool HasAttr, bool Separate)
+  : Stride(HasAttr ? NumArrays + 1 : NumArrays), // last elmt is attr
+    Separate(Separate) {
   for (int i = 0; i < NumDims; i++) {
     DimSizeList.push_back(L[i]);
   }
 }
 
 SPDIR::SPDIR(const Scop &S, LoopInfo &LI, ScalarEvolution &SE)
-  : KernelNum(KernelNumCount), DI(nullptr) {
+  : KernelNum(KernelNumCount),
+    ModuleName("kernel" + std::to_string(KernelNumCount)),
+    DeviceAttr(SPDDeviceAttr), NumInstrs(0),
+    MaxStreamOffset(0), TileWidth(0), GridWidth(0), ColumnHalo(0),
+    DI(nullptr),
+    BroadcastStream(nullptr) {
   KernelNumCount++;
 
 // FIXME temporary limitation
@@ -172,23 +276,26 @@ SPDIR::SPDIR(const Scop &S, LoopInfo &LI, ScalarEvolution &SE)
 
 // Analysis
 // 1. generates steam info
+// written arrays define the rank of the kernel, so they come first
   int Offset = 0;
   for (const ScopStmt &Stmt : S) {
     for (const MemoryAccess *MA : Stmt) {
-      addReadAccess(MA, Offset);
+      addWriteAccess(MA, Offset);
     }
   }
 
-  createReadStreamInfo();
+  createWriteStreamInfo();
 
   Offset = 0;
+  int BroadcastOffset = 0;
   for (const ScopStmt &Stmt : S) {
     for (const MemoryAccess *MA : Stmt) {
-      addWriteAccess(MA, Offset);
+      addReadAccess(MA, Offset, BroadcastOffset);
     }
   }
 
-  createWriteStreamInfo();
+  createReadStreamInfo();
+  createBroadcastStreamInfo();
 
 // FIXME temporary limitation
   if (ReadStream->getAllocSize() !=
@@ -206,25 +313,95 @@ SPDIR::SPDIR(const Scop &S, LoopInfo &LI, ScalarEvolution &SE)
     generateWriteDomain(Stmt);
   }
 
+// 3. splits wide grids into column tiles
+  for (const ScopStmt &Stmt : S) {
+    tileStreams(Stmt);
+  }
+
+// 4. selects the compressed input channels
+  selectCompressedArrays();
+
 // IR Generation
   for (const ScopStmt &Stmt : S) {
     BasicBlock *BB = Stmt.getBasicBlock();
     for (BasicBlock::iterator IIB = BB->begin(), IIE = BB->end();
          IIB != IIE; ++IIB) {
       Instruction &I = *IIB;
+      if (isScalarRead(&I, Stmt)) continue;
+
       SPDInstr *NewInstr = SPDInstr::get(&I, &Stmt, this);
       if (NewInstr != nullptr) {
         InstrList.push_back(NewInstr);
+        InstrIndex[&I] = NewInstr;
       }
     }
   }
 
   removeDeadInstrs();
+  NumInstrs = InstrList.size();
+  collectParams();
+
+  if (SPDNarrowIntOps) {
+    computeBitWidths(S, SE);
+  }
+
+  MaxStreamOffset = computeMaxStreamOffset();
+}
+
+void SPDIR::releaseInstrs() {
+  for (SPDInstr *I : InstrList) {
+    delete I;
+  }
+
+  InstrList.clear();
+  InstrIndex.clear();
+  UniqueMemReadCache.clear();
+  BitWidths.clear();
 }
 
 bool SPDIR::has(Instruction *TargetInstr) const {
+  return InstrIndex.count(TargetInstr) != 0;
+}
+
+uint64_t SPDIR::computeMaxStreamOffset() const {
+  uint64_t MaxOffset = 0;
   for (SPDInstr *I : InstrList) {
-    if (I->equal(TargetInstr)) {
+    if (!I->getLLVMInstr()->mayReadFromMemory()) continue;
+
+    MemoryAccess *MA = I->getMemoryAccess();
+    const SPDArrayInfo *AI = getArrayInfo(MA->getOriginalBaseAddr());
+    if (AI->getKind() != SPDArrayInfo::Stream) continue;
+
+    int64_t StreamOffset = I->getStreamOffset();
+    uint64_t OffsetAbs
+      = (StreamOffset > 0) ? StreamOffset : -StreamOffset;
+    if (OffsetAbs > MaxOffset) {
+      MaxOffset = OffsetAbs;
+    }
+  }
+
+  return MaxOffset;
+}
+
+// Only the channels of a separate stream can be encoded on their own, tiles
+// are sent as a whole
+void SPDIR::selectCompressedArrays() {
+  if (!hasSeparateStreams() || (TileWidth != 0)) {
+    return;
+  }
+
+  for (SPDArrayInfo *AI : ReadAccesses) {
+    StringRef Name = AI->getArrayRef()->getName();
+    if (std::find(SPDCompressArrays.begin(), SPDCompressArrays.end(),
+                  Name.str()) != SPDCompressArrays.end()) {
+      AI->setCompressed();
+    }
+  }
+}
+
+bool SPDIR::hasCompressedArrays() const {
+  for (SPDArrayInfo *AI : ReadAccesses) {
+    if (AI->isCompressed()) {
       return true;
     }
   }
@@ -232,20 +409,109 @@ bool SPDIR::has(Instruction *TargetInstr) const {
   return false;
 }
 
+// the ranges come from the Scop, which is gone when the kernel is printed.
+// An operator computes with operands truncated to its width, which is
+// enough for add, sub and mul as they wrap. The low bits of a quotient
+// depend on the high bits of the operands, a divider gets the width of its
+// widest operand as well.
+void SPDIR::computeBitWidths(const Scop &S, ScalarEvolution &SE) {
+  SPDRangeAnalysis RA(S, SE);
+  for (SPDInstr *I : InstrList) {
+    Instruction *Instr = I->getLLVMInstr();
+    if (!Instr->isBinaryOp() || !Instr->getType()->isIntegerTy()) {
+      continue;
+    }
+
+    unsigned BitWidth
+      = SPDRangeAnalysis::getBitWidth(RA.getRange(Instr, I->getStmt()));
+    if ((Instr->getOpcode() == Instruction::UDiv) ||
+        (Instr->getOpcode() == Instruction::SDiv)) {
+      for (Value *Op : Instr->operands()) {
+        BitWidth = std::max(BitWidth, SPDRangeAnalysis::getBitWidth(
+                                          RA.getRange(Op, I->getStmt())));
+      }
+    }
+
+    BitWidths[Instr] = BitWidth;
+  }
+}
+
+unsigned SPDIR::getBitWidth(Instruction *I) const {
+  auto Iter = BitWidths.find(I);
+  if (Iter != BitWidths.end()) {
+    return Iter->second;
+  }
+
+  return I->getType()->getScalarSizeInBits();
+}
+
+Value *SPDIR::getUniqueMemRead(Value *V, const ScopStmt *Stmt) const {
+  auto Iter = UniqueMemReadCache.find(V);
+  if (Iter != UniqueMemReadCache.end()) {
+    return Iter->second;
+  }
+
+  Value *Ret = computeUniqueMemRead(V, Stmt);
+  UniqueMemReadCache[V] = Ret;
+  return Ret;
+}
+
+Value *SPDIR::computeUniqueMemRead(Value *V, const ScopStmt *Stmt) const {
+  Instruction *Instr = dyn_cast<Instruction>(V);
+  if (Instr == nullptr) {
+    return nullptr;
+  }
+
+  if (Instr->mayReadFromMemory()) {
+    MemoryAccess *MA = Stmt->getArrayAccessOrNULLFor(Instr);
+    const SPDArrayInfo *AI = getArrayInfo(MA->getOriginalBaseAddr());
+// scalar reads are parameters and have no array info
+    if ((AI == nullptr) || (AI->getKind() != SPDArrayInfo::Stream)) {
+      return nullptr;
+    }
+
+    return MA->getOriginalBaseAddr();
+  }
+
+  Value *Ret = nullptr;
+  for (unsigned i = 0; i < Instr->getNumOperands(); i++) {
+    if (Ret == nullptr) {
+      Ret = getUniqueMemRead(Instr->getOperand(i), Stmt);
+    }
+    else {
+      Value *Temp = getUniqueMemRead(Instr->getOperand(i), Stmt);
+      if (Temp == nullptr) continue;
+      else if (Temp != Ret) return nullptr;
+    }
+  }
+
+  return Ret;
+}
+
 void SPDIR::dump() const {
-  std::cerr << "SPDIR::dump() ---------------------------\n";
+  errs() << "SPDIR::dump() ---------------------------\n";
   for (SPDInstr *I : InstrList) {
     I->dump();
   }
-  std::cerr << "READ ---------------------------\n";
+  errs() << "READ ---------------------------\n";
   for (SPDArrayInfo *AI : ReadAccesses) {
     AI->dump();
   }
 
-  std::cerr << "WRITE --------------------------\n";
+  errs() << "WRITE --------------------------\n";
   for (SPDArrayInfo *AI : WriteAccesses) {
     AI->dump();
   }
+
+  errs() << "BROADCAST ----------------------\n";
+  for (SPDArrayInfo *AI : BroadcastAccesses) {
+    AI->dump();
+  }
+
+  errs() << "CONSTANT -----------------------\n";
+  for (SPDArrayInfo *AI : ConstantAccesses) {
+    AI->dump();
+  }
 }
 
 bool SPDIR::reads(Value *V) const {
@@ -255,6 +521,18 @@ bool SPDIR::reads(Value *V) const {
     }
   }
 
+  for (SPDArrayInfo *R : BroadcastAccesses) {
+    if (R->equal(V)) {
+      return true;
+    }
+  }
+
+  for (SPDArrayInfo *R : ConstantAccesses) {
+    if (R->equal(V)) {
+      return true;
+    }
+  }
+
   return false;
 }
 
@@ -268,18 +546,77 @@ bool SPDIR::writes(Value *V) const {
   return false;
 }
 
-void SPDIR::addReadAccess(const MemoryAccess *MA, int &Offset) {
+SPDArrayInfo::ArrayKind SPDIR::getReadKind(const MemoryAccess *MA) const {
+  Value *BaseAddr = MA->getOriginalBaseAddr();
+
+// constant tables only read at constant subscripts
+  GlobalVariable *GV = dyn_cast<GlobalVariable>(BaseAddr);
+  if ((GV != nullptr) && GV->isConstant() &&
+      GV->hasDefinitiveInitializer()) {
+    bool ConstantSubscripts = true;
+    for (const MemoryAccess *Acc : *(MA->getStatement())) {
+      if (Acc->getOriginalBaseAddr() != BaseAddr) continue;
+
+      for (unsigned i = 0; i < Acc->getNumSubscripts(); i++) {
+        if (!isa<SCEVConstant>(Acc->getSubscript(i))) {
+          ConstantSubscripts = false;
+        }
+      }
+    }
+
+    if (ConstantSubscripts) {
+      return SPDArrayInfo::Constant;
+    }
+  }
+
+// arrays of a lower rank than the kernel are replayed for every row
+  int NumDims = 0;
+  Type *T = BaseAddr->getType()->getPointerElementType();
+  while (T->isArrayTy()) {
+    NumDims++;
+    T = T->getArrayElementType();
+  }
+
+  if (NumDims < WriteStream->getNumDims()) {
+    return SPDArrayInfo::Broadcast;
+  }
+
+  return SPDArrayInfo::Stream;
+}
+
+void SPDIR::addReadAccess(const MemoryAccess *MA, int &Offset,
+                          int &BroadcastOffset) {
   Value *BaseAddr = MA->getOriginalBaseAddr();
   if (MA->isRead()) {
     if (writes(BaseAddr)) {
       llvm_unreachable("READ and WRITE is not allowed");
     }
+    else if (!isArrayRef(BaseAddr)) {
+      // scalar, see collectParams()
+      return;
+    }
     else if (!reads(BaseAddr)) {
-      SPDArrayInfo *AI = new SPDArrayInfo(BaseAddr, Offset);
-      ReadAccesses.push_back(AI);
-      ArrayInfoTable[BaseAddr] = AI;
+      SPDArrayInfo::ArrayKind Kind = getReadKind(MA);
+      SPDArrayInfo *AI = nullptr;
+      switch (Kind) {
+      case SPDArrayInfo::Stream:
+        AI = new SPDArrayInfo(BaseAddr, Offset, Kind);
+        ReadAccesses.push_back(AI);
 // FIXME bad impl
-      Offset++;
+        Offset++;
+        break;
+      case SPDArrayInfo::Broadcast:
+        AI = new SPDArrayInfo(BaseAddr, BroadcastOffset, Kind);
+        BroadcastAccesses.push_back(AI);
+        BroadcastOffset++;
+        break;
+      case SPDArrayInfo::Constant:
+        AI = new SPDArrayInfo(BaseAddr, 0, Kind);
+        ConstantAccesses.push_back(AI);
+        break;
+      }
+
+      ArrayInfoTable[BaseAddr] = AI;
     }
   }
 }
@@ -340,7 +677,13 @@ void SPDIR::createReadStreamInfo() {
     }
   }
 
-  ReadStream = new SPDStreamInfo(NumArrays, NumDims, DimSizeArray);
+  if (TileWidth != 0) {
+    DimSizeArray[0] = TileWidth;
+  }
+
+  ReadStream = new SPDStreamInfo(NumArrays, NumDims, DimSizeArray,
+                                 !DeviceAttr,
+                                 SPDLayout == SPD_LAYOUT_SEPARATE);
   delete[] DimSizeArray;
 }
 
@@ -377,7 +720,46 @@ void SPDIR::createWriteStreamInfo() {
     }
   }
 
-  WriteStream = new SPDStreamInfo(NumArrays, NumDims, DimSizeArray);
+  if (TileWidth != 0) {
+    DimSizeArray[0] = TileWidth;
+  }
+
+  WriteStream = new SPDStreamInfo(NumArrays, NumDims, DimSizeArray,
+                                  !DeviceAttr,
+                                  SPDLayout == SPD_LAYOUT_SEPARATE);
+  delete[] DimSizeArray;
+}
+
+// the broadcast stream holds one row of the innermost dimensions of the
+// kernel, arrays of a lower rank only use its first elements
+void SPDIR::createBroadcastStreamInfo() {
+  if (BroadcastAccesses.empty()) {
+    return;
+  }
+
+  int NumDims = 0;
+  for (SPDArrayInfo *AI : BroadcastAccesses) {
+    int Idx = 0;
+    for (uint64_t DimSize : *AI) {
+      if (DimSize != ReadStream->getSize(Idx)) {
+        llvm_unreachable("broadcast array should match the kernel row size");
+      }
+
+      Idx++;
+    }
+
+    if (AI->getNumDims() > NumDims) {
+      NumDims = AI->getNumDims();
+    }
+  }
+
+  uint64_t *DimSizeArray = new uint64_t[NumDims];
+  for (int i = 0; i < NumDims; i++) {
+    DimSizeArray[i] = ReadStream->getSize(i);
+  }
+
+  BroadcastStream = new SPDStreamInfo(BroadcastAccesses.size(), NumDims,
+                                      DimSizeArray, false);
   delete[] DimSizeArray;
 }
 
@@ -483,18 +865,272 @@ void SPDIR::generateWriteDomain(const ScopStmt &Stmt) {
   }
 }
 
+// The delay lines of a stream offset grow with the row width of the stream.
+// With -polly-spd-tile-width, the rows of a wide 2-D stream are cut into
+// tiles of TileWidth columns which the host streams one after the other.
+// Neighbouring tiles overlap by the largest column distance of a read, so
+// that every written column of a tile sees all of its inputs.
+void SPDIR::tileStreams(const ScopStmt &Stmt) {
+  GridWidth = ReadStream->getSize(0);
+
+  for (const MemoryAccess *MA : Stmt) {
+    if (!MA->isRead()) continue;
+
+    const SPDArrayInfo *AI = getArrayInfo(MA->getOriginalBaseAddr());
+    if ((AI == nullptr) || (AI->getKind() != SPDArrayInfo::Stream)) continue;
+
+    const SCEVAddRecExpr *SExpr
+      = dyn_cast<SCEVAddRecExpr>(MA->getSubscript(MA->getNumSubscripts() - 1));
+    if (SExpr == nullptr) continue;
+
+    const SCEVConstant *StartExpr = dyn_cast<SCEVConstant>(SExpr->getStart());
+    if (StartExpr == nullptr) continue;
+
+    int64_t Distance = StartExpr->getValue()->getSExtValue() - DI->getStart(0);
+    uint64_t DistanceAbs = (Distance > 0) ? Distance : -Distance;
+    if (DistanceAbs > ColumnHalo) {
+      ColumnHalo = DistanceAbs;
+    }
+  }
+
+// FIXME broadcast rows are not tiled yet
+  if ((SPDTileWidth == 0) || (SPDTileWidth >= GridWidth) ||
+      (ReadStream->getNumDims() != 2) || !BroadcastAccesses.empty()) {
+    return;
+  }
+
+  // the channels of a separate stream hold whole arrays, the whole rows are
+  // streamed instead
+  if (hasSeparateStreams()) {
+    errs() << "SPD kernel " << Stmt.getParent()->getFunction().getName()
+           << ": the tile width " << SPDTileWidth
+           << " does not apply to the separate stream layout, the stream is "
+              "not tiled\n";
+    return;
+  }
+
+  // a tile without any written column would never end, the whole rows are
+  // streamed instead
+  if (SPDTileWidth <= 2 * ColumnHalo) {
+    errs() << "SPD kernel " << Stmt.getParent()->getFunction().getName()
+           << ": the tile width " << SPDTileWidth
+           << " does not exceed the column halo " << ColumnHalo
+           << " of both sides, the stream is not tiled\n";
+    return;
+  }
+
+  TileWidth = SPDTileWidth;
+  delete ReadStream;
+  delete WriteStream;
+  createReadStreamInfo();
+  createWriteStreamInfo();
+}
+
+// an instruction dies with its last user, so only the operands of a removed
+// instruction are checked again
 void SPDIR::removeDeadInstrs() {
-  bool ContinueRemove = false;
-  do {
-    ContinueRemove = false;
-    for (auto Iter = InstrList.begin(), IterEnd = InstrList.end();
-         Iter != IterEnd; ++Iter) {
-      SPDInstr *I = *Iter;
-      if (I->isDeadInstr()) {
-        InstrList.erase(Iter);
-        ContinueRemove = true;
-        break;
+  std::vector<SPDInstr *> Worklist;
+  for (SPDInstr *I : InstrList) {
+    if (I->isDeadInstr()) {
+      Worklist.push_back(I);
+    }
+  }
+
+  DenseSet<SPDInstr *> Removed;
+  while (!Worklist.empty()) {
+    SPDInstr *I = Worklist.back();
+    Worklist.pop_back();
+    if (!Removed.insert(I).second) continue;
+
+    Instruction *Instr = I->getLLVMInstr();
+    InstrIndex.erase(Instr);
+
+    for (Value *Op : Instr->operands()) {
+      Instruction *OpInstr = dyn_cast<Instruction>(Op);
+      if (OpInstr == nullptr) continue;
+
+      auto Iter = InstrIndex.find(OpInstr);
+      if ((Iter != InstrIndex.end()) && Iter->second->isDeadInstr()) {
+        Worklist.push_back(Iter->second);
+      }
+    }
+  }
+
+  if (Removed.empty()) {
+    return;
+  }
+
+  std::vector<SPDInstr *> LiveInstrs;
+  for (SPDInstr *I : InstrList) {
+    if (Removed.count(I) != 0) {
+      delete I;
+    }
+    else {
+      LiveInstrs.push_back(I);
+    }
+  }
+
+  InstrList.swap(LiveInstrs);
+}
+
+void SPDIR::addParam(Value *V) {
+  if (ParamTable.find(V) != ParamTable.end()) {
+    return;
+  }
+
+  SPDParamInfo *PI = new SPDParamInfo(V, Params.size());
+  Params.push_back(PI);
+  ParamTable[V] = PI;
+}
+
+// operands defined outside of the kernel datapath are loop invariant, they
+// are read from registers the host sets before __spd_run_kernel
+void SPDIR::collectParams() {
+  for (SPDInstr *I : InstrList) {
+    Instruction *Instr = I->getLLVMInstr();
+    if (Instr->mayReadFromMemory()) continue;
+
+// stores only pass their value operand
+    unsigned NumOperands = Instr->mayWriteToMemory()
+                           ? 1 : Instr->getNumOperands();
+    for (unsigned i = 0; i < NumOperands; i++) {
+      Value *V = Instr->getOperand(i);
+      if (isa<Argument>(V)) {
+        addParam(V);
+      }
+      else if (isa<ConstantFP>(V) && SPDConstantParams) {
+        addParam(V);
+      }
+      else if (Instruction *OpInstr = dyn_cast<Instruction>(V)) {
+        if (isScalarRead(OpInstr, *(I->getStmt()))) {
+          addParam(V);
+        }
+      }
+    }
+  }
+}
+
+SPDChain::SPDChain(std::vector<SPDIR *> &S, uint64_t R)
+  : RegionNumber(R), Stages(S) {
+  assert(!Stages.empty() && "chain should have a stage");
+
+// arrays written by later stages come first
+  int Offset = 0;
+  for (int i = getNumStages() - 1; i >= 0; i--) {
+    SPDIR *IR = Stages[i];
+    for (auto Iter = IR->write_begin(); Iter != IR->write_end(); Iter++) {
+      Value *V = (*Iter)->getArrayRef();
+      bool Found = false;
+      for (SPDArrayInfo *AI : WriteAccesses) {
+        if (AI->equal(V)) Found = true;
+      }
+
+      if (Found) continue;
+
+      WriteAccesses.push_back(new SPDArrayInfo(V, Offset));
+      WriteStages.push_back(i);
+      Offset++;
+    }
+  }
+
+  SPDStreamInfo *SI = getFirstStage()->getWriteStream();
+  uint64_t *DimSizeArray = new uint64_t[SI->getNumDims()];
+  for (int i = 0; i < SI->getNumDims(); i++) {
+    DimSizeArray[i] = SI->getSize(i);
+  }
+
+  WriteStream = new SPDStreamInfo(WriteAccesses.size(), SI->getNumDims(),
+                                  DimSizeArray, !hasDeviceAttr(),
+                                  hasSeparateStreams());
+  delete[] DimSizeArray;
+}
+
+int SPDChain::getWriter(Value *V, int Stage) const {
+  for (int i = Stage - 1; i >= 0; i--) {
+    for (auto Iter = Stages[i]->write_begin();
+         Iter != Stages[i]->write_end(); Iter++) {
+      if ((*Iter)->equal(V)) {
+        return i;
       }
     }
-  } while (ContinueRemove);
+  }
+
+  return -1;
+}
+
+uint64_t SPDChain::getMaxStreamOffset() const {
+  uint64_t MaxOffset = 0;
+  for (SPDIR *IR : Stages) {
+    MaxOffset += IR->getMaxStreamOffset();
+  }
+
+  return MaxOffset;
+}
+
+uint64_t SPDChain::getColumnHalo() const {
+  uint64_t Halo = 0;
+  for (SPDIR *IR : Stages) {
+    Halo += IR->getColumnHalo();
+  }
+
+  return Halo;
+}
+
+// a chain the device cannot stream is reported, its kernels run one by one
+static bool rejectChain(uint64_t RegionNumber, const char *Reason) {
+  errs() << "SPD region " << RegionNumber << ": " << Reason
+         << ", its kernels are not chained\n";
+  return false;
+}
+
+// FIXME temporary limitations
+bool SPDChain::verify() const {
+  SPDIR *First = getFirstStage();
+  SPDStreamInfo *SI = First->getReadStream();
+  for (int i = 0; i < getNumStages(); i++) {
+    SPDIR *IR = Stages[i];
+    for (SPDStreamInfo *Other : {IR->getReadStream(), IR->getWriteStream()}) {
+      if (Other->getNumDims() != SI->getNumDims()) {
+        return rejectChain(RegionNumber,
+                           "chained kernels should have the same stream size");
+      }
+
+      for (int j = 0; j < SI->getNumDims(); j++) {
+        if (Other->getSize(j) != SI->getSize(j)) {
+          return rejectChain(RegionNumber, "chained kernels should have the "
+                                           "same stream size");
+        }
+      }
+    }
+
+// the attr of the first stage is passed down the chain
+    if (!IR->getDomainInfo()->equals(First->getDomainInfo())) {
+      return rejectChain(RegionNumber,
+                         "chained kernels should have the same domain");
+    }
+
+    if ((IR->getNumBroadcasts() != 0) || (IR->getNumParams() != 0)) {
+      return rejectChain(RegionNumber, "chained kernels cannot have broadcast "
+                                       "arrays or parameters");
+    }
+
+// FIXME the decoders of the first stage should move to the chain
+    if ((getNumStages() > 1) && IR->hasCompressedArrays()) {
+      return rejectChain(RegionNumber,
+                         "chained kernels cannot have compressed inputs");
+    }
+
+    if (i == 0) continue;
+
+    for (auto Iter = IR->read_begin(); Iter != IR->read_end(); Iter++) {
+      Value *V = (*Iter)->getArrayRef();
+      if ((getWriter(V, i) < 0) && (First->getArrayInfo(V) == nullptr)) {
+        return rejectChain(RegionNumber, "chained kernel reads an array which "
+                                         "is neither an input nor an output "
+                                         "of a previous kernel");
+      }
+    }
+  }
+
+  return true;
 }
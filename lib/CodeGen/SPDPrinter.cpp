@@ -5,50 +5,183 @@
 using namespace llvm;
 using namespace polly;
 
-void SPDPrinter::emitInParams(uint64_t VL) {
+// An interleaved stream is one interface carrying the lanes of every array.
+// A separate stream (-polly-spd-layout=separate) declares an interface per
+// array and one for the attr, numbered by their word in the stream element.
+// The channels advance in lockstep, sop/eop are carried by the first one.
+static void emitStreamDecl(raw_ostream &OS, const std::string &Name,
+                           const std::string &Prefix,
+                           const std::vector<std::vector<std::string>> &Words,
+                           bool Separate) {
+  OS << Name << " {" << Prefix << "::";
+  for (unsigned i = 0; i < Words.size(); i++) {
+    if (Separate && (i != 0)) {
+      OS << Name.substr(0, Name.find(' ')) << i << " {" << Prefix << i
+         << "::";
+    }
+
+    for (unsigned j = 0; j < Words[i].size(); j++) {
+      OS << Words[i][j];
+      if (Separate && (i != 0)) {
+        OS << ((j == (Words[i].size() - 1)) ? "};\n" : ", ");
+      }
+      else {
+        OS << ", ";
+      }
+    }
+
+    if (Separate && (i == 0)) {
+      OS << "sop, eop};\n";
+    }
+  }
+
+  if (!Separate) {
+    OS << "sop, eop};\n";
+  }
+}
+
+// the channel of a run-length encoded array carries (word, run length)
+// pairs when Encoded is set
+void SPDPrinter::emitInParams(uint64_t VL, bool Encoded) {
   if (IR->getNumReads() == 0) return;
 
-  *OS << "Main_In  {Mi::";
-  auto Iter = IR->read_begin();
-  while (true) {
+  std::vector<std::vector<std::string>> Words;
+  for (auto Iter = IR->read_begin(); Iter != IR->read_end(); Iter++) {
     SPDArrayInfo *AI = *Iter;
-    for (uint64_t i = 0; i < VL; i++) {
-      *OS << AI->getArrayRef()->getName().str() << i << ", ";
+    Words.emplace_back();
+    if (Encoded && AI->isCompressed()) {
+      std::string Name = AI->getArrayRef()->getName().str();
+      Words.back().push_back(Name + "_run");
+      Words.back().push_back(Name + "_len");
+      continue;
     }
 
-    Iter++;
-    if (Iter == IR->read_end()) {
-      *OS << "iattr, sop, eop};\n";
-      break;
+    for (uint64_t i = 0; i < VL; i++) {
+      Words.back().push_back(AI->getArrayRef()->getName().str()
+                             + std::to_string(i));
     }
   }
+  if (!IR->hasDeviceAttr()) {
+    Words.push_back({"iattr"});
+  }
+
+  emitStreamDecl(*OS, "Main_In ", "Mi", Words, IR->hasSeparateStreams());
 }
 
 void SPDPrinter::emitOutParams(uint64_t VL) {
   if (IR->getNumWrites() == 0) return;
 
-  *OS << "Main_Out {Mo::";
-  auto Iter = IR->write_begin();
-  while (true) {
+  std::vector<std::vector<std::string>> Words;
+  for (auto Iter = IR->write_begin(); Iter != IR->write_end(); Iter++) {
+    SPDArrayInfo *AI = *Iter;
+    Words.emplace_back();
+    for (uint64_t i = 0; i < VL; i++) {
+      Words.back().push_back(AI->getArrayRef()->getName().str()
+                             + std::to_string(i));
+    }
+  }
+  if (!IR->hasDeviceAttr()) {
+    Words.push_back({"oattr"});
+  }
+
+  emitStreamDecl(*OS, "Main_Out", "Mo", Words, IR->hasSeparateStreams());
+}
+
+// broadcast arrays arrive once through their own interface
+void SPDPrinter::emitBroadcastParams(uint64_t VL) {
+  if (IR->getNumBroadcasts() == 0) return;
+
+  *OS << "Brdc_In  {Bi::";
+  for (auto Iter = IR->broadcast_begin();
+       Iter != IR->broadcast_end(); Iter++) {
     SPDArrayInfo *AI = *Iter;
     for (uint64_t i = 0; i < VL; i++) {
       *OS << AI->getArrayRef()->getName().str() << i << ", ";
     }
+  }
+  *OS << "sop, eop};\n";
+}
+
+// trailing arguments passing the broadcast interface to a core
+void SPDPrinter::emitBroadcastArgs(uint64_t VL) {
+  if (IR->getNumBroadcasts() == 0) return;
+
+  for (auto Iter = IR->broadcast_begin();
+       Iter != IR->broadcast_end(); Iter++) {
+    SPDArrayInfo *AI = *Iter;
+    for (uint64_t i = 0; i < VL; i++) {
+      *OS << ", " << AI->getArrayRef()->getName().str() << i;
+    }
+  }
+  *OS << ", Bi::sop, Bi::eop";
+}
+
+// kernel parameters are registers shared by all lanes, the host writes them
+// by index (__spd_set_param)
+void SPDPrinter::emitRegParams() {
+  if (IR->getNumParams() == 0) return;
+
+  *OS << "Regs_In  {Ri::";
+  auto Iter = IR->param_begin();
+  while (true) {
+    *OS << (*Iter)->getName();
 
     Iter++;
-    if (Iter == IR->write_end()) {
-      *OS << "oattr, sop, eop};\n";
+    if (Iter == IR->param_end()) {
+      *OS << "};\n";
       break;
     }
+
+    *OS << ", ";
+  }
+}
+
+void SPDPrinter::emitRegArgs() {
+  for (auto Iter = IR->param_begin(); Iter != IR->param_end(); Iter++) {
+    *OS << ", " << (*Iter)->getName();
+  }
+}
+
+// start/end/size of every domain dimension, innermost first
+void SPDPrinter::emitDomainParams() {
+  if (!IR->hasDeviceAttr()) return;
+
+  *OS << "Domn_In  {Di::";
+  int NumDims = IR->getDomainInfo()->getNumDims();
+  for (int i = 0; i < NumDims; i++) {
+    *OS << "dstart" << i << ", dend" << i << ", dsize" << i;
+    *OS << ((i == (NumDims - 1)) ? "};\n" : ", ");
+  }
+}
+
+void SPDPrinter::emitDomainArgs() {
+  if (!IR->hasDeviceAttr()) return;
+
+  int NumDims = IR->getDomainInfo()->getNumDims();
+  for (int i = 0; i < NumDims; i++) {
+    *OS << ", dstart" << i << ", dend" << i << ", dsize" << i;
   }
 }
 
-void SPDPrinter::emitModuleDecl(std::string &KernelName, uint64_t VL) {
+// position counters driven by sop/eop replace the attr word of the stream
+void SPDPrinter::emitDomainAttr(uint64_t VL) {
+  emitHDLPrefix();
+  *OS << "1, (iattr)() = mDomainAttr(Mi::sop[0], Mi::eop[0]";
+  emitDomainArgs();
+  *OS << ")(), <.pNumDims(" << IR->getDomainInfo()->getNumDims()
+      << "),.pVL(" << VL << ")>;\n";
+}
+
+void SPDPrinter::emitModuleDecl(std::string &KernelName, uint64_t VL,
+                                bool Encoded) {
 // FIXME needs name
   *OS << "Name     " << KernelName << ";\n";
 
-  emitInParams(VL);
+  emitInParams(VL, Encoded);
   emitOutParams(VL);
+  emitBroadcastParams(VL);
+  emitRegParams();
+  emitDomainParams();
 }
 
 // copied from WriteConstantInternal()@IR/AsmPrinter.cpp
@@ -85,6 +218,18 @@ void SPDPrinter::emitConstantFP(ConstantFP *CFP) {
   llvm_unreachable("unsupported floating point type");
 }
 
+void SPDPrinter::emitConstant(Constant *C) {
+  if (isa<ConstantInt>(C)) {
+    emitConstantInt(dyn_cast<ConstantInt>(C));
+  }
+  else if (isa<ConstantFP>(C)) {
+    emitConstantFP(dyn_cast<ConstantFP>(C));
+  }
+  else {
+    llvm_unreachable("unsupported constant");
+  }
+}
+
 unsigned SPDPrinter::getValueNum(Value *V) {
   CalcInstrMapTy::iterator Iter = CalcInstrMap.find(V);
   if (Iter == CalcInstrMap.end()) {
@@ -98,19 +243,27 @@ unsigned SPDPrinter::getValueNum(Value *V) {
 }
 
 void SPDPrinter::emitValue(Value *V, uint64_t VL) {
+  const SPDParamInfo *PI = IR->getParamInfo(V);
+  if (PI != nullptr) {
+    *OS << PI->getName();
+    return;
+  }
+
   MemInstrMapTy::iterator Iter = MemInstrMap.find(V);
   if (Iter != MemInstrMap.end()) {
     SPDInstr *I = Iter->second;
+    if (I->getConstantValue() != nullptr) {
+      emitConstant(I->getConstantValue());
+      return;
+    }
+
     MemoryAccess *MA = I->getMemoryAccess();
     int64_t StreamOffset = I->getStreamOffset();
     assert((StreamOffset == 0) && "array subscript is not allowed here");
     *OS << MA->getOriginalBaseAddr()->getName().str() << VL;
   }
-  else if (isa<ConstantInt>(V)) {
-    emitConstantInt(dyn_cast<ConstantInt>(V));
-  }
-  else if (isa<ConstantFP>(V)) {
-    emitConstantFP(dyn_cast<ConstantFP>(V));
+  else if (isa<ConstantInt>(V) || isa<ConstantFP>(V)) {
+    emitConstant(dyn_cast<Constant>(V));
   }
   else {
     if (V->hasName()) {
@@ -155,38 +308,36 @@ void SPDPrinter::emitHDLPrefix() {
   HDLCount++;
 }
 
-static Value *getUniqueMemRead(Value *V, const ScopStmt *Stmt) {
-  Instruction *Instr = dyn_cast<Instruction>(V);
-  if (Instr == nullptr) {
-    return nullptr;
-  }
-
-  if (Instr->mayReadFromMemory()) {
-    MemoryAccess *MA = Stmt->getArrayAccessOrNULLFor(Instr);
-    return MA->getOriginalBaseAddr();
-  }
-
-  Value *Ret = nullptr;
-  for (unsigned i = 0; i < Instr->getNumOperands(); i++) {
-    if (Ret == nullptr) {
-      Ret = getUniqueMemRead(Instr->getOperand(i), Stmt);
-    }
-    else {
-      Value *Temp = getUniqueMemRead(Instr->getOperand(i), Stmt);
-      if (Temp == nullptr) continue;
-      else if (Temp != Ret) return nullptr;
-    }
-  }
-
-  return Ret;
+// the row buffer keeps the broadcast row and replays the element at the
+// current row position (plus the offset) for every stream element
+void SPDPrinter::emitBroadcastRead(SPDInstr *I, uint64_t VL) {
+  MemoryAccess *MA = I->getMemoryAccess();
+  const SPDArrayInfo *AI = IR->getArrayInfo(MA->getOriginalBaseAddr());
+
+  emitHDLPrefix();
+  *OS << 2 << ", (";
+  emitValue(dyn_cast<Value>(I->getLLVMInstr()), VL);
+  *OS << ")() = mRowBroadcast(";
+  *OS << AI->getArrayRef()->getName().str() << VL;
+  *OS << ", Bi::eop[0], Mi::sop[0])(), <.pConstWord(0),.pRowLength("
+      << AI->getNumElements() << "),.pOffset("
+      << I->getStreamOffset() << ")>;\n";
 }
 
 void SPDPrinter::emitInstruction(SPDInstr *I, uint64_t VL) {
   Instruction *Instr = I->getLLVMInstr();
   if (Instr->mayReadFromMemory()) {
+    MemoryAccess *MA = I->getMemoryAccess();
+    const SPDArrayInfo *AI = IR->getArrayInfo(MA->getOriginalBaseAddr());
+    if (AI->getKind() == SPDArrayInfo::Broadcast) {
+      emitBroadcastRead(I, VL);
+      return;
+    }
+
 // FIXME need this?
     int64_t StreamOffset = I->getStreamOffset();
-    if (StreamOffset == 0) {
+    if ((StreamOffset == 0) ||
+        (AI->getKind() == SPDArrayInfo::Constant)) {
       MemInstrMap[dyn_cast<Value>(Instr)] = I;
     }
     else {
@@ -228,8 +379,8 @@ void SPDPrinter::emitInstruction(SPDInstr *I, uint64_t VL) {
     *OS << " = mux(";
 // false value
 // FIXME current implementation uses array read instead of original value
-    Value *UniqueMemRead = getUniqueMemRead(Instr->getOperand(0),
-                                            I->getStmt());
+    Value *UniqueMemRead = IR->getUniqueMemRead(Instr->getOperand(0),
+                                                I->getStmt());
     if (UniqueMemRead == nullptr) {
       llvm_unreachable("cannot find a original value for masking output");
     }
@@ -251,6 +402,9 @@ void SPDPrinter::emitInstruction(SPDInstr *I, uint64_t VL) {
     emitValue(Instr->getOperand(0), VL);
     emitOpcode(Instr->getOpcode());
     emitValue(Instr->getOperand(1), VL);
+    if (Instr->getType()->isIntegerTy()) {
+      *OS << ", <.pWidth(" << IR->getBitWidth(Instr) << ")>";
+    }
     *OS << ";\n";
   }
   else {
@@ -271,10 +425,9 @@ void SPDPrinter::emitUnrollModule(std::string &UnrolledKernelName,
 
   assert((VL > 0) && "VL should be more than 0");
 
-// FIXME
-// +3 is for attr, sop, eop
-// remove this magic number when attr becomes optional
-  int SurfixInc = (IR->getNumWrites() * VL) + 3;
+// +3 is for attr, sop, eop (+2 without attr)
+  int NumCtrls = IR->hasDeviceAttr() ? 2 : 3;
+  int SurfixInc = (IR->getNumWrites() * VL) + NumCtrls;
   int SurfixStart = 0;
   for (uint64_t i = 0; i < UC; i++) {
 // writes
@@ -296,10 +449,15 @@ void SPDPrinter::emitUnrollModule(std::string &UnrolledKernelName,
     }
 
     if (i == (UC - 1)) {
-      *OS << "oattr, Mo::sop, Mo::eop) = ";
+      if (!IR->hasDeviceAttr()) {
+        *OS << "oattr, ";
+      }
+      *OS << "Mo::sop, Mo::eop) = ";
     }
     else {
-      *OS << "xxxt" << WriteId << ", "; WriteId++; // attr
+      if (!IR->hasDeviceAttr()) {
+        *OS << "xxxt" << WriteId << ", "; WriteId++; // attr
+      }
       *OS << "xxxt" << WriteId << ", "; WriteId++; // sop
       *OS << "xxxt" << WriteId << ") = ";     // eop
     }
@@ -323,18 +481,80 @@ void SPDPrinter::emitUnrollModule(std::string &UnrolledKernelName,
     }
 
     if (i == 0) {
-      *OS << "iattr, Mi::sop, Mi::eop);\n";
+      if (!IR->hasDeviceAttr()) {
+        *OS << "iattr, ";
+      }
+      *OS << "Mi::sop, Mi::eop";
     }
     else {
-      *OS << "xxxt" << ReadId << ", "; ReadId++; // attr
+      if (!IR->hasDeviceAttr()) {
+        *OS << "xxxt" << ReadId << ", "; ReadId++; // attr
+      }
       *OS << "xxxt" << ReadId << ", "; ReadId++; // sop
-      *OS << "xxxt" << ReadId << ");\n";     // eop
+      *OS << "xxxt" << ReadId;     // eop
     }
 
+// every core reads the broadcast interface and registers directly
+    emitBroadcastArgs(VL);
+    emitRegArgs();
+    emitDomainArgs();
+    *OS << ");\n";
+
     SurfixStart += SurfixInc;
   }
 }
 
+// The front-end expands the run-length encoded channels into the lanes of
+// their array and passes every stream on to the kernel (or its unrolled
+// version) unchanged.
+void SPDPrinter::emitFrontEndModule(std::string &FrontEndName,
+                                    std::string &KernelName, uint64_t VL) {
+  emitModuleDecl(FrontEndName, VL, true);
+
+  for (auto Iter = IR->read_begin(); Iter != IR->read_end(); Iter++) {
+    SPDArrayInfo *AI = *Iter;
+    if (!AI->isCompressed()) continue;
+
+    std::string Name = AI->getArrayRef()->getName().str();
+    emitHDLPrefix();
+    *OS << 2 << ", (";
+    for (uint64_t i = 0; i < VL; i++) {
+      *OS << Name << i << ((i == (VL - 1)) ? ")" : ", ");
+    }
+    *OS << "() = mRunLengthDecoder(" << Name << "_run, " << Name
+        << "_len, Mi::eop[0])(), <.pVL(" << VL << ")>;\n";
+  }
+
+// writes
+  *OS << "HDL      top, ###, (";
+  for (auto Iter = IR->write_begin(); Iter != IR->write_end(); Iter++) {
+    for (uint64_t i = 0; i < VL; i++) {
+      *OS << (*Iter)->getArrayRef()->getName().str() << i << ", ";
+    }
+  }
+  if (!IR->hasDeviceAttr()) {
+    *OS << "oattr, ";
+  }
+  *OS << "Mo::sop, Mo::eop) = ";
+
+// reads
+  *OS << KernelName << "(";
+  for (auto Iter = IR->read_begin(); Iter != IR->read_end(); Iter++) {
+    for (uint64_t i = 0; i < VL; i++) {
+      *OS << (*Iter)->getArrayRef()->getName().str() << i << ", ";
+    }
+  }
+  if (!IR->hasDeviceAttr()) {
+    *OS << "iattr, ";
+  }
+  *OS << "Mi::sop, Mi::eop";
+
+  emitBroadcastArgs(VL);
+  emitRegArgs();
+  emitDomainArgs();
+  *OS << ");\n";
+}
+
 SPDPrinter::SPDPrinter(SPDIR *I, uint64_t VL, uint64_t UC)
   : IR(I), EQUCount(0), HDLCount(0), ValueCount(0) {
   std::error_code EC;
@@ -347,6 +567,10 @@ SPDPrinter::SPDPrinter(SPDIR *I, uint64_t VL, uint64_t UC)
 
   emitModuleDecl(KernelName, VL);
 
+  if (IR->hasDeviceAttr()) {
+    emitDomainAttr(VL);
+  }
+
   for (auto Iter = IR->instr_begin(); Iter != IR->instr_end(); Iter++) {
     SPDInstr *Instr = *Iter;
     for (uint64_t i = 0; i < VL; i++) {
@@ -354,9 +578,13 @@ SPDPrinter::SPDPrinter(SPDIR *I, uint64_t VL, uint64_t UC)
     }
   }
 
-// FIXME attr should be optional
-  *OS <<
-    "DRCT     (oattr, Mo::sop, Mo::eop) = (iattr, Mi::sop, Mi::eop);\n";
+  if (IR->hasDeviceAttr()) {
+    *OS << "DRCT     (Mo::sop, Mo::eop) = (Mi::sop, Mi::eop);\n";
+  }
+  else {
+    *OS <<
+      "DRCT     (oattr, Mo::sop, Mo::eop) = (iattr, Mi::sop, Mi::eop);\n";
+  }
 
   delete OS;
 
@@ -371,5 +599,158 @@ SPDPrinter::SPDPrinter(SPDIR *I, uint64_t VL, uint64_t UC)
     emitUnrollModule(UnrolledKernelName, KernelName, VL, UC);
 
     delete OS;
+    KernelName = UnrolledKernelName;
+  }
+  IR->setModuleName(KernelName);
+
+// the host talks to the front-end when some inputs are encoded
+  if (IR->hasCompressedArrays()) {
+    std::string FrontEndName("RLE_");
+    FrontEndName += "kernel" + std::to_string(IR->getKernelNum());
+    OS = new raw_fd_ostream(FrontEndName + ".spd", EC, sys::fs::F_None);
+
+    emitFrontEndModule(FrontEndName, KernelName, VL);
+
+    delete OS;
+    IR->setModuleName(FrontEndName);
+  }
+}
+
+// outputs of stage k are named xxxs<k>_<array><lane>, inputs of the chain
+// keep their array name
+std::string SPDChainPrinter::getSignalName(Value *V, int Stage,
+                                           uint64_t Lane) const {
+  std::string Name;
+  if (Stage >= 0) {
+    Name += "xxxs" + std::to_string(Stage) + "_";
+  }
+
+  Name += V->getName().str() + std::to_string(Lane);
+  return Name;
+}
+
+void SPDChainPrinter::emitModuleDecl(std::string &ChainName, uint64_t VL) {
+  *OS << "Name     " << ChainName << ";\n";
+
+  SPDIR *First = Chain->getFirstStage();
+  std::vector<std::vector<std::string>> InWords;
+  for (auto Iter = First->read_begin(); Iter != First->read_end(); Iter++) {
+    InWords.emplace_back();
+    for (uint64_t i = 0; i < VL; i++) {
+      InWords.back().push_back(getSignalName((*Iter)->getArrayRef(), -1, i));
+    }
+  }
+  if (!Chain->hasDeviceAttr()) {
+    InWords.push_back({"iattr"});
+  }
+  emitStreamDecl(*OS, "Main_In ", "Mi", InWords,
+                 Chain->hasSeparateStreams());
+
+  std::vector<std::vector<std::string>> OutWords;
+  int Idx = 0;
+  for (auto Iter = Chain->write_begin(); Iter != Chain->write_end(); Iter++) {
+    OutWords.emplace_back();
+    for (uint64_t i = 0; i < VL; i++) {
+      OutWords.back().push_back(getSignalName((*Iter)->getArrayRef(),
+                                              Chain->getWriteStage(Idx), i));
+    }
+
+    Idx++;
   }
+  if (!Chain->hasDeviceAttr()) {
+    OutWords.push_back({"oattr"});
+  }
+  emitStreamDecl(*OS, "Main_Out", "Mo", OutWords,
+                 Chain->hasSeparateStreams());
+
+  if (Chain->hasDeviceAttr()) {
+    *OS << "Domn_In  {Di::";
+    int NumDims = First->getDomainInfo()->getNumDims();
+    for (int i = 0; i < NumDims; i++) {
+      *OS << "dstart" << i << ", dend" << i << ", dsize" << i;
+      *OS << ((i == (NumDims - 1)) ? "};\n" : ", ");
+    }
+  }
+}
+
+void SPDChainPrinter::emitDomainArgs() {
+  if (!Chain->hasDeviceAttr()) return;
+
+  int NumDims = Chain->getFirstStage()->getDomainInfo()->getNumDims();
+  for (int i = 0; i < NumDims; i++) {
+    *OS << ", dstart" << i << ", dend" << i << ", dsize" << i;
+  }
+}
+
+void SPDChainPrinter::emitStage(int Stage, uint64_t VL) {
+  SPDIR *IR = Chain->getStage(Stage);
+  bool LastStage = (Stage == (Chain->getNumStages() - 1));
+  std::string Prefix = "xxxs" + std::to_string(Stage) + "_";
+  std::string PrevPrefix = "xxxs" + std::to_string(Stage - 1) + "_";
+
+// writes
+  *OS << "HDL      stage" << Stage << ", ###, (";
+  for (auto Iter = IR->write_begin(); Iter != IR->write_end(); Iter++) {
+    for (uint64_t i = 0; i < VL; i++) {
+      *OS << getSignalName((*Iter)->getArrayRef(), Stage, i) << ", ";
+    }
+  }
+
+  if (LastStage) {
+    if (!Chain->hasDeviceAttr()) {
+      *OS << "oattr, ";
+    }
+    *OS << "Mo::sop, Mo::eop) = ";
+  }
+  else {
+    if (!Chain->hasDeviceAttr()) {
+      *OS << Prefix << "attr, ";
+    }
+    *OS << Prefix << "sop, " << Prefix << "eop) = ";
+  }
+
+// reads
+  *OS << IR->getModuleName() << "(";
+  for (auto Iter = IR->read_begin(); Iter != IR->read_end(); Iter++) {
+    Value *V = (*Iter)->getArrayRef();
+    int Writer = Chain->getWriter(V, Stage);
+    for (uint64_t i = 0; i < VL; i++) {
+      *OS << getSignalName(V, Writer, i) << ", ";
+    }
+  }
+
+  if (Stage == 0) {
+    if (!Chain->hasDeviceAttr()) {
+      *OS << "iattr, ";
+    }
+    *OS << "Mi::sop, Mi::eop";
+  }
+  else {
+    if (!Chain->hasDeviceAttr()) {
+      *OS << PrevPrefix << "attr, ";
+    }
+    *OS << PrevPrefix << "sop, " << PrevPrefix << "eop";
+  }
+
+  emitDomainArgs();
+  *OS << ");\n";
+}
+
+SPDChainPrinter::SPDChainPrinter(SPDChain *C, uint64_t VL) : Chain(C) {
+  std::error_code EC;
+  std::string ChainName("chain");
+  ChainName += std::to_string(Chain->getRegionNumber());
+  OS = new raw_fd_ostream(ChainName + ".spd", EC, sys::fs::F_None);
+  if (EC) {
+    std::cerr << "cannot create a output file";
+  }
+
+  assert((VL > 0) && "VL should be more than 0");
+
+  emitModuleDecl(ChainName, VL);
+  for (int i = 0; i < Chain->getNumStages(); i++) {
+    emitStage(i, VL);
+  }
+
+  delete OS;
 }
@@ -0,0 +1,245 @@
+//===--- SPDRangeAnalysis.cpp - Value ranges of SPD kernels -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Value range analysis of the integer instructions of an SPD kernel.
+//
+//===----------------------------------------------------------------------===//
+
+#include "isl/aff.h"
+#include "isl/id.h"
+#include "isl/ilp.h"
+#include "isl/local_space.h"
+#include "isl/map.h"
+#include "isl/set.h"
+#include "isl/space.h"
+#include "isl/val.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstrTypes.h"
+#include "polly/ScopInfo.h"
+#include "polly/CodeGen/SPDRangeAnalysis.h"
+#include "polly/Support/GICHelper.h"
+#include "polly/Support/SCEVValidator.h"
+#include <algorithm>
+
+using namespace llvm;
+using namespace polly;
+
+static bool isNonNegative(const ConstantRange &R) {
+  return !R.isEmptySet() && !R.isSignWrappedSet() &&
+         R.getSignedMin().isNonNegative();
+}
+
+// [Min, Max] as a range of BitWidth bits, the full set if it does not fit
+static ConstantRange getRangeFromBounds(unsigned BitWidth,
+                                        const APInt &Min, const APInt &Max) {
+  if ((Min.getMinSignedBits() > BitWidth) ||
+      (Max.getMinSignedBits() > BitWidth)) {
+    return ConstantRange(BitWidth, true);
+  }
+
+  APInt Lower = Min.sextOrTrunc(BitWidth);
+  APInt Upper = Max.sextOrTrunc(BitWidth) + 1;
+  if (Lower == Upper) {
+    return ConstantRange(BitWidth, true);
+  }
+
+  return ConstantRange(Lower, Upper);
+}
+
+ConstantRange SPDRangeAnalysis::getRange(Value *V, const ScopStmt *Stmt) {
+  auto Iter = RangeCache.find(V);
+  if (Iter != RangeCache.end()) {
+    return Iter->second;
+  }
+
+  ConstantRange R = computeRange(V, Stmt);
+  RangeCache.insert(std::make_pair(V, R));
+  return R;
+}
+
+// E as an affine function on the domain space LS of Stmt, whose set
+// dimensions are the loops of the statement. Parameters of E that are not
+// parameters of the Scop are not added to it, nullptr is returned for them
+// and for every expression the kernel cannot bound.
+static __isl_give isl_aff *getAffOnDomain(const SCEV *E, const ScopStmt *Stmt,
+                                          __isl_keep isl_local_space *LS) {
+  isl_space *Space = isl_local_space_get_space(LS);
+  int NumParams = isl_space_dim(Space, isl_dim_param);
+  for (int i = 0; i < NumParams; i++) {
+    isl_id *Id = isl_space_get_dim_id(Space, isl_dim_param, i);
+    bool IsParam = isl_id_get_user(Id) == E;
+    isl_id_free(Id);
+    if (IsParam) {
+      isl_space_free(Space);
+      return isl_aff_var_on_domain(isl_local_space_copy(LS), isl_dim_param,
+                                   i);
+    }
+  }
+  isl_space_free(Space);
+
+  isl_ctx *Ctx = isl_local_space_get_ctx(LS);
+  if (const SCEVConstant *C = dyn_cast<SCEVConstant>(E)) {
+    return isl_aff_val_on_domain(isl_local_space_copy(LS),
+                                 isl_valFromAPInt(Ctx, C->getAPInt(), true));
+  }
+
+  if (const SCEVAddExpr *Add = dyn_cast<SCEVAddExpr>(E)) {
+    isl_aff *Sum = nullptr;
+    for (const SCEV *Op : Add->operands()) {
+      isl_aff *Aff = getAffOnDomain(Op, Stmt, LS);
+      if (Aff == nullptr) {
+        isl_aff_free(Sum);
+        return nullptr;
+      }
+      Sum = (Sum == nullptr) ? Aff : isl_aff_add(Sum, Aff);
+    }
+    return Sum;
+  }
+
+// the constant factor comes first
+  if (const SCEVMulExpr *Mul = dyn_cast<SCEVMulExpr>(E)) {
+    const SCEVConstant *C = dyn_cast<SCEVConstant>(Mul->getOperand(0));
+    if ((Mul->getNumOperands() != 2) || (C == nullptr)) {
+      return nullptr;
+    }
+
+    isl_aff *Aff = getAffOnDomain(Mul->getOperand(1), Stmt, LS);
+    if (Aff == nullptr) {
+      return nullptr;
+    }
+    return isl_aff_scale_val(Aff, isl_valFromAPInt(Ctx, C->getAPInt(), true));
+  }
+
+// {Start,+,Step}<L> is Start + Step * i for the dimension i of the loop L
+  if (const SCEVAddRecExpr *AddRec = dyn_cast<SCEVAddRecExpr>(E)) {
+    const SCEVConstant *Step
+      = dyn_cast<SCEVConstant>(AddRec->getOperand(1));
+    if (!AddRec->isAffine() || (Step == nullptr)) {
+      return nullptr;
+    }
+
+    for (unsigned i = 0; i < Stmt->getNumIterators(); i++) {
+      if (Stmt->getLoopForDimension(i) != AddRec->getLoop()) continue;
+
+      isl_aff *Start = getAffOnDomain(AddRec->getStart(), Stmt, LS);
+      if (Start == nullptr) {
+        return nullptr;
+      }
+
+      isl_aff *Iter
+        = isl_aff_var_on_domain(isl_local_space_copy(LS), isl_dim_set, i);
+      Iter = isl_aff_scale_val(Iter,
+                               isl_valFromAPInt(Ctx, Step->getAPInt(), true));
+      return isl_aff_add(Start, Iter);
+    }
+  }
+
+  return nullptr;
+}
+
+// values the SCEV of V takes in the statement domain, under the context of
+// the Scop. The SCEV is translated on its own, so that the Scop is not
+// changed and statements of any kind are handled.
+ConstantRange SPDRangeAnalysis::getAffineRange(Value *V,
+                                               const ScopStmt *Stmt) {
+  unsigned BitWidth = V->getType()->getIntegerBitWidth();
+  ConstantRange Full(BitWidth, true);
+
+  const SCEV *E = SE.getSCEV(V);
+  if (!isAffineExpr(&S.getRegion(), Stmt->getSurroundingLoop(), E, SE)) {
+    return Full;
+  }
+
+  isl_set *Context = S.getContext();
+  isl_set *Domain = isl_set_align_params(Stmt->getDomain(),
+                                         isl_set_get_space(Context));
+  isl_local_space *LS = isl_local_space_from_space(isl_set_get_space(Domain));
+  isl_aff *Aff = getAffOnDomain(E, Stmt, LS);
+  isl_local_space_free(LS);
+  if (Aff == nullptr) {
+    isl_set_free(Domain);
+    isl_set_free(Context);
+    return Full;
+  }
+
+  isl_map *Map = isl_map_intersect_domain(isl_map_from_aff(Aff), Domain);
+  isl_set *Values = isl_map_range(Map);
+  Values = isl_set_intersect_params(Values, Context);
+
+  isl_aff *Var = isl_aff_var_on_domain(
+      isl_local_space_from_space(isl_set_get_space(Values)), isl_dim_set, 0);
+  isl_val *Min = isl_set_min_val(Values, Var);
+  isl_val *Max = isl_set_max_val(Values, Var);
+  isl_aff_free(Var);
+  isl_set_free(Values);
+
+// unbounded or empty
+  if (!isl_val_is_int(Min) || !isl_val_is_int(Max)) {
+    isl_val_free(Min);
+    isl_val_free(Max);
+    return Full;
+  }
+
+  return getRangeFromBounds(BitWidth, APIntFromVal(Min), APIntFromVal(Max));
+}
+
+ConstantRange SPDRangeAnalysis::computeRange(Value *V,
+                                             const ScopStmt *Stmt) {
+  if (ConstantInt *CI = dyn_cast<ConstantInt>(V)) {
+    return ConstantRange(CI->getValue());
+  }
+
+  ConstantRange Ret = getAffineRange(V, Stmt);
+
+// loads and values defined outside of the kernel keep the range of
+// their SCEV
+  BinaryOperator *BO = dyn_cast<BinaryOperator>(V);
+  if (BO == nullptr) {
+    return Ret;
+  }
+
+  ConstantRange L = getRange(BO->getOperand(0), Stmt);
+  ConstantRange R = getRange(BO->getOperand(1), Stmt);
+  switch (BO->getOpcode()) {
+  case Instruction::Add:
+    return Ret.intersectWith(L.add(R));
+  case Instruction::Sub:
+    return Ret.intersectWith(L.sub(R));
+  case Instruction::Mul:
+    return Ret.intersectWith(L.multiply(R));
+  case Instruction::UDiv:
+    return Ret.intersectWith(L.udiv(R));
+  case Instruction::SDiv:
+    if (isNonNegative(L) && isNonNegative(R)) {
+      return Ret.intersectWith(L.udiv(R));
+    }
+    return Ret;
+  default:
+    return Ret;
+  }
+}
+
+unsigned SPDRangeAnalysis::getBitWidth(const ConstantRange &R) {
+  if (R.isFullSet()) {
+    return R.getBitWidth();
+  }
+
+  if (R.isEmptySet()) {
+    return 1;
+  }
+
+  if (isNonNegative(R)) {
+    return std::max(1u, R.getUnsignedMax().getActiveBits());
+  }
+
+  return std::max(R.getSignedMin().getMinSignedBits(),
+                  R.getSignedMax().getMinSignedBits());
+}
@@ -11,34 +11,331 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "polly/CodeGen/LoopGenerators.h"
+#include "polly/CodeGen/SPDEmulator.h"
 #include "polly/CodeGen/SPDIR.h"
 #include "polly/CodeGen/SPDPrinter.h"
 #include "polly/HostCodeGeneration.h"
 #include "polly/LinkAllPasses.h"
+#include "polly/Options.h"
+#include "polly/ScopDetection.h"
 #include "polly/ScopInfo.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/IR/Argument.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 using namespace llvm;
 using namespace polly;
 
 #define DEBUG_TYPE "polly-host-codegen"
 
+static cl::opt<unsigned> SPDNumPartitions(
+    "polly-spd-num-partitions",
+    cl::desc("Split the SPD domain into the given number of slabs, each "
+             "processed by its own kernel instance"),
+    cl::Hidden, cl::init(1), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<bool> SPDEmulate(
+    "polly-spd-emulate",
+    cl::desc("Register a host emulation of the SPD kernel with the runtime"),
+    cl::Hidden, cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<bool> SPDInlinePack(
+    "polly-spd-inline-pack",
+    cl::desc("Emit the contiguous pack and unpack loops of SPD streams "
+             "inline as OpenMP parallel loops instead of runtime calls"),
+    cl::Hidden, cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<unsigned> SPDLinkBandwidth(
+    "polly-spd-link-bandwidth",
+    cl::desc("Host-device bandwidth assumed by the SPD offload cost model "
+             "(MB/s)"),
+    cl::Hidden, cl::init(6000), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<unsigned> SPDClock(
+    "polly-spd-clock",
+    cl::desc("Clock of the SPD kernels assumed by the offload cost model "
+             "(MHz)"),
+    cl::Hidden, cl::init(200), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<unsigned> SPDHostOps(
+    "polly-spd-host-ops",
+    cl::desc("Kernel instructions the host executes per microsecond in the "
+             "SPD offload cost model"),
+    cl::Hidden, cl::init(4000), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+namespace {
+// A block of the stream. Rows [HaloBegin, HaloEnd) of the outermost
+// dimension and the tile width of columns from HaloColBegin on are streamed
+// to the kernel, rows [Begin, End) and columns [ColBegin, ColEnd) are written
+// back. Untiled blocks span every column. Dev < 0 is the single device.
+struct SPDSlab {
+  uint64_t Begin;
+  uint64_t End;
+  uint64_t HaloBegin;
+  uint64_t HaloEnd;
+  uint64_t ColBegin;
+  uint64_t ColEnd;
+  int64_t HaloColBegin;
+  int Dev;
+  GlobalVariable *ReadStreamBuffer;
+  GlobalVariable *WriteStreamBuffer;
+
+  uint64_t getNumRows() const { return HaloEnd - HaloBegin; }
+};
+} // end anonymous namespace
+
+// number of stream elements in one row of the outermost dimension
+static uint64_t getRowSize(const SPDStreamInfo *SI) {
+  uint64_t RowSize = 1;
+  for (int i = 0; i < SI->getNumDims() - 1; i++) {
+    RowSize *= SI->getSize(i);
+  }
+
+  return RowSize;
+}
+
+static uint64_t getRowSize(const SPDArrayInfo *AI) {
+  uint64_t RowSize = 1;
+  int Idx = 0;
+  for (uint64_t DimSize : *AI) {
+    if (Idx == AI->getNumDims() - 1) break;
+    RowSize *= DimSize;
+    Idx++;
+  }
+
+  return RowSize;
+}
+
+static uint64_t getNumRows(const SPDArrayInfo *AI) {
+  return *(AI->end() - 1);
+}
+
+static uint64_t getSlabNumElements(const SPDStreamInfo *SI,
+                                   const SPDSlab &Slab) {
+  return getRowSize(SI) * Slab.getNumRows();
+}
+
+static uint64_t getSlabAllocSize(const SPDStreamInfo *SI,
+                                 const SPDSlab &Slab) {
+  return getSlabNumElements(SI, Slab) * SI->getStride();
+}
+
+// word Offset of the stream elements in the slab buffer SB, as the pointer,
+// offset and stride passed to the pack/unpack functions of the runtime. The
+// words of a separate stream are planes of the buffer.
+static Value *getStreamWord(IRBuilder<> &IRB, Value *SB,
+                            const SPDStreamInfo *SI, const SPDSlab &Slab,
+                            int &Offset, uint32_t &Stride) {
+  if (!SI->isSeparate()) {
+    Stride = SI->getStride();
+    return SB;
+  }
+
+  uint64_t PlaneOffset = Offset * getSlabNumElements(SI, Slab);
+  Offset = 0;
+  Stride = 1;
+  if (PlaneOffset == 0) {
+    return SB;
+  }
+
+  return IRB.CreateGEP(SB, IRB.getInt64(PlaneOffset));
+}
+
+// an array can be moved by the DMA of its channel without packing when it
+// covers the rows [Begin, End) of the stream
+static bool isZeroCopy(const SPDArrayInfo *AI, const SPDStreamInfo *SI,
+                       uint64_t End) {
+  return SI->isSeparate() && (getRowSize(AI) == getRowSize(SI)) &&
+         (getNumRows(AI) >= End);
+}
+
+// Dst[i * DstStride] = Src[i * SrcStride] for i in [0, Size), as a GOMP
+// parallel loop (see ParallelLoopGenerator). The strides and the size are
+// constants of the loop, so LLVM can vectorize the loop of the subfunction.
+// Only the subfunction gets new blocks, the dominator tree and loop info of
+// the host function are just needed by the generator.
+static void createInlineCopy(IRBuilder<> &IRB, Value *Dst, uint32_t DstStride,
+                             Value *Src, uint32_t SrcStride, uint64_t Size) {
+  if (Size == 0) return;
+
+  Function *F = IRB.GetInsertBlock()->getParent();
+  DominatorTree DT(*F);
+  LoopInfo LI(DT);
+  ScopAnnotator Annotator;
+  PollyIRBuilder Builder(IRB.getContext(), ConstantFolder(),
+                         IRInserter(Annotator));
+  Builder.SetInsertPoint(&*IRB.GetInsertPoint());
+
+  SetVector<Value *> UsedValues;
+  for (Value *V : {Dst, Src}) {
+    if (!isa<Constant>(V)) {
+      UsedValues.insert(V);
+    }
+  }
+
+  ValueMapT Map;
+  BasicBlock::iterator LoopBody;
+  ParallelLoopGenerator ParallelLoopGen(Builder, LI, DT,
+                                        F->getParent()->getDataLayout());
+  Value *IV = ParallelLoopGen.createParallelLoop(
+      Builder.getInt64(0), Builder.getInt64(Size - 1), Builder.getInt64(1),
+      UsedValues, Map, &LoopBody);
+
+  Builder.SetInsertPoint(&*LoopBody);
+  if (UsedValues.count(Dst)) {
+    Dst = Map[Dst];
+  }
+  if (UsedValues.count(Src)) {
+    Src = Map[Src];
+  }
+
+  Value *SrcIdx = IV;
+  if (SrcStride != 1) {
+    SrcIdx = Builder.CreateMul(IV, Builder.getInt64(SrcStride));
+  }
+  Value *DstIdx = IV;
+  if (DstStride != 1) {
+    DstIdx = Builder.CreateMul(IV, Builder.getInt64(DstStride));
+  }
+  Value *Elmt = Builder.CreateLoad(Builder.CreateGEP(Src, SrcIdx));
+  Builder.CreateStore(Elmt, Builder.CreateGEP(Dst, DstIdx));
+}
+
+// Stream[Offset + i * Stride] = Array[i] for i in [0, Size)
+static void createPackContiguous(Module &M, IRBuilder<> &IRB, Value *Stream,
+                                 int Offset, uint32_t Stride, Value *Array,
+                                 uint64_t Size) {
+  if (SPDInlinePack) {
+    if (Offset != 0) {
+      Stream = IRB.CreateGEP(Stream, IRB.getInt64(Offset));
+    }
+    createInlineCopy(IRB, Stream, Stride, Array, 1, Size);
+    return;
+  }
+
+  Type *RetTy = Type::getVoidTy(M.getContext());
+  Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
+  Type *Int32Ty = Type::getInt32Ty(M.getContext());
+  Type *Int64Ty = Type::getInt64Ty(M.getContext());
+
+  Value *Func
+    = M.getOrInsertFunction("__spd_pack_contiguous", RetTy,
+                            FloatPtrTy, Int32Ty, Int32Ty,
+                            FloatPtrTy, Int64Ty);
+  IRB.CreateCall(Func, {Stream, IRB.getInt32(Offset), IRB.getInt32(Stride),
+                        Array, IRB.getInt64(Size)});
+}
+
+// Array[i] = Stream[Offset + i * Stride] for i in [0, Size)
+static void createUnpackContiguous(Module &M, IRBuilder<> &IRB, Value *Array,
+                                   uint64_t Size, Value *Stream, int Offset,
+                                   uint32_t Stride) {
+  if (SPDInlinePack) {
+    if (Offset != 0) {
+      Stream = IRB.CreateGEP(Stream, IRB.getInt64(Offset));
+    }
+    createInlineCopy(IRB, Array, 1, Stream, Stride, Size);
+    return;
+  }
+
+  Type *RetTy = Type::getVoidTy(M.getContext());
+  Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
+  Type *Int32Ty = Type::getInt32Ty(M.getContext());
+  Type *Int64Ty = Type::getInt64Ty(M.getContext());
+
+  Value *Func
+    = M.getOrInsertFunction("__spd_unpack_contiguous", RetTy,
+                            FloatPtrTy, Int64Ty,
+                            FloatPtrTy, Int32Ty, Int32Ty);
+  IRB.CreateCall(Func, {Array, IRB.getInt64(Size), Stream,
+                        IRB.getInt32(Offset), IRB.getInt32(Stride)});
+}
+
+// splits the outermost dimension of the stream into NumSlabs slabs. Each slab
+// carries enough neighbouring rows to cover the largest stream offset.
+static std::vector<SPDSlab> createSlabs(SPDChain &C, unsigned NumSlabs) {
+  SPDStreamInfo *SI = C.getReadStream();
+  uint64_t NumRows = SI->getSize(SI->getNumDims() - 1);
+  uint64_t RowSize = getRowSize(SI);
+  uint64_t HaloRows = (C.getMaxStreamOffset() + RowSize - 1) / RowSize;
+
+  if (NumSlabs == 0) NumSlabs = 1;
+  if (NumSlabs > NumRows) NumSlabs = NumRows;
+
+  std::vector<SPDSlab> Slabs;
+  for (unsigned i = 0; i < NumSlabs; i++) {
+    SPDSlab Slab;
+    Slab.Begin = NumRows * i / NumSlabs;
+    Slab.End = NumRows * (i + 1) / NumSlabs;
+    Slab.HaloBegin = (Slab.Begin > HaloRows) ? Slab.Begin - HaloRows : 0;
+    Slab.HaloEnd = std::min(Slab.End + HaloRows, NumRows);
+    Slab.ColBegin = 0;
+    Slab.ColEnd = C.getGridWidth();
+    Slab.HaloColBegin = 0;
+    Slab.Dev = (NumSlabs > 1) ? i : -1;
+    Slab.ReadStreamBuffer = nullptr;
+    Slab.WriteStreamBuffer = nullptr;
+    Slabs.push_back(Slab);
+  }
+
+  return Slabs;
+}
+
+// splits every slab into column tiles. Tiles of the same columns are stored
+// next to each other, the tiles of a slab share its device and buffers.
+static std::vector<SPDSlab> createTiles(SPDChain &C,
+                                        std::vector<SPDSlab> &Slabs) {
+  uint64_t Halo = C.getColumnHalo();
+  assert((C.getTileWidth() > 2 * Halo) &&
+         "tile width should exceed the column halo of the chain");
+
+  uint64_t Width = C.getTileWidth() - 2 * Halo;
+  std::vector<SPDSlab> Tiles;
+  for (uint64_t Col = 0; Col < C.getGridWidth(); Col += Width) {
+    for (SPDSlab Tile : Slabs) {
+      Tile.ColBegin = Col;
+      Tile.ColEnd = std::min(Col + Width, C.getGridWidth());
+      Tile.HaloColBegin = (int64_t)Col - (int64_t)Halo;
+      Tiles.push_back(Tile);
+    }
+  }
+
+  return Tiles;
+}
+
 static void createRuntimeInitFunc(Module &M, IRBuilder<> &IRB) {
   Type *VoidTy = Type::getVoidTy(M.getContext());
   Value *Func = M.getOrInsertFunction("__spd_initialize", VoidTy);
   IRB.CreateCall(Func);
 }
 
-static GlobalVariable *createAllocStreamFunc(SPDStreamInfo *SI,
+static void createSetEmulatorFunc(Function *Emulator,
+                                  Module &M, IRBuilder<> &IRB) {
+  Type *VoidTy = Type::getVoidTy(M.getContext());
+  Value *Func = M.getOrInsertFunction("__spd_set_emulator", VoidTy,
+                                      Emulator->getType());
+  IRB.CreateCall(Func, {Emulator});
+}
+
+static GlobalVariable *createAllocStreamFunc(uint64_t AllocSize,
                                              Module &M, IRBuilder<> &IRB) {
   Type *RetTy = Type::getFloatPtrTy(M.getContext());
   Type *Int64Ty = Type::getInt64Ty(M.getContext());
 
   Value *Func = M.getOrInsertFunction("__spd_alloc_stream", RetTy, Int64Ty);
-  CallInst *RetValue = IRB.CreateCall(Func, {IRB.getInt64(SI->getAllocSize())});
+  CallInst *RetValue = IRB.CreateCall(Func, {IRB.getInt64(AllocSize)});
 
 // FIXME InternalLinkage is better?
   GlobalVariable *StreamBufferPtr
@@ -50,8 +347,131 @@ static GlobalVariable *createAllocStreamFunc(SPDStreamInfo *SI,
   return StreamBufferPtr;
 }
 
+// table of the arrays moved by a fused pack/unpack, nullptr unless the
+// arrays are stored at consecutive offsets and have the same number of
+// elements in rows [BeginRow, EndRow)
+static Value *createArrayTable(Module &M, IRBuilder<> &IRB,
+                               const std::vector<SPDArrayInfo *> &Arrays,
+                               uint64_t BeginRow, uint64_t EndRow,
+                               uint64_t &Size) {
+  Type *FloatTy = Type::getFloatTy(M.getContext());
+  Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
+  Type *Int64Ty = Type::getInt64Ty(M.getContext());
+  if (Arrays.empty()) {
+    return nullptr;
+  }
+
+  SmallVector<Constant *, 8> Elmts;
+  for (unsigned i = 0; i < Arrays.size(); i++) {
+    SPDArrayInfo *AI = Arrays[i];
+    uint64_t RowSize = getRowSize(AI);
+    uint64_t NumRows = getNumRows(AI);
+    uint64_t Begin = std::min(BeginRow, NumRows) * RowSize;
+    uint64_t End = std::min(EndRow, NumRows) * RowSize;
+    if ((AI->getOffset() != (int)i) || ((i != 0) && (End - Begin != Size))) {
+      return nullptr;
+    }
+
+    Size = End - Begin;
+    Constant *ArrayRef = cast<Constant>(AI->getArrayRef());
+    ArrayRef = ConstantExpr::getPointerCast(ArrayRef, FloatPtrTy);
+    if (Begin != 0) {
+      ArrayRef = ConstantExpr::getGetElementPtr(
+          FloatTy, ArrayRef, ConstantInt::get(Int64Ty, Begin));
+    }
+    Elmts.push_back(ArrayRef);
+  }
+
+  ArrayType *TableTy = ArrayType::get(FloatPtrTy, Elmts.size());
+  GlobalVariable *Table
+    = new GlobalVariable(M, TableTy, true, GlobalValue::PrivateLinkage,
+                         ConstantArray::get(TableTy, Elmts), "__spd_arrays");
+
+  return IRB.CreateConstGEP2_64(Table, 0, 0);
+}
+
 static void createPackFunc(SPDIR &IR, Module &M, IRBuilder<> &IRB,
-                           SPDStreamInfo *SI, GlobalVariable *StreamBuffer) {
+                           SPDStreamInfo *SI, const SPDSlab &Slab) {
+  Type *RetTy = Type::getVoidTy(M.getContext());
+  Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
+  Type *Int32Ty = Type::getInt32Ty(M.getContext());
+  Type *Int64Ty = Type::getInt64Ty(M.getContext());
+  Type *FloatPtrPtrTy = FloatPtrTy->getPointerTo();
+  bool Tiled = IR.getTileWidth() != 0;
+
+// all arrays in one pass
+  uint64_t Size = 0;
+  std::vector<SPDArrayInfo *> Arrays(IR.read_begin(), IR.read_end());
+  Value *Table = nullptr;
+  if (!Tiled && !SI->isSeparate() && !SPDInlinePack) {
+    Table = createArrayTable(M, IRB, Arrays, Slab.HaloBegin, Slab.HaloEnd,
+                             Size);
+  }
+
+  if (Table != nullptr) {
+    Value *Func
+      = M.getOrInsertFunction("__spd_pack_interleaved", RetTy,
+                              FloatPtrTy, Int32Ty, FloatPtrPtrTy,
+                              Int32Ty, Int64Ty);
+    Value *SB = IRB.CreateLoad(Slab.ReadStreamBuffer);
+    IRB.CreateCall(Func, {SB, IRB.getInt32(SI->getStride()), Table,
+                          IRB.getInt32(Arrays.size()), IRB.getInt64(Size)});
+    return;
+  }
+
+  Value *Func = nullptr;
+  if (Tiled) {
+    Func = M.getOrInsertFunction("__spd_pack_2d", RetTy,
+                                 FloatPtrTy, Int32Ty, Int32Ty, Int64Ty,
+                                 FloatPtrTy, Int64Ty, Int64Ty, Int64Ty);
+  }
+
+  for (auto Iter = IR.read_begin(); Iter != IR.read_end(); Iter++) {
+    SPDArrayInfo *AI = *Iter;
+
+    SmallVector<Value *, 8> Args;
+
+    int Offset = AI->getOffset();
+    uint32_t Stride;
+    Value *SB = IRB.CreateLoad(Slab.ReadStreamBuffer);
+    SB = getStreamWord(IRB, SB, SI, Slab, Offset, Stride);
+    Args.push_back(SB);
+    Args.push_back(IRB.getInt32(Offset));
+    Args.push_back(IRB.getInt32(Stride));
+    if (Tiled) {
+      Args.push_back(IRB.getInt64(SI->getSize(0)));
+    }
+
+    uint64_t RowSize = getRowSize(AI);
+    uint64_t NumRows = getNumRows(AI);
+    uint64_t Begin = std::min(Slab.HaloBegin, NumRows) * RowSize;
+    uint64_t End = std::min(Slab.HaloEnd, NumRows) * RowSize;
+
+    Value *ArrayRef = AI->getArrayRef();
+    ArrayRef = IRB.CreatePointerCast(ArrayRef, FloatPtrTy);
+    if (Begin != 0) {
+      ArrayRef = IRB.CreateGEP(ArrayRef, IRB.getInt64(Begin));
+    }
+    if (!Tiled) {
+      createPackContiguous(M, IRB, SB, Offset, Stride, ArrayRef,
+                           End - Begin);
+      continue;
+    }
+
+// columns of the tile outside of the array are filled with 0
+    Args.push_back(ArrayRef);
+    Args.push_back(IRB.getInt64(RowSize));
+    Args.push_back(IRB.getInt64((End - Begin) / RowSize));
+    Args.push_back(IRB.getInt64(Slab.HaloColBegin));
+
+    IRB.CreateCall(Func, Args);
+  }
+}
+
+// broadcast arrays are packed once and shared by all slabs
+static void createBroadcastPackFunc(SPDIR &IR, Module &M, IRBuilder<> &IRB,
+                                    SPDStreamInfo *SI,
+                                    GlobalVariable *StreamBuffer) {
   Type *RetTy = Type::getVoidTy(M.getContext());
   Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
   Type *Int32Ty = Type::getInt32Ty(M.getContext());
@@ -62,11 +482,10 @@ static void createPackFunc(SPDIR &IR, Module &M, IRBuilder<> &IRB,
                             FloatPtrTy, Int32Ty, Int32Ty,
                             FloatPtrTy, Int64Ty);
 
-  for (auto Iter = IR.read_begin(); Iter != IR.read_end(); Iter++) {
+  for (auto Iter = IR.broadcast_begin(); Iter != IR.broadcast_end(); Iter++) {
     SPDArrayInfo *AI = *Iter;
 
     SmallVector<Value *, 8> Args;
-
     Value *SB = IRB.CreateLoad(StreamBuffer);
     Args.push_back(SB);
     Args.push_back(IRB.getInt32(AI->getOffset()));
@@ -75,143 +494,491 @@ static void createPackFunc(SPDIR &IR, Module &M, IRBuilder<> &IRB,
     Value *ArrayRef = AI->getArrayRef();
     ArrayRef = IRB.CreatePointerCast(ArrayRef, FloatPtrTy);
     Args.push_back(ArrayRef);
-
-    uint64_t TotalSize = 1;
-    for (uint64_t DimSize : *AI) {
-      TotalSize *= DimSize;
-    }
-    Args.push_back(IRB.getInt64(TotalSize));
+    Args.push_back(IRB.getInt64(AI->getNumElements()));
 
     IRB.CreateCall(Func, Args);
   }
 }
 
-static void createPCIInFunc(Module &M, IRBuilder<> &IRB,
-                            SPDStreamInfo *SI, GlobalVariable *StreamBuffer) {
+// Dev < 0 uses the single-device interface
+static void createPCIBroadcastFunc(Module &M, IRBuilder<> &IRB,
+                                   SPDStreamInfo *SI,
+                                   GlobalVariable *StreamBuffer, int Dev) {
   Type *RetTy = Type::getVoidTy(M.getContext());
   Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
+  Type *Int32Ty = Type::getInt32Ty(M.getContext());
   Type *Int64Ty = Type::getInt64Ty(M.getContext());
 
-  Value *Func
-    = M.getOrInsertFunction("__spd_pci_dma_to_FPGA", RetTy,
-                            FloatPtrTy, Int64Ty);
-
   SmallVector<Value *, 8> Args;
   Value *SB = IRB.CreateLoad(StreamBuffer);
   Args.push_back(SB);
   Args.push_back(IRB.getInt64(SI->getAllocSize()));
+
+  Value *Func;
+  if (Dev < 0) {
+    Func = M.getOrInsertFunction("__spd_pci_dma_bcast_to_FPGA", RetTy,
+                                 FloatPtrTy, Int64Ty);
+  }
+  else {
+    Func = M.getOrInsertFunction("__spd_pci_dma_bcast_to_FPGA_dev", RetTy,
+                                 FloatPtrTy, Int64Ty, Int32Ty);
+    Args.push_back(IRB.getInt32(Dev));
+  }
+
   IRB.CreateCall(Func, Args);
 }
 
-static void createDomainAttrFunc(SPDDomainInfo &DI,
-                                 Module &M, IRBuilder<> &IRB,
-                                 SPDStreamInfo *SI,
-                                 GlobalVariable *StreamBuffer) {
+// Dev < 0 uses the single-device interface
+static void createPCIInFunc(Module &M, IRBuilder<> &IRB,
+                            SPDStreamInfo *SI, const SPDSlab &Slab,
+                            int Dev) {
   Type *RetTy = Type::getVoidTy(M.getContext());
   Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
   Type *Int32Ty = Type::getInt32Ty(M.getContext());
   Type *Int64Ty = Type::getInt64Ty(M.getContext());
 
-  Value *Func
-    = M.getOrInsertFunction("__spd_create_domain_2", RetTy,
-                            FloatPtrTy, Int32Ty,
-                            Int64Ty, Int64Ty, Int64Ty,
-                            Int64Ty, Int64Ty, Int64Ty);
-
   SmallVector<Value *, 8> Args;
-  Value *SB = IRB.CreateLoad(StreamBuffer);
+  Value *SB = IRB.CreateLoad(Slab.ReadStreamBuffer);
   Args.push_back(SB);
+  Args.push_back(IRB.getInt64(getSlabAllocSize(SI, Slab)));
+
+  Value *Func;
+  if (Dev < 0) {
+    Func = M.getOrInsertFunction("__spd_pci_dma_to_FPGA", RetTy,
+                                 FloatPtrTy, Int64Ty);
+  }
+  else {
+    Func = M.getOrInsertFunction("__spd_pci_dma_to_FPGA_dev", RetTy,
+                                 FloatPtrTy, Int64Ty, Int32Ty);
+    Args.push_back(IRB.getInt32(Dev));
+  }
+
+  IRB.CreateCall(Func, Args);
+}
+
+// Dev < 0 uses the single-device interface. A compressed channel is sent
+// run-length encoded, the runtime encodes it.
+static void createPCIChannelInFunc(Module &M, IRBuilder<> &IRB,
+                                   Value *Src, const SPDStreamInfo *SI,
+                                   const SPDSlab &Slab, int Channel,
+                                   int Dev, bool Compressed = false) {
+  Type *RetTy = Type::getVoidTy(M.getContext());
+  Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
+  Type *Int32Ty = Type::getInt32Ty(M.getContext());
+  Type *Int64Ty = Type::getInt64Ty(M.getContext());
+
+  SmallVector<Value *, 8> Args;
+  Args.push_back(Src);
+  Args.push_back(IRB.getInt64(getSlabNumElements(SI, Slab)));
+  Args.push_back(IRB.getInt32(Channel));
   Args.push_back(IRB.getInt32(SI->getStride()));
 
+  std::string FuncName = Compressed ? "__spd_pci_dma_channel_rle_to_FPGA"
+                                    : "__spd_pci_dma_channel_to_FPGA";
+  Value *Func;
+  if (Dev < 0) {
+    Func = M.getOrInsertFunction(FuncName, RetTy,
+                                 FloatPtrTy, Int64Ty, Int32Ty, Int32Ty);
+  }
+  else {
+    Func = M.getOrInsertFunction(FuncName + "_dev", RetTy,
+                                 FloatPtrTy, Int64Ty, Int32Ty, Int32Ty,
+                                 Int32Ty);
+    Args.push_back(IRB.getInt32(Dev));
+  }
+
+  IRB.CreateCall(Func, Args);
+}
+
+// Every word of a separate stream is sent through its own channel. Arrays
+// covering the rows of the slab are sent from their own memory, the others
+// are packed into their plane of the slab buffer first. The attr plane is
+// filled by createDomainAttrFunc. Arrays of -polly-spd-compress-arrays are
+// run-length encoded on the way.
+static void createChannelInFunc(SPDIR &IR, Module &M, IRBuilder<> &IRB,
+                                SPDStreamInfo *SI, const SPDSlab &Slab) {
+  Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
+
+  for (auto Iter = IR.read_begin(); Iter != IR.read_end(); Iter++) {
+    SPDArrayInfo *AI = *Iter;
+    uint64_t RowSize = getRowSize(AI);
+    uint64_t NumRows = getNumRows(AI);
+    uint64_t Begin = std::min(Slab.HaloBegin, NumRows) * RowSize;
+    uint64_t End = std::min(Slab.HaloEnd, NumRows) * RowSize;
+
+    Value *ArrayRef = AI->getArrayRef();
+    ArrayRef = IRB.CreatePointerCast(ArrayRef, FloatPtrTy);
+    if (Begin != 0) {
+      ArrayRef = IRB.CreateGEP(ArrayRef, IRB.getInt64(Begin));
+    }
+
+    Value *Src = ArrayRef;
+    if (!isZeroCopy(AI, SI, Slab.HaloEnd)) {
+      int Offset = AI->getOffset();
+      uint32_t Stride;
+      Value *SB = IRB.CreateLoad(Slab.ReadStreamBuffer);
+      Src = getStreamWord(IRB, SB, SI, Slab, Offset, Stride);
+      createPackContiguous(M, IRB, Src, Offset, Stride, ArrayRef,
+                           End - Begin);
+    }
+
+    createPCIChannelInFunc(M, IRB, Src, SI, Slab, AI->getOffset(), Slab.Dev,
+                           AI->isCompressed());
+  }
+
+  if (!IR.hasDeviceAttr()) {
+    int Offset = SI->getStride() - 1;
+    uint32_t Stride;
+    Value *SB = IRB.CreateLoad(Slab.ReadStreamBuffer);
+    SB = getStreamWord(IRB, SB, SI, Slab, Offset, Stride);
+    createPCIChannelInFunc(M, IRB, SB, SI, Slab, SI->getStride() - 1,
+                           Slab.Dev);
+  }
+}
+
+// with a device-side attr the bounds are written to the domain registers of
+// the kernel, otherwise the host fills the attr word of the stream
+static void createDomainAttrFunc(SPDIR &IR, Module &M, IRBuilder<> &IRB,
+                                 SPDStreamInfo *SI,
+                                 const SPDSlab &Slab, int Dev) {
+  Type *RetTy = Type::getVoidTy(M.getContext());
+  Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
+  Type *Int32Ty = Type::getInt32Ty(M.getContext());
+  Type *Int64Ty = Type::getInt64Ty(M.getContext());
+  SPDDomainInfo &DI = *(IR.getDomainInfo());
+
+  SmallVector<Value *, 8> Args;
+  if (!IR.hasDeviceAttr()) {
+    int Offset = SI->getStride() - 1;
+    uint32_t Stride;
+    Value *SB = IRB.CreateLoad(Slab.ReadStreamBuffer);
+    SB = getStreamWord(IRB, SB, SI, Slab, Offset, Stride);
+    Args.push_back(SB);
+    Args.push_back(IRB.getInt32(Stride));
+  }
+
 // FIXME now supports only 2-dim arrays
   int NumDims = DI.getNumDims();
   assert((NumDims == 2) && "now supports only 2-dim arrays");
-  for (int i = 0; i < 2; i++) {
-    Args.push_back(IRB.getInt64(DI.getStart(i)));
-    Args.push_back(IRB.getInt64(DI.getEnd(i)));
-    Args.push_back(IRB.getInt64(SI->getSize(i)));
+// the innermost dimension is clipped to the columns written back by this
+// tile and expressed relative to the first column of the tile
+  int64_t ColStart = std::max<int64_t>(DI.getStart(0), Slab.ColBegin);
+  int64_t ColEnd = std::min<int64_t>(DI.getEnd(0), Slab.ColEnd - 1);
+  Args.push_back(IRB.getInt64(ColStart - Slab.HaloColBegin));
+  Args.push_back(IRB.getInt64(ColEnd - Slab.HaloColBegin));
+  Args.push_back(IRB.getInt64(SI->getSize(0)));
+
+// the outermost dimension is clipped to the rows written back by this slab
+// and expressed relative to the first row of the slab
+  int64_t Start = std::max<int64_t>(DI.getStart(1), Slab.Begin);
+  int64_t End = std::min<int64_t>(DI.getEnd(1), Slab.End - 1);
+  Args.push_back(IRB.getInt64(Start - Slab.HaloBegin));
+  Args.push_back(IRB.getInt64(End - Slab.HaloBegin));
+  Args.push_back(IRB.getInt64(Slab.getNumRows()));
+
+  Value *Func;
+  if (!IR.hasDeviceAttr()) {
+    Func = M.getOrInsertFunction("__spd_create_domain_2", RetTy,
+                                 FloatPtrTy, Int32Ty,
+                                 Int64Ty, Int64Ty, Int64Ty,
+                                 Int64Ty, Int64Ty, Int64Ty);
+  }
+  else if (Dev < 0) {
+    Func = M.getOrInsertFunction("__spd_set_domain_2", RetTy,
+                                 Int64Ty, Int64Ty, Int64Ty,
+                                 Int64Ty, Int64Ty, Int64Ty);
+  }
+  else {
+    Func = M.getOrInsertFunction("__spd_set_domain_2_dev", RetTy,
+                                 Int64Ty, Int64Ty, Int64Ty,
+                                 Int64Ty, Int64Ty, Int64Ty, Int32Ty);
+    Args.push_back(IRB.getInt32(Dev));
   }
 
   IRB.CreateCall(Func, Args);
 }
 
+// value of a value of the extracted function as seen from its caller
+static Value *getCallerValue(Value *V, CallInst *Caller, IRBuilder<> &IRB) {
+  if (Argument *Arg = dyn_cast<Argument>(V)) {
+    return Caller->getArgOperand(Arg->getArgNo());
+  }
+  else if (isa<Constant>(V)) {
+    return V;
+  }
+  else if (LoadInst *Load = dyn_cast<LoadInst>(V)) {
+    return IRB.CreateLoad(getCallerValue(Load->getPointerOperand(),
+                                         Caller, IRB));
+  }
+
+  llvm_unreachable("unsupported kernel parameter");
+}
+
+// parameters are passed as 32-bit words, integers as their bit pattern
+static void createSetParamFunc(SPDIR &IR, Module &M, IRBuilder<> &IRB,
+                               CallInst *Caller, int Dev) {
+  Type *RetTy = Type::getVoidTy(M.getContext());
+  Type *FloatTy = Type::getFloatTy(M.getContext());
+  Type *Int32Ty = Type::getInt32Ty(M.getContext());
+
+  Value *Func;
+  if (Dev < 0) {
+    Func = M.getOrInsertFunction("__spd_set_param", RetTy,
+                                 Int32Ty, FloatTy);
+  }
+  else {
+    Func = M.getOrInsertFunction("__spd_set_param_dev", RetTy,
+                                 Int32Ty, FloatTy, Int32Ty);
+  }
+
+  for (auto Iter = IR.param_begin(); Iter != IR.param_end(); Iter++) {
+    const SPDParamInfo *PI = *Iter;
+    Value *V = getCallerValue(PI->getValue(), Caller, IRB);
+    Type *Ty = V->getType();
+    if (Ty->isDoubleTy()) {
+      V = IRB.CreateFPTrunc(V, FloatTy);
+    }
+    else if (Ty->isIntegerTy()) {
+      V = IRB.CreateSExtOrTrunc(V, Int32Ty);
+      V = IRB.CreateBitCast(V, FloatTy);
+    }
+    else if (!Ty->isFloatTy()) {
+      llvm_unreachable("unsupported parameter type");
+    }
+
+    SmallVector<Value *, 8> Args;
+    Args.push_back(IRB.getInt32(PI->getIndex()));
+    Args.push_back(V);
+    if (Dev >= 0) {
+      Args.push_back(IRB.getInt32(Dev));
+    }
+
+    IRB.CreateCall(Func, Args);
+  }
+}
+
 static void createRunKernelFunc(Module &M, IRBuilder<> &IRB,
                                 SPDStreamInfo *RSI, SPDStreamInfo *WSI,
-                                uint64_t SwitchInOut) {
+                                const SPDSlab &Slab,
+                                uint64_t SwitchInOut, int Dev) {
   Type *RetTy = Type::getVoidTy(M.getContext());
   Type *Int32Ty = Type::getInt32Ty(M.getContext());
   Type *Int64Ty = Type::getInt64Ty(M.getContext());
-  
-  Value *Func
-    = M.getOrInsertFunction("__spd_run_kernel", RetTy,
-                            Int64Ty, Int32Ty);
 
-  assert((RSI->getAllocSize() == WSI->getAllocSize()) &&
-         "in/out stream should have the same size");
+  // the output stream of a chain may be wider than its input stream
+  uint64_t Size = std::max(getSlabAllocSize(RSI, Slab),
+                           getSlabAllocSize(WSI, Slab));
 
   SmallVector<Value *, 8> Args;
-  Args.push_back(IRB.getInt64(RSI->getAllocSize()));
+  Args.push_back(IRB.getInt64(Size));
   Args.push_back(IRB.getInt32(SwitchInOut));
+
+  Value *Func;
+  if (Dev < 0) {
+    Func = M.getOrInsertFunction("__spd_run_kernel", RetTy,
+                                 Int64Ty, Int32Ty);
+  }
+  else {
+    Func = M.getOrInsertFunction("__spd_run_kernel_dev", RetTy,
+                                 Int64Ty, Int32Ty, Int32Ty);
+    Args.push_back(IRB.getInt32(Dev));
+  }
+
   IRB.CreateCall(Func, Args);
 }
 
 static void createPCIOutFunc(Module &M, IRBuilder<> &IRB,
-                             SPDStreamInfo *SI, GlobalVariable *StreamBuffer,
-                             uint64_t SwitchInOut) {
+                             SPDStreamInfo *SI, const SPDSlab &Slab,
+                             uint64_t SwitchInOut, int Dev) {
   Type *RetTy = Type::getVoidTy(M.getContext());
   Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
   Type *Int32Ty = Type::getInt32Ty(M.getContext());
   Type *Int64Ty = Type::getInt64Ty(M.getContext());
 
-  Value *Func
-    = M.getOrInsertFunction("__spd_pci_dma_from_FPGA", RetTy,
-                            FloatPtrTy, Int64Ty, Int32Ty);
-
   SmallVector<Value *, 8> Args;
-  Value *SB = IRB.CreateLoad(StreamBuffer);
+  Value *SB = IRB.CreateLoad(Slab.WriteStreamBuffer);
   Args.push_back(SB);
-  Args.push_back(IRB.getInt64(SI->getAllocSize()));
+  Args.push_back(IRB.getInt64(getSlabAllocSize(SI, Slab)));
   Args.push_back(IRB.getInt32(SwitchInOut));
+
+  Value *Func;
+  if (Dev < 0) {
+    Func = M.getOrInsertFunction("__spd_pci_dma_from_FPGA", RetTy,
+                                 FloatPtrTy, Int64Ty, Int32Ty);
+  }
+  else {
+    Func = M.getOrInsertFunction("__spd_pci_dma_from_FPGA_dev", RetTy,
+                                 FloatPtrTy, Int64Ty, Int32Ty, Int32Ty);
+    Args.push_back(IRB.getInt32(Dev));
+  }
+
   IRB.CreateCall(Func, Args);
 }
 
-static void createUnpackFunc(SPDIR &IR, Module &M, IRBuilder<> &IRB,
-                             SPDStreamInfo *SI, GlobalVariable *StreamBuffer) {
+// Dev < 0 uses the single-device interface
+static void createPCIChannelOutFunc(Module &M, IRBuilder<> &IRB, Value *Dst,
+                                    uint64_t Size, uint64_t Offset,
+                                    int Channel, uint64_t SwitchInOut,
+                                    int Dev) {
   Type *RetTy = Type::getVoidTy(M.getContext());
   Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
   Type *Int32Ty = Type::getInt32Ty(M.getContext());
   Type *Int64Ty = Type::getInt64Ty(M.getContext());
 
-  Value *Func
-    = M.getOrInsertFunction("__spd_unpack_contiguous", RetTy,
-                            FloatPtrTy, Int64Ty,
-                            FloatPtrTy, Int32Ty, Int32Ty);
+  SmallVector<Value *, 8> Args;
+  Args.push_back(Dst);
+  Args.push_back(IRB.getInt64(Size));
+  Args.push_back(IRB.getInt64(Offset));
+  Args.push_back(IRB.getInt32(Channel));
+  Args.push_back(IRB.getInt32(SwitchInOut));
+
+  Value *Func;
+  if (Dev < 0) {
+    Func = M.getOrInsertFunction("__spd_pci_dma_channel_from_FPGA", RetTy,
+                                 FloatPtrTy, Int64Ty, Int64Ty, Int32Ty,
+                                 Int32Ty);
+  }
+  else {
+    Func = M.getOrInsertFunction("__spd_pci_dma_channel_from_FPGA_dev",
+                                 RetTy, FloatPtrTy, Int64Ty, Int64Ty,
+                                 Int32Ty, Int32Ty, Int32Ty);
+    Args.push_back(IRB.getInt32(Dev));
+  }
+
+  IRB.CreateCall(Func, Args);
+}
+
+// Only the rows [Begin, End) of every array channel are read back, directly
+// into the arrays covering them and through the slab buffer otherwise.
+static void createChannelOutFunc(SPDChain &C, Module &M, IRBuilder<> &IRB,
+                                 SPDStreamInfo *SI, const SPDSlab &Slab,
+                                 uint64_t SwitchInOut) {
+  Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
+
+  uint64_t HaloSize = (Slab.Begin - Slab.HaloBegin) * getRowSize(SI);
+  for (auto Iter = C.write_begin(); Iter != C.write_end(); Iter++) {
+    SPDArrayInfo *AI = *Iter;
+    uint64_t RowSize = getRowSize(AI);
+    uint64_t NumRows = getNumRows(AI);
+    uint64_t Begin = std::min(Slab.Begin, NumRows) * RowSize;
+    uint64_t End = std::min(Slab.End, NumRows) * RowSize;
+
+    Value *ArrayRef = AI->getArrayRef();
+    ArrayRef = IRB.CreatePointerCast(ArrayRef, FloatPtrTy);
+    if (Begin != 0) {
+      ArrayRef = IRB.CreateGEP(ArrayRef, IRB.getInt64(Begin));
+    }
+
+    if (isZeroCopy(AI, SI, Slab.End)) {
+      createPCIChannelOutFunc(M, IRB, ArrayRef, End - Begin, HaloSize,
+                              AI->getOffset(), SwitchInOut, Slab.Dev);
+      continue;
+    }
+
+    int Offset = AI->getOffset();
+    uint32_t Stride;
+    Value *SB = IRB.CreateLoad(Slab.WriteStreamBuffer);
+    SB = getStreamWord(IRB, SB, SI, Slab, Offset, Stride);
+    createPCIChannelOutFunc(M, IRB, SB, End - Begin, HaloSize,
+                            AI->getOffset(), SwitchInOut, Slab.Dev);
+    createUnpackContiguous(M, IRB, ArrayRef, End - Begin, SB, Offset,
+                           Stride);
+  }
+}
+
+static void createUnpackFunc(SPDChain &C, Module &M, IRBuilder<> &IRB,
+                             SPDStreamInfo *SI, const SPDSlab &Slab) {
+  Type *RetTy = Type::getVoidTy(M.getContext());
+  Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
+  Type *Int32Ty = Type::getInt32Ty(M.getContext());
+  Type *Int64Ty = Type::getInt64Ty(M.getContext());
+  Type *FloatPtrPtrTy = FloatPtrTy->getPointerTo();
+  bool Tiled = C.getTileWidth() != 0;
+
+// all arrays in one pass, skipping the leading halo rows of the slab
+  uint64_t Size = 0;
+  std::vector<SPDArrayInfo *> Arrays(C.write_begin(), C.write_end());
+  Value *Table = nullptr;
+  if (!Tiled && !SI->isSeparate() && !SPDInlinePack) {
+    Table = createArrayTable(M, IRB, Arrays, Slab.Begin, Slab.End, Size);
+  }
+
+  if (Table != nullptr) {
+    Value *Func
+      = M.getOrInsertFunction("__spd_unpack_interleaved", RetTy,
+                              FloatPtrPtrTy, Int32Ty, Int64Ty,
+                              FloatPtrTy, Int32Ty);
+    Value *SB = IRB.CreateLoad(Slab.WriteStreamBuffer);
+    uint64_t HaloSize
+      = (Slab.Begin - Slab.HaloBegin) * getRowSize(SI) * SI->getStride();
+    if (HaloSize != 0) {
+      SB = IRB.CreateGEP(SB, IRB.getInt64(HaloSize));
+    }
+    IRB.CreateCall(Func, {Table, IRB.getInt32(Arrays.size()),
+                          IRB.getInt64(Size), SB,
+                          IRB.getInt32(SI->getStride())});
+    return;
+  }
+
+  Value *Func = nullptr;
+  if (Tiled) {
+    Func = M.getOrInsertFunction("__spd_unpack_2d", RetTy,
+                                 FloatPtrTy, Int64Ty, Int64Ty, Int64Ty,
+                                 FloatPtrTy, Int32Ty, Int32Ty, Int64Ty);
+  }
 
-  for (auto Iter = IR.write_begin(); Iter != IR.write_end(); Iter++) {
+  for (auto Iter = C.write_begin(); Iter != C.write_end(); Iter++) {
     SPDArrayInfo *AI = *Iter;
 
     SmallVector<Value *, 8> Args;
 
+    uint64_t RowSize = getRowSize(AI);
+    uint64_t NumRows = getNumRows(AI);
+    uint64_t Begin = std::min(Slab.Begin, NumRows) * RowSize;
+    uint64_t End = std::min(Slab.End, NumRows) * RowSize;
+    uint64_t NumSlabRows = (End - Begin) / RowSize;
+    if (Tiled) {
+      Begin += Slab.ColBegin;
+    }
+
     Value *ArrayRef = AI->getArrayRef();
     ArrayRef = IRB.CreatePointerCast(ArrayRef, FloatPtrTy);
+    if (Begin != 0) {
+      ArrayRef = IRB.CreateGEP(ArrayRef, IRB.getInt64(Begin));
+    }
     Args.push_back(ArrayRef);
+    Args.push_back(IRB.getInt64(RowSize));
+    Args.push_back(IRB.getInt64(NumSlabRows));
+    Args.push_back(IRB.getInt64(Slab.ColEnd - Slab.ColBegin));
+
+// skip the leading halo rows and columns of the slab
+    int Offset = AI->getOffset();
+    uint32_t Stride;
+    Value *SB = IRB.CreateLoad(Slab.WriteStreamBuffer);
+    SB = getStreamWord(IRB, SB, SI, Slab, Offset, Stride);
+    uint64_t HaloSize
+      = ((Slab.Begin - Slab.HaloBegin) * getRowSize(SI)
+         + (Slab.ColBegin - Slab.HaloColBegin)) * Stride;
+    if (HaloSize != 0) {
+      SB = IRB.CreateGEP(SB, IRB.getInt64(HaloSize));
+    }
 
-    uint64_t TotalSize = 1;
-    for (uint64_t DimSize : *AI) {
-      TotalSize *= DimSize;
+    if (!Tiled) {
+      createUnpackContiguous(M, IRB, ArrayRef, End - Begin, SB, Offset,
+                             Stride);
+      continue;
     }
-    Args.push_back(IRB.getInt64(TotalSize));
 
-    Value *SB = IRB.CreateLoad(StreamBuffer);
     Args.push_back(SB);
-    Args.push_back(IRB.getInt32(AI->getOffset()));
-    Args.push_back(IRB.getInt32(SI->getStride()));
+    Args.push_back(IRB.getInt32(Offset));
+    Args.push_back(IRB.getInt32(Stride));
+    Args.push_back(IRB.getInt64(SI->getSize(0)));
 
     IRB.CreateCall(Func, Args);
   }
 }
 
-static void createFreeStreamFunc(SPDIR &IR, Module &M, IRBuilder<> &IRB,
+static void createFreeStreamFunc(Module &M, IRBuilder<> &IRB,
                                  GlobalVariable *StreamBuffer) {
   Type *RetTy = Type::getVoidTy(M.getContext());
   Type *FloatPtrTy = Type::getFloatPtrTy(M.getContext());
@@ -227,6 +994,11 @@ static void createRuntimeFinFunc(Module &M, IRBuilder<> &IRB) {
   IRB.CreateCall(Func);
 }
 
+static uint64_t getMetadataValue(MDNode *Node, unsigned Idx) {
+  ConstantAsMetadata *CM = dyn_cast<ConstantAsMetadata>(Node->getOperand(Idx));
+  return dyn_cast<ConstantInt>(CM->getValue())->getZExtValue();
+}
+
 uint64_t HostCodeGeneration::getRegionNumber(Instruction *Instr) const {
   ConstantInt *RegionInfo = dyn_cast<ConstantInt>(Instr->getOperand(0));
   if (RegionInfo == nullptr) {
@@ -251,6 +1023,14 @@ const Scop *HostCodeGeneration::getScopFromInstr(Instruction *Instr,
 
 bool HostCodeGeneration::doInitialization(Module &M) {
   for (Function &F : M) {
+    if (MDNode *Node = F.getMetadata("polly_extracted_loop")) {
+      for (User *U : F.users()) {
+        if (CallInst *CI = dyn_cast<CallInst>(U)) {
+          RegionKernelCount[{CI->getFunction(), getMetadataValue(Node, 1)}]++;
+        }
+      }
+    }
+
     for (BasicBlock &BB : F) {
       for (BasicBlock::iterator Iter = BB.begin(); Iter != BB.end(); ) {
         Instruction *Instr = &*Iter++;
@@ -259,18 +1039,496 @@ bool HostCodeGeneration::doInitialization(Module &M) {
 
         Function *Func = CI->getCalledFunction();
         if (Func->getName().equals("__spd_begin")) {
-          RegionBeginMap[getRegionNumber(CI)] = CI;
+          RegionBeginMap[{&F, getRegionNumber(CI)}] = CI;
         }
         else if (Func->getName().equals("__spd_end")) {
-          RegionEndMap[getRegionNumber(CI)] = CI;
+          RegionEndMap[{&F, getRegionNumber(CI)}] = CI;
         }
+        else if (Func->getName().equals("__spd_num_calls")) {
+          RegionNumCallsMap[{&F, getRegionNumber(CI)}] = CI;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+// the kernels of a region which was not completely analyzed stay on the host
+bool HostCodeGeneration::doFinalization(Module &M) {
+  for (auto &Region : PendingKernels) {
+    errs() << "SPD region " << Region.first.second << " in "
+           << Region.first.first->getName() << ": " << Region.second.size()
+           << " of " << RegionKernelCount[Region.first]
+           << " kernels analyzed, it stays on the host\n";
+    for (SPDKernel &K : Region.second) {
+      if (K.Emulator != nullptr) {
+        K.Emulator->eraseFromParent();
       }
+      delete K.IR;
     }
   }
 
+  PendingKernels.clear();
+  RegionKernelCount.clear();
+  RegionBeginMap.clear();
+  RegionEndMap.clear();
+  RegionNumCallsMap.clear();
   return false;
 }
 
+// With SwitchInOut every kernel call continues from the output of the
+// previous call. The halo rows of a slab are computed by the devices of its
+// neighbours, so the host exchanges them between the calls by copying the
+// rows of the output streams into the input streams. This needs output
+// streams of the layout of the input streams.
+static bool canExchangeHalos(SPDChain &C) {
+  SPDStreamInfo *RSI = C.getReadStream();
+  SPDStreamInfo *WSI = C.getWriteStream();
+  return !RSI->isSeparate() && !WSI->isSeparate() &&
+         (RSI->getStride() == WSI->getStride()) &&
+         (getRowSize(RSI) == getRowSize(WSI));
+}
+
+// copies every row of the input stream of Slab from the output stream of the
+// slab writing it back
+static void createHaloExchange(IRBuilder<> &IRB, SPDStreamInfo *SI,
+                               const SPDSlab &Slab,
+                               std::vector<SPDSlab> &Slabs) {
+  uint64_t RowWords = getRowSize(SI) * SI->getStride();
+  Value *Dst = IRB.CreateLoad(Slab.ReadStreamBuffer);
+  for (SPDSlab &Src : Slabs) {
+    uint64_t Begin = std::max(Slab.HaloBegin, Src.Begin);
+    uint64_t End = std::min(Slab.HaloEnd, Src.End);
+    if (Begin >= End) {
+      continue;
+    }
+
+    Value *SB = IRB.CreateLoad(Src.WriteStreamBuffer);
+    Value *SrcRows
+      = IRB.CreateGEP(SB, IRB.getInt64((Begin - Src.HaloBegin) * RowWords));
+    Value *DstRows
+      = IRB.CreateGEP(Dst, IRB.getInt64((Begin - Slab.HaloBegin) * RowWords));
+    IRB.CreateMemCpy(DstRows, SrcRows,
+                     (End - Begin) * RowWords * sizeof(float), 4);
+  }
+}
+
+// the streams of the slabs stay on the device between the region begin and
+// the region end, except for the halo exchange of SwitchInOut calls
+static void createSlabHostCode(SPDChain &Chain, std::vector<SPDSlab> &Slabs,
+                               CallInst *Caller, Instruction *RegionEnd,
+                               uint64_t SwitchInOut, IRBuilder<> &IRB) {
+  SPDIR &IR = *(Chain.getFirstStage());
+  Module *M = Caller->getModule();
+  SPDStreamInfo *RSI = Chain.getReadStream();
+  SPDStreamInfo *WSI = Chain.getWriteStream();
+  SPDStreamInfo *BSI = IR.getBroadcastStream();
+
+  GlobalVariable *BroadcastStreamBuffer = nullptr;
+  if (BSI != nullptr) {
+    BroadcastStreamBuffer
+      = createAllocStreamFunc(BSI->getAllocSize(), *M, IRB);
+    createBroadcastPackFunc(IR, *M, IRB, BSI, BroadcastStreamBuffer);
+  }
+
+  for (SPDSlab &Slab : Slabs) {
+    Slab.ReadStreamBuffer
+      = createAllocStreamFunc(getSlabAllocSize(RSI, Slab), *M, IRB);
+    Slab.WriteStreamBuffer
+      = createAllocStreamFunc(getSlabAllocSize(WSI, Slab), *M, IRB);
+    if (RSI->isSeparate()) {
+      createDomainAttrFunc(IR, *M, IRB, RSI, Slab, Slab.Dev);
+      createChannelInFunc(IR, *M, IRB, RSI, Slab);
+    }
+    else {
+      createPackFunc(IR, *M, IRB, RSI, Slab);
+      createDomainAttrFunc(IR, *M, IRB, RSI, Slab, Slab.Dev);
+      createPCIInFunc(*M, IRB, RSI, Slab, Slab.Dev);
+    }
+    if (BSI != nullptr) {
+      createPCIBroadcastFunc(*M, IRB, BSI, BroadcastStreamBuffer, Slab.Dev);
+    }
+  }
+
+  // kernel run
+  IRB.SetInsertPoint(Caller);
+  for (SPDSlab &Slab : Slabs) {
+    createSetParamFunc(IR, *M, IRB, Caller, Slab.Dev);
+    createRunKernelFunc(*M, IRB, RSI, WSI, Slab, SwitchInOut, Slab.Dev);
+  }
+
+  // halo exchange, the attr words of the copied rows belong to the slab they
+  // were copied from and are created again
+  if (SwitchInOut && (Slabs.size() > 1)) {
+    for (SPDSlab &Slab : Slabs) {
+      createPCIOutFunc(*M, IRB, WSI, Slab, SwitchInOut, Slab.Dev);
+    }
+    for (SPDSlab &Slab : Slabs) {
+      createHaloExchange(IRB, RSI, Slab, Slabs);
+      if (!IR.hasDeviceAttr()) {
+        createDomainAttrFunc(IR, *M, IRB, RSI, Slab, Slab.Dev);
+      }
+      createPCIInFunc(*M, IRB, RSI, Slab, Slab.Dev);
+    }
+  }
+
+  // begion end
+  if (RegionEnd != nullptr) IRB.SetInsertPoint(RegionEnd);
+  for (SPDSlab &Slab : Slabs) {
+    if (WSI->isSeparate()) {
+      createChannelOutFunc(Chain, *M, IRB, WSI, Slab, SwitchInOut);
+    }
+    else {
+      createPCIOutFunc(*M, IRB, WSI, Slab, SwitchInOut, Slab.Dev);
+      createUnpackFunc(Chain, *M, IRB, WSI, Slab);
+    }
+    createFreeStreamFunc(*M, IRB, Slab.ReadStreamBuffer);
+    createFreeStreamFunc(*M, IRB, Slab.WriteStreamBuffer);
+  }
+  if (BroadcastStreamBuffer != nullptr) {
+    createFreeStreamFunc(*M, IRB, BroadcastStreamBuffer);
+  }
+}
+
+// Tiles cannot stay on the device, the host streams them one column of tiles
+// after the other at every kernel call: the tiles of a column run in
+// parallel on the devices of their slabs and are read back before the next
+// column reuses the buffers of the slabs.
+static void createTiledHostCode(SPDChain &Chain, std::vector<SPDSlab> &Slabs,
+                                CallInst *Caller, Instruction *RegionEnd,
+                                uint64_t SwitchInOut, IRBuilder<> &IRB) {
+  SPDIR &IR = *(Chain.getFirstStage());
+  Module *M = Caller->getModule();
+  SPDStreamInfo *RSI = Chain.getReadStream();
+  SPDStreamInfo *WSI = Chain.getWriteStream();
+  assert(!RSI->isSeparate() && !WSI->isSeparate() &&
+         "separate streams are not tiled");
+
+  for (SPDSlab &Slab : Slabs) {
+    Slab.ReadStreamBuffer
+      = createAllocStreamFunc(getSlabAllocSize(RSI, Slab), *M, IRB);
+    Slab.WriteStreamBuffer
+      = createAllocStreamFunc(getSlabAllocSize(WSI, Slab), *M, IRB);
+  }
+
+  // kernel run
+  IRB.SetInsertPoint(Caller);
+  std::vector<SPDSlab> Tiles = createTiles(Chain, Slabs);
+  for (auto Column = Tiles.begin(); Column != Tiles.end();
+       Column += Slabs.size()) {
+    for (auto Tile = Column; Tile != Column + Slabs.size(); Tile++) {
+      createPackFunc(IR, *M, IRB, RSI, *Tile);
+      createDomainAttrFunc(IR, *M, IRB, RSI, *Tile, Tile->Dev);
+      createPCIInFunc(*M, IRB, RSI, *Tile, Tile->Dev);
+      createSetParamFunc(IR, *M, IRB, Caller, Tile->Dev);
+      createRunKernelFunc(*M, IRB, RSI, WSI, *Tile, SwitchInOut, Tile->Dev);
+    }
+
+    for (auto Tile = Column; Tile != Column + Slabs.size(); Tile++) {
+      createPCIOutFunc(*M, IRB, WSI, *Tile, SwitchInOut, Tile->Dev);
+      createUnpackFunc(Chain, *M, IRB, WSI, *Tile);
+    }
+  }
+
+  // begion end
+  if (RegionEnd != nullptr) IRB.SetInsertPoint(RegionEnd);
+  for (SPDSlab &Slab : Slabs) {
+    createFreeStreamFunc(*M, IRB, Slab.ReadStreamBuffer);
+    createFreeStreamFunc(*M, IRB, Slab.WriteStreamBuffer);
+  }
+}
+
+// the kernels of a region run in the order of their calls
+static void sortByCallOrder(std::vector<SPDKernel> &Kernels) {
+  Function *F = Kernels.front().Caller->getFunction();
+  std::map<Instruction *, unsigned> Order;
+  unsigned Count = 0;
+  for (BasicBlock &BB : *F) {
+    for (Instruction &I : BB) {
+      Order[&I] = Count++;
+    }
+  }
+
+  std::sort(Kernels.begin(), Kernels.end(),
+            [&Order](const SPDKernel &A, const SPDKernel &B) {
+              return Order[A.Caller] < Order[B.Caller];
+            });
+}
+
+// Seconds spent by one kernel call of a region on the host and on the
+// device, and by the transfers of the streams. The device streams every
+// element of a slab at VL elements per clock, the slabs in parallel and the
+// stages of a chain as one pipeline; the host executes every instruction of
+// every stage for each point of the domain.
+namespace {
+struct SPDCost {
+  double Transfer;
+  double Kernel;
+  double Host;
+};
+} // end anonymous namespace
+
+// largest number of calls the cost model compares with, every count up to it
+// is exact as a double
+static const double SPDMaxCalls = 9007199254740992.0;
+
+static SPDCost estimateCost(SPDChain &Chain, uint64_t VL,
+                            unsigned NumSlabs) {
+  SPDCost Cost;
+  uint64_t Words = Chain.getReadStream()->getAllocSize()
+                   + Chain.getWriteStream()->getAllocSize();
+  SPDStreamInfo *BSI = Chain.getFirstStage()->getBroadcastStream();
+  if (BSI != nullptr) {
+    Words += BSI->getAllocSize();
+  }
+  Cost.Transfer = Words * sizeof(float) / (SPDLinkBandwidth * 1e6);
+
+  uint64_t NumElements = Chain.getReadStream()->getNumElements();
+  Cost.Kernel = NumElements / (double)(VL * NumSlabs) / (SPDClock * 1e6);
+
+  Cost.Host = 0;
+  for (int i = 0; i < Chain.getNumStages(); i++) {
+    SPDIR *IR = Chain.getStage(i);
+    SPDDomainInfo *DI = IR->getDomainInfo();
+    double NumPoints = 1;
+    for (int j = 0; j < DI->getNumDims(); j++) {
+      NumPoints *= DI->getEnd(j) - DI->getStart(j) + 1;
+    }
+
+    Cost.Host += NumPoints * IR->getNumInstrs() / (SPDHostOps * 1e6);
+  }
+
+  return Cost;
+}
+
+// Decides whether the kernels of a region run on the device. NumCalls is the
+// __spd_num_calls marker of the region, if the number of kernel calls is
+// known. When it is parametric, Cond is set to a runtime check emitted at the
+// region begin, which is true when offloading is faster.
+static bool isProfitable(SPDChain &Chain, std::vector<SPDKernel> &Kernels,
+                         unsigned NumSlabs, Instruction *RegionBegin,
+                         CallInst *NumCalls, Value *&Cond) {
+  Cond = nullptr;
+  if (PollyProcessUnprofitable) {
+    return true;
+  }
+
+  SPDCost Cost = estimateCost(Chain, Kernels.front().VectorLength, NumSlabs);
+  DEBUG(dbgs() << "SPD region " << Chain.getRegionNumber()
+               << ": transfer " << Cost.Transfer << " s, kernel "
+               << Cost.Kernel << " s, host " << Cost.Host << " s per call\n");
+
+// tiles and slabs exchanging their halos are streamed at every call
+  if ((Chain.getTileWidth() != 0) ||
+      (Kernels.front().SwitchInOut && (NumSlabs > 1))) {
+    return Cost.Transfer + Cost.Kernel < Cost.Host;
+  }
+
+  if (!(Cost.Kernel < Cost.Host)) {
+    return false;
+  }
+
+// the transfers pay off after MinCalls calls, a count beyond any loop nest
+// (or not a number for broken estimates) is never reached
+  double MinCalls = std::floor(Cost.Transfer / (Cost.Host - Cost.Kernel)) + 1;
+  if (!std::isfinite(MinCalls) || (MinCalls > SPDMaxCalls)) {
+    return false;
+  }
+  if (RegionBegin == nullptr) {
+    return MinCalls <= 1;
+  }
+
+// without a known number of calls the cost model cannot overrule the
+// offload directive of the region
+  if (NumCalls == nullptr) {
+    return true;
+  }
+
+  uint64_t Calls
+    = cast<ConstantInt>(NumCalls->getArgOperand(1))->getZExtValue();
+  Value *ParamCalls = NumCalls->getArgOperand(2);
+  if (ConstantInt *C = dyn_cast<ConstantInt>(ParamCalls)) {
+    return double(Calls) * double(C->getZExtValue()) >= MinCalls;
+  }
+
+  uint64_t MinParamCalls = uint64_t(MinCalls) / Calls;
+  if (uint64_t(MinCalls) % Calls != 0) {
+    MinParamCalls++;
+  }
+
+  IRBuilder<> IRB(RegionBegin);
+  Cond = IRB.CreateICmpUGE(ParamCalls, IRB.getInt64(MinParamCalls),
+                           "spd.profitable");
+  return true;
+}
+
+// The region begin, the kernel calls and the region end get an offloaded
+// version, taken when Cond holds. The host version of a call is a copy of it.
+static void versionRegion(Value *Cond, std::vector<SPDKernel> &Kernels,
+                          Instruction *&RegionBegin, Instruction *&RegionEnd) {
+  RegionBegin = SplitBlockAndInsertIfThen(Cond, RegionBegin, false);
+
+  for (SPDKernel &K : Kernels) {
+    TerminatorInst *ThenTerm;
+    TerminatorInst *ElseTerm;
+    Instruction *HostCall = K.Caller->clone();
+    SplitBlockAndInsertIfThenElse(Cond, K.Caller, &ThenTerm, &ElseTerm);
+    K.Caller->moveBefore(ThenTerm);
+    HostCall->insertBefore(ElseTerm);
+  }
+
+  if (RegionEnd != nullptr) {
+    RegionEnd = SplitBlockAndInsertIfThen(Cond, RegionEnd, false);
+  }
+}
+
+// Sorts the kernels of a region in the order of their calls and checks that
+// the device can run them as a chain. The reason of a rejection is reported.
+static bool canChain(uint64_t RegionNumber, std::vector<SPDKernel> &Kernels) {
+  for (SPDKernel &K : Kernels) {
+    if (K.VectorLength != Kernels.front().VectorLength) {
+      errs() << "SPD region " << RegionNumber << ": chained kernels should "
+                "have the same vector length, its kernels are not chained\n";
+      return false;
+    }
+  }
+
+  sortByCallOrder(Kernels);
+  std::vector<SPDIR *> Stages;
+  for (SPDKernel &K : Kernels) {
+    Stages.push_back(K.IR);
+  }
+
+  SPDChain Chain(Stages, RegionNumber);
+  return Chain.verify();
+}
+
+void HostCodeGeneration::createHostCode(uint64_t RegionNumber,
+                                        std::vector<SPDKernel> &Kernels,
+                                        bool InRegion) {
+  // kernels which cannot be chained are offloaded one by one, each streaming
+  // its arrays around its own call
+  if (InRegion && (Kernels.size() > 1) && !canChain(RegionNumber, Kernels)) {
+    for (SPDKernel &K : Kernels) {
+      std::vector<SPDKernel> Kernel(1, K);
+      createHostCode(RegionNumber, Kernel, false);
+    }
+    return;
+  }
+
+  std::vector<SPDIR *> Stages;
+  std::vector<Function *> Emulators;
+  for (SPDKernel &K : Kernels) {
+    Stages.push_back(K.IR);
+    if (K.Emulator != nullptr) {
+      Emulators.push_back(K.Emulator);
+    }
+  }
+
+  CallInst *Caller = Kernels.front().Caller;
+  uint64_t SwitchInOut = Kernels.front().SwitchInOut;
+  Module *M = Caller->getModule();
+
+  SPDChain Chain(Stages, RegionNumber);
+
+  // the streams of the stages are laid out as tiles already, a chain whose
+  // stages disagree on the tiles or whose halos add up to the tile width
+  // cannot be streamed
+  bool CanTile = (Chain.getTileWidth() == 0) ||
+                 (Chain.getTileWidth() > 2 * Chain.getColumnHalo());
+  for (SPDIR *IR : Stages) {
+    CanTile &= (IR->getTileWidth() == Chain.getTileWidth());
+  }
+
+  if (!CanTile) {
+    errs() << "SPD region " << RegionNumber << ": the tile width "
+           << Chain.getTileWidth() << " does not fit the column halo "
+           << Chain.getColumnHalo() << " of its kernels, it stays on the "
+              "host\n";
+    for (SPDKernel &K : Kernels) {
+      if (K.Emulator != nullptr) {
+        K.Emulator->eraseFromParent();
+      }
+    }
+    return;
+  }
+
+  // every slab runs on its own device, a single slab keeps using the
+  // single-device interface
+  unsigned NumSlabs = SPDNumPartitions;
+  if (SwitchInOut && (Chain.getTileWidth() == 0) && (NumSlabs > 1) &&
+      !canExchangeHalos(Chain)) {
+    DEBUG(dbgs() << "SPD region " << RegionNumber
+                 << " cannot exchange the halos of its slabs, it runs on a "
+                    "single device\n");
+    NumSlabs = 1;
+  }
+
+  Instruction *InsertInstr = nullptr;
+  Instruction *RegionEnd = nullptr;
+  CallInst *NumCalls = nullptr;
+  if (InRegion) {
+    SPDRegion Region(Kernels.front().Caller->getFunction(), RegionNumber);
+    InsertInstr = RegionBeginMap[Region];
+    RegionEnd = RegionEndMap[Region];
+    NumCalls = RegionNumCallsMap[Region];
+  }
+
+  Value *Cond;
+  if (!isProfitable(Chain, Kernels, NumSlabs, InsertInstr, NumCalls, Cond)) {
+    DEBUG(dbgs() << "SPD region " << RegionNumber
+                 << " stays on the host\n");
+    for (SPDKernel &K : Kernels) {
+      if (K.Emulator != nullptr) {
+        K.Emulator->eraseFromParent();
+      }
+    }
+    return;
+  }
+
+  if (Cond != nullptr) {
+    versionRegion(Cond, Kernels, InsertInstr, RegionEnd);
+  }
+
+  Function *Emulator = nullptr;
+  if (Emulators.size() == Kernels.size()) {
+    if (Kernels.size() == 1) {
+      Emulator = Emulators.front();
+    }
+    else {
+      Emulator = SPDEmulator::createChainEmulator(&Chain, Emulators, *M);
+    }
+  }
+
+  if (Kernels.size() > 1) {
+    SPDChainPrinter Print(&Chain, Kernels.front().VectorLength);
+  }
+
+  std::vector<SPDSlab> Slabs = createSlabs(Chain, NumSlabs);
+
+  // region begin
+  if (InsertInstr == nullptr) InsertInstr = Caller;
+  IRBuilder<> IRB(InsertInstr); 
+  createRuntimeInitFunc(*M, IRB);
+  if (Emulator != nullptr) {
+    createSetEmulatorFunc(Emulator, *M, IRB);
+  }
+
+  if (Chain.getTileWidth() != 0) {
+    createTiledHostCode(Chain, Slabs, Caller, RegionEnd, SwitchInOut, IRB);
+  }
+  else {
+    createSlabHostCode(Chain, Slabs, Caller, RegionEnd, SwitchInOut, IRB);
+  }
+
+  createRuntimeFinFunc(*M, IRB);
+
+  for (SPDKernel &K : Kernels) {
+    K.Caller->eraseFromParent();
+  }
+}
+
 bool HostCodeGeneration::runOnFunction(Function &F) {
   ScopInfo *SI = getAnalysis<ScopInfoWrapperPass>().getSI();
 
@@ -278,73 +1536,54 @@ bool HostCodeGeneration::runOnFunction(Function &F) {
 
   if (MDNode *Node = F.getMetadata("polly_extracted_loop")) {
     ValueAsMetadata *VM = dyn_cast<ValueAsMetadata>(Node->getOperand(0));
-    ConstantAsMetadata *CM = dyn_cast<ConstantAsMetadata>(Node->getOperand(1));
-    uint64_t RegionNumber
-      = dyn_cast<ConstantInt>(CM->getValue())->getZExtValue();
-    CM = dyn_cast<ConstantAsMetadata>(Node->getOperand(2));
-    uint64_t VectorLength
-      = dyn_cast<ConstantInt>(CM->getValue())->getZExtValue();
-    CM = dyn_cast<ConstantAsMetadata>(Node->getOperand(3));
-    uint64_t UnrollCount
-      = dyn_cast<ConstantInt>(CM->getValue())->getZExtValue();
-    CM = dyn_cast<ConstantAsMetadata>(Node->getOperand(4));
-    uint64_t SwitchInOut
-      = dyn_cast<ConstantInt>(CM->getValue())->getZExtValue();
+    uint64_t RegionNumber = getMetadataValue(Node, 1);
+    uint64_t VectorLength = getMetadataValue(Node, 2);
+    uint64_t UnrollCount = getMetadataValue(Node, 3);
+    uint64_t SwitchInOut = getMetadataValue(Node, 4);
 
     const Scop *S
       = getScopFromInstr(dyn_cast<Instruction>(VM->getValue()), SI);
     auto &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
     auto &SE = getAnalysis<ScalarEvolutionWrapperPass>().getSE();
-    SPDIR IR(*S, LI, SE);
+    SPDIR *IR = new SPDIR(*S, LI, SE);
 // FIXME for unroll test
-    SPDPrinter Print(&IR, VectorLength, UnrollCount);
+    SPDPrinter Print(IR, VectorLength, UnrollCount);
+
+    Function *Emulator = nullptr;
+    if (SPDEmulate) {
+      SPDEmulator Emu(IR, *F.getParent());
+      Emulator = Emu.getFunction();
+      Changed = true;
+    }
+
+    // the Scop of F is gone when the other kernels of the region are analyzed
+    IR->releaseInstrs();
 
     // FIXME consider better impl than using counter
     unsigned InstCount = 0;
-    for (auto UI = F.use_begin(), UE = F.use_end(); UI != UE;) {
-      Use *U = &*UI;
-      ++UI;
+    CallInst *Caller = nullptr;
+    for (Use &U : F.uses()) {
       ++InstCount;
-      CallInst *Caller = dyn_cast<CallInst>(U->getUser());
+      Caller = dyn_cast<CallInst>(U.getUser());
       assert(Caller != nullptr && "user should be a function call");
+    }
+    assert(InstCount == 1 && "assuming one caller per extracted func");
 
-      Module *M = F.getParent();
-
-      SPDStreamInfo *RSI = IR.getReadStream();
-      SPDStreamInfo *WSI = IR.getWriteStream();
-
-      // region begin
-      Instruction *InsertInstr = RegionBeginMap[RegionNumber];
-      if (InsertInstr == nullptr) InsertInstr = Caller;
-      IRBuilder<> IRB(InsertInstr); 
-      createRuntimeInitFunc(*M, IRB);
-      GlobalVariable *ReadStreamBuffer
-        = createAllocStreamFunc(RSI, *M, IRB);
-      GlobalVariable *WriteStreamBuffer
-        = createAllocStreamFunc(WSI, *M, IRB);
-      createPackFunc(IR, *M, IRB, RSI, ReadStreamBuffer);
-      createDomainAttrFunc(*(IR.getDomainInfo()), *M,
-                           IRB, RSI, ReadStreamBuffer);
-      createPCIInFunc(*M, IRB, RSI, ReadStreamBuffer);
-
-      // kernel run
-      if (InsertInstr != Caller) IRB.SetInsertPoint(Caller);
-      createRunKernelFunc(*M, IRB, RSI, WSI, SwitchInOut);
-
-      // begion end
-      InsertInstr = RegionEndMap[RegionNumber];
-      if (InsertInstr != nullptr) IRB.SetInsertPoint(InsertInstr);
-      createPCIOutFunc(*M, IRB, WSI, WriteStreamBuffer, SwitchInOut);
-      createUnpackFunc(IR, *M, IRB, WSI, WriteStreamBuffer);
-      createFreeStreamFunc(IR, *M, IRB, ReadStreamBuffer);
-      createFreeStreamFunc(IR, *M, IRB, WriteStreamBuffer);
-      createRuntimeFinFunc(*M, IRB);
-
-      Caller->eraseFromParent();
+    // host code is generated once every kernel of the region is analyzed
+    SPDRegion Region(Caller->getFunction(), RegionNumber);
+    std::vector<SPDKernel> &Kernels = PendingKernels[Region];
+    Kernels.push_back({IR, Caller, VectorLength, SwitchInOut, Emulator});
+    if (Kernels.size() < RegionKernelCount[Region]) {
+      return Changed;
+    }
 
-      Changed = true;
+    createHostCode(RegionNumber, Kernels);
+    for (SPDKernel &K : Kernels) {
+      delete K.IR;
     }
-    assert(InstCount == 1 && "assuming one caller per extracted func");
+    PendingKernels.erase(Region);
+
+    Changed = true;
   }
 
   return Changed;
@@ -13,71 +13,402 @@
 
 #include "polly/LinkAllPasses.h"
 #include "polly/LoopExtraction.h"
+#include "polly/Options.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpander.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugLoc.h"
 #include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Metadata.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/CodeExtractor.h"
+#include "json/reader.h"
+#include <limits>
+#include <memory>
+#include <system_error>
 
 using namespace llvm;
 using namespace polly;
 
 #define DEBUG_TYPE "polly-loop-ext"
 
-bool LoopExtraction::runOnLoop(Loop *L, LPPassManager &) {
-  if (skipLoop(L))
+static cl::opt<std::string> SPDLoopsFile(
+    "polly-spd-loops-file",
+    cl::desc("JSON file selecting the loops offloaded to SPD kernels and "
+             "their parameters"),
+    cl::Hidden, cl::init(""), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static const char *const SPDRegionMD = "spd.offload.region";
+static const char *const SPDVectorLengthMD = "spd.offload.vector_length";
+static const char *const SPDUnrollCountMD = "spd.offload.unroll_count";
+static const char *const SPDSwitchInOutMD = "spd.offload.switch_inout";
+
+static bool isSPDMetadata(const MDNode *Node) {
+  if ((Node == nullptr) || (Node->getNumOperands() == 0)) {
     return false;
+  }
+
+  const MDString *Name = dyn_cast<MDString>(Node->getOperand(0));
+  return (Name != nullptr) && Name->getString().startswith("spd.offload.");
+}
 
-  // FIXME temporary impl
-  // implement directive
+static Metadata *createDirectiveMD(LLVMContext &Ctx, StringRef Name,
+                                   uint64_t Value) {
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+  Metadata *MDs[] = {
+    MDString::get(Ctx, Name),
+    ConstantAsMetadata::get(ConstantInt::get(Int64Ty, Value))
+  };
+  return MDNode::get(Ctx, MDs);
+}
+
+// malformed directives are reported and the loop is not offloaded, a source
+// file should not be able to crash the compiler
+static bool ignoreDirective(Loop *L, StringRef Reason) {
   BasicBlock *Header = L->getHeader();
-  Instruction *FirstNonPHI = Header->getFirstNonPHI();
-  uint64_t RegionNumber = 0;
-  uint64_t VectorLength = 1;
-  uint64_t UnrollCount = 1;
-  uint64_t SwitchInOut = 0;
+  errs() << "SPD directive of loop " << Header->getName() << " in "
+         << Header->getParent()->getName() << " ignored: " << Reason << "\n";
+  return false;
+}
+
+// the __spd_loop marker is kept for existing sources, it is erased so that
+// it does not reach the kernel
+static bool getDirectiveFromMarker(Loop *L, SPDLoopDirective &D) {
+  Instruction *FirstNonPHI = L->getHeader()->getFirstNonPHI();
   CallInst *CI = dyn_cast<CallInst>(FirstNonPHI);
-  if (CI == nullptr) {
+  if ((CI == nullptr) || (CI->getCalledFunction() == nullptr) ||
+      !CI->getCalledFunction()->getName().equals("__spd_loop")) {
     return false;
   }
-  else {
-    if (CI->getCalledFunction()->getName().equals("__spd_loop")) {
-      ConstantInt *Op = dyn_cast<ConstantInt>(CI->getOperand(0));
-      if (Op == nullptr) {
-        llvm_unreachable("region number is not a constant integer");
-      }
 
-      RegionNumber = Op->getZExtValue();
+  ConstantInt *Ops[4];
+  unsigned NumOps = CI->getNumArgOperands();
+  for (unsigned i = 0; i < 4; i++) {
+    Ops[i] = (i < NumOps) ? dyn_cast<ConstantInt>(CI->getArgOperand(i))
+                          : nullptr;
+  }
+  CI->eraseFromParent();
 
-      Op = dyn_cast<ConstantInt>(CI->getOperand(1));
-      if (Op == nullptr) {
-        llvm_unreachable("vector length is not a constant integer");
-      }
+  if (NumOps != 4) {
+    return ignoreDirective(L, "__spd_loop should have four arguments");
+  }
+  if (Ops[0] == nullptr) {
+    return ignoreDirective(L, "region number is not a constant integer");
+  }
+  if (Ops[1] == nullptr) {
+    return ignoreDirective(L, "vector length is not a constant integer");
+  }
+  if (Ops[2] == nullptr) {
+    return ignoreDirective(L, "unroll count is not a constant integer");
+  }
+  if (Ops[3] == nullptr) {
+    return ignoreDirective(L, "switch in/out is not a constant integer");
+  }
+  if (!(Ops[3]->isOne() || Ops[3]->isZero())) {
+    return ignoreDirective(L, "switch in/out should be a boolean value");
+  }
 
-      VectorLength = Op->getZExtValue();
+  D.RegionNumber = Ops[0]->getZExtValue();
+  D.VectorLength = Ops[1]->getZExtValue();
+  D.UnrollCount = Ops[2]->getZExtValue();
+  D.SwitchInOut = Ops[3]->getZExtValue();
+  return true;
+}
+
+static bool getDirectiveFromMetadata(Loop *L, SPDLoopDirective &D) {
+  MDNode *LoopID = L->getLoopID();
+  if (LoopID == nullptr) {
+    return false;
+  }
+
+  bool Found = false;
+  for (unsigned i = 1; i < LoopID->getNumOperands(); i++) {
+    MDNode *Node = dyn_cast<MDNode>(LoopID->getOperand(i));
+    if (!isSPDMetadata(Node)) continue;
+
+    if (Node->getNumOperands() != 2) {
+      return ignoreDirective(L, "spd.offload metadata should have a single "
+                                "value");
+    }
 
-      Op = dyn_cast<ConstantInt>(CI->getOperand(2));
-      if (Op == nullptr) {
-        llvm_unreachable("unroll count is not a constant integer");
+    ConstantInt *Value
+      = mdconst::dyn_extract_or_null<ConstantInt>(Node->getOperand(1));
+    if (Value == nullptr) {
+      return ignoreDirective(L, "spd.offload metadata is not a constant "
+                                "integer");
+    }
+
+    StringRef Name = cast<MDString>(Node->getOperand(0))->getString();
+    if (Name == SPDRegionMD) {
+      D.RegionNumber = Value->getZExtValue();
+      Found = true;
+    }
+    else if (Name == SPDVectorLengthMD) {
+      D.VectorLength = Value->getZExtValue();
+    }
+    else if (Name == SPDUnrollCountMD) {
+      D.UnrollCount = Value->getZExtValue();
+    }
+    else if (Name == SPDSwitchInOutMD) {
+      if (Value->getZExtValue() > 1) {
+        return ignoreDirective(L, "switch in/out should be a boolean value");
       }
 
-      UnrollCount = Op->getZExtValue();
+      D.SwitchInOut = Value->getZExtValue();
+    }
+  }
 
-      Op = dyn_cast<ConstantInt>(CI->getOperand(3));
-      if (Op == nullptr) {
-        llvm_unreachable("switch in/out is not a constant integer");
+  return Found;
+}
+
+// replaces the spd.offload metadata of the loop by the given directive
+static void setDirectiveMetadata(Loop *L, const SPDLoopDirective &D) {
+  LLVMContext &Ctx = L->getHeader()->getContext();
+  SmallVector<Metadata *, 8> MDs;
+  MDs.push_back(nullptr);
+
+  if (MDNode *LoopID = L->getLoopID()) {
+    for (unsigned i = 1; i < LoopID->getNumOperands(); i++) {
+      MDNode *Node = dyn_cast<MDNode>(LoopID->getOperand(i));
+      if (!isSPDMetadata(Node)) {
+        MDs.push_back(LoopID->getOperand(i));
       }
-      else if (!(Op->isOne() || Op->isZero())) {
-        llvm_unreachable("switch in/out should be a boolean value");
+    }
+  }
+
+  MDs.push_back(createDirectiveMD(Ctx, SPDRegionMD, D.RegionNumber));
+  MDs.push_back(createDirectiveMD(Ctx, SPDVectorLengthMD, D.VectorLength));
+  MDs.push_back(createDirectiveMD(Ctx, SPDUnrollCountMD, D.UnrollCount));
+  MDs.push_back(createDirectiveMD(Ctx, SPDSwitchInOutMD, D.SwitchInOut));
+
+  MDNode *NewLoopID = MDNode::getDistinct(Ctx, MDs);
+  NewLoopID->replaceOperandWith(0, NewLoopID);
+  L->setLoopID(NewLoopID);
+}
+
+// reads an optional unsigned field of a loop of the loops file
+static bool getUIntField(const Json::Value &LoopJSON, const char *Name,
+                         uint64_t Default, uint64_t &Result) {
+  const Json::Value &Field = LoopJSON[Name];
+  if (Field.isNull()) {
+    Result = Default;
+    return true;
+  }
+
+  if (!Field.isIntegral() || (Field.isInt() && (Field.asInt() < 0))) {
+    errs() << "SPD loops file: \"" << Name << "\" should be an unsigned "
+              "integer\n";
+    return false;
+  }
+
+  Result = Field.asUInt();
+  return true;
+}
+
+// {
+//   "loops" : [
+//     { "function" : "main", "header" : "for.cond", "line" : 12,
+//       "region" : 0, "vector_length" : 4, "unroll_count" : 1,
+//       "switch_inout" : 0 }
+//   ]
+// }
+void LoopExtraction::loadLoopsFile() {
+  LoopsFileLoaded = true;
+  if (SPDLoopsFile.empty()) {
+    return;
+  }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Result
+    = MemoryBuffer::getFile(SPDLoopsFile);
+  if (std::error_code EC = Result.getError()) {
+    errs() << "SPD loops file could not be read: " << EC.message() << "\n";
+    return;
+  }
+
+  Json::Reader Reader;
+  Json::Value Root;
+  if (!Reader.parse(Result.get()->getBufferStart(), Root) ||
+      !Root.isObject() || !Root["loops"].isArray()) {
+    errs() << "SPD loops file could not be parsed\n";
+    return;
+  }
+
+  const Json::Value &Loops = Root["loops"];
+  for (Json::UInt i = 0; i < Loops.size(); i++) {
+    const Json::Value &LoopJSON = Loops[i];
+    if (!LoopJSON.isObject() ||
+        !(LoopJSON["function"].isString() || LoopJSON["function"].isNull()) ||
+        !(LoopJSON["header"].isString() || LoopJSON["header"].isNull())) {
+      errs() << "SPD loops file: a loop should be an object with string "
+                "\"function\" and \"header\" names\n";
+      continue;
+    }
+
+    SPDLoopFileEntry Entry;
+    SPDLoopDirective &D = Entry.Directive;
+    uint64_t Line;
+    Entry.Function = LoopJSON.get("function", "").asString();
+    Entry.Header = LoopJSON.get("header", "").asString();
+    if (!getUIntField(LoopJSON, "line", 0, Line) ||
+        !getUIntField(LoopJSON, "region", 0, D.RegionNumber) ||
+        !getUIntField(LoopJSON, "vector_length", 1, D.VectorLength) ||
+        !getUIntField(LoopJSON, "unroll_count", 1, D.UnrollCount) ||
+        !getUIntField(LoopJSON, "switch_inout", 0, D.SwitchInOut)) {
+      continue;
+    }
+
+    if (D.SwitchInOut > 1) {
+      errs() << "SPD loops file: \"switch_inout\" should be 0 or 1\n";
+      continue;
+    }
+
+    Entry.Line = Line;
+    if (Entry.Function.empty() || (Entry.Header.empty() && Entry.Line == 0)) {
+      errs() << "SPD loops file: a loop needs a function and a header or "
+                "a line\n";
+      continue;
+    }
+
+    LoopsFile.push_back(Entry);
+  }
+}
+
+// loops selected by the file are annotated like a pragma would
+void LoopExtraction::applyLoopsFile(Loop *L) {
+  BasicBlock *Header = L->getHeader();
+  unsigned Line = 0;
+  if (DebugLoc Loc = L->getStartLoc()) {
+    Line = Loc.getLine();
+  }
+
+  for (const SPDLoopFileEntry &Entry : LoopsFile) {
+    if (Header->getParent()->getName() != Entry.Function) continue;
+    if (!Entry.Header.empty() && (Header->getName() != Entry.Header)) continue;
+    if ((Entry.Line != 0) && (Line != Entry.Line)) continue;
+
+    setDirectiveMetadata(L, Entry.Directive);
+    return;
+  }
+}
+
+// the __spd_begin or __spd_num_calls marker of a region in F
+static CallInst *findRegionMarker(Function &F, StringRef Name,
+                                  uint64_t RegionNumber) {
+  for (BasicBlock &BB : F) {
+    for (Instruction &Instr : BB) {
+      CallInst *CI = dyn_cast<CallInst>(&Instr);
+      if ((CI == nullptr) || (CI->getCalledFunction() == nullptr) ||
+          !CI->getCalledFunction()->getName().equals(Name)) continue;
+
+      ConstantInt *Region = dyn_cast<ConstantInt>(CI->getArgOperand(0));
+      if ((Region != nullptr) && (Region->getZExtValue() == RegionNumber)) {
+        return CI;
       }
+    }
+  }
 
-      SwitchInOut = Op->getZExtValue();
+  return nullptr;
+}
 
-      CI->eraseFromParent();
+// Number of calls of the kernel extracted from L: the product of the trip
+// counts of the loops around L inside the region. Constant trip counts are
+// folded into Calls, the trip count of a single parametric loop is returned as
+// an i64 SCEV. Returns false if the number of calls is unknown.
+static bool getNumCalls(Loop *L, Instruction *RegionBegin, ScalarEvolution &SE,
+                        uint64_t &Calls, const SCEV *&ParamCalls) {
+  Calls = 1;
+  ParamCalls = nullptr;
+  for (L = L->getParentLoop(); (L != nullptr) && !L->contains(RegionBegin);
+       L = L->getParentLoop()) {
+    if (unsigned TripCount = SE.getSmallConstantTripCount(L)) {
+      // a saturated count is larger than any count the cost model needs
+      uint64_t MaxCalls = std::numeric_limits<uint64_t>::max();
+      Calls = (Calls > MaxCalls / TripCount) ? MaxCalls : Calls * TripCount;
+      continue;
     }
-    else {
+
+    const SCEV *BTC = SE.getBackedgeTakenCount(L);
+    if (isa<SCEVCouldNotCompute>(BTC) || (ParamCalls != nullptr) ||
+        (SE.getTypeSizeInBits(BTC->getType()) > 64)) {
       return false;
     }
+
+    // the trip count of a loop with a narrower induction variable, e.g. an
+    // int, is widened before the increment, which cannot overflow then
+    Type *Int64Ty = Type::getInt64Ty(RegionBegin->getContext());
+    ParamCalls = SE.getAddExpr(SE.getNoopOrZeroExtend(BTC, Int64Ty),
+                               SE.getOne(Int64Ty));
+  }
+
+  return true;
+}
+
+// The number of kernel calls of a region is passed to HostCodeGeneration by a
+// __spd_num_calls(R, Calls, ParamCalls) call before the __spd_begin(R) marker,
+// where ParamCalls is the parametric trip count expanded at the region begin
+// (1 if there is none). Only the calls of the first extracted loop of the
+// region are counted.
+static void createNumCallsMarker(Loop *L, uint64_t RegionNumber,
+                                 ScalarEvolution &SE) {
+  Function &F = *L->getHeader()->getParent();
+  CallInst *RegionBegin = findRegionMarker(F, "__spd_begin", RegionNumber);
+  if ((RegionBegin == nullptr) ||
+      (findRegionMarker(F, "__spd_num_calls", RegionNumber) != nullptr)) {
+    return;
+  }
+
+  uint64_t Calls;
+  const SCEV *ParamCalls;
+  if (!getNumCalls(L, RegionBegin, SE, Calls, ParamCalls)) {
+    return;
+  }
+  if ((ParamCalls != nullptr) &&
+      !isSafeToExpandAt(ParamCalls, RegionBegin, SE)) {
+    return;
+  }
+
+  IRBuilder<> IRB(RegionBegin);
+  Value *ParamCallsValue = IRB.getInt64(1);
+  if (ParamCalls != nullptr) {
+    SCEVExpander Expander(SE, F.getParent()->getDataLayout(), "spd");
+    ParamCallsValue
+      = Expander.expandCodeFor(ParamCalls, IRB.getInt64Ty(), RegionBegin);
+  }
+
+  Module *M = F.getParent();
+  Function *Marker = M->getFunction("__spd_num_calls");
+  if (Marker == nullptr) {
+    Type *Int64Ty = IRB.getInt64Ty();
+    FunctionType *Ty = FunctionType::get(IRB.getVoidTy(),
+                                         {Int64Ty, Int64Ty, Int64Ty}, false);
+    Marker = Function::Create(Ty, Function::ExternalLinkage,
+                              "__spd_num_calls", M);
+  }
+  IRB.CreateCall(Marker, {IRB.getInt64(RegionNumber), IRB.getInt64(Calls),
+                          ParamCallsValue});
+}
+
+bool LoopExtraction::doInitialization(Loop *L, LPPassManager &LPM) {
+  if (!LoopsFileLoaded) {
+    loadLoopsFile();
+  }
+
+  return false;
+}
+
+bool LoopExtraction::runOnLoop(Loop *L, LPPassManager &) {
+  if (skipLoop(L))
+    return false;
+
+  applyLoopsFile(L);
+
+  SPDLoopDirective D;
+  if (!getDirectiveFromMarker(L, D) && !getDirectiveFromMetadata(L, D)) {
+    return false;
   }
 
   // If LoopSimplify form is not available, stay out of trouble.
@@ -130,6 +461,14 @@ bool LoopExtraction::runOnLoop(Loop *L, LPPassManager &) {
   if (ShouldExtractLoop) {
     if (NumLoops == 0) return Changed;
     --NumLoops;
+    ScalarEvolution &SE = getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+    createNumCallsMarker(L, D.RegionNumber, SE);
+    // the loops around L get a call instead of L
+    Loop *Outermost = L;
+    while (Outermost->getParentLoop() != nullptr) {
+      Outermost = Outermost->getParentLoop();
+    }
+    SE.forgetLoop(Outermost);
     CodeExtractor Extractor(DT, *L);
     Function *ExtractedFunc = Extractor.extractCodeRegion();
     if (ExtractedFunc != nullptr) {
@@ -140,10 +479,10 @@ bool LoopExtraction::runOnLoop(Loop *L, LPPassManager &) {
       Type *Int64Ty = Type::getInt64Ty(ExtractedFunc->getContext());
       Metadata *MDArgs[] = {
         ValueAsMetadata::get(&*(L->getHeader()->begin())),
-        ConstantAsMetadata::get(ConstantInt::get(Int64Ty, RegionNumber)),
-        ConstantAsMetadata::get(ConstantInt::get(Int64Ty, VectorLength)),
-        ConstantAsMetadata::get(ConstantInt::get(Int64Ty, UnrollCount)),
-        ConstantAsMetadata::get(ConstantInt::get(Int64Ty, SwitchInOut))
+        ConstantAsMetadata::get(ConstantInt::get(Int64Ty, D.RegionNumber)),
+        ConstantAsMetadata::get(ConstantInt::get(Int64Ty, D.VectorLength)),
+        ConstantAsMetadata::get(ConstantInt::get(Int64Ty, D.UnrollCount)),
+        ConstantAsMetadata::get(ConstantInt::get(Int64Ty, D.SwitchInOut))
       };
       ExtractedFunc->setMetadata("polly_extracted_loop",
                                  MDNode::get(ExtractedFunc->getContext(),
@@ -159,6 +498,7 @@ void LoopExtraction::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequiredID(LoopSimplifyID);
   AU.addRequired<DominatorTreeWrapperPass>();
   AU.addRequired<LoopInfoWrapperPass>();
+  AU.addRequired<ScalarEvolutionWrapperPass>();
 }
 
 char LoopExtraction::ID = 0;
@@ -173,5 +513,6 @@ INITIALIZE_PASS_DEPENDENCY(BreakCriticalEdges);
 INITIALIZE_PASS_DEPENDENCY(LoopSimplify);
 INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass);
 INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass);
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass);
 INITIALIZE_PASS_END(LoopExtraction, "polly-loop-ext",
                     "Polly - Loop Extraction", false, false)
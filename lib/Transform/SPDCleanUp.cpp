@@ -32,7 +32,8 @@ bool SPDCleanUp::runOnFunction(Function &F) {
 
       Function *Func = CI->getCalledFunction();
       if (Func->getName().equals("__spd_begin") ||
-          Func->getName().equals("__spd_end")) {
+          Func->getName().equals("__spd_end") ||
+          Func->getName().equals("__spd_num_calls")) {
         RemoveInstrList.push_back(CI);
       }
     }
@@ -54,11 +54,17 @@
 #include "polly/ScopInfo.h"
 #include "polly/Support/GICHelper.h"
 #include "polly/Support/ISLOStream.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "isl/aff.h"
 #include "isl/band.h"
 #include "isl/constraint.h"
+#include "isl/local_space.h"
 #include "isl/map.h"
 #include "isl/options.h"
 #include "isl/printer.h"
@@ -163,6 +169,17 @@ static cl::opt<int> SecondCacheLevelSize(
     cl::desc("The size of the second level specified in bytes."), cl::Hidden,
     cl::init(262144), cl::ZeroOrMore, cl::cat(PollyCategory));
 
+static cl::opt<int> CacheLineSize(
+    "polly-target-cache-line-size",
+    cl::desc("The size of a cache line specified in bytes."), cl::Hidden,
+    cl::init(64), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<bool> CacheFromHost(
+    "polly-target-cache-from-host",
+    cl::desc("Take the cache parameters that are not specified from the "
+             "host, if the host is the target"),
+    cl::Hidden, cl::init(true), cl::ZeroOrMore, cl::cat(PollyCategory));
+
 static cl::opt<int> VectorRegisterBitwidth(
     "polly-target-vector-register-bitwidth",
     cl::desc("The size in bits of a vector register (if not set, this "
@@ -182,6 +199,17 @@ static cl::list<int>
                         cl::Hidden, cl::ZeroOrMore, cl::CommaSeparated,
                         cl::cat(PollyCategory));
 
+static cl::opt<bool> CacheModelTileSizes(
+    "polly-tile-sizes-from-cache-model",
+    cl::desc("Derive the tile sizes, which are not specified, from the "
+             "footprint of the tiles in the cache"),
+    cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<int> CacheModelMaxTileSize(
+    "polly-cache-model-max-tile-size",
+    cl::desc("The largest tile size derived from the cache model"),
+    cl::Hidden, cl::init(1024), cl::ZeroOrMore, cl::cat(PollyCategory));
+
 static cl::opt<bool>
     SecondLevelTiling("polly-2nd-level-tiling",
                       cl::desc("Enable a 2nd level loop of loop tiling"),
@@ -224,11 +252,34 @@ static cl::list<int>
                       cl::Hidden, cl::ZeroOrMore, cl::CommaSeparated,
                       cl::cat(PollyCategory));
 
+static cl::opt<bool> DiamondTiling(
+    "polly-diamond-tiling",
+    cl::desc("Tile the time loop and the outermost spatial loop of iterative "
+             "stencils with diamond tiles"),
+    cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<int> DiamondTileSize(
+    "polly-diamond-tile-size",
+    cl::desc("The size of the diamond tiles along both of their faces"),
+    cl::Hidden, cl::init(32), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<int> DiamondMaxSlope(
+    "polly-diamond-max-slope",
+    cl::desc("The largest slope of the diamond faces, in spatial iterations "
+             "per time step"),
+    cl::Hidden, cl::init(4), cl::ZeroOrMore, cl::cat(PollyCategory));
+
 static cl::opt<bool>
     PMBasedOpts("polly-pattern-matching-based-opts",
                 cl::desc("Perform optimizations based on pattern matching"),
                 cl::init(true), cl::ZeroOrMore, cl::cat(PollyCategory));
 
+static cl::opt<bool> PMBasedTensorContractionOpts(
+    "polly-pattern-matching-based-tensor-contractions",
+    cl::desc("Map tensor contractions, such as batched or transposed matrix "
+             "multiplications, onto the matrix multiplication kernel"),
+    cl::Hidden, cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
 static cl::opt<bool> OptimizedScops(
     "polly-optimized-scops",
     cl::desc("Polly - Dump polyhedral description of Scops optimized with "
@@ -478,21 +529,210 @@ bool ScheduleTreeOptimizer::isTileableBandNode(
   return isSimpleInnermostBand(ManagedNode);
 }
 
+namespace {
+/// The elements of an array accessed by a tile.
+///
+/// For each dimension of the array, the band members its subscripts depend
+/// on.
+struct TileFootprintTy {
+  int ElementSize;
+  SmallVector<uint64_t, 4> DimMembers;
+};
+} // namespace
+
+/// Check if the affine expressions of @p PwAff involve the input dimension
+/// @p Pos. Unlike isl_pw_aff_involves_dims, the domains of the pieces are not
+/// considered.
+static bool affineExprInvolvesDim(const isl::pw_aff &PwAff, unsigned Pos) {
+  bool Involves = false;
+  PwAff.foreach_piece([&](isl::set Set, isl::aff Aff) -> isl::stat {
+    Involves = Involves || Aff.involves_dims(isl::dim::in, Pos, 1);
+    return isl::stat::ok;
+  });
+  return Involves;
+}
+
+/// Collect the arrays accessed in the band @p Node.
+///
+/// A subscript depends on a band member if both involve the same statement
+/// iterator. Accesses that are not single-valued depend on all members.
+static DenseMap<const ScopArrayInfo *, TileFootprintTy>
+getTileFootprints(const isl::schedule_node &Node) {
+  DenseMap<const ScopArrayInfo *, TileFootprintTy> Footprints;
+  auto Schedule =
+      give(isl_schedule_node_band_get_partial_schedule(Node.keep()));
+  unsigned Members = isl_schedule_node_band_n_member(Node.keep());
+  assert(Members <= 64 && "Too many band members for the footprint model");
+
+  Node.get_domain().foreach_set([&](isl::set Domain) -> isl::stat {
+    auto *Stmt = static_cast<ScopStmt *>(Domain.get_tuple_id().get_user());
+    auto Space = Domain.get_space().from_domain().add_dims(isl::dim::out, 1);
+    unsigned Iterators = Domain.dim(isl::dim::set);
+
+    SmallVector<uint64_t, 8> IteratorMembers(Iterators, 0);
+    for (unsigned M = 0; M < Members; M++) {
+      auto Member = Schedule.get_union_pw_aff(M).extract_pw_aff(Space);
+      for (unsigned I = 0; I < Iterators; I++)
+        if (affineExprInvolvesDim(Member, I))
+          IteratorMembers[I] |= uint64_t(1) << M;
+    }
+
+    for (MemoryAccess *MA : *Stmt) {
+      if (!MA->isLatestArrayKind())
+        continue;
+      auto Access = give(MA->getLatestAccessRelation());
+      auto *SAI = MA->getLatestScopArrayInfo();
+      unsigned Dims = Access.dim(isl::dim::out);
+      auto &Footprint = Footprints[SAI];
+      Footprint.ElementSize = SAI->getElemSizeInBytes();
+      Footprint.DimMembers.resize(std::max<size_t>(Footprint.DimMembers.size(),
+                                                   Dims));
+
+      if (!Access.is_single_valued()) {
+        for (unsigned D = 0; D < Dims; D++)
+          Footprint.DimMembers[D] = ~uint64_t(0);
+        continue;
+      }
+
+      auto Subscripts = isl::pw_multi_aff::from_map(Access);
+      for (unsigned D = 0; D < Dims; D++) {
+        auto Subscript = Subscripts.get_pw_aff(D);
+        for (unsigned I = 0; I < Iterators; I++)
+          if (affineExprInvolvesDim(Subscript, I))
+            Footprint.DimMembers[D] |= IteratorMembers[I];
+      }
+    }
+    return isl::stat::ok;
+  });
+  return Footprints;
+}
+
+/// Get the number of bytes that a tile of @p TileSizes loads into the cache.
+///
+/// In each array dimension, a tile spans the sum of the tile sizes of the
+/// members the subscript depends on. The innermost dimension is rounded up to
+/// full cache lines.
+static uint64_t
+getTileFootprint(const DenseMap<const ScopArrayInfo *, TileFootprintTy> &Arrays,
+                 ArrayRef<int> TileSizes, int LineSize) {
+  uint64_t Bytes = 0;
+  for (auto &Array : Arrays) {
+    auto &DimMembers = Array.second.DimMembers;
+    if (DimMembers.empty())
+      continue;
+
+    uint64_t Elements = 1;
+    for (unsigned D = 0; D < DimMembers.size(); D++) {
+      uint64_t Extent = 1;
+      for (unsigned M = 0; M < TileSizes.size(); M++)
+        if (DimMembers[D] & (uint64_t(1) << M))
+          Extent += TileSizes[M] - 1;
+      if (D + 1 < DimMembers.size())
+        Elements *= Extent;
+      else
+        Elements *= alignTo(Extent * Array.second.ElementSize, LineSize);
+    }
+    Bytes += Elements;
+  }
+  return Bytes;
+}
+
+/// Get the tile sizes of the band @p Node from a model of its footprint.
+///
+/// The tiles of all members grow by powers of two, starting with the
+/// innermost member, as long as their footprint fits into the cache. To
+/// leave space for the data that streams through the cache and to avoid
+/// conflict misses, one way of the cache is not used by the tiles. Members
+/// that no subscript depends on keep @p DefaultTileSize.
+///
+/// @return The tile sizes, or no tile sizes if @p Cache is unknown.
+static SmallVector<int, 4>
+getCacheModelTileSizes(const isl::schedule_node &Node,
+                       const CacheLevelTy &Cache, int DefaultTileSize) {
+  SmallVector<int, 4> TileSizes;
+  if (Cache.Size <= 0 || Cache.LineSize <= 0)
+    return TileSizes;
+
+  uint64_t Capacity = Cache.Size;
+  if (Cache.Associativity > 1)
+    Capacity = Capacity * (Cache.Associativity - 1) / Cache.Associativity;
+  else
+    Capacity /= 2;
+
+  auto Arrays = getTileFootprints(Node);
+  uint64_t Members = 0;
+  for (auto &Array : Arrays)
+    for (auto DimMembers : Array.second.DimMembers)
+      Members |= DimMembers;
+
+  unsigned Dims = isl_schedule_node_band_n_member(Node.keep());
+  TileSizes.assign(Dims, 1);
+  for (bool Grown = true; Grown;) {
+    Grown = false;
+    for (int M = Dims - 1; M >= 0; M--) {
+      if (!(Members & (uint64_t(1) << M)) ||
+          2 * TileSizes[M] > CacheModelMaxTileSize)
+        continue;
+      TileSizes[M] *= 2;
+      if (getTileFootprint(Arrays, TileSizes, Cache.LineSize) <= Capacity) {
+        Grown = true;
+        continue;
+      }
+      TileSizes[M] /= 2;
+    }
+  }
+
+  for (unsigned M = 0; M < Dims; M++)
+    if (!(Members & (uint64_t(1) << M)))
+      TileSizes[M] = DefaultTileSize;
+
+  DEBUG({
+    dbgs() << "Tile sizes of the cache model:";
+    for (int TileSize : TileSizes)
+      dbgs() << " " << TileSize;
+    dbgs() << "\n";
+  });
+  return TileSizes;
+}
+
 __isl_give isl_schedule_node *
 ScheduleTreeOptimizer::standardBandOpts(__isl_take isl_schedule_node *Node,
                                         void *User) {
-  if (FirstLevelTiling)
-    Node = tileNode(Node, "1st level tiling", FirstLevelTileSizes,
+  auto *OAI = static_cast<const OptimizerAdditionalInfoTy *>(User);
+  bool UseCacheModel = CacheModelTileSizes && OAI;
+
+  // The innermost level of tiling targets the first cache level.
+  if (FirstLevelTiling) {
+    SmallVector<int, 4> TileSizes(FirstLevelTileSizes.begin(),
+                                  FirstLevelTileSizes.end());
+    if (UseCacheModel && TileSizes.empty())
+      TileSizes = getCacheModelTileSizes(
+          isl::manage(isl_schedule_node_copy(Node)),
+          SecondLevelTiling ? OAI->L2 : OAI->L1, FirstLevelDefaultTileSize);
+    Node = tileNode(Node, "1st level tiling", TileSizes,
                     FirstLevelDefaultTileSize);
+  }
 
-  if (SecondLevelTiling)
-    Node = tileNode(Node, "2nd level tiling", SecondLevelTileSizes,
+  if (SecondLevelTiling) {
+    SmallVector<int, 4> TileSizes(SecondLevelTileSizes.begin(),
+                                  SecondLevelTileSizes.end());
+    if (UseCacheModel && TileSizes.empty())
+      TileSizes =
+          getCacheModelTileSizes(isl::manage(isl_schedule_node_copy(Node)),
+                                 OAI->L1, SecondLevelDefaultTileSize);
+    Node = tileNode(Node, "2nd level tiling", TileSizes,
                     SecondLevelDefaultTileSize);
+  }
 
   if (RegisterTiling)
     Node =
         applyRegisterTiling(Node, RegisterTileSizes, RegisterDefaultTileSize);
 
+  return prevectInnermostCoincident(Node);
+}
+
+__isl_give isl_schedule_node *ScheduleTreeOptimizer::prevectInnermostCoincident(
+    __isl_take isl_schedule_node *Node) {
   if (PollyVectorizerChoice == VECTORIZER_NONE)
     return Node;
 
@@ -509,6 +749,147 @@ ScheduleTreeOptimizer::standardBandOpts(__isl_take isl_schedule_node *Node,
   return Node;
 }
 
+/// Check if all dependence distances lie in the cone of a diamond.
+///
+/// The faces of the diamond are the hyperplanes Slope * d0 + d1 and
+/// Slope * d0 - d1 of the time dimension d0 and the spatial dimension d1.
+/// Tiling along both faces is legal if no distance in @p Deltas is negative
+/// along either of them.
+static bool isInDiamondCone(__isl_keep isl_set *Deltas, int Slope) {
+  auto *LocalSpace = isl_local_space_from_space(isl_set_get_space(Deltas));
+  bool Inside = true;
+  for (int Sign : {1, -1}) {
+    // The distances with Slope * d0 - Sign * d1 < 0.
+    auto *Outside = isl_constraint_alloc_inequality(
+        isl_local_space_copy(LocalSpace));
+    Outside =
+        isl_constraint_set_coefficient_si(Outside, isl_dim_set, 0, -Slope);
+    Outside = isl_constraint_set_coefficient_si(Outside, isl_dim_set, 1, Sign);
+    Outside = isl_constraint_set_constant_si(Outside, -1);
+    auto *Violated = isl_set_add_constraint(isl_set_copy(Deltas), Outside);
+    Inside = Inside && isl_set_is_empty(Violated);
+    isl_set_free(Violated);
+  }
+  isl_local_space_free(LocalSpace);
+  return Inside;
+}
+
+int ScheduleTreeOptimizer::getDiamondTilingSlope(
+    __isl_keep isl_schedule_node *Node, const Dependences *D) {
+  if (!D || !D->hasValidDependences())
+    return 0;
+
+  // The outermost member is the time loop. It carries the dependences of the
+  // stencil, while each time step is free of dependences along the spatial
+  // members.
+  if (isl_schedule_node_band_member_get_coincident(Node, 0))
+    return 0;
+
+  unsigned PrefixDims = isl_schedule_node_get_schedule_depth(Node);
+  auto *Prefix = isl_schedule_node_get_prefix_schedule_union_map(Node);
+  auto *Partial = isl_schedule_node_band_get_partial_schedule_union_map(Node);
+  auto *Schedule = isl_union_map_flat_range_product(Prefix, Partial);
+  Schedule = isl_union_map_intersect_domain(Schedule,
+                                            isl_schedule_node_get_domain(Node));
+
+  auto *Deps = D->getDependences(Dependences::TYPE_RAW | Dependences::TYPE_WAR |
+                                 Dependences::TYPE_WAW);
+  Deps = isl_union_map_apply_domain(Deps, isl_union_map_copy(Schedule));
+  Deps = isl_union_map_apply_range(Deps, Schedule);
+  auto *UDeltas = isl_union_map_deltas(Deps);
+  if (isl_union_set_n_set(UDeltas) != 1) {
+    isl_union_set_free(UDeltas);
+    return 0;
+  }
+
+  // Only the dependences that are not carried by the outer bands matter.
+  auto *Deltas = isl_set_from_union_set(UDeltas);
+  for (unsigned i = 0; i < PrefixDims; i++)
+    Deltas = isl_set_fix_si(Deltas, isl_dim_set, i, 0);
+  Deltas = isl_set_project_out(Deltas, isl_dim_set, 0, PrefixDims);
+
+  // Without spatial distances rectangular tiles already start concurrently.
+  auto *NoSpatialDistance =
+      isl_set_fix_si(isl_set_copy(Deltas), isl_dim_set, 1, 0);
+  bool IsStencil = !isl_set_is_subset(Deltas, NoSpatialDistance);
+  isl_set_free(NoSpatialDistance);
+
+  int Slope = 0;
+  for (int S = 1; IsStencil && S <= DiamondMaxSlope; S++)
+    if (isInDiamondCone(Deltas, S)) {
+      Slope = S;
+      break;
+    }
+  isl_set_free(Deltas);
+  return Slope;
+}
+
+/// Replace the partial schedule of the band @p Node.
+///
+/// The new band is permutable and its members are coincident as given by
+/// @p Coincident.
+static __isl_give isl_schedule_node *
+replaceBandSchedule(__isl_take isl_schedule_node *Node,
+                    __isl_take isl_multi_union_pw_aff *Schedule,
+                    ArrayRef<bool> Coincident) {
+  Node = isl_schedule_node_delete(Node);
+  Node = isl_schedule_node_insert_partial_schedule(Node, Schedule);
+  Node = isl_schedule_node_band_set_permutable(Node, 1);
+  for (unsigned i = 0; i < Coincident.size(); i++)
+    Node = isl_schedule_node_band_member_set_coincident(Node, i, Coincident[i]);
+  return Node;
+}
+
+/// Get the coincidence of the members of the band @p Node.
+static SmallVector<bool, 4>
+getBandCoincidence(__isl_keep isl_schedule_node *Node) {
+  SmallVector<bool, 4> Coincident;
+  for (int i = 0, e = isl_schedule_node_band_n_member(Node); i < e; i++)
+    Coincident.push_back(isl_schedule_node_band_member_get_coincident(Node, i));
+  return Coincident;
+}
+
+__isl_give isl_schedule_node *
+ScheduleTreeOptimizer::applyDiamondTiling(__isl_take isl_schedule_node *Node,
+                                          int Slope) {
+  auto *Ctx = isl_schedule_node_get_ctx(Node);
+
+  // Skew the time loop t and the spatial loop s to the faces of the diamonds,
+  // (Slope * t + s, Slope * t - s).
+  auto Coincident = getBandCoincidence(Node);
+  Coincident[0] = Coincident[1] = false;
+  auto *Schedule = isl_schedule_node_band_get_partial_schedule(Node);
+  auto *Time = isl_multi_union_pw_aff_get_union_pw_aff(Schedule, 0);
+  auto *Space = isl_multi_union_pw_aff_get_union_pw_aff(Schedule, 1);
+  Time = isl_union_pw_aff_scale_val(Time, isl_val_int_from_si(Ctx, Slope));
+  auto *Left = isl_union_pw_aff_add(isl_union_pw_aff_copy(Time),
+                                    isl_union_pw_aff_copy(Space));
+  auto *Right = isl_union_pw_aff_sub(Time, Space);
+  Schedule = isl_multi_union_pw_aff_set_union_pw_aff(Schedule, 0, Left);
+  Schedule = isl_multi_union_pw_aff_set_union_pw_aff(Schedule, 1, Right);
+  Node = replaceBandSchedule(Node, Schedule, Coincident);
+
+  int TileSizes[] = {DiamondTileSize, DiamondTileSize};
+  Node = tileNode(Node, "Diamond tiling", TileSizes, FirstLevelDefaultTileSize);
+
+  // Execute the tiles in wavefronts of (T0 + T1, T1). The dependences between
+  // diamonds point to larger T0 or T1, such that all diamonds of a wavefront
+  // run in parallel, starting with the diamonds along the first time step.
+  Node = isl_schedule_node_parent(isl_schedule_node_parent(Node));
+  Coincident = getBandCoincidence(Node);
+  Coincident[0] = false;
+  Coincident[1] = true;
+  Schedule = isl_schedule_node_band_get_partial_schedule(Node);
+  Left = isl_multi_union_pw_aff_get_union_pw_aff(Schedule, 0);
+  Right = isl_multi_union_pw_aff_get_union_pw_aff(Schedule, 1);
+  Schedule = isl_multi_union_pw_aff_set_union_pw_aff(
+      Schedule, 0, isl_union_pw_aff_add(Left, Right));
+  Node = replaceBandSchedule(Node, Schedule, Coincident);
+  Node = isl_schedule_node_child(isl_schedule_node_child(Node, 0), 0);
+
+  return prevectInnermostCoincident(Node);
+}
+
 /// Get the position of a dimension with a non-zero coefficient.
 ///
 /// Check that isl constraint @p Constraint has only one non-zero
@@ -861,6 +1242,255 @@ static bool containsMatrMult(__isl_keep isl_map *PartialSchedule,
   return true;
 }
 
+/// Get the input dimensions that determine the subscripts of a tensor
+/// contraction operand.
+///
+/// Check that each output dimension of the isl basic map @p bmap is equal to
+/// a single input dimension and that no input dimension is used twice. The
+/// input dimensions are stored in the vector pointed by @p user. For example,
+/// S[i, j, k] -> A[k, i] yields {2, 0}.
+///
+/// @param bmap The isl basic map to be checked.
+/// @param user The input dimensions of @p bmap.
+/// @return     isl_stat_ok in case isl basic map satisfies the requirements,
+///             isl_stat_error otherwise.
+static isl_stat
+getContractionOperandBasicMapDims(__isl_take isl_basic_map *bmap, void *user) {
+  auto &InDims = *static_cast<SmallVectorImpl<int> *>(user);
+  int OutDimNum = isl_basic_map_dim(bmap, isl_dim_out);
+  auto *Constraints = isl_basic_map_get_constraint_list(bmap);
+  isl_basic_map_free(bmap);
+  InDims.assign(OutDimNum, -1);
+  int ConstraintNum = isl_constraint_list_n_constraint(Constraints);
+  isl_stat Result = ConstraintNum == OutDimNum ? isl_stat_ok : isl_stat_error;
+  for (int i = 0; i < ConstraintNum && Result == isl_stat_ok; i++) {
+    auto *Constraint = isl_constraint_list_get_constraint(Constraints, i);
+    int InPos, OutPos;
+    if (isMatMulOperandConstraint(Constraint, InPos, OutPos) ==
+            isl_stat_error ||
+        InDims[OutPos] >= 0 || is_contained(InDims, InPos))
+      Result = isl_stat_error;
+    else
+      InDims[OutPos] = InPos;
+    isl_constraint_free(Constraint);
+  }
+  isl_constraint_list_free(Constraints);
+  return Result;
+}
+
+/// Get the input dimensions that determine the subscripts of a tensor
+/// contraction operand.
+///
+/// @param MemAccess The memory access to be checked.
+/// @param InDims    The input dimension of the access relation of @p MemAccess
+///                  for each of its subscripts.
+/// @return          True in case each subscript of @p MemAccess is a distinct
+///                  loop dimension and false, otherwise.
+static bool getContractionOperandDims(MemoryAccess *MemAccess,
+                                      SmallVectorImpl<int> &InDims) {
+  auto *AccMap = MemAccess->getAccessRelation();
+  bool IsOperand =
+      isl_map_n_basic_map(AccMap) == 1 &&
+      isl_map_foreach_basic_map(AccMap, getContractionOperandBasicMapDims,
+                                static_cast<void *>(&InDims)) == isl_stat_ok &&
+      !InDims.empty();
+  isl_map_free(AccMap);
+  return IsOperand;
+}
+
+/// Check that the memory access has stride 0 in all loops.
+///
+/// @param MemAccess       The memory access to be checked.
+/// @param PartialSchedule The partial schedule of the SCoP statement.
+/// @return                True in case @p MemAccess has stride 0, if the
+///                        innermost loop is exchanged with any of the loops
+///                        of @p PartialSchedule and false, otherwise.
+static bool isStrideZeroInAllLoops(MemoryAccess *MemAccess,
+                                   __isl_keep isl_map *PartialSchedule) {
+  unsigned OutDimNum = isl_map_dim(PartialSchedule, isl_dim_out);
+  for (unsigned i = 0; i < OutDimNum; i++) {
+    auto *Map = permuteDimensions(isl_map_copy(PartialSchedule), isl_dim_out,
+                                  i, OutDimNum - 1);
+    if (!MemAccess->isStrideZero(Map))
+      return false;
+  }
+  return true;
+}
+
+/// Get the dimension of @p Dims that is used by the rightmost subscript.
+///
+/// @param Dims     The candidate dimensions.
+/// @param Operand  The subscripts of an operand, as returned by
+///                 getContractionOperandDims.
+/// @return         The dimension of @p Dims that is used by the rightmost
+///                 subscript of @p Operand.
+static int getInnermostContractionDim(ArrayRef<int> Dims,
+                                      ArrayRef<int> Operand) {
+  for (auto It = Operand.rbegin(); It != Operand.rend(); It++)
+    if (is_contained(Dims, *It))
+      return *It;
+  llvm_unreachable("Each dimension is used by the operand");
+}
+
+/// Check for dependencies corresponding to a tensor contraction.
+///
+/// Check that true dependencies and reductions only cross iterations of the
+/// contracted dimensions @p K. The band is permutable, which allows to
+/// interchange and tile all of its dimensions.
+///
+/// @param  Schedule The schedule of the SCoP statement.
+/// @param  D        The SCoP dependencies.
+/// @param  K        The contracted dimensions.
+/// @return True in case the distances of the dependencies are zero in all
+///         dimensions that are different from @p K and false, otherwise.
+static bool containsOnlyContractionDep(__isl_keep isl_map *Schedule,
+                                       const Dependences *D, ArrayRef<int> K) {
+  auto *Dep = D->getDependences(Dependences::TYPE_RAW);
+  auto *Red = D->getDependences(Dependences::TYPE_RED);
+  if (Red)
+    Dep = isl_union_map_union(Dep, Red);
+  auto *DomainSpace = isl_space_domain(isl_map_get_space(Schedule));
+  auto *Space = isl_space_map_from_domain_and_range(isl_space_copy(DomainSpace),
+                                                    DomainSpace);
+  auto *Deltas = isl_map_deltas(isl_union_map_extract_map(Dep, Space));
+  isl_union_map_free(Dep);
+  if (isl_set_is_empty(Deltas)) {
+    isl_set_free(Deltas);
+    return true;
+  }
+  int DeltasDimNum = isl_set_dim(Deltas, isl_dim_set);
+  for (int i = 0; i < DeltasDimNum; i++) {
+    if (is_contained(K, i))
+      continue;
+    auto *Val = isl_set_plain_get_val_if_fixed(Deltas, isl_dim_set, i);
+    bool IsZero = isl_val_is_zero(Val);
+    isl_val_free(Val);
+    if (!IsZero) {
+      isl_set_free(Deltas);
+      return false;
+    }
+  }
+  isl_set_free(Deltas);
+  return true;
+}
+
+/// Check if the SCoP statement computes a tensor contraction.
+///
+/// A tensor contraction has the form C[...] += A[...] * B[...], where each
+/// subscript of the tensors is a loop dimension, which belongs to one of the
+/// following groups:
+/// 1. I, the free dimensions of A, which are used by C and A only.
+/// 2. J, the free dimensions of B, which are used by C and B only.
+/// 3. K, the contracted dimensions, which are used by A and B only.
+/// 4. The batch dimensions, which are used by C, A and B.
+/// Each group except from the batch dimensions should be non-empty and the
+/// subscripts can be in any order. For example, batched and transposed
+/// matrix multiplications as well as the contraction
+/// C[a][b][c] += A[a][d][b] * B[d][c] are tensor contractions.
+///
+/// Similar to the transpose-transpose-GEMM-transpose (TTGT) approach, the
+/// contraction is mapped onto the matrix multiplication kernel. Instead of
+/// transposing the tensors to matrices, one dimension i, j and k of the
+/// groups I, J and K, respectively, forms the matrix multiplication, while
+/// the remaining dimensions become outer loops. The packing of A and B
+/// reads the tensors through their original access relations and, thus,
+/// performs the transposition of the operands of the kernel. We choose the
+/// dimensions used by the rightmost subscripts of C and A, which are accessed
+/// with unit stride in the row-major order.
+///
+/// Besides C, A and B, the SCoP statement can contain only memory accesses
+/// that have stride 0 in all loops, similar to containsMatrMult.
+///
+/// @param PartialSchedule The PartialSchedule that contains a SCoP statement
+///        to check.
+/// @param D   The SCoP dependencies.
+/// @param MMI Parameters of the matrix multiplication operands.
+static bool containsTensorContraction(__isl_keep isl_map *PartialSchedule,
+                                      const Dependences *D,
+                                      MatMulInfoTy &MMI) {
+  auto *InputDimsId = isl_map_get_tuple_id(PartialSchedule, isl_dim_in);
+  auto *Stmt = static_cast<ScopStmt *>(isl_id_get_user(InputDimsId));
+  isl_id_free(InputDimsId);
+  int DimNum = isl_map_dim(PartialSchedule, isl_dim_in);
+  if (Stmt->size() <= 1 ||
+      DimNum != (int)isl_map_dim(PartialSchedule, isl_dim_out))
+    return false;
+
+  MemoryAccess *WriteToC = nullptr;
+  for (auto *MemA = Stmt->end() - 1; MemA != Stmt->begin(); MemA--)
+    if ((*MemA)->isArrayKind()) {
+      WriteToC = *MemA;
+      break;
+    }
+  SmallVector<int, 4> C;
+  if (!WriteToC || !WriteToC->isWrite() ||
+      !getContractionOperandDims(WriteToC, C))
+    return false;
+
+  auto *WriteAccMap = WriteToC->getAccessRelation();
+  MemoryAccess *ReadFromC = nullptr;
+  SmallVector<MemoryAccess *, 2> Operands;
+  SmallVector<SmallVector<int, 4>, 2> OperandDims;
+  for (auto *MemAccessPtr : *Stmt) {
+    if (!MemAccessPtr->isArrayKind() || MemAccessPtr == WriteToC)
+      continue;
+    auto *AccMap = MemAccessPtr->getAccessRelation();
+    bool IsReadFromC = MemAccessPtr->isRead() && !ReadFromC &&
+                       isl_map_is_equal(AccMap, WriteAccMap);
+    isl_map_free(AccMap);
+    SmallVector<int, 4> Dims;
+    if (IsReadFromC) {
+      ReadFromC = MemAccessPtr;
+    } else if (MemAccessPtr->isRead() && Operands.size() < 2 &&
+               getContractionOperandDims(MemAccessPtr, Dims)) {
+      Operands.push_back(MemAccessPtr);
+      OperandDims.push_back(Dims);
+    } else if (!isStrideZeroInAllLoops(MemAccessPtr, PartialSchedule)) {
+      isl_map_free(WriteAccMap);
+      return false;
+    }
+  }
+  isl_map_free(WriteAccMap);
+  if (!ReadFromC || Operands.size() != 2)
+    return false;
+
+  // B is the operand that shares the rightmost subscript of C, if it is a
+  // free dimension.
+  unsigned AIdx = 0;
+  if (is_contained(OperandDims[0], C.back()) &&
+      !is_contained(OperandDims[1], C.back()))
+    AIdx = 1;
+  ArrayRef<int> A = OperandDims[AIdx];
+  ArrayRef<int> B = OperandDims[1 - AIdx];
+
+  SmallVector<int, 4> I, J, K;
+  for (int Dim = 0; Dim < DimNum; Dim++) {
+    bool InC = is_contained(C, Dim);
+    bool InA = is_contained(A, Dim);
+    bool InB = is_contained(B, Dim);
+    if (InC && InA && !InB)
+      I.push_back(Dim);
+    else if (InC && !InA && InB)
+      J.push_back(Dim);
+    else if (!InC && InA && InB)
+      K.push_back(Dim);
+    else if (!(InC && InA && InB))
+      return false;
+  }
+  if (I.empty() || J.empty() || K.empty() ||
+      !containsOnlyContractionDep(PartialSchedule, D, K))
+    return false;
+
+  MMI.A = Operands[AIdx];
+  MMI.B = Operands[1 - AIdx];
+  MMI.ReadFromC = ReadFromC;
+  MMI.WriteToC = WriteToC;
+  MMI.i = getInnermostContractionDim(I, C);
+  MMI.j = getInnermostContractionDim(J, C);
+  MMI.k = getInnermostContractionDim(K, A);
+  return true;
+}
+
 /// Permute two dimensions of the band node.
 ///
 /// Permute FirstDim and SecondDim dimensions of the Node.
@@ -889,9 +1519,13 @@ permuteBandNodeDimensions(__isl_take isl_schedule_node *Node, unsigned FirstDim,
 
 __isl_give isl_schedule_node *ScheduleTreeOptimizer::createMicroKernel(
     __isl_take isl_schedule_node *Node, MicroKernelParamsTy MicroKernelParams) {
-  applyRegisterTiling(Node, {MicroKernelParams.Mr, MicroKernelParams.Nr}, 1);
+  int DimOutNum = isl_schedule_node_band_n_member(Node);
+  std::vector<int> TileSizes(DimOutNum, 1);
+  TileSizes[DimOutNum - 3] = MicroKernelParams.Mr;
+  TileSizes[DimOutNum - 2] = MicroKernelParams.Nr;
+  applyRegisterTiling(Node, TileSizes, 1);
   Node = isl_schedule_node_parent(isl_schedule_node_parent(Node));
-  Node = permuteBandNodeDimensions(Node, 0, 1);
+  Node = permuteBandNodeDimensions(Node, DimOutNum - 3, DimOutNum - 2);
   return isl_schedule_node_child(isl_schedule_node_child(Node, 0), 0);
 }
 
@@ -1038,7 +1672,10 @@ getMacroKernelParams(const MicroKernelParamsTy &MicroKernelParams,
 ///
 /// Create an access relation of the following form:
 /// [O0, O1, O2, O3, O4, O5, O6, O7, O8] -> [OI, O5, OJ]
-/// where I is @p FirstDim, J is @p SecondDim.
+/// where I is @p FirstDim, J is @p SecondDim. In case the band of the
+/// matrix multiplication has n > 3 dimensions, the relation has 3n input
+/// dimensions and O(2n - 1), the last dimension of the micro-kernel tiles,
+/// is used instead of O5.
 ///
 /// It can be used, for example, to create relations that helps to consequently
 /// access elements of operands of a matrix multiplication after creation of
@@ -1062,10 +1699,12 @@ getMacroKernelParams(const MicroKernelParamsTy &MicroKernelParams,
 __isl_give isl_map *getMatMulAccRel(__isl_take isl_map *MapOldIndVar,
                                     unsigned FirstDim, unsigned SecondDim) {
   auto *Ctx = isl_map_get_ctx(MapOldIndVar);
-  auto *AccessRelSpace = isl_space_alloc(Ctx, 0, 9, 3);
+  unsigned DimNum = isl_map_dim(MapOldIndVar, isl_dim_out);
+  auto *AccessRelSpace = isl_space_alloc(Ctx, 0, DimNum, 3);
   auto *AccessRel = isl_map_universe(AccessRelSpace);
   AccessRel = isl_map_equate(AccessRel, isl_dim_in, FirstDim, isl_dim_out, 0);
-  AccessRel = isl_map_equate(AccessRel, isl_dim_in, 5, isl_dim_out, 1);
+  AccessRel =
+      isl_map_equate(AccessRel, isl_dim_in, 2 * DimNum / 3 - 1, isl_dim_out, 1);
   AccessRel = isl_map_equate(AccessRel, isl_dim_in, SecondDim, isl_dim_out, 2);
   return isl_map_apply_range(MapOldIndVar, AccessRel);
 }
@@ -1102,6 +1741,11 @@ createExtensionNode(__isl_take isl_schedule_node *Node,
 /// MemoryAccess::setNewAccessRelation, and copy the data to the array, using
 /// the copy statement created by Scop::addScopStmt.
 ///
+/// In case of a tensor contraction, the band has additional outer dimensions
+/// that are not tiled. The packed arrays are refilled in each of their
+/// iterations and the copy statements read through the original access
+/// relations, which also packs transposed operands in-stride.
+///
 /// @param Node The schedule node to be optimized.
 /// @param MapOldIndVar The relation, which maps original induction variables
 ///                     to the ones, which are produced by schedule
@@ -1117,14 +1761,17 @@ static __isl_give isl_schedule_node *optimizeDataLayoutMatrMulPattern(
   auto InputDimsId = isl_map_get_tuple_id(MapOldIndVar, isl_dim_in);
   auto *Stmt = static_cast<ScopStmt *>(isl_id_get_user(InputDimsId));
   isl_id_free(InputDimsId);
+  unsigned DimOutNum = isl_map_dim(MapOldIndVar, isl_dim_out) / 3;
 
   // Create a copy statement that corresponds to the memory access to the
   // matrix B, the second operand of the matrix multiplication.
   Node = isl_schedule_node_parent(isl_schedule_node_parent(Node));
   Node = isl_schedule_node_parent(isl_schedule_node_parent(Node));
   Node = isl_schedule_node_parent(Node);
-  Node = isl_schedule_node_child(isl_schedule_node_band_split(Node, 2), 0);
-  auto *AccRel = getMatMulAccRel(isl_map_copy(MapOldIndVar), 3, 7);
+  Node = isl_schedule_node_child(
+      isl_schedule_node_band_split(Node, DimOutNum - 1), 0);
+  auto *AccRel = getMatMulAccRel(isl_map_copy(MapOldIndVar), 2 * DimOutNum - 3,
+                                 3 * DimOutNum - 2);
   unsigned FirstDimSize = MacroParams.Nc / MicroParams.Nr;
   unsigned SecondDimSize = MacroParams.Kc;
   unsigned ThirdDimSize = MicroParams.Nr;
@@ -1134,9 +1781,9 @@ static __isl_give isl_schedule_node *optimizeDataLayoutMatrMulPattern(
   AccRel = isl_map_set_tuple_id(AccRel, isl_dim_out, SAI->getBasePtrId());
   auto *OldAcc = MMI.B->getAccessRelation();
   MMI.B->setNewAccessRelation(AccRel);
-  auto *ExtMap =
-      isl_map_project_out(isl_map_copy(MapOldIndVar), isl_dim_out, 2,
-                          isl_map_dim(MapOldIndVar, isl_dim_out) - 2);
+  auto *ExtMap = isl_map_project_out(
+      isl_map_copy(MapOldIndVar), isl_dim_out, DimOutNum - 1,
+      isl_map_dim(MapOldIndVar, isl_dim_out) - DimOutNum + 1);
   ExtMap = isl_map_reverse(ExtMap);
   ExtMap = isl_map_fix_si(ExtMap, isl_dim_out, MMI.i, 0);
   auto *Domain = Stmt->getDomain();
@@ -1154,7 +1801,8 @@ static __isl_give isl_schedule_node *optimizeDataLayoutMatrMulPattern(
   // Create a copy statement that corresponds to the memory access
   // to the matrix A, the first operand of the matrix multiplication.
   Node = isl_schedule_node_child(Node, 0);
-  AccRel = getMatMulAccRel(isl_map_copy(MapOldIndVar), 4, 6);
+  AccRel = getMatMulAccRel(isl_map_copy(MapOldIndVar), 2 * DimOutNum - 2,
+                           3 * DimOutNum - 3);
   FirstDimSize = MacroParams.Mc / MicroParams.Mr;
   ThirdDimSize = MicroParams.Mr;
   SAI = Stmt->getParent()->createScopArrayInfo(
@@ -1163,8 +1811,9 @@ static __isl_give isl_schedule_node *optimizeDataLayoutMatrMulPattern(
   AccRel = isl_map_set_tuple_id(AccRel, isl_dim_out, SAI->getBasePtrId());
   OldAcc = MMI.A->getAccessRelation();
   MMI.A->setNewAccessRelation(AccRel);
-  ExtMap = isl_map_project_out(MapOldIndVar, isl_dim_out, 3,
-                               isl_map_dim(MapOldIndVar, isl_dim_out) - 3);
+  ExtMap = isl_map_project_out(MapOldIndVar, isl_dim_out, DimOutNum,
+                               isl_map_dim(MapOldIndVar, isl_dim_out) -
+                                   DimOutNum);
   ExtMap = isl_map_reverse(ExtMap);
   ExtMap = isl_map_fix_si(ExtMap, isl_dim_out, MMI.j, 0);
   NewStmt = Stmt->getParent()->addScopStmt(OldAcc, MMI.A->getAccessRelation(),
@@ -1185,6 +1834,10 @@ static __isl_give isl_schedule_node *optimizeDataLayoutMatrMulPattern(
 ///
 /// @param Node The schedule node produced as the result of creation
 ///        of the BLIS kernels.
+/// The range of the relation consists of the dimensions of the three band
+/// nodes of the BLIS kernels: the macro-kernel tiles, the micro-kernel tiles
+/// and the micro-kernel points.
+///
 /// @param MicroKernelParams, MacroKernelParams Parameters of the BLIS kernel
 ///                                             to be taken into account.
 /// @return  The relation mapping original induction variables to the ones
@@ -1199,12 +1852,7 @@ getInductionVariablesSubstitution(__isl_take isl_schedule_node *Node,
   auto *Child = isl_schedule_node_get_child(Node, 0);
   auto *UnMapOldIndVar = isl_schedule_node_get_prefix_schedule_union_map(Child);
   isl_schedule_node_free(Child);
-  auto *MapOldIndVar = isl_map_from_union_map(UnMapOldIndVar);
-  if (isl_map_dim(MapOldIndVar, isl_dim_out) > 9)
-    MapOldIndVar =
-        isl_map_project_out(MapOldIndVar, isl_dim_out, 0,
-                            isl_map_dim(MapOldIndVar, isl_dim_out) - 9);
-  return MapOldIndVar;
+  return isl_map_from_union_map(UnMapOldIndVar);
 }
 
 /// Isolate a set of partial tile prefixes and unroll the isolated part.
@@ -1227,20 +1875,23 @@ isolateAndUnrollMatMulInnerLoops(isl::schedule_node Node,
   isl::schedule_node Child = Node.get_child(0);
   isl::union_map UnMapOldIndVar = Child.get_prefix_schedule_relation();
   isl::set Prefix = isl::map::from_union_map(UnMapOldIndVar).range();
+  unsigned BandDims = isl_schedule_node_band_n_member(Node.keep());
   unsigned Dims = Prefix.dim(isl::dim::set);
   Prefix = Prefix.project_out(isl::dim::set, Dims - 1, 1);
   Prefix = getPartialTilePrefixes(Prefix, MicroKernelParams.Nr);
   Prefix = getPartialTilePrefixes(Prefix, MicroKernelParams.Mr);
 
   isl::union_set IsolateOption =
-      getIsolateOptions(Prefix.add_dims(isl::dim::set, 3), 3);
+      getIsolateOptions(Prefix.add_dims(isl::dim::set, 3), BandDims);
   isl::ctx Ctx = Node.get_ctx();
   isl::union_set AtomicOption = getAtomicOptions(Ctx);
   isl::union_set Options = IsolateOption.unite(AtomicOption);
   Options = Options.unite(getUnrollIsolatedSetOptions(Ctx));
   Node = Node.band_set_ast_build_options(Options);
   Node = Node.parent().parent();
-  IsolateOption = getIsolateOptions(Prefix, 3);
+  Dims = Prefix.dim(isl::dim::set);
+  Prefix = Prefix.project_out(isl::dim::set, 2 * BandDims, Dims - 2 * BandDims);
+  IsolateOption = getIsolateOptions(Prefix, BandDims);
   Options = IsolateOption.unite(AtomicOption);
   Node = Node.band_set_ast_build_options(Options);
   Node = Node.child(0).child(0);
@@ -1348,6 +1999,13 @@ bool ScheduleTreeOptimizer::isMatrMultPattern(
     isl_map_free(NewPartialSchedule);
     return true;
   }
+  MMI = MatMulInfoTy();
+  if (PMBasedTensorContractionOpts &&
+      containsTensorContraction(NewPartialSchedule, D, MMI)) {
+    DEBUG(dbgs() << "The tensor contraction pattern was detected\n");
+    isl_map_free(NewPartialSchedule);
+    return true;
+  }
   isl_map_free(NewPartialSchedule);
   return false;
 }
@@ -1367,6 +2025,14 @@ ScheduleTreeOptimizer::optimizeBand(__isl_take isl_schedule_node *Node,
     return optimizeMatMulPattern(Node, OAI->TTI, MMI);
   }
 
+  if (DiamondTiling && User) {
+    int Slope = getDiamondTilingSlope(Node, OAI->D);
+    if (Slope > 0) {
+      DEBUG(dbgs() << "An iterative stencil was detected\n");
+      return applyDiamondTiling(Node, Slope);
+    }
+  }
+
   return standardBandOpts(Node, User);
 }
 
@@ -1441,6 +2107,90 @@ private:
 
 char IslScheduleOptimizer::ID = 0;
 
+/// Read an integer of the cache description in sysfs, with an optional K or
+/// M suffix.
+static int readSysfsCacheValue(const Twine &Path) {
+  auto Buffer = MemoryBuffer::getFileAsStream(Path);
+  if (!Buffer)
+    return 0;
+
+  StringRef Value = (*Buffer)->getBuffer().trim();
+  int Scale = 1;
+  if (Value.consume_back("K"))
+    Scale = 1024;
+  else if (Value.consume_back("M"))
+    Scale = 1024 * 1024;
+
+  int Result;
+  if (Value.getAsInteger(10, Result))
+    return 0;
+  return Result * Scale;
+}
+
+/// Get the data cache of level @p Level of the host from sysfs.
+static CacheLevelTy getHostCacheLevel(int Level) {
+  CacheLevelTy Cache;
+  for (int Index = 0;; Index++) {
+    std::string Dir =
+        "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(Index);
+    int IndexLevel = readSysfsCacheValue(Dir + "/level");
+    if (IndexLevel == 0)
+      return Cache;
+    if (IndexLevel != Level)
+      continue;
+
+    auto Type = MemoryBuffer::getFileAsStream(Dir + "/type");
+    if (Type && (*Type)->getBuffer().trim() == "Instruction")
+      continue;
+
+    Cache.Size = readSysfsCacheValue(Dir + "/size");
+    Cache.Associativity = readSysfsCacheValue(Dir + "/ways_of_associativity");
+    Cache.LineSize = readSysfsCacheValue(Dir + "/coherency_line_size");
+    return Cache;
+  }
+}
+
+/// Get the parameters of the first two cache levels of the target of @p M.
+///
+/// The parameters given on the command line are used as they are. The others
+/// are taken from the host, if the target is the host, and otherwise keep
+/// their defaults.
+static void getTargetCacheLevels(const Module &M, CacheLevelTy &L1,
+                                 CacheLevelTy &L2) {
+  L1.Size = FirstCacheLevelSize;
+  L1.Associativity = FirstCacheLevelAssociativity;
+  L1.LineSize = CacheLineSize;
+  L2.Size = SecondCacheLevelSize;
+  L2.Associativity = SecondCacheLevelAssociativity;
+  L2.LineSize = CacheLineSize;
+
+  if (!CacheFromHost)
+    return;
+
+  Triple Target(M.getTargetTriple());
+  Triple Host(sys::getProcessTriple());
+  if (!M.getTargetTriple().empty() &&
+      (Target.getArch() != Host.getArch() || Target.getOS() != Host.getOS()))
+    return;
+
+  auto HostL1 = getHostCacheLevel(1);
+  auto HostL2 = getHostCacheLevel(2);
+  if (HostL1.Size > 0 && FirstCacheLevelSize.getNumOccurrences() == 0)
+    L1.Size = HostL1.Size;
+  if (HostL1.Associativity > 0 &&
+      FirstCacheLevelAssociativity.getNumOccurrences() == 0)
+    L1.Associativity = HostL1.Associativity;
+  if (HostL2.Size > 0 && SecondCacheLevelSize.getNumOccurrences() == 0)
+    L2.Size = HostL2.Size;
+  if (HostL2.Associativity > 0 &&
+      SecondCacheLevelAssociativity.getNumOccurrences() == 0)
+    L2.Associativity = HostL2.Associativity;
+  if (HostL1.LineSize > 0 && CacheLineSize.getNumOccurrences() == 0) {
+    L1.LineSize = HostL1.LineSize;
+    L2.LineSize = HostL2.LineSize > 0 ? HostL2.LineSize : HostL1.LineSize;
+  }
+}
+
 bool IslScheduleOptimizer::runOnScop(Scop &S) {
 
   // Skip SCoPs in case they're already optimised by PPCGCodeGeneration
@@ -1583,7 +2333,9 @@ bool IslScheduleOptimizer::runOnScop(Scop &S) {
 
   Function &F = S.getFunction();
   auto *TTI = &getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
-  const OptimizerAdditionalInfoTy OAI = {TTI, const_cast<Dependences *>(&D)};
+  OptimizerAdditionalInfoTy OAI = {TTI, const_cast<Dependences *>(&D)};
+  if (CacheModelTileSizes)
+    getTargetCacheLevels(*F.getParent(), OAI.L1, OAI.L2);
   isl_schedule *NewSchedule =
       ScheduleTreeOptimizer::optimizeSchedule(Schedule, &OAI);
 
@@ -0,0 +1,71 @@
+; RUN: opt %loadPolly -polly-ast -polly-parallel -polly-parallel-force -analyze < %s | FileCheck %s
+; RUN: opt %loadPolly -polly-ast -polly-parallel -polly-parallel-force -polly-parallel-doacross -analyze < %s | FileCheck %s
+
+; The outer loop is not parallel and its body is not a single loop, so it is
+; not executed as doacross loop. The loops in its body are still detected as
+; parallel.
+;
+; for (i = 1; i < 1024; i++) {
+;   for (j = 0; j < 1024; j++)
+;     A[i][j] = A[i - 1][j];
+;   for (j = 0; j < 1024; j++)
+;     B[i][j] = A[i][j];
+; }
+
+; CHECK-NOT: ordered(2)
+; CHECK: for (int c0 = 0; c0 <= 1022; c0 += 1) {
+; CHECK:   #pragma simd
+; CHECK:   #pragma omp parallel for
+; CHECK:   for (int c1 = 0; c1 <= 1023; c1 += 1)
+; CHECK:     Stmt_S1(c0, c1);
+; CHECK:   #pragma simd
+; CHECK:   #pragma omp parallel for
+; CHECK:   for (int c1 = 0; c1 <= 1023; c1 += 1)
+; CHECK:     Stmt_S2(c0, c1);
+; CHECK: }
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [1024 x [1024 x float]] zeroinitializer, align 16
+@B = common global [1024 x [1024 x float]] zeroinitializer, align 16
+
+define void @doacross_block_body() {
+entry:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %for.i.inc ]
+  %i.prev = add nsw i64 %i, -1
+  br label %S1
+
+S1:
+  %j1 = phi i64 [ 0, %for.i ], [ %j1.next, %S1 ]
+  %up.gep = getelementptr [1024 x [1024 x float]], [1024 x [1024 x float]]* @A, i64 0, i64 %i.prev, i64 %j1
+  %up = load float, float* %up.gep
+  %a.gep = getelementptr [1024 x [1024 x float]], [1024 x [1024 x float]]* @A, i64 0, i64 %i, i64 %j1
+  store float %up, float* %a.gep
+  %j1.next = add nuw nsw i64 %j1, 1
+  %j1.cond = icmp ne i64 %j1.next, 1024
+  br i1 %j1.cond, label %S1, label %S2.preheader
+
+S2.preheader:
+  br label %S2
+
+S2:
+  %j2 = phi i64 [ 0, %S2.preheader ], [ %j2.next, %S2 ]
+  %val.gep = getelementptr [1024 x [1024 x float]], [1024 x [1024 x float]]* @A, i64 0, i64 %i, i64 %j2
+  %val = load float, float* %val.gep
+  %b.gep = getelementptr [1024 x [1024 x float]], [1024 x [1024 x float]]* @B, i64 0, i64 %i, i64 %j2
+  store float %val, float* %b.gep
+  %j2.next = add nuw nsw i64 %j2, 1
+  %j2.cond = icmp ne i64 %j2.next, 1024
+  br i1 %j2.cond, label %S2, label %for.i.inc
+
+for.i.inc:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp ne i64 %i.next, 1024
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
@@ -1,5 +1,6 @@
 ; RUN: opt %loadPolly -polly-scops -analyze -polly-import-jscop -polly-import-jscop-postfix=transformed < %s 2>&1 | FileCheck %s
 ; RUN: opt %loadPolly -polly-import-jscop -polly-import-jscop-postfix=transformed -polly-codegen -S < %s 2>&1 | FileCheck %s --check-prefix=CODEGEN
+; RUN: opt %loadPolly -polly-import-jscop -polly-import-jscop-postfix=transformed -polly-codegen -polly-scratch-buffers -S < %s 2>&1 | FileCheck %s --check-prefix=SCRATCH
 ;
 ;  for (i = 0; i < _PB_NI; i++)
 ;    for (j = 0; j < _PB_NJ; j++)
@@ -32,6 +33,21 @@
 ; CODEGEN:  {{%.*}} = load double, double* %polly.access.E, align 8, !alias.scope [[TAG0:![0-9]+]], !noalias [[TAG2:![0-9]+]]
 ; CODEGEN:  store double {{%.*}}, double* %scevgep36, align 8, !alias.scope [[TAG5:![0-9]+]], !noalias [[TAG8:![0-9]+]]
 ;
+; SCRATCH: @polly.scratch.key.D = private global i8 0
+; SCRATCH: @polly.scratch.key.E = private global i8 0
+; SCRATCH: @polly.scratch.key.F = private global i8 0
+;
+; SCRATCH-NOT: alloca [270336 x double]
+; SCRATCH: polly.start:
+; SCRATCH:   %polly.scratch.D = call i8* @polly_getScratchBuffer(i8* @polly.scratch.key.D, i64 2162688, i64 64)
+; SCRATCH-NEXT:   %D = bitcast i8* %polly.scratch.D to double*
+; SCRATCH:   %polly.scratch.E = call i8* @polly_getScratchBuffer(i8* @polly.scratch.key.E, i64 432537600000, i64 64)
+; SCRATCH:   %polly.scratch.F = call i8* @polly_getScratchBuffer(i8* @polly.scratch.key.F, i64 2162688, i64 64)
+; SCRATCH-NEXT:   %F = bitcast i8* %polly.scratch.F to i64*
+; SCRATCH-NOT: call void @free
+;
+; SCRATCH: declare i8* @polly_getScratchBuffer(i8*, i64, i64)
+;
 ; CODEGEN-DAG: [[TAG0]] = distinct !{[[TAG0]], [[TAG1:![0-9]+]], !"polly.alias.scope.E"}
 ; CODEGEN-DAG: [[TAG1]] = distinct !{[[TAG1]], !"polly.alias.scope.domain"}
 ; CODEGEN-DAG: [[TAG2]] = !{[[TAG3:![0-9]+]], [[TAG4:![0-9]+]], [[TAG5:![0-9]+]], [[TAG6:![0-9]+]], [[TAG7:![0-9]+]]}
@@ -0,0 +1,77 @@
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-force -polly-ast -analyze < %s | FileCheck %s -check-prefix=AST
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-force -polly-parallel-collapse=2 -polly-ast -analyze < %s | FileCheck %s -check-prefix=AST-COLLAPSE
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-force -polly-parallel-collapse=2 -polly-codegen -S -verify-dom-info < %s | FileCheck %s -check-prefix=IR
+
+; The parallel outer loop has only four iterations, the parallel loop nested
+; in it is collapsed into it to distribute 4 * 64 iterations to the threads.
+;
+; float A[4][64][64];
+;
+; void collapse(void) {
+;   for (long i = 0; i < 4; i++)
+;     for (long j = 0; j < 64; j++)
+;       for (long k = 0; k < 64; k++)
+;         A[i][j][k] = 1;
+; }
+
+; AST: #pragma omp parallel for
+; AST-NOT: collapse
+; AST: for (int c0 = 0; c0 <= 3; c0 += 1)
+
+; AST-COLLAPSE: #pragma omp parallel for collapse(2)
+; AST-COLLAPSE: for (int c0 = 0; c0 <= 3; c0 += 1)
+; AST-COLLAPSE:   for (int c1 = 0; c1 <= 63; c1 += 1)
+; AST-COLLAPSE:     #pragma simd
+; AST-COLLAPSE:     for (int c2 = 0; c2 <= 63; c2 += 1)
+; AST-COLLAPSE:       Stmt_S(c0, c1, c2);
+
+; IR-LABEL: polly.parallel.for:
+; IR:   call void @GOMP_parallel_loop_runtime_start(void (i8*)* @collapse_polly_subfn, i8* %polly.par.userContext{{[0-9]*}}, i32 0, i64 0, i64 256, i64 1)
+
+; IR: define internal void @collapse_polly_subfn(i8* %polly.par.userContext)
+; IR-LABEL: polly.loop_header:
+; IR:   %[[J:[0-9]+]] = urem i64 %polly.indvar, 64
+; IR:   %[[I:[0-9]+]] = udiv i64 %polly.indvar, 64
+; IR:   %polly.par.collapsedIV = add nsw i64 0, %{{[0-9]+}}
+; IR:   %polly.par.collapsedIV{{[0-9]+}} = add nsw i64 0, %{{[0-9]+}}
+
+; IR-LABEL: polly.stmt.S:
+; IR:   getelementptr [4 x [64 x [64 x float]]], [4 x [64 x [64 x float]]]* @A, i64 0, i64 %polly.par.collapsedIV{{[0-9]+}}, i64 %polly.par.collapsedIV, i64 %polly.indvar{{[0-9]+}}
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [4 x [64 x [64 x float]]] zeroinitializer, align 16
+
+define void @collapse() {
+entry:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.i.inc ]
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 0, %for.i ], [ %j.next, %for.j.inc ]
+  br label %S
+
+S:
+  %k = phi i64 [ 0, %for.j ], [ %k.next, %S ]
+  %gep = getelementptr [4 x [64 x [64 x float]]], [4 x [64 x [64 x float]]]* @A, i64 0, i64 %i, i64 %j, i64 %k
+  store float 1.0, float* %gep
+  %k.next = add nuw nsw i64 %k, 1
+  %k.cond = icmp ne i64 %k.next, 64
+  br i1 %k.cond, label %S, label %for.j.inc
+
+for.j.inc:
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cond = icmp ne i64 %j.next, 64
+  br i1 %j.cond, label %for.j, label %for.i.inc
+
+for.i.inc:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp ne i64 %i.next, 4
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
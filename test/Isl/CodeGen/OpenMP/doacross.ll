@@ -0,0 +1,132 @@
+; RUN: opt %loadPolly -polly-parallel -polly-ast -analyze < %s | FileCheck %s -check-prefix=AST-NODOACROSS
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-doacross -polly-ast -analyze < %s | FileCheck %s -check-prefix=AST
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-doacross -polly-codegen -S -verify-dom-info < %s | FileCheck %s -check-prefix=IR
+
+; Neither loop is parallel. The outer loop runs as doacross loop: iteration i
+; computes A[i][j] once iteration i - 1 finished A[i - 1][j].
+;
+; float A[1024][1024];
+;
+; void doacross(void) {
+;   for (long i = 1; i < 1024; i++)
+;     for (long j = 1; j < 1024; j++)
+;       A[i][j] = A[i - 1][j] + A[i][j - 1];
+; }
+;
+; In the second function, iteration i reads A[i - 1][j + 1], i.e., the inner
+; distance of the dependence carried by the outer loop is -1. Iteration i has
+; to wait until iteration i - 1 finished A[i - 1][j + 1].
+;
+; void doacross_skewed(void) {
+;   for (long i = 1; i < 1024; i++)
+;     for (long j = 1; j < 1023; j++)
+;       A[i][j] = A[i - 1][j + 1] + A[i][j - 1];
+; }
+
+; AST-NODOACROSS-NOT: #pragma omp parallel for
+
+; AST: #pragma omp parallel for ordered(2) depend(sink: -1, +0)
+; AST: for (int c0 = 0; c0 <= 1022; c0 += 1)
+; AST:   for (int c1 = 0; c1 <= 1022; c1 += 1)
+; AST:     Stmt_S(c0, c1);
+
+; AST: #pragma omp parallel for ordered(2) depend(sink: -1, +1)
+; AST: for (int c0 = 0; c0 <= 1022; c0 += 1)
+; AST:   for (int c1 = 0; c1 <= 1021; c1 += 1)
+; AST:     Stmt_S(c0, c1);
+
+; IR-LABEL: polly.parallel.for:
+; IR:   %malloccall = {{.*}}call i8* @malloc(i64 8192)
+; IR:   %polly.par.progress = bitcast i8* %malloccall to i64*
+; IR:   store i64 9223372036854775807, i64* %polly.par.progress
+; IR:   store i64 -9223372036854775808, i64*
+; IR:   call void @GOMP_parallel_loop_runtime_start(
+; IR:   call void @GOMP_parallel_end()
+; IR:   call void @free(i8*
+
+; IR: define internal void @doacross_polly_subfn(i8* %polly.par.userContext)
+; IR:   %polly.par.waitSlot = getelementptr i64, i64* %polly.subfunc.arg.polly.par.progress, i64 %{{.*}}
+; IR:   %polly.par.postSlot = getelementptr i64, i64* %polly.subfunc.arg.polly.par.progress, i64 %{{.*}}
+
+; IR-LABEL: polly.par.wait:
+; IR-NEXT:   %polly.par.progress = load atomic i64, i64* %polly.par.waitSlot acquire, align 8
+; IR-NEXT:   %polly.par.isReady = icmp sge i64 %polly.par.progress, %{{.*}}
+; IR-NEXT:   br i1 %polly.par.isReady, label %polly.par.ready, label %polly.par.wait
+
+; IR-LABEL: polly.par.ready:
+; IR:   store atomic i64 %polly.indvar{{[0-9]*}}, i64* %polly.par.postSlot release, align 8
+
+; IR:   store atomic i64 9223372036854775807, i64* %polly.par.postSlot release, align 8
+
+; IR: define internal void @doacross_skewed_polly_subfn(i8* %polly.par.userContext)
+; IR:   %[[TARGET:[0-9]+]] = add i64 %polly.indvar{{[0-9]*}}, 1
+; IR:   %polly.par.isReady = icmp sge i64 %polly.par.progress, %[[TARGET]]
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [1024 x [1024 x float]] zeroinitializer, align 16
+
+define void @doacross() {
+entry:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %for.i.inc ]
+  %i.prev = add nsw i64 %i, -1
+  br label %S
+
+S:
+  %j = phi i64 [ 1, %for.i ], [ %j.next, %S ]
+  %j.prev = add nsw i64 %j, -1
+  %up.gep = getelementptr [1024 x [1024 x float]], [1024 x [1024 x float]]* @A, i64 0, i64 %i.prev, i64 %j
+  %up = load float, float* %up.gep
+  %left.gep = getelementptr [1024 x [1024 x float]], [1024 x [1024 x float]]* @A, i64 0, i64 %i, i64 %j.prev
+  %left = load float, float* %left.gep
+  %sum = fadd float %up, %left
+  %gep = getelementptr [1024 x [1024 x float]], [1024 x [1024 x float]]* @A, i64 0, i64 %i, i64 %j
+  store float %sum, float* %gep
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cond = icmp ne i64 %j.next, 1024
+  br i1 %j.cond, label %S, label %for.i.inc
+
+for.i.inc:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp ne i64 %i.next, 1024
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
+
+define void @doacross_skewed() {
+entry:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %for.i.inc ]
+  %i.prev = add nsw i64 %i, -1
+  br label %S
+
+S:
+  %j = phi i64 [ 1, %for.i ], [ %j.next, %S ]
+  %j.prev = add nsw i64 %j, -1
+  %j.succ = add nsw i64 %j, 1
+  %up.gep = getelementptr [1024 x [1024 x float]], [1024 x [1024 x float]]* @A, i64 0, i64 %i.prev, i64 %j.succ
+  %up = load float, float* %up.gep
+  %left.gep = getelementptr [1024 x [1024 x float]], [1024 x [1024 x float]]* @A, i64 0, i64 %i, i64 %j.prev
+  %left = load float, float* %left.gep
+  %sum = fadd float %up, %left
+  %gep = getelementptr [1024 x [1024 x float]], [1024 x [1024 x float]]* @A, i64 0, i64 %i, i64 %j
+  store float %sum, float* %gep
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cond = icmp ne i64 %j.next, 1023
+  br i1 %j.cond, label %S, label %for.i.inc
+
+for.i.inc:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp ne i64 %i.next, 1024
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,75 @@
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-force -polly-ast -analyze < %s | FileCheck %s -check-prefix=NOPRIV
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-force -polly-parallel-reductions -polly-ast -analyze < %s | FileCheck %s -check-prefix=AST
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-force -polly-parallel-reductions -polly-num-threads=4 -polly-codegen -S -verify-dom-info < %s | FileCheck %s -check-prefix=IR
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-force -polly-parallel-reductions -polly-codegen -S < %s | FileCheck %s -check-prefix=IR-AUTO
+
+; Every thread accumulates the sum in a private copy, the partial sums are
+; combined once the threads are joined.
+;
+; void reduction_privatized(int *A, int *sum) {
+;   for (long i = 0; i < 1024; i++)
+;     *sum += A[i];
+; }
+
+; NOPRIV-NOT: #pragma omp parallel for
+; NOPRIV: #pragma known-parallel reduction (+ : MemRef_sum)
+; NOPRIV: for (int c0 = 0; c0 <= 1023; c0 += 1)
+
+; AST: #pragma omp parallel for reduction (+ : MemRef_sum)
+; AST: for (int c0 = 0; c0 <= 1023; c0 += 1)
+; AST:   Stmt_for_body(c0);
+
+; IR-LABEL: polly.parallel.for:
+; IR:   %polly.par.partials = alloca i32, i64 4
+; IR:   call void @GOMP_parallel_loop_runtime_start(void (i8*)* @reduction_privatized_polly_subfn, i8* %polly.par.userContext{{[0-9]*}}, i32 4, i64 0, i64 1024, i64 1)
+; IR:   call void @GOMP_parallel_end()
+; IR:   call i64 @llvm.ctlz.i64(i64 3, i1 false)
+; IR:   %[[SHARED:[._a-zA-Z0-9]*]] = load i32, i32* %{{.*}}sum
+; IR:   %[[RESULT:[._a-zA-Z0-9]*]] = load i32, i32* %polly.par.partials
+; IR:   %[[SUM:[._a-zA-Z0-9]*]] = add i32 %[[SHARED]], %[[RESULT]]
+; IR:   store i32 %[[SUM]], i32* %{{.*}}sum
+; IR:   call void @llvm.stackrestore(
+; IR:   store i32 0, i32* %{{.*}}
+; IR:   %polly.red.add = add i32
+
+; IR: define internal void @reduction_privatized_polly_subfn(i8* %polly.par.userContext)
+; IR-LABEL: polly.par.setup:
+; IR:   %polly.par.private.MemRef_sum = alloca i32
+; IR:   store i32 0, i32* %polly.par.private.MemRef_sum
+; IR:   br label %polly.par.checkNext
+
+; IR-LABEL: polly.par.exit:
+; IR-NEXT:   call void @GOMP_loop_end_nowait()
+; IR-NEXT:   %{{.*}} = call i32 @omp_get_thread_num()
+; IR-NEXT:   %polly.par.threadNum = sext i32 %{{.*}} to i64
+; IR:   %[[PRIV:[._a-zA-Z0-9]*]] = load i32, i32* %polly.par.private.MemRef_sum
+; IR:   store i32 %[[PRIV]], i32*
+; IR-NEXT:   ret void
+
+; IR-LABEL: polly.stmt.for.body:
+; IR:   load i32, i32* %polly.par.private.MemRef_sum
+; IR:   store i32 %{{.*}}, i32* %polly.par.private.MemRef_sum
+
+; IR-AUTO: %polly.par.numThreads = sext i32 %{{.*}} to i64
+; IR-AUTO: %polly.par.partials = alloca i32, i64 %polly.par.numThreads
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+define void @reduction_privatized(i32* %A, i32* %sum) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %A, i64 %i
+  %0 = load i32, i32* %arrayidx
+  %1 = load i32, i32* %sum
+  %add = add nsw i32 %1, %0
+  store i32 %add, i32* %sum
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp ne i64 %i.next, 1024
+  br i1 %exitcond, label %for.body, label %exit
+
+exit:
+  ret void
+}
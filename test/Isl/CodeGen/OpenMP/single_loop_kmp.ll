@@ -0,0 +1,107 @@
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-force -polly-omp-backend=LLVM -polly-scheduling=static -polly-codegen -S -verify-dom-info < %s | FileCheck %s -check-prefix=IR
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-force -polly-omp-backend=LLVM -polly-scheduling=static -polly-scheduling-chunksize=4 -polly-codegen -S -verify-dom-info < %s | FileCheck %s -check-prefix=IR-CHUNKED
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-force -polly-omp-backend=LLVM -polly-scheduling=dynamic -polly-scheduling-chunksize=4 -polly-num-threads=2 -polly-codegen -S -verify-dom-info < %s | FileCheck %s -check-prefix=IR-DYNAMIC
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-force -polly-scheduling=guided -polly-codegen -S < %s | FileCheck %s -check-prefix=IR-GOMP
+
+; The parallel loop runs on the LLVM OpenMP runtime. With static scheduling,
+; every thread computes the bounds of its blocks of iterations at the start of
+; the subfunction. Without a chunk size, every thread runs a single block.
+;
+; #define N 1024
+; float A[N];
+;
+; void single_parallel_loop(void) {
+;   for (long i = 0; i < N; i++)
+;     A[i] = 1;
+; }
+
+; IR: @polly.par.ident = private constant %struct.ident_t { i32 0, i32 2, i32 0, i32 0, i8* getelementptr inbounds ([23 x i8], [23 x i8]* @polly.par.ident.str, i32 0, i32 0) }
+
+; IR-LABEL: polly.parallel.for:
+; IR-NEXT:   %polly.par.userContext1 = bitcast {}* %polly.par.userContext to i8*
+; IR-NEXT:   call void (%struct.ident_t*, i32, void (i32*, i32*, ...)*, ...) @__kmpc_fork_call(%struct.ident_t* @polly.par.ident, i32 4, void (i32*, i32*, ...)* bitcast (void (i32*, i32*, i64, i64, i64, i8*)* @single_parallel_loop_polly_subfn to void (i32*, i32*, ...)*), i64 0, i64 1023, i64 1, i8* %polly.par.userContext1)
+; IR-NEXT:   br label %polly.exiting
+
+; IR: define internal void @single_parallel_loop_polly_subfn(i32* %polly.par.global_tid, i32* %polly.par.bound_tid, i64 %polly.par.lb, i64 %polly.par.ub, i64 %polly.par.stride, i8* %polly.par.userContext)
+; IR-LABEL: polly.par.setup:
+; IR:        %polly.par.global_tid1 = load i32, i32* %polly.par.global_tid
+; IR:        call void @__kmpc_for_static_init_8(%struct.ident_t* @polly.par.ident, i32 %polly.par.global_tid1, i32 34, i32* %polly.par.lastIterPtr, i64* %polly.par.LBPtr, i64* %polly.par.UBPtr, i64* %polly.par.StridePtr, i64 %polly.par.stride, i64 1)
+; IR-NEXT:   br label %polly.par.checkNext
+
+; IR-LABEL: polly.par.exit:
+; IR-NEXT:   call void @__kmpc_for_static_fini(%struct.ident_t* @polly.par.ident, i32 %polly.par.global_tid1)
+; IR-NEXT:   ret void
+
+; IR-LABEL: polly.par.checkNext:
+; IR-NEXT:   %polly.par.LB = load i64, i64* %polly.par.LBPtr
+; IR-NEXT:   %polly.par.blockUB = load i64, i64* %polly.par.UBPtr
+; IR-NEXT:   %polly.par.isLastBlock = icmp slt i64 %polly.par.ub, %polly.par.blockUB
+; IR-NEXT:   %polly.par.UB = select i1 %polly.par.isLastBlock, i64 %polly.par.ub, i64 %polly.par.blockUB
+; IR-NEXT:   %polly.par.hasNextScheduleBlock = icmp sle i64 %polly.par.LB, %polly.par.UB
+; IR-NEXT:   br i1 %polly.par.hasNextScheduleBlock, label %polly.par.loadIVBounds, label %polly.par.exit
+
+; IR-LABEL: polly.loop_exit:
+; IR-NEXT:   br label %polly.par.exit
+
+; IR-LABEL: polly.loop_header:
+; IR-NEXT:   %polly.indvar = phi i64 [ %polly.par.LB, %polly.loop_preheader ], [ %polly.indvar_next, %polly.stmt.S ]
+
+; With a chunk size, the blocks of a thread are the block stride apart.
+;
+; IR-CHUNKED-LABEL: polly.par.setup:
+; IR-CHUNKED:        call void @__kmpc_for_static_init_8(%struct.ident_t* @polly.par.ident, i32 %polly.par.global_tid1, i32 33, i32* %polly.par.lastIterPtr, i64* %polly.par.LBPtr, i64* %polly.par.UBPtr, i64* %polly.par.StridePtr, i64 %polly.par.stride, i64 4)
+; IR-CHUNKED-NEXT:   %polly.par.blockStride = load i64, i64* %polly.par.StridePtr
+; IR-CHUNKED-NEXT:   br label %polly.par.checkNext
+
+; IR-CHUNKED-LABEL: polly.loop_exit:
+; IR-CHUNKED-NEXT:   %[[LB:[._a-zA-Z0-9]*]] = load i64, i64* %polly.par.LBPtr
+; IR-CHUNKED-NEXT:   %polly.par.nextLB = add i64 %[[LB]], %polly.par.blockStride
+; IR-CHUNKED-NEXT:   store i64 %polly.par.nextLB, i64* %polly.par.LBPtr
+; IR-CHUNKED-NEXT:   %[[UB:[._a-zA-Z0-9]*]] = load i64, i64* %polly.par.UBPtr
+; IR-CHUNKED-NEXT:   %polly.par.nextUB = add i64 %[[UB]], %polly.par.blockStride
+; IR-CHUNKED-NEXT:   store i64 %polly.par.nextUB, i64* %polly.par.UBPtr
+; IR-CHUNKED-NEXT:   br label %polly.par.checkNext
+
+; IR-DYNAMIC-LABEL: polly.parallel.for:
+; IR-DYNAMIC:   %polly.par.gtid = call i32 @__kmpc_global_thread_num(%struct.ident_t* @polly.par.ident)
+; IR-DYNAMIC:   call void @__kmpc_push_num_threads(%struct.ident_t* @polly.par.ident, i32 %polly.par.gtid, i32 2)
+; IR-DYNAMIC:   call void {{.*}} @__kmpc_fork_call(
+
+; IR-DYNAMIC-LABEL: polly.par.setup:
+; IR-DYNAMIC:   call void @__kmpc_dispatch_init_8(%struct.ident_t* @polly.par.ident, i32 %polly.par.global_tid1, i32 35, i64 %polly.par.lb, i64 %polly.par.ub, i64 %polly.par.stride, i64 4)
+
+; IR-DYNAMIC-LABEL: polly.par.exit:
+; IR-DYNAMIC-NEXT:   ret void
+
+; IR-DYNAMIC-LABEL: polly.par.checkNext:
+; IR-DYNAMIC-NEXT:   %[[next:[._a-zA-Z0-9]*]] = call i32 @__kmpc_dispatch_next_8(%struct.ident_t* @polly.par.ident, i32 %polly.par.global_tid1, i32* %polly.par.lastIterPtr, i64* %polly.par.LBPtr, i64* %polly.par.UBPtr, i64* %polly.par.StridePtr)
+; IR-DYNAMIC-NEXT:   %polly.par.hasNextScheduleBlock = icmp ne i32 %[[next]], 0
+
+; IR-GOMP:   call void @GOMP_parallel_loop_guided_start(void (i8*)* @single_parallel_loop_polly_subfn, i8* %polly.par.userContext1, i32 0, i64 0, i64 1024, i64 1, i64 1)
+; IR-GOMP:   call i8 @GOMP_loop_guided_next(i64* %polly.par.LBPtr, i64* %polly.par.UBPtr)
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+
+@A = common global [1024 x float] zeroinitializer, align 16
+
+define void @single_parallel_loop() nounwind {
+entry:
+  br label %for.i
+
+for.i:
+  %indvar = phi i64 [ %indvar.next, %for.inc], [ 0, %entry ]
+  %scevgep = getelementptr [1024 x float], [1024 x float]* @A, i64 0, i64 %indvar
+  %exitcond = icmp ne i64 %indvar, 1024
+  br i1 %exitcond, label %S, label %exit
+
+S:
+  store float 1.0, float* %scevgep
+  br label %for.inc
+
+for.inc:
+  %indvar.next = add i64 %indvar, 1
+  br label %for.i
+
+exit:
+  ret void
+}
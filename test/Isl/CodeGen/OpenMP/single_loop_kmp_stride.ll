@@ -0,0 +1,74 @@
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-force -polly-omp-backend=LLVM -polly-scheduling=static -polly-codegen -S -verify-dom-info < %s | FileCheck %s -check-prefix=IR
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-force -polly-omp-backend=LLVM -polly-scheduling=static -polly-scheduling-chunksize=4 -polly-codegen -S -verify-dom-info < %s | FileCheck %s -check-prefix=IR-CHUNKED
+
+; The parallel loop only runs the even iterations, so its increment is 2.
+; Without a chunk size, the stride returned by __kmpc_for_static_init_8 is the
+; trip count, which is not scaled by the increment. Every thread runs its
+; single block and leaves, without stepping to a next block.
+;
+; #define N 1024
+; float A[N];
+;
+; void strided_parallel_loop(void) {
+;   for (long i = 0; i < N; i++)
+;     if (i % 2 == 0)
+;       A[i] = 1;
+; }
+
+; IR-LABEL: polly.parallel.for:
+; IR:        call void {{.*}} @__kmpc_fork_call(%struct.ident_t* @polly.par.ident, i32 4, {{.*}}, i64 0, i64 {{102[23]}}, i64 2, i8* %polly.par.userContext1)
+
+; IR-LABEL: polly.par.setup:
+; IR:        call void @__kmpc_for_static_init_8(%struct.ident_t* @polly.par.ident, i32 %polly.par.global_tid1, i32 34, i32* %polly.par.lastIterPtr, i64* %polly.par.LBPtr, i64* %polly.par.UBPtr, i64* %polly.par.StridePtr, i64 %polly.par.stride, i64 1)
+; IR-NEXT:   br label %polly.par.checkNext
+
+; IR-LABEL: polly.par.checkNext:
+; IR:        br i1 %polly.par.hasNextScheduleBlock, label %polly.par.loadIVBounds, label %polly.par.exit
+
+; IR-LABEL: polly.loop_exit:
+; IR-NEXT:   br label %polly.par.exit
+
+; IR-NOT:    %polly.par.nextLB
+
+; With a chunk size, the stride is the distance to the next chunk of the
+; thread and already accounts for the increment.
+;
+; IR-CHUNKED-LABEL: polly.par.setup:
+; IR-CHUNKED:        call void @__kmpc_for_static_init_8(%struct.ident_t* @polly.par.ident, i32 %polly.par.global_tid1, i32 33, i32* %polly.par.lastIterPtr, i64* %polly.par.LBPtr, i64* %polly.par.UBPtr, i64* %polly.par.StridePtr, i64 %polly.par.stride, i64 4)
+; IR-CHUNKED-NEXT:   %polly.par.blockStride = load i64, i64* %polly.par.StridePtr
+
+; IR-CHUNKED-LABEL: polly.loop_exit:
+; IR-CHUNKED:        %polly.par.nextLB = add i64 %{{.*}}, %polly.par.blockStride
+; IR-CHUNKED:        %polly.par.nextUB = add i64 %{{.*}}, %polly.par.blockStride
+; IR-CHUNKED:        br label %polly.par.checkNext
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+
+@A = common global [1024 x float] zeroinitializer, align 16
+
+define void @strided_parallel_loop() nounwind {
+entry:
+  br label %for.i
+
+for.i:
+  %indvar = phi i64 [ %indvar.next, %for.inc], [ 0, %entry ]
+  %exitcond = icmp ne i64 %indvar, 1024
+  br i1 %exitcond, label %if.cond, label %exit
+
+if.cond:
+  %rem = srem i64 %indvar, 2
+  %even = icmp eq i64 %rem, 0
+  br i1 %even, label %S, label %for.inc
+
+S:
+  %scevgep = getelementptr [1024 x float], [1024 x float]* @A, i64 0, i64 %indvar
+  store float 1.0, float* %scevgep
+  br label %for.inc
+
+for.inc:
+  %indvar.next = add i64 %indvar, 1
+  br label %for.i
+
+exit:
+  ret void
+}
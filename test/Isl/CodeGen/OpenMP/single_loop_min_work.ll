@@ -0,0 +1,57 @@
+; RUN: opt %loadPolly -polly-parallel -polly-ast -analyze < %s \
+; RUN: | FileCheck %s -check-prefix=NOCHECK
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-min-work=1000 \
+; RUN: -polly-ast -analyze < %s | FileCheck %s -check-prefix=AST
+; RUN: opt %loadPolly -polly-parallel -polly-parallel-min-work=1000 \
+; RUN: -polly-codegen -S -verify-dom-info < %s | FileCheck %s -check-prefix=IR
+
+; An innermost loop is only run in parallel with a run-time check of its
+; iteration count. Below the minimal work, the sequential loop is executed.
+;
+; void single_parallel_loop_min_work(long n, float *A) {
+;   for (long i = 0; i < n; i++)
+;     A[i] = 1;
+; }
+
+; NOCHECK-NOT: #pragma omp parallel for
+
+; AST: #pragma omp parallel for
+; AST: for (int c0 = 0; c0 < n; c0 += 1)
+; AST:   Stmt_S(c0);
+
+; IR:       %polly.par.hasWork = icmp sge i64 %{{.*}}, 1000
+; IR-NEXT:  br i1 %polly.par.hasWork, label %polly.par.parallel, label %polly.par.sequential
+
+; IR-LABEL: polly.par.merge:
+
+; IR-LABEL: polly.par.parallel:
+; IR:       call void @GOMP_parallel_loop_runtime_start(void (i8*)* @single_parallel_loop_min_work_polly_subfn
+; IR:       call void @GOMP_parallel_end()
+
+; IR-LABEL: polly.par.sequential:
+; IR-NOT:   GOMP
+; IR:       br label %polly.loop_{{if|preheader}}
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+define void @single_parallel_loop_min_work(i64 %n, float* %A) {
+entry:
+  br label %for.i
+
+for.i:
+  %indvar = phi i64 [ %indvar.next, %for.inc ], [ 0, %entry ]
+  %scevgep = getelementptr float, float* %A, i64 %indvar
+  %exitcond = icmp slt i64 %indvar, %n
+  br i1 %exitcond, label %S, label %exit
+
+S:
+  store float 1.0, float* %scevgep
+  br label %for.inc
+
+for.inc:
+  %indvar.next = add nsw i64 %indvar, 1
+  br label %for.i
+
+exit:
+  ret void
+}
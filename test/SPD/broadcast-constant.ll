@@ -0,0 +1,91 @@
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -S | FileCheck %s
+; RUN: FileCheck %s -check-prefix=SPD < %t/kernel0.spd
+;
+;    float A[64][64], B[64][64], w[64];
+;    const float k[2] = {2.0f, 0.5f};
+;
+;    void scale_rows(void) {
+;      for (long i = 1; i < 63; i++) {
+;        __spd_loop(0, 1, 1, 0);
+;        for (long j = 1; j < 63; j++)
+;          B[i][j] = A[i][j] * w[j] + k[1];
+;      }
+;    }
+;
+; The row w is sent once through the broadcast interface and replayed for
+; every row of the stream, k[1] becomes a literal of the datapath.
+;
+; CHECK-LABEL: define void @scale_rows()
+; CHECK: call void @__spd_initialize()
+; CHECK: call float* @__spd_alloc_stream(i64 64)
+; CHECK: call void @__spd_pack_contiguous(float* %{{.*}}, i32 0, i32 1, float* {{.*}}@w{{.*}}, i64 64)
+; CHECK: call float* @__spd_alloc_stream(i64 8192)
+; CHECK: call float* @__spd_alloc_stream(i64 8192)
+; CHECK: call void @__spd_pack_interleaved(float* %{{.*}}, i32 2, float** getelementptr {{.*}} @__spd_arrays{{.*}}, i32 1, i64 4096)
+; CHECK: call void @__spd_pci_dma_to_FPGA(float* %{{.*}}, i64 8192)
+; CHECK: call void @__spd_pci_dma_bcast_to_FPGA(float* %{{.*}}, i64 64)
+; CHECK: call void @__spd_run_kernel(i64 8192, i32 0)
+; CHECK: call void @__spd_unpack_interleaved(
+; CHECK: call void @__spd_free_stream(
+; CHECK: call void @__spd_free_stream(
+; CHECK: call void @__spd_free_stream(
+; CHECK: call void @__spd_finalize()
+; CHECK: ret void
+;
+; SPD: Name     kernel0;
+; SPD: Main_In  {Mi::A0, iattr, sop, eop};
+; SPD: Main_Out {Mo::B0, oattr, sop, eop};
+; SPD: Brdc_In  {Bi::w0, sop, eop};
+; SPD: HDL      hdl0, 2, (wj0)() = mRowBroadcast(w0, Bi::eop[0], Mi::sop[0])(), <.pConstWord(0),.pRowLength(64),.pOffset(0)>;
+; SPD: EQU      equ0, mul0 = A0 * wj0;
+; SPD: EQU      equ1, add0 = mul0 + 0.500000;
+; SPD: EQU      equ2, B0 = mux(A0, add0, iattr[0]);
+; SPD: DRCT     (oattr, Mo::sop, Mo::eop) = (iattr, Mi::sop, Mi::eop);
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [64 x [64 x float]] zeroinitializer, align 16
+@B = common global [64 x [64 x float]] zeroinitializer, align 16
+@w = common global [64 x float] zeroinitializer, align 16
+@k = constant [2 x float] [float 2.000000e+00, float 5.000000e-01], align 4
+
+define void @scale_rows() {
+entry:
+  br label %for.i.preheader
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 1, %for.i.preheader ], [ %i.next, %for.i.latch ]
+  call void @__spd_loop(i64 0, i64 1, i64 1, i64 0)
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 1, %for.i ], [ %j.next, %for.j ]
+  %p.a = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j
+  %a = load float, float* %p.a, align 4
+  %p.w = getelementptr inbounds [64 x float], [64 x float]* @w, i64 0, i64 %j
+  %wj = load float, float* %p.w, align 4
+  %p.k = getelementptr inbounds [2 x float], [2 x float]* @k, i64 0, i64 1
+  %k1 = load float, float* %p.k, align 4
+  %mul = fmul float %a, %wj
+  %add = fadd float %mul, %k1
+  %p.b = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @B, i64 0, i64 %i, i64 %j
+  store float %add, float* %p.b, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cond = icmp slt i64 %j.next, 63
+  br i1 %j.cond, label %for.j, label %for.i.latch
+
+for.i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 63
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
+
+declare void @__spd_loop(i64, i64, i64, i64)
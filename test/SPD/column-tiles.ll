@@ -0,0 +1,91 @@
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -polly-spd-tile-width=32 -S | FileCheck %s
+; RUN: FileCheck %s -check-prefix=SPD < %t/kernel0.spd
+;
+;    float A[64][64], B[64][64];
+;
+;    void west_sum(void) {
+;      for (long i = 1; i < 63; i++) {
+;        __spd_loop(0, 1, 1, 0);
+;        for (long j = 1; j < 63; j++)
+;          B[i][j] = A[i][j] + A[i][j - 1];
+;      }
+;    }
+;
+; Tiles of 32 columns overlap by the column halo 1 on both sides, so every
+; tile writes 30 columns back: [0, 30), [30, 60) and [60, 64). The domain of
+; a tile is relative to its first streamed column.
+;
+; CHECK-LABEL: define void @west_sum()
+; CHECK: call float* @__spd_alloc_stream(i64 4096)
+; CHECK: call float* @__spd_alloc_stream(i64 4096)
+; CHECK-NOT: call void @__spd_pack_interleaved(
+;
+; CHECK: call void @__spd_pack_2d(float* %{{.*}}, i32 0, i32 2, i64 32, float* {{.*}}@A{{.*}}, i64 64, i64 64, i64 -1)
+; CHECK: call void @__spd_create_domain_2(float* %{{.*}}, i32 2, i64 2, i64 30, i64 32, i64 1, i64 62, i64 64)
+; CHECK: call void @__spd_pci_dma_to_FPGA(float* %{{.*}}, i64 4096)
+; CHECK: call void @__spd_run_kernel(i64 4096, i32 0)
+; CHECK: call void @__spd_pci_dma_from_FPGA(float* %{{.*}}, i64 4096, i32 0)
+; CHECK: call void @__spd_unpack_2d(float* {{.*}}@B{{.*}}, i64 64, i64 64, i64 30, float* %{{.*}}, i32 0, i32 2, i64 32)
+;
+; CHECK: call void @__spd_pack_2d(float* %{{.*}}, i32 0, i32 2, i64 32, float* {{.*}}@A{{.*}}, i64 64, i64 64, i64 29)
+; CHECK: call void @__spd_create_domain_2(float* %{{.*}}, i32 2, i64 1, i64 30, i64 32, i64 1, i64 62, i64 64)
+; CHECK: call void @__spd_run_kernel(i64 4096, i32 0)
+; CHECK: call void @__spd_unpack_2d(float* {{.*}}@B{{.*}}, i64 64, i64 64, i64 30, float* %{{.*}}, i32 0, i32 2, i64 32)
+;
+; CHECK: call void @__spd_pack_2d(float* %{{.*}}, i32 0, i32 2, i64 32, float* {{.*}}@A{{.*}}, i64 64, i64 64, i64 59)
+; CHECK: call void @__spd_create_domain_2(float* %{{.*}}, i32 2, i64 1, i64 3, i64 32, i64 1, i64 62, i64 64)
+; CHECK: call void @__spd_run_kernel(i64 4096, i32 0)
+; CHECK: call void @__spd_unpack_2d(float* {{.*}}@B{{.*}}, i64 64, i64 64, i64 4, float* %{{.*}}, i32 0, i32 2, i64 32)
+;
+; CHECK-NOT: call void @__spd_run_kernel(
+; CHECK: call void @__spd_free_stream(
+; CHECK: call void @__spd_free_stream(
+; CHECK: call void @__spd_finalize()
+;
+; The delay line of A[i][j - 1] is as long as the offset in a tile row.
+;
+; SPD: HDL      hdl0, 2, (w0)() = mStreamBackward(A0, Mi::eop[0])(), <.pConstWord(0),.pBwdCycles(1)>;
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [64 x [64 x float]] zeroinitializer, align 16
+@B = common global [64 x [64 x float]] zeroinitializer, align 16
+
+define void @west_sum() {
+entry:
+  br label %for.i.preheader
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 1, %for.i.preheader ], [ %i.next, %for.i.latch ]
+  call void @__spd_loop(i64 0, i64 1, i64 1, i64 0)
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 1, %for.i ], [ %j.next, %for.j ]
+  %j.m1 = add nsw i64 %j, -1
+  %p.c = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j
+  %c = load float, float* %p.c, align 4
+  %p.w = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j.m1
+  %w = load float, float* %p.w, align 4
+  %add = fadd float %c, %w
+  %p.b = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @B, i64 0, i64 %i, i64 %j
+  store float %add, float* %p.b, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cond = icmp slt i64 %j.next, 63
+  br i1 %j.cond, label %for.j, label %for.i.latch
+
+for.i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 63
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
+
+declare void @__spd_loop(i64, i64, i64, i64)
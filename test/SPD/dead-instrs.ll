@@ -0,0 +1,68 @@
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -S -o /dev/null
+; RUN: FileCheck %s -check-prefix=SPD --implicit-check-not=3.000000 \
+; RUN: --implicit-check-not=7.000000 --implicit-check-not=11.000000 \
+; RUN: < %t/kernel0.spd
+;
+;    float A[64][64], B[64][64];
+;
+;    void add_half(void) {
+;      for (long i = 0; i < 64; i++) {
+;        __spd_loop(0, 1, 1, 0);
+;        for (long j = 0; j < 64; j++) {
+;          float t = (A[i][j] * 3.0f + 7.0f) - 11.0f;  /* unused */
+;          B[i][j] = A[i][j] + 0.5f;
+;        }
+;      }
+;    }
+;
+; Only the last instruction computing t is unused. The others become dead
+; one after the other, once their user is removed, and none of them reaches
+; the kernel.
+;
+; SPD: Name     kernel0;
+; SPD: EQU      equ0, add0 = A0 + 0.500000;
+; SPD: DRCT     (oattr, Mo::sop, Mo::eop) = (iattr, Mi::sop, Mi::eop);
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [64 x [64 x float]] zeroinitializer, align 16
+@B = common global [64 x [64 x float]] zeroinitializer, align 16
+
+define void @add_half() {
+entry:
+  br label %for.i.preheader
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 0, %for.i.preheader ], [ %i.next, %for.i.latch ]
+  call void @__spd_loop(i64 0, i64 1, i64 1, i64 0)
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 0, %for.i ], [ %j.next, %for.j ]
+  %p.a = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j
+  %a = load float, float* %p.a, align 4
+  %dead.mul = fmul float %a, 3.000000e+00
+  %dead.add = fadd float %dead.mul, 7.000000e+00
+  %dead.sub = fsub float %dead.add, 1.100000e+01
+  %add = fadd float %a, 5.000000e-01
+  %p.b = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @B, i64 0, i64 %i, i64 %j
+  store float %add, float* %p.b, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cond = icmp slt i64 %j.next, 64
+  br i1 %j.cond, label %for.j, label %for.i.latch
+
+for.i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 64
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
+
+declare void @__spd_loop(i64, i64, i64, i64)
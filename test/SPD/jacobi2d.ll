@@ -0,0 +1,137 @@
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -polly-spd-emulate -S | FileCheck %s
+; RUN: FileCheck %s -check-prefix=SPD < %t/kernel0.spd
+;
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -polly-spd-num-partitions=2 -S \
+; RUN: | FileCheck %s -check-prefix=PART
+;
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -polly-spd-inline-pack -S \
+; RUN: | FileCheck %s -check-prefix=INL
+;
+;    float A[64][64], B[64][64];
+;
+;    void jacobi2d(void) {
+;      for (long i = 1; i < 63; i++) {
+;        __spd_loop(0, 1, 1, 0);
+;        for (long j = 1; j < 63; j++)
+;          B[i][j] = 0.2f * (A[i][j] + A[i - 1][j] + A[i + 1][j] +
+;                            A[i][j - 1] + A[i][j + 1]);
+;      }
+;    }
+;
+; The single array read is packed in one pass, the host writes the attr
+; word of the rows and columns inside the loop bounds.
+;
+; CHECK-LABEL: define void @jacobi2d()
+; CHECK: call void @__spd_initialize()
+; CHECK-NEXT: call void @__spd_set_emulator(void (float*, float*, float*, float*, i64*, i64)* @kernel0_emu)
+; CHECK: call float* @__spd_alloc_stream(i64 8192)
+; CHECK: call float* @__spd_alloc_stream(i64 8192)
+; CHECK: call void @__spd_pack_interleaved(float* %{{.*}}, i32 2, float** getelementptr {{.*}} @__spd_arrays{{.*}}, i32 1, i64 4096)
+; CHECK: call void @__spd_create_domain_2(float* %{{.*}}, i32 2, i64 1, i64 62, i64 64, i64 1, i64 62, i64 64)
+; CHECK: call void @__spd_pci_dma_to_FPGA(float* %{{.*}}, i64 8192)
+; CHECK: call void @__spd_run_kernel(i64 8192, i32 0)
+; CHECK: call void @__spd_pci_dma_from_FPGA(float* %{{.*}}, i64 8192, i32 0)
+; CHECK: call void @__spd_unpack_interleaved(float** getelementptr {{.*}} @__spd_arrays{{.*}}, i32 1, i64 4096, float* %{{.*}}, i32 2)
+; CHECK: call void @__spd_free_stream(
+; CHECK: call void @__spd_free_stream(
+; CHECK: call void @__spd_finalize()
+; CHECK-NOT: call void @jacobi2d_
+; CHECK: ret void
+;
+; CHECK: define internal void @kernel0_emu(float* %instream, float* %outstream,
+;
+; SPD: Name     kernel0;
+; SPD: Main_In  {Mi::A0, iattr, sop, eop};
+; SPD: Main_Out {Mo::B0, oattr, sop, eop};
+; SPD: DRCT     (oattr, Mo::sop, Mo::eop) = (iattr, Mi::sop, Mi::eop);
+;
+; The pack and unpack loops may be emitted inline as OpenMP loops, strided by
+; the constant stride of the stream.
+;
+; INL-LABEL: define void @jacobi2d()
+; INL-NOT: call void @__spd_pack
+; INL: call void @GOMP_parallel_loop_runtime_start(void (i8*)* @jacobi2d_polly_subfn, i8* %{{.*}}, i32 0, i64 0, i64 4096, i64 1)
+; INL: call void @__spd_create_domain_2(float* %{{.*}}, i32 2, i64 1, i64 62, i64 64, i64 1, i64 62, i64 64)
+; INL: call void @__spd_pci_dma_from_FPGA(float* %{{.*}}, i64 8192, i32 0)
+; INL-NOT: call void @__spd_unpack
+; INL: call void @GOMP_parallel_loop_runtime_start(void (i8*)* @jacobi2d_polly_subfn_1, i8* %{{.*}}, i32 0, i64 0, i64 4096, i64 1)
+; INL: call void @__spd_finalize()
+;
+; INL: define internal void @jacobi2d_polly_subfn(i8* %polly.par.userContext)
+; INL: mul i64 %polly.indvar, 2
+; INL: store float %{{.*}}, float* %{{.*}}
+;
+; Every slab carries one halo row on each side and runs on its own device.
+;
+; PART-LABEL: define void @jacobi2d()
+; PART: call void @__spd_pack_interleaved(float* %{{.*}}, i32 2, float** getelementptr {{.*}}, i32 1, i64 2112)
+; PART: call void @__spd_create_domain_2(float* %{{.*}}, i32 2, i64 1, i64 62, i64 64, i64 1, i64 31, i64 33)
+; PART: call void @__spd_pci_dma_to_FPGA_dev(float* %{{.*}}, i64 4224, i32 0)
+; PART: call void @__spd_pack_interleaved(float* %{{.*}}, i32 2, float** getelementptr {{.*}}, i32 1, i64 2112)
+; PART: call void @__spd_create_domain_2(float* %{{.*}}, i32 2, i64 1, i64 62, i64 64, i64 1, i64 31, i64 33)
+; PART: call void @__spd_pci_dma_to_FPGA_dev(float* %{{.*}}, i64 4224, i32 1)
+; PART: call void @__spd_run_kernel_dev(i64 4224, i32 0, i32 0)
+; PART: call void @__spd_run_kernel_dev(i64 4224, i32 0, i32 1)
+; PART: call void @__spd_pci_dma_from_FPGA_dev(float* %{{.*}}, i64 4224, i32 0, i32 0)
+; PART: call void @__spd_pci_dma_from_FPGA_dev(float* %{{.*}}, i64 4224, i32 0, i32 1)
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [64 x [64 x float]] zeroinitializer, align 16
+@B = common global [64 x [64 x float]] zeroinitializer, align 16
+
+define void @jacobi2d() {
+entry:
+  br label %for.i.preheader
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 1, %for.i.preheader ], [ %i.next, %for.i.latch ]
+  call void @__spd_loop(i64 0, i64 1, i64 1, i64 0)
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 1, %for.i ], [ %j.next, %for.j ]
+  %i.m1 = add nsw i64 %i, -1
+  %i.p1 = add nsw i64 %i, 1
+  %j.m1 = add nsw i64 %j, -1
+  %j.p1 = add nsw i64 %j, 1
+  %p.c = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j
+  %c = load float, float* %p.c, align 4
+  %p.n = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i.m1, i64 %j
+  %n = load float, float* %p.n, align 4
+  %p.s = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i.p1, i64 %j
+  %s = load float, float* %p.s, align 4
+  %p.w = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j.m1
+  %w = load float, float* %p.w, align 4
+  %p.e = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j.p1
+  %e = load float, float* %p.e, align 4
+  %add0 = fadd float %c, %n
+  %add1 = fadd float %add0, %s
+  %add2 = fadd float %add1, %w
+  %add3 = fadd float %add2, %e
+  %mul = fmul float %add3, 0x3FC99999A0000000
+  %p.b = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @B, i64 0, i64 %i, i64 %j
+  store float %mul, float* %p.b, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cond = icmp slt i64 %j.next, 63
+  br i1 %j.cond, label %for.j, label %for.i.latch
+
+for.i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 63
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
+
+declare void @__spd_loop(i64, i64, i64, i64)
@@ -0,0 +1,92 @@
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -S -o /dev/null
+; RUN: FileCheck %s -check-prefix=CHAIN < %t/chain0.spd
+;
+;    float A[64][64], B[64][64], C[64][64];
+;
+;    void west_sum_half(void) {
+;      for (long i = 1; i < 63; i++) {
+;        __spd_loop(0, 1, 2, 0);
+;        for (long j = 1; j < 63; j++)
+;          B[i][j] = A[i][j] + A[i][j - 1];
+;      }
+;      for (long i = 1; i < 63; i++) {
+;        __spd_loop(0, 1, 2, 0);
+;        for (long j = 1; j < 63; j++)
+;          C[i][j] = B[i][j] * 0.5f;
+;      }
+;    }
+;
+; The stages of the chain are the unrolled modules of the kernels.
+;
+; CHAIN: Name     chain0;
+; CHAIN: HDL      stage0, ###, (xxxs0_B0, xxxs0_attr, xxxs0_sop, xxxs0_eop) = UC2_kernel{{[01]}}(A0, iattr, Mi::sop, Mi::eop);
+; CHAIN: HDL      stage1, ###, (xxxs1_C0, oattr, Mo::sop, Mo::eop) = UC2_kernel{{[01]}}(xxxs0_B0, xxxs0_attr, xxxs0_sop, xxxs0_eop);
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [64 x [64 x float]] zeroinitializer, align 16
+@B = common global [64 x [64 x float]] zeroinitializer, align 16
+@C = common global [64 x [64 x float]] zeroinitializer, align 16
+
+define void @west_sum_half() {
+entry:
+  br label %for.i.preheader
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 1, %for.i.preheader ], [ %i.next, %for.i.latch ]
+  call void @__spd_loop(i64 0, i64 1, i64 2, i64 0)
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 1, %for.i ], [ %j.next, %for.j ]
+  %j.m1 = add nsw i64 %j, -1
+  %p.c = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j
+  %c = load float, float* %p.c, align 4
+  %p.w = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j.m1
+  %w = load float, float* %p.w, align 4
+  %add = fadd float %c, %w
+  %p.b = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @B, i64 0, i64 %i, i64 %j
+  store float %add, float* %p.b, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cond = icmp slt i64 %j.next, 63
+  br i1 %j.cond, label %for.j, label %for.i.latch
+
+for.i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 63
+  br i1 %i.cond, label %for.i, label %for.k.preheader
+
+for.k.preheader:
+  br label %for.k
+
+for.k:
+  %k = phi i64 [ 1, %for.k.preheader ], [ %k.next, %for.k.latch ]
+  call void @__spd_loop(i64 0, i64 1, i64 2, i64 0)
+  br label %for.l
+
+for.l:
+  %l = phi i64 [ 1, %for.k ], [ %l.next, %for.l ]
+  %p.bb = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @B, i64 0, i64 %k, i64 %l
+  %b = load float, float* %p.bb, align 4
+  %half = fmul float %b, 5.000000e-01
+  %p.cc = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @C, i64 0, i64 %k, i64 %l
+  store float %half, float* %p.cc, align 4
+  %l.next = add nuw nsw i64 %l, 1
+  %l.cond = icmp slt i64 %l.next, 63
+  br i1 %l.cond, label %for.l, label %for.k.latch
+
+for.k.latch:
+  %k.next = add nuw nsw i64 %k, 1
+  %k.cond = icmp slt i64 %k.next, 63
+  br i1 %k.cond, label %for.k, label %exit
+
+exit:
+  ret void
+}
+
+declare void @__spd_loop(i64, i64, i64, i64)
@@ -0,0 +1,169 @@
+; RUN: opt %loadPolly -polly-loop-ext \
+; RUN: -polly-spd-loops-file=%S/loop-directives-invalid.json -S < %s \
+; RUN: 2>&1 >/dev/null | FileCheck %s -check-prefix=ERR
+; RUN: opt %loadPolly -polly-loop-ext \
+; RUN: -polly-spd-loops-file=%S/loop-directives-invalid.json -S < %s \
+; RUN: 2>/dev/null | FileCheck %s
+;
+; Malformed directives are reported and their loops are not extracted.
+;
+; ERR: SPD loops file: a loop should be an object with string "function" and "header" names
+; ERR: SPD loops file: "region" should be an unsigned integer
+; ERR: SPD loops file: "vector_length" should be an unsigned integer
+; ERR: SPD loops file: "switch_inout" should be 0 or 1
+; ERR: SPD directive of loop for.i in marker_operand ignored: region number is not a constant integer
+; ERR: SPD directive of loop for.i in marker_switch ignored: switch in/out should be a boolean value
+; ERR: SPD directive of loop for.i in metadata_string ignored: spd.offload metadata is not a constant integer
+; ERR: SPD directive of loop for.i in metadata_values ignored: spd.offload metadata should have a single value
+; ERR: SPD directive of loop for.i in metadata_switch ignored: switch in/out should be a boolean value
+;
+; The markers are erased nevertheless.
+;
+; CHECK-NOT: call void @__spd_loop(
+; CHECK-NOT: polly_extracted_loop
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+define void @marker_operand(float* %A, i64 %n) {
+entry:
+  %cond = icmp ne float* %A, null
+  br i1 %cond, label %for.i.preheader, label %exit
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 0, %for.i.preheader ], [ %i.next, %for.i ]
+  call void @__spd_loop(i64 %n, i64 1, i64 1, i64 0)
+  %p = getelementptr inbounds float, float* %A, i64 %i
+  %v = load float, float* %p, align 4
+  %add = fadd float %v, 1.000000e+00
+  store float %add, float* %p, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 64
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
+
+define void @marker_switch(float* %A) {
+entry:
+  %cond = icmp ne float* %A, null
+  br i1 %cond, label %for.i.preheader, label %exit
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 0, %for.i.preheader ], [ %i.next, %for.i ]
+  call void @__spd_loop(i64 0, i64 1, i64 1, i64 2)
+  %p = getelementptr inbounds float, float* %A, i64 %i
+  %v = load float, float* %p, align 4
+  %add = fadd float %v, 1.000000e+00
+  store float %add, float* %p, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 64
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
+
+define void @metadata_string(float* %A) {
+entry:
+  %cond = icmp ne float* %A, null
+  br i1 %cond, label %for.i.preheader, label %exit
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 0, %for.i.preheader ], [ %i.next, %for.i ]
+  %p = getelementptr inbounds float, float* %A, i64 %i
+  %v = load float, float* %p, align 4
+  %add = fadd float %v, 1.000000e+00
+  store float %add, float* %p, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 64
+  br i1 %i.cond, label %for.i, label %exit, !llvm.loop !0
+
+exit:
+  ret void
+}
+
+define void @metadata_values(float* %A) {
+entry:
+  %cond = icmp ne float* %A, null
+  br i1 %cond, label %for.i.preheader, label %exit
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 0, %for.i.preheader ], [ %i.next, %for.i ]
+  %p = getelementptr inbounds float, float* %A, i64 %i
+  %v = load float, float* %p, align 4
+  %add = fadd float %v, 1.000000e+00
+  store float %add, float* %p, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 64
+  br i1 %i.cond, label %for.i, label %exit, !llvm.loop !2
+
+exit:
+  ret void
+}
+
+define void @metadata_switch(float* %A) {
+entry:
+  %cond = icmp ne float* %A, null
+  br i1 %cond, label %for.i.preheader, label %exit
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 0, %for.i.preheader ], [ %i.next, %for.i ]
+  %p = getelementptr inbounds float, float* %A, i64 %i
+  %v = load float, float* %p, align 4
+  %add = fadd float %v, 1.000000e+00
+  store float %add, float* %p, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 64
+  br i1 %i.cond, label %for.i, label %exit, !llvm.loop !4
+
+exit:
+  ret void
+}
+
+define void @file_loop(float* %A) {
+entry:
+  %cond = icmp ne float* %A, null
+  br i1 %cond, label %for.i.preheader, label %exit
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 0, %for.i.preheader ], [ %i.next, %for.i ]
+  %p = getelementptr inbounds float, float* %A, i64 %i
+  %v = load float, float* %p, align 4
+  %add = fadd float %v, 1.000000e+00
+  store float %add, float* %p, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 64
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
+
+declare void @__spd_loop(i64, i64, i64, i64)
+
+!0 = distinct !{!0, !1}
+!1 = !{!"spd.offload.region", !"zero"}
+!2 = distinct !{!2, !3}
+!3 = !{!"spd.offload.region", i64 0, i64 1}
+!4 = distinct !{!4, !5, !6}
+!5 = !{!"spd.offload.region", i64 0}
+!6 = !{!"spd.offload.switch_inout", i64 2}
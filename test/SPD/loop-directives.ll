@@ -0,0 +1,83 @@
+; RUN: opt %loadPolly -polly-loop-ext \
+; RUN: -polly-spd-loops-file=%S/loop-directives.json -S < %s | FileCheck %s
+;
+;    void metadata(float *A) {
+;      if (A) {
+;        #pragma spd offload region(3) vector_length(4) unroll_count(2)
+;        for (long i = 0; i < 64; i++)
+;          A[i] += 1;
+;      }
+;    }
+;
+;    void loops_file(float *A) {
+;      if (A) {
+;        for (long i = 0; i < 64; i++)
+;          A[i] += 1;
+;      }
+;    }
+;
+; The loop of @metadata carries the spd.offload metadata a pragma emits, the
+; loop of @loops_file is selected by the loops file. Both are extracted with
+; their directive.
+;
+; CHECK-LABEL: define void @metadata(
+; CHECK: call void @metadata_
+; CHECK-LABEL: define void @loops_file(
+; CHECK: call void @loops_file_
+;
+; CHECK: define internal void @metadata_{{.*}} !polly_extracted_loop ![[META:[0-9]+]]
+; CHECK: define internal void @loops_file_{{.*}} !polly_extracted_loop ![[FILE:[0-9]+]]
+;
+; CHECK: ![[META]] = !{{[{].*}}, i64 3, i64 4, i64 2, i64 0}
+; CHECK: ![[FILE]] = !{{[{].*}}, i64 1, i64 8, i64 1, i64 1}
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+define void @metadata(float* %A) {
+entry:
+  %cond = icmp ne float* %A, null
+  br i1 %cond, label %for.i.preheader, label %exit
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 0, %for.i.preheader ], [ %i.next, %for.i ]
+  %p = getelementptr inbounds float, float* %A, i64 %i
+  %v = load float, float* %p, align 4
+  %add = fadd float %v, 1.000000e+00
+  store float %add, float* %p, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 64
+  br i1 %i.cond, label %for.i, label %exit, !llvm.loop !0
+
+exit:
+  ret void
+}
+
+define void @loops_file(float* %A) {
+entry:
+  %cond = icmp ne float* %A, null
+  br i1 %cond, label %for.i.preheader, label %exit
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 0, %for.i.preheader ], [ %i.next, %for.i ]
+  %p = getelementptr inbounds float, float* %A, i64 %i
+  %v = load float, float* %p, align 4
+  %add = fadd float %v, 1.000000e+00
+  store float %add, float* %p, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 64
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
+
+!0 = distinct !{!0, !1, !2, !3}
+!1 = !{!"spd.offload.region", i64 3}
+!2 = !{!"spd.offload.vector_length", i64 4}
+!3 = !{!"spd.offload.unroll_count", i64 2}
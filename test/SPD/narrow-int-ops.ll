@@ -0,0 +1,74 @@
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -disable-output
+; RUN: FileCheck %s < %t/kernel0.spd
+;
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -polly-spd-narrow-int-ops=false -disable-output
+; RUN: FileCheck %s -check-prefix=WIDE < %t/kernel0.spd
+;
+;    unsigned A[64][64], B[64][64];
+;
+;    void high_halves(void) {
+;      for (long i = 1; i < 63; i++) {
+;        __spd_loop(0, 1, 1, 0);
+;        for (long j = 1; j < 63; j++)
+;          B[i][j] = A[i][j] / 65536 + A[i][j - 1] / 65536;
+;      }
+;    }
+;
+; The quotients fit into 16 bits and their sum into 17 bits. The dividers
+; keep the width of the loaded words, they compute with all their bits.
+;
+; CHECK: EQU {{.*}} ahi0 = A0 / 65536, <.pWidth(32)>;
+; CHECK: EQU {{.*}} whi0 = w0 / 65536, <.pWidth(32)>;
+; CHECK: EQU {{.*}} sum0 = ahi0 + whi0, <.pWidth(17)>;
+;
+; WIDE: EQU {{.*}} ahi0 = A0 / 65536, <.pWidth(32)>;
+; WIDE: EQU {{.*}} whi0 = w0 / 65536, <.pWidth(32)>;
+; WIDE: EQU {{.*}} sum0 = ahi0 + whi0, <.pWidth(32)>;
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [64 x [64 x i32]] zeroinitializer, align 16
+@B = common global [64 x [64 x i32]] zeroinitializer, align 16
+
+define void @high_halves() {
+entry:
+  br label %for.i.preheader
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 1, %for.i.preheader ], [ %i.next, %for.i.latch ]
+  call void @__spd_loop(i64 0, i64 1, i64 1, i64 0)
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 1, %for.i ], [ %j.next, %for.j ]
+  %j.m1 = add nsw i64 %j, -1
+  %p.a = getelementptr inbounds [64 x [64 x i32]], [64 x [64 x i32]]* @A, i64 0, i64 %i, i64 %j
+  %a = load i32, i32* %p.a, align 4
+  %p.w = getelementptr inbounds [64 x [64 x i32]], [64 x [64 x i32]]* @A, i64 0, i64 %i, i64 %j.m1
+  %w = load i32, i32* %p.w, align 4
+  %ahi = udiv i32 %a, 65536
+  %whi = udiv i32 %w, 65536
+  %sum = add i32 %ahi, %whi
+  %p.b = getelementptr inbounds [64 x [64 x i32]], [64 x [64 x i32]]* @B, i64 0, i64 %i, i64 %j
+  store i32 %sum, i32* %p.b, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cond = icmp slt i64 %j.next, 63
+  br i1 %j.cond, label %for.j, label %for.i.latch
+
+for.i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 63
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
+
+declare void @__spd_loop(i64, i64, i64, i64)
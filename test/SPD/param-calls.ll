@@ -0,0 +1,105 @@
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-host-codegen -polly-spd-host-ops=100 \
+; RUN: -polly-spd-cleanup -S | FileCheck %s
+; RUN: opt %loadPolly -polly-loop-ext -S < %s | FileCheck %s -check-prefix=EXT
+;
+;    float A[64][64], B[64][64];
+;
+;    void jacobi2d_steps(int n) {
+;      __spd_begin(0);
+;      for (int t = 0; t < n; t++)
+;        for (long i = 1; i < 63; i++) {
+;          __spd_loop(0, 1, 1, 0);
+;          for (long j = 1; j < 63; j++)
+;            B[i][j] = 0.2f * (A[i][j] + A[i - 1][j] + A[i + 1][j] +
+;                              A[i][j - 1] + A[i][j + 1]);
+;        }
+;      __spd_end(0);
+;    }
+;
+; The number of kernel calls is the trip count n of the int loop around the
+; call. It is widened to i64 and compared at the region begin with the number
+; of calls the transfers need to pay off.
+;
+; LoopExtraction counts the calls: 62 per step of the parametric loop, whose
+; trip count is expanded before the region begin.
+;
+; EXT-LABEL: define void @jacobi2d_steps(i32 %n)
+; EXT:       zext i32 %{{.*}} to i64
+; EXT:       call void @__spd_num_calls(i64 0, i64 62, i64 %{{.*}})
+; EXT-NEXT:  call void @__spd_begin(i64 0)
+;
+; CHECK-LABEL: define void @jacobi2d_steps(i32 %n)
+; CHECK: zext i32 %{{.*}} to i64
+; CHECK-NOT: call void @__spd_num_calls
+; CHECK: %spd.profitable = icmp uge i64 %{{.*}}, {{[0-9]+}}
+; CHECK: br i1 %spd.profitable
+; CHECK: call void @__spd_initialize()
+; CHECK: call void @__spd_run_kernel(i64 8192, i32 0)
+; CHECK: call void @__spd_finalize()
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [64 x [64 x float]] zeroinitializer, align 16
+@B = common global [64 x [64 x float]] zeroinitializer, align 16
+
+define void @jacobi2d_steps(i32 %n) {
+entry:
+  call void @__spd_begin(i64 0)
+  %t.guard = icmp sgt i32 %n, 0
+  br i1 %t.guard, label %for.t, label %exit
+
+for.t:
+  %t = phi i32 [ 0, %entry ], [ %t.next, %for.t.latch ]
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 1, %for.t ], [ %i.next, %for.i.latch ]
+  call void @__spd_loop(i64 0, i64 1, i64 1, i64 0)
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 1, %for.i ], [ %j.next, %for.j ]
+  %i.m1 = add nsw i64 %i, -1
+  %i.p1 = add nsw i64 %i, 1
+  %j.m1 = add nsw i64 %j, -1
+  %j.p1 = add nsw i64 %j, 1
+  %p.c = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j
+  %c = load float, float* %p.c, align 4
+  %p.n = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i.m1, i64 %j
+  %north = load float, float* %p.n, align 4
+  %p.s = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i.p1, i64 %j
+  %s = load float, float* %p.s, align 4
+  %p.w = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j.m1
+  %w = load float, float* %p.w, align 4
+  %p.e = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j.p1
+  %e = load float, float* %p.e, align 4
+  %add0 = fadd float %c, %north
+  %add1 = fadd float %add0, %s
+  %add2 = fadd float %add1, %w
+  %add3 = fadd float %add2, %e
+  %mul = fmul float %add3, 0x3FC99999A0000000
+  %p.b = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @B, i64 0, i64 %i, i64 %j
+  store float %mul, float* %p.b, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cond = icmp slt i64 %j.next, 63
+  br i1 %j.cond, label %for.j, label %for.i.latch
+
+for.i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 63
+  br i1 %i.cond, label %for.i, label %for.t.latch
+
+for.t.latch:
+  %t.next = add nsw i32 %t, 1
+  %t.cond = icmp slt i32 %t.next, %n
+  br i1 %t.cond, label %for.t, label %exit
+
+exit:
+  call void @__spd_end(i64 0)
+  ret void
+}
+
+declare void @__spd_begin(i64)
+declare void @__spd_end(i64)
+declare void @__spd_loop(i64, i64, i64, i64)
@@ -0,0 +1,76 @@
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -S | FileCheck %s
+; RUN: FileCheck %s -check-prefix=SPD < %t/kernel0.spd
+;
+;    float A[64][64], B[64][64], alpha;
+;
+;    void scale_shift(float s) {
+;      for (long i = 1; i < 63; i++) {
+;        __spd_loop(0, 1, 1, 0);
+;        for (long j = 1; j < 63; j++)
+;          B[i][j] = A[i][j] * s + alpha;
+;      }
+;    }
+;
+; The argument s and the scalar global alpha are registers of the kernel,
+; the host writes them by their index before every kernel run.
+;
+; CHECK-LABEL: define void @scale_shift(float %s)
+; CHECK: call void @__spd_initialize()
+; CHECK: call void @__spd_pci_dma_to_FPGA(float* %{{.*}}, i64 8192)
+; CHECK: call void @__spd_set_param(i32 0, float %s)
+; CHECK: %[[ALPHA:[0-9]+]] = load float, float* @alpha
+; CHECK: call void @__spd_set_param(i32 1, float %[[ALPHA]])
+; CHECK: call void @__spd_run_kernel(i64 8192, i32 0)
+; CHECK: call void @__spd_finalize()
+;
+; SPD: Name     kernel0;
+; SPD: Main_In  {Mi::A0, iattr, sop, eop};
+; SPD: Main_Out {Mo::B0, oattr, sop, eop};
+; SPD: Regs_In  {Ri::s, al};
+; SPD: EQU      equ0, mul0 = A0 * s;
+; SPD: EQU      equ1, add0 = mul0 + al;
+; SPD: EQU      equ2, B0 = mux(A0, add0, iattr[0]);
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [64 x [64 x float]] zeroinitializer, align 16
+@B = common global [64 x [64 x float]] zeroinitializer, align 16
+@alpha = common global float 0.000000e+00, align 4
+
+define void @scale_shift(float %s) {
+entry:
+  br label %for.i.preheader
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 1, %for.i.preheader ], [ %i.next, %for.i.latch ]
+  call void @__spd_loop(i64 0, i64 1, i64 1, i64 0)
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 1, %for.i ], [ %j.next, %for.j ]
+  %p.a = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j
+  %a = load float, float* %p.a, align 4
+  %al = load float, float* @alpha, align 4
+  %mul = fmul float %a, %s
+  %add = fadd float %mul, %al
+  %p.b = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @B, i64 0, i64 %i, i64 %j
+  store float %add, float* %p.b, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cond = icmp slt i64 %j.next, 63
+  br i1 %j.cond, label %for.j, label %for.i.latch
+
+for.i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 63
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
+
+declare void @__spd_loop(i64, i64, i64, i64)
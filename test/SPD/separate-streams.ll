@@ -0,0 +1,141 @@
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -S | FileCheck %s
+;
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -polly-spd-layout=separate -S \
+; RUN: | FileCheck %s -check-prefix=SEP
+; RUN: FileCheck %s -check-prefix=SPD < %t/kernel0.spd
+;
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -polly-spd-layout=separate -polly-spd-tile-width=32 \
+; RUN: -S 2>%t/err | FileCheck %s -check-prefix=SEP
+; RUN: FileCheck %s -check-prefix=TILE-ERR < %t/err
+;
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -polly-spd-layout=separate \
+; RUN: -polly-spd-compress-arrays=C -S | FileCheck %s -check-prefix=RLE
+; RUN: FileCheck %s -check-prefix=RLE-SPD < %t/RLE_kernel0.spd
+;
+;    float A[64][64], B[64][64], C[64][64], D[64][64];
+;
+;    void stencils(void) {
+;      for (long i = 1; i < 63; i++) {
+;        __spd_loop(0, 1, 1, 0);
+;        for (long j = 1; j < 63; j++) {
+;          B[i][j] = 0.5f * (A[i - 1][j] + A[i + 1][j]);
+;          D[i][j] = 0.5f * (C[i][j - 1] + C[i][j + 1]);
+;        }
+;      }
+;    }
+;
+; Two arrays of the same size are interleaved in one pass.
+;
+; CHECK-LABEL: define void @stencils()
+; CHECK: call float* @__spd_alloc_stream(i64 12288)
+; CHECK: call float* @__spd_alloc_stream(i64 12288)
+; CHECK: call void @__spd_pack_interleaved(float* %{{.*}}, i32 3, float** getelementptr {{.*}} @__spd_arrays{{.*}}, i32 2, i64 4096)
+; CHECK: call void @__spd_create_domain_2(float* %{{.*}}, i32 3, i64 1, i64 62, i64 64, i64 1, i64 62, i64 64)
+; CHECK: call void @__spd_pci_dma_to_FPGA(float* %{{.*}}, i64 12288)
+; CHECK: call void @__spd_run_kernel(i64 12288, i32 0)
+; CHECK: call void @__spd_unpack_interleaved(float** getelementptr {{.*}} @__spd_arrays{{.*}}, i32 2, i64 4096, float* %{{.*}}, i32 3)
+;
+; With separate streams the attr is a plane of the buffer and every array
+; goes through its own channel without being packed.
+;
+; SEP-LABEL: define void @stencils()
+; SEP-NOT: call void @__spd_pack
+; SEP: call void @__spd_create_domain_2(float* %{{.*}}, i32 1, i64 1, i64 62, i64 64, i64 1, i64 62, i64 64)
+; SEP: call void @__spd_pci_dma_channel_to_FPGA(float* bitcast ({{.*}} @A to float*), i64 4096, i32 0, i32 3)
+; SEP: call void @__spd_pci_dma_channel_to_FPGA(float* bitcast ({{.*}} @C to float*), i64 4096, i32 1, i32 3)
+; SEP: call void @__spd_pci_dma_channel_to_FPGA(float* %{{.*}}, i64 4096, i32 2, i32 3)
+; SEP: call void @__spd_run_kernel(i64 12288, i32 0)
+; SEP: call void @__spd_pci_dma_channel_from_FPGA(float* bitcast ({{.*}} @B to float*), i64 4096, i64 0, i32 0, i32 0)
+; SEP: call void @__spd_pci_dma_channel_from_FPGA(float* bitcast ({{.*}} @D to float*), i64 4096, i64 0, i32 1, i32 0)
+; SEP-NOT: call void @__spd_unpack
+; SEP: call void @__spd_finalize()
+;
+; The channels carry whole arrays, so a tile width is reported and the
+; streams are sent as without it.
+;
+; TILE-ERR: SPD kernel {{.*}}: the tile width 32 does not apply to the separate stream layout, the stream is not tiled
+;
+; SPD: Main_In  {Mi::A0, sop, eop};
+; SPD: Main_In1 {Mi1::C0};
+; SPD: Main_In2 {Mi2::iattr};
+; SPD: Main_Out {Mo::B0, sop, eop};
+; SPD: Main_Out1 {Mo1::D0};
+; SPD: Main_Out2 {Mo2::oattr};
+;
+; A compressed array is encoded by the runtime and expanded by the front-end
+; module of the kernel.
+;
+; RLE-LABEL: define void @stencils()
+; RLE: call void @__spd_pci_dma_channel_to_FPGA(float* bitcast ({{.*}} @A to float*), i64 4096, i32 0, i32 3)
+; RLE: call void @__spd_pci_dma_channel_rle_to_FPGA(float* bitcast ({{.*}} @C to float*), i64 4096, i32 1, i32 3)
+; RLE: call void @__spd_pci_dma_channel_to_FPGA(float* %{{.*}}, i64 4096, i32 2, i32 3)
+;
+; RLE-SPD: Name     RLE_kernel0;
+; RLE-SPD: Main_In  {Mi::A0, sop, eop};
+; RLE-SPD: Main_In1 {Mi1::C_run, C_len};
+; RLE-SPD: HDL      hdl0, 2, (C0)() = mRunLengthDecoder(C_run, C_len, Mi::eop[0])(), <.pVL(1)>;
+; RLE-SPD: HDL      top, ###, (B0, D0, oattr, Mo::sop, Mo::eop) = kernel0(A0, C0, iattr, Mi::sop, Mi::eop);
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [64 x [64 x float]] zeroinitializer, align 16
+@B = common global [64 x [64 x float]] zeroinitializer, align 16
+@C = common global [64 x [64 x float]] zeroinitializer, align 16
+@D = common global [64 x [64 x float]] zeroinitializer, align 16
+
+define void @stencils() {
+entry:
+  br label %for.i.preheader
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 1, %for.i.preheader ], [ %i.next, %for.i.latch ]
+  call void @__spd_loop(i64 0, i64 1, i64 1, i64 0)
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 1, %for.i ], [ %j.next, %for.j ]
+  %i.m1 = add nsw i64 %i, -1
+  %i.p1 = add nsw i64 %i, 1
+  %j.m1 = add nsw i64 %j, -1
+  %j.p1 = add nsw i64 %j, 1
+  %p.an = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i.m1, i64 %j
+  %an = load float, float* %p.an, align 4
+  %p.as = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i.p1, i64 %j
+  %as = load float, float* %p.as, align 4
+  %p.cw = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @C, i64 0, i64 %i, i64 %j.m1
+  %cw = load float, float* %p.cw, align 4
+  %p.ce = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @C, i64 0, i64 %i, i64 %j.p1
+  %ce = load float, float* %p.ce, align 4
+  %a.add = fadd float %an, %as
+  %a.mul = fmul float %a.add, 5.000000e-01
+  %p.b = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @B, i64 0, i64 %i, i64 %j
+  store float %a.mul, float* %p.b, align 4
+  %c.add = fadd float %cw, %ce
+  %c.mul = fmul float %c.add, 5.000000e-01
+  %p.d = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @D, i64 0, i64 %i, i64 %j
+  store float %c.mul, float* %p.d, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cond = icmp slt i64 %j.next, 63
+  br i1 %j.cond, label %for.j, label %for.i.latch
+
+for.i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 63
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
+
+declare void @__spd_loop(i64, i64, i64, i64)
@@ -0,0 +1,122 @@
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -S | FileCheck %s
+;
+; RUN: rm -rf %t && mkdir -p %t && cd %t && opt %loadPolly -polly-loop-ext \
+; RUN: < %s | opt %loadPolly -polly-process-unprofitable -polly-host-codegen \
+; RUN: -polly-spd-cleanup -polly-spd-num-partitions=2 -S \
+; RUN: | FileCheck %s -check-prefix=PART
+;
+;    float A[64][64], B[64][64];
+;
+;    void jacobi2d_steps(void) {
+;      __spd_begin(0);
+;      for (long t = 0; t < 16; t++)
+;        for (long i = 1; i < 63; i++) {
+;          __spd_loop(0, 1, 1, 1);
+;          for (long j = 1; j < 63; j++)
+;            B[i][j] = 0.2f * (A[i][j] + A[i - 1][j] + A[i + 1][j] +
+;                              A[i][j - 1] + A[i][j + 1]);
+;        }
+;      __spd_end(0);
+;    }
+;
+; With SwitchInOut every call continues from the output of the previous one.
+; A single device keeps its streams between the calls.
+;
+; CHECK-LABEL: define void @jacobi2d_steps()
+; CHECK: call void @__spd_pci_dma_to_FPGA(float* %{{.*}}, i64 8192)
+; CHECK: call void @__spd_run_kernel(i64 8192, i32 1)
+; CHECK-NOT: call void @llvm.memcpy
+; CHECK-NOT: call void @__spd_pci_dma_to_FPGA
+; CHECK: call void @__spd_pci_dma_from_FPGA(float* %{{.*}}, i64 8192, i32 1)
+; CHECK: call void @__spd_finalize()
+;
+; The halo row of each slab is computed by the device of the other slab. The
+; host reads the slabs back after every call, copies the rows of each input
+; stream from the output stream of the slab writing them back (128 words per
+; row), creates the attr words again and sends the slabs.
+;
+; PART-LABEL: define void @jacobi2d_steps()
+; PART: call void @__spd_pci_dma_to_FPGA_dev(float* %{{.*}}, i64 4224, i32 0)
+; PART: call void @__spd_pci_dma_to_FPGA_dev(float* %{{.*}}, i64 4224, i32 1)
+; PART: call void @__spd_run_kernel_dev(i64 4224, i32 1, i32 0)
+; PART: call void @__spd_run_kernel_dev(i64 4224, i32 1, i32 1)
+; PART: call void @__spd_pci_dma_from_FPGA_dev(float* %{{.*}}, i64 4224, i32 1, i32 0)
+; PART: call void @__spd_pci_dma_from_FPGA_dev(float* %{{.*}}, i64 4224, i32 1, i32 1)
+; PART: call void @llvm.memcpy.p0i8.p0i8.i64(i8* %{{.*}}, i8* %{{.*}}, i64 16384, i32 4, i1 false)
+; PART: call void @llvm.memcpy.p0i8.p0i8.i64(i8* %{{.*}}, i8* %{{.*}}, i64 512, i32 4, i1 false)
+; PART: call void @__spd_create_domain_2(float* %{{.*}}, i32 2, i64 1, i64 62, i64 64, i64 1, i64 31, i64 33)
+; PART: call void @__spd_pci_dma_to_FPGA_dev(float* %{{.*}}, i64 4224, i32 0)
+; PART: call void @llvm.memcpy.p0i8.p0i8.i64(i8* %{{.*}}, i8* %{{.*}}, i64 512, i32 4, i1 false)
+; PART: call void @llvm.memcpy.p0i8.p0i8.i64(i8* %{{.*}}, i8* %{{.*}}, i64 16384, i32 4, i1 false)
+; PART: call void @__spd_create_domain_2(float* %{{.*}}, i32 2, i64 1, i64 62, i64 64, i64 1, i64 31, i64 33)
+; PART: call void @__spd_pci_dma_to_FPGA_dev(float* %{{.*}}, i64 4224, i32 1)
+; PART: call void @__spd_pci_dma_from_FPGA_dev(float* %{{.*}}, i64 4224, i32 1, i32 0)
+; PART: call void @__spd_pci_dma_from_FPGA_dev(float* %{{.*}}, i64 4224, i32 1, i32 1)
+; PART: call void @__spd_finalize()
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [64 x [64 x float]] zeroinitializer, align 16
+@B = common global [64 x [64 x float]] zeroinitializer, align 16
+
+define void @jacobi2d_steps() {
+entry:
+  call void @__spd_begin(i64 0)
+  br label %for.t
+
+for.t:
+  %t = phi i64 [ 0, %entry ], [ %t.next, %for.t.latch ]
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 1, %for.t ], [ %i.next, %for.i.latch ]
+  call void @__spd_loop(i64 0, i64 1, i64 1, i64 1)
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 1, %for.i ], [ %j.next, %for.j ]
+  %i.m1 = add nsw i64 %i, -1
+  %i.p1 = add nsw i64 %i, 1
+  %j.m1 = add nsw i64 %j, -1
+  %j.p1 = add nsw i64 %j, 1
+  %p.c = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j
+  %c = load float, float* %p.c, align 4
+  %p.n = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i.m1, i64 %j
+  %n = load float, float* %p.n, align 4
+  %p.s = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i.p1, i64 %j
+  %s = load float, float* %p.s, align 4
+  %p.w = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j.m1
+  %w = load float, float* %p.w, align 4
+  %p.e = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j.p1
+  %e = load float, float* %p.e, align 4
+  %add0 = fadd float %c, %n
+  %add1 = fadd float %add0, %s
+  %add2 = fadd float %add1, %w
+  %add3 = fadd float %add2, %e
+  %mul = fmul float %add3, 0x3FC99999A0000000
+  %p.b = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @B, i64 0, i64 %i, i64 %j
+  store float %mul, float* %p.b, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cond = icmp slt i64 %j.next, 63
+  br i1 %j.cond, label %for.j, label %for.i.latch
+
+for.i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 63
+  br i1 %i.cond, label %for.i, label %for.t.latch
+
+for.t.latch:
+  %t.next = add nuw nsw i64 %t, 1
+  %t.cond = icmp slt i64 %t.next, 16
+  br i1 %t.cond, label %for.t, label %exit
+
+exit:
+  call void @__spd_end(i64 0)
+  ret void
+}
+
+declare void @__spd_begin(i64)
+declare void @__spd_end(i64)
+declare void @__spd_loop(i64, i64, i64, i64)
@@ -0,0 +1,86 @@
+; RUN: opt %loadPolly -polly-loop-ext < %s | opt %loadPolly \
+; RUN: -polly-process-unprofitable -polly-host-codegen -polly-spd-cleanup \
+; RUN: -polly-spd-tile-width=2 -S 2>&1 >/dev/null \
+; RUN: | FileCheck %s -check-prefix=ERR
+; RUN: opt %loadPolly -polly-loop-ext < %s | opt %loadPolly \
+; RUN: -polly-process-unprofitable -polly-host-codegen -polly-spd-cleanup \
+; RUN: -polly-spd-tile-width=2 -S 2>/dev/null | FileCheck %s
+;
+;    float A[64][64], B[64][64];
+;
+;    void jacobi2d(void) {
+;      for (long i = 1; i < 63; i++) {
+;        __spd_loop(0, 1, 1, 0);
+;        for (long j = 1; j < 63; j++)
+;          B[i][j] = 0.2f * (A[i][j] + A[i - 1][j] + A[i + 1][j] +
+;                            A[i][j - 1] + A[i][j + 1]);
+;      }
+;    }
+;
+; A tile of two columns would only hold the halo columns of both sides. The
+; tile width is reported and the rows are streamed whole.
+;
+; ERR: SPD kernel {{.*}}: the tile width 2 does not exceed the column halo 1 of both sides, the stream is not tiled
+;
+; CHECK-LABEL: define void @jacobi2d()
+; CHECK-NOT: call void @__spd_pack_2d(
+; CHECK: call void @__spd_pack_interleaved(float* %{{.*}}, i32 2, float** getelementptr {{.*}} @__spd_arrays{{.*}}, i32 1, i64 4096)
+; CHECK: call void @__spd_create_domain_2(float* %{{.*}}, i32 2, i64 1, i64 62, i64 64, i64 1, i64 62, i64 64)
+; CHECK: call void @__spd_run_kernel(i64 8192, i32 0)
+; CHECK-NOT: call void @__spd_unpack_2d(
+; CHECK: call void @__spd_unpack_interleaved(float** getelementptr {{.*}} @__spd_arrays{{.*}}, i32 1, i64 4096, float* %{{.*}}, i32 2)
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [64 x [64 x float]] zeroinitializer, align 16
+@B = common global [64 x [64 x float]] zeroinitializer, align 16
+
+define void @jacobi2d() {
+entry:
+  br label %for.i.preheader
+
+for.i.preheader:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 1, %for.i.preheader ], [ %i.next, %for.i.latch ]
+  call void @__spd_loop(i64 0, i64 1, i64 1, i64 0)
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 1, %for.i ], [ %j.next, %for.j ]
+  %i.m1 = add nsw i64 %i, -1
+  %i.p1 = add nsw i64 %i, 1
+  %j.m1 = add nsw i64 %j, -1
+  %j.p1 = add nsw i64 %j, 1
+  %p.c = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j
+  %c = load float, float* %p.c, align 4
+  %p.n = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i.m1, i64 %j
+  %n = load float, float* %p.n, align 4
+  %p.s = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i.p1, i64 %j
+  %s = load float, float* %p.s, align 4
+  %p.w = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j.m1
+  %w = load float, float* %p.w, align 4
+  %p.e = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @A, i64 0, i64 %i, i64 %j.p1
+  %e = load float, float* %p.e, align 4
+  %add0 = fadd float %c, %n
+  %add1 = fadd float %add0, %s
+  %add2 = fadd float %add1, %w
+  %add3 = fadd float %add2, %e
+  %mul = fmul float %add3, 0x3FC99999A0000000
+  %p.b = getelementptr inbounds [64 x [64 x float]], [64 x [64 x float]]* @B, i64 0, i64 %i, i64 %j
+  store float %mul, float* %p.b, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cond = icmp slt i64 %j.next, 63
+  br i1 %j.cond, label %for.j, label %for.i.latch
+
+for.i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cond = icmp slt i64 %i.next, 63
+  br i1 %i.cond, label %for.i, label %exit
+
+exit:
+  ret void
+}
+
+declare void @__spd_loop(i64, i64, i64, i64)
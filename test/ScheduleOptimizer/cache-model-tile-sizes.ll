@@ -0,0 +1,63 @@
+; RUN: opt %loadPolly -polly-opt-isl -analyze -polly-ast \
+; RUN: -polly-tile-sizes-from-cache-model -polly-target-cache-from-host=false \
+; RUN: -polly-target-1st-cache-level-size=32768 \
+; RUN: -polly-target-1st-cache-level-associativity=8 \
+; RUN: -polly-target-cache-line-size=64 < %s | FileCheck %s
+; RUN: opt %loadPolly -polly-opt-isl -analyze -polly-ast \
+; RUN: -polly-tile-sizes-from-cache-model -polly-target-cache-from-host=false \
+; RUN: -polly-tile-sizes=16,16 < %s | FileCheck %s -check-prefix=GIVEN
+
+; The tile sizes are the largest powers of two such that the tiles of A and
+; B fit into seven of the eight ways of the first cache level. A tile of
+; 32 x 64 iterations spans 64 rows of 32 floats of A and 32 rows of 64 floats
+; of B, which are 16 KiB in total.
+;
+; void transpose(float A[1024][1024], float B[1024][1024]) {
+;   for (long i = 0; i < 1024; i++)
+;     for (long j = 0; j < 1024; j++)
+;       B[i][j] = A[j][i];
+; }
+
+; CHECK: // 1st level tiling - Tiles
+; CHECK: for (int c0 = 0; c0 <= 31; c0 += 1)
+; CHECK:   for (int c1 = 0; c1 <= 15; c1 += 1)
+; CHECK:     // 1st level tiling - Points
+; CHECK:     for (int c2 = 0; c2 <= 31; c2 += 1)
+; CHECK:       for (int c3 = 0; c3 <= 63; c3 += 1)
+; CHECK:         Stmt_for_body3(32 * c0 + c2, 64 * c1 + c3);
+
+; GIVEN: for (int c0 = 0; c0 <= 63; c0 += 1)
+; GIVEN:   for (int c1 = 0; c1 <= 63; c1 += 1)
+; GIVEN:     // 1st level tiling - Points
+; GIVEN:     for (int c2 = 0; c2 <= 15; c2 += 1)
+; GIVEN:       for (int c3 = 0; c3 <= 15; c3 += 1)
+; GIVEN:         Stmt_for_body3(16 * c0 + c2, 16 * c1 + c3);
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+define void @transpose([1024 x float]* %A, [1024 x float]* %B) {
+entry:
+  br label %for.cond1.preheader
+
+for.cond1.preheader:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.inc ]
+  br label %for.body3
+
+for.body3:
+  %j = phi i64 [ 0, %for.cond1.preheader ], [ %j.next, %for.body3 ]
+  %arrayidx.A = getelementptr inbounds [1024 x float], [1024 x float]* %A, i64 %j, i64 %i
+  %val = load float, float* %arrayidx.A
+  %arrayidx.B = getelementptr inbounds [1024 x float], [1024 x float]* %B, i64 %i, i64 %j
+  store float %val, float* %arrayidx.B
+  %j.next = add nuw nsw i64 %j, 1
+  %exitcond = icmp ne i64 %j.next, 1024
+  br i1 %exitcond, label %for.body3, label %for.inc
+
+for.inc:
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond.i = icmp ne i64 %i.next, 1024
+  br i1 %exitcond.i, label %for.cond1.preheader, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,69 @@
+; RUN: opt %loadPolly -polly-opt-isl -analyze -polly-ast < %s \
+; RUN: | FileCheck %s -check-prefix=RECT
+; RUN: opt %loadPolly -polly-opt-isl -analyze -polly-diamond-tiling \
+; RUN: -polly-ast < %s | FileCheck %s
+; RUN: opt %loadPolly -polly-opt-isl -analyze -polly-diamond-tiling \
+; RUN: -polly-parallel -polly-ast < %s | FileCheck %s -check-prefix=PAR
+
+; The time loop and the spatial loop of the stencil are tiled with diamonds,
+; which are executed in parallel wavefronts.
+;
+; void diamond(float A[65][1024]) {
+;   for (long t = 0; t < 64; t++)
+;     for (long i = 1; i < 1023; i++)
+;       A[t + 1][i] = A[t][i - 1] + A[t][i] + A[t][i + 1];
+; }
+
+; RECT-NOT: Diamond tiling
+; RECT: // 1st level tiling - Tiles
+
+; CHECK-NOT: 1st level tiling
+; CHECK: // Diamond tiling - Tiles
+; CHECK: for (int c0 =
+; CHECK:   for (int c1 =
+; CHECK:     // Diamond tiling - Points
+; CHECK:     for (int c2 =
+; CHECK:       for (int c3 =
+; CHECK:         Stmt_for_body3(
+
+; PAR: // Diamond tiling - Tiles
+; PAR: for (int c0 =
+; PAR:   #pragma omp parallel for
+; PAR:   for (int c1 =
+; PAR:     // Diamond tiling - Points
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+define void @diamond([1024 x float]* %A) {
+entry:
+  br label %for.cond1.preheader
+
+for.cond1.preheader:
+  %t = phi i64 [ 0, %entry ], [ %t.next, %for.inc ]
+  %t.next = add nuw nsw i64 %t, 1
+  br label %for.body3
+
+for.body3:
+  %i = phi i64 [ 1, %for.cond1.preheader ], [ %i.next, %for.body3 ]
+  %i.prev = add nsw i64 %i, -1
+  %i.next = add nuw nsw i64 %i, 1
+  %arrayidx.l = getelementptr inbounds [1024 x float], [1024 x float]* %A, i64 %t, i64 %i.prev
+  %l = load float, float* %arrayidx.l
+  %arrayidx.c = getelementptr inbounds [1024 x float], [1024 x float]* %A, i64 %t, i64 %i
+  %c = load float, float* %arrayidx.c
+  %arrayidx.r = getelementptr inbounds [1024 x float], [1024 x float]* %A, i64 %t, i64 %i.next
+  %r = load float, float* %arrayidx.r
+  %add = fadd float %l, %c
+  %add2 = fadd float %add, %r
+  %arrayidx.w = getelementptr inbounds [1024 x float], [1024 x float]* %A, i64 %t.next, i64 %i
+  store float %add2, float* %arrayidx.w
+  %exitcond = icmp ne i64 %i.next, 1023
+  br i1 %exitcond, label %for.body3, label %for.inc
+
+for.inc:
+  %exitcond.t = icmp ne i64 %t.next, 64
+  br i1 %exitcond.t, label %for.cond1.preheader, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,89 @@
+; RUN: opt %loadPolly -polly-opt-isl -polly-pattern-matching-based-opts=true \
+; RUN: -polly-pattern-matching-based-tensor-contractions \
+; RUN: -debug < %s 2>&1 | FileCheck %s
+; RUN: opt %loadPolly -polly-opt-isl -polly-pattern-matching-based-opts=true \
+; RUN: -debug < %s 2>&1 | FileCheck %s --check-prefix=NO-CONTRACTIONS
+; RUN: opt %loadPolly -polly-opt-isl -polly-pattern-matching-based-opts=true \
+; RUN: -polly-pattern-matching-based-tensor-contractions \
+; RUN: -polly-target-throughput-vector-fma=1 \
+; RUN: -polly-target-latency-vector-fma=8 \
+; RUN: -polly-target-1st-cache-level-size=32768 \
+; RUN: -polly-target-vector-register-bitwidth=256 \
+; RUN: -polly-target-2nd-cache-level-size=262144 -polly-ast \
+; RUN: -analyze < %s | FileCheck %s --check-prefix=PATTERN-MATCHING-OPTS
+; REQUIRES: asserts
+;
+;    Check that a batched matrix multiplication is mapped onto the matrix
+;    multiplication kernel and the batch loop becomes an outer loop of the
+;    kernel, which refills the packed arrays in each of its iterations.
+;
+;    for (b = 0; b < 16; b++)
+;      for (i = 0; i < 64; i++)
+;        for (j = 0; j < 64; j++)
+;          for (k = 0; k < 64; k++)
+;            C[b][i][j] += A[b][i][k] * B[b][k][j];
+;
+; CHECK: The tensor contraction pattern was detected
+; CHECK: The matrix multiplication pattern was detected
+;
+; NO-CONTRACTIONS-NOT: The matrix multiplication pattern was detected
+;
+; PATTERN-MATCHING-OPTS: // 1st level tiling - Tiles
+; PATTERN-MATCHING-OPTS-NEXT: for (int c0 = 0; c0 <= 15; c0 += 1)
+; PATTERN-MATCHING-OPTS: CopyStmt_0(c0, 0,
+; PATTERN-MATCHING-OPTS: CopyStmt_1(c0,
+; PATTERN-MATCHING-OPTS: // Register tiling - Points
+; PATTERN-MATCHING-OPTS: Stmt_for_k(c0,
+;
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-unknown"
+
+define void @batched_gemm([64 x [64 x double]]* %C, [64 x [64 x double]]* %A, [64 x [64 x double]]* %B) {
+entry:
+  br label %for.b
+
+for.b:
+  %b = phi i64 [ 0, %entry ], [ %b.next, %for.b.inc ]
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 0, %for.b ], [ %i.next, %for.i.inc ]
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 0, %for.i ], [ %j.next, %for.j.inc ]
+  br label %for.k
+
+for.k:
+  %k = phi i64 [ 0, %for.j ], [ %k.next, %for.k ]
+  %arrayidx.A = getelementptr inbounds [64 x [64 x double]], [64 x [64 x double]]* %A, i64 %b, i64 %i, i64 %k
+  %a = load double, double* %arrayidx.A, align 8
+  %arrayidx.B = getelementptr inbounds [64 x [64 x double]], [64 x [64 x double]]* %B, i64 %b, i64 %k, i64 %j
+  %bv = load double, double* %arrayidx.B, align 8
+  %mul = fmul double %a, %bv
+  %arrayidx.C = getelementptr inbounds [64 x [64 x double]], [64 x [64 x double]]* %C, i64 %b, i64 %i, i64 %j
+  %c = load double, double* %arrayidx.C, align 8
+  %add = fadd double %c, %mul
+  store double %add, double* %arrayidx.C, align 8
+  %k.next = add nuw nsw i64 %k, 1
+  %exitcond.k = icmp ne i64 %k.next, 64
+  br i1 %exitcond.k, label %for.k, label %for.j.inc
+
+for.j.inc:
+  %j.next = add nuw nsw i64 %j, 1
+  %exitcond.j = icmp ne i64 %j.next, 64
+  br i1 %exitcond.j, label %for.j, label %for.i.inc
+
+for.i.inc:
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond.i = icmp ne i64 %i.next, 64
+  br i1 %exitcond.i, label %for.i, label %for.b.inc
+
+for.b.inc:
+  %b.next = add nuw nsw i64 %b, 1
+  %exitcond.b = icmp ne i64 %b.next, 16
+  br i1 %exitcond.b, label %for.b, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,432 @@
+/**************** SPDPackKernels.c - SPD stream interleaving ******************/
+/*                                                                            */
+/*                     The LLVM Compiler Infrastructure                       */
+/*                                                                            */
+/* This file is dual licensed under the MIT and the University of Illinois    */
+/* Open Source License. See LICENSE.TXT for details.                          */
+/*                                                                            */
+/******************************************************************************/
+/*                                                                            */
+/*  Packing is a strided scatter of every array into the stream, it is bound  */
+/*  by memory bandwidth. All arrays of a stream are moved in a single pass,   */
+/*  so each cache line of the stream is touched once, and the common strides  */
+/*  (1-4 arrays, with or without the attr word) use SIMD transposes.          */
+/*                                                                            */
+/*  A kernel handles a prefix of the elements and returns its length, the     */
+/*  scalar loop finishes the rest.                                            */
+/*                                                                            */
+/******************************************************************************/
+
+#include "SPDPackKernels.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SPD_X86 1
+#include <immintrin.h>
+#define SPD_TARGET(ISA) __attribute__((target(ISA)))
+#endif
+
+typedef int64_t (*PackKernel)(float *Stream, int32_t Stride,
+                              float *const *Arrays, int32_t NumArrays,
+                              int64_t Size);
+typedef int64_t (*UnpackKernel)(float *const *Arrays, int32_t NumArrays,
+                                int64_t Size, const float *Stream,
+                                int32_t Stride);
+
+enum { ISA_SCALAR, ISA_SSE, ISA_AVX2, ISA_AVX512 };
+static int HostISA = -1;
+
+static void packScalar(float *Stream, int32_t Stride, float *const *Arrays,
+                       int32_t NumArrays, int64_t Begin, int64_t End) {
+  for (int64_t i = Begin; i < End; i++) {
+    float *Elmt = &Stream[i * Stride];
+    for (int32_t k = 0; k < NumArrays; k++)
+      Elmt[k] = Arrays[k][i];
+    for (int32_t k = NumArrays; k < Stride; k++)
+      Elmt[k] = 0;
+  }
+}
+
+static void unpackScalar(float *const *Arrays, int32_t NumArrays,
+                         int64_t Begin, int64_t End, const float *Stream,
+                         int32_t Stride) {
+  for (int64_t i = Begin; i < End; i++) {
+    const float *Elmt = &Stream[i * Stride];
+    for (int32_t k = 0; k < NumArrays; k++)
+      Arrays[k][i] = Elmt[k];
+  }
+}
+
+#ifdef SPD_X86
+/* Missing arrays of a transpose read as 0. */
+SPD_TARGET("sse2")
+static __m128 loadRow128(float *const *Arrays, int32_t NumArrays, int32_t k,
+                         int64_t i) {
+  return (k < NumArrays) ? _mm_loadu_ps(&Arrays[k][i]) : _mm_setzero_ps();
+}
+
+SPD_TARGET("avx2")
+static __m256 loadRow256(float *const *Arrays, int32_t NumArrays, int32_t k,
+                         int64_t i) {
+  return (k < NumArrays) ? _mm256_loadu_ps(&Arrays[k][i])
+                         : _mm256_setzero_ps();
+}
+
+/*** SSE: 4x4 transposes ***/
+
+/* The kernels of a single stride are only selected for it, the words of
+ * consecutive elements follow each other at fixed offsets from Elmt. */
+
+SPD_TARGET("sse2")
+static int64_t packSSE2(float *Stream, int32_t Stride, float *const *Arrays,
+                        int32_t NumArrays, int64_t Size) {
+  int64_t i = 0;
+  for (; i + 4 <= Size; i += 4) {
+    __m128 A = loadRow128(Arrays, NumArrays, 0, i);
+    __m128 B = loadRow128(Arrays, NumArrays, 1, i);
+    float *Elmt = &Stream[i * Stride];
+    _mm_storeu_ps(Elmt, _mm_unpacklo_ps(A, B));
+    _mm_storeu_ps(Elmt + 4, _mm_unpackhi_ps(A, B));
+  }
+
+  return i;
+}
+
+/* Strides 3 to 5: every element is written with a 4-word store. With
+ * stride 3 the last word spills into the next element, which is written
+ * afterwards, so the kernel stops one element before the end. */
+SPD_TARGET("sse2")
+static int64_t packSSETranspose(float *Stream, int32_t Stride,
+                                float *const *Arrays, int32_t NumArrays,
+                                int64_t Size) {
+  int64_t Last = (Stride == 3) ? Size - 1 : Size;
+  int64_t i = 0;
+  for (; i + 4 <= Last; i += 4) {
+    __m128 R0 = loadRow128(Arrays, NumArrays, 0, i);
+    __m128 R1 = loadRow128(Arrays, NumArrays, 1, i);
+    __m128 R2 = loadRow128(Arrays, NumArrays, 2, i);
+    __m128 R3 = loadRow128(Arrays, NumArrays, 3, i);
+    _MM_TRANSPOSE4_PS(R0, R1, R2, R3);
+
+    float *Elmt = &Stream[i * Stride];
+    _mm_storeu_ps(Elmt, R0);
+    _mm_storeu_ps(Elmt + Stride, R1);
+    _mm_storeu_ps(Elmt + 2 * Stride, R2);
+    _mm_storeu_ps(Elmt + 3 * Stride, R3);
+    if (Stride == 5) {
+      for (int j = 0; j < 4; j++)
+        Elmt[j * 5 + 4] = 0;
+    }
+  }
+
+  return i;
+}
+
+SPD_TARGET("sse2")
+static int64_t unpackSSE2(float *const *Arrays, int32_t NumArrays,
+                          int64_t Size, const float *Stream, int32_t Stride) {
+  int64_t i = 0;
+  for (; i + 4 <= Size; i += 4) {
+    const float *Elmt = &Stream[i * Stride];
+    __m128 V0 = _mm_loadu_ps(Elmt);
+    __m128 V1 = _mm_loadu_ps(Elmt + 4);
+    _mm_storeu_ps(&Arrays[0][i],
+                  _mm_shuffle_ps(V0, V1, _MM_SHUFFLE(2, 0, 2, 0)));
+    if (NumArrays > 1)
+      _mm_storeu_ps(&Arrays[1][i],
+                    _mm_shuffle_ps(V0, V1, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+
+  return i;
+}
+
+/* Strides 3 to 5, with stride 3 the last load reads the first word of the
+ * next element. */
+SPD_TARGET("sse2")
+static int64_t unpackSSETranspose(float *const *Arrays, int32_t NumArrays,
+                                  int64_t Size, const float *Stream,
+                                  int32_t Stride) {
+  int64_t Last = (Stride == 3) ? Size - 1 : Size;
+  int64_t i = 0;
+  for (; i + 4 <= Last; i += 4) {
+    const float *Elmt = &Stream[i * Stride];
+    __m128 R0 = _mm_loadu_ps(Elmt);
+    __m128 R1 = _mm_loadu_ps(Elmt + Stride);
+    __m128 R2 = _mm_loadu_ps(Elmt + 2 * Stride);
+    __m128 R3 = _mm_loadu_ps(Elmt + 3 * Stride);
+    _MM_TRANSPOSE4_PS(R0, R1, R2, R3);
+
+    __m128 Rows[4] = {R0, R1, R2, R3};
+    for (int32_t k = 0; k < NumArrays; k++)
+      _mm_storeu_ps(&Arrays[k][i], Rows[k]);
+  }
+
+  return i;
+}
+
+/*** AVX2: in-lane transposes, gathers for the other strides ***/
+
+SPD_TARGET("avx2")
+static int64_t packAVX2Stride2(float *Stream, int32_t Stride,
+                               float *const *Arrays, int32_t NumArrays,
+                               int64_t Size) {
+  int64_t i = 0;
+  for (; i + 8 <= Size; i += 8) {
+    __m256 A = loadRow256(Arrays, NumArrays, 0, i);
+    __m256 B = loadRow256(Arrays, NumArrays, 1, i);
+    __m256 Lo = _mm256_unpacklo_ps(A, B);
+    __m256 Hi = _mm256_unpackhi_ps(A, B);
+    float *Elmt = &Stream[i * Stride];
+    _mm256_storeu_ps(Elmt, _mm256_permute2f128_ps(Lo, Hi, 0x20));
+    _mm256_storeu_ps(Elmt + 8, _mm256_permute2f128_ps(Lo, Hi, 0x31));
+  }
+
+  return i;
+}
+
+SPD_TARGET("avx2")
+static int64_t packAVX2Stride4(float *Stream, int32_t Stride,
+                               float *const *Arrays, int32_t NumArrays,
+                               int64_t Size) {
+  int64_t i = 0;
+  for (; i + 8 <= Size; i += 8) {
+    __m256 R0 = loadRow256(Arrays, NumArrays, 0, i);
+    __m256 R1 = loadRow256(Arrays, NumArrays, 1, i);
+    __m256 R2 = loadRow256(Arrays, NumArrays, 2, i);
+    __m256 R3 = loadRow256(Arrays, NumArrays, 3, i);
+    __m256 T0 = _mm256_unpacklo_ps(R0, R1);
+    __m256 T1 = _mm256_unpackhi_ps(R0, R1);
+    __m256 T2 = _mm256_unpacklo_ps(R2, R3);
+    __m256 T3 = _mm256_unpackhi_ps(R2, R3);
+    /* element j of each lane */
+    __m256 E0 = _mm256_shuffle_ps(T0, T2, 0x44);
+    __m256 E1 = _mm256_shuffle_ps(T0, T2, 0xEE);
+    __m256 E2 = _mm256_shuffle_ps(T1, T3, 0x44);
+    __m256 E3 = _mm256_shuffle_ps(T1, T3, 0xEE);
+
+    float *Elmt = &Stream[i * Stride];
+    _mm256_storeu_ps(Elmt, _mm256_permute2f128_ps(E0, E1, 0x20));
+    _mm256_storeu_ps(Elmt + 8, _mm256_permute2f128_ps(E2, E3, 0x20));
+    _mm256_storeu_ps(Elmt + 16, _mm256_permute2f128_ps(E0, E1, 0x31));
+    _mm256_storeu_ps(Elmt + 24, _mm256_permute2f128_ps(E2, E3, 0x31));
+  }
+
+  return i;
+}
+
+SPD_TARGET("avx2")
+static int64_t unpackAVX2Stride2(float *const *Arrays, int32_t NumArrays,
+                                 int64_t Size, const float *Stream,
+                                 int32_t Stride) {
+  int64_t i = 0;
+  for (; i + 8 <= Size; i += 8) {
+    const float *Elmt = &Stream[i * Stride];
+    __m256 V0 = _mm256_loadu_ps(Elmt);
+    __m256 V1 = _mm256_loadu_ps(Elmt + 8);
+    __m256 U0 = _mm256_permute2f128_ps(V0, V1, 0x20);
+    __m256 U1 = _mm256_permute2f128_ps(V0, V1, 0x31);
+    _mm256_storeu_ps(&Arrays[0][i],
+                     _mm256_shuffle_ps(U0, U1, _MM_SHUFFLE(2, 0, 2, 0)));
+    if (NumArrays > 1)
+      _mm256_storeu_ps(&Arrays[1][i],
+                       _mm256_shuffle_ps(U0, U1, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+
+  return i;
+}
+
+SPD_TARGET("avx2")
+static int64_t unpackAVX2Stride4(float *const *Arrays, int32_t NumArrays,
+                                 int64_t Size, const float *Stream,
+                                 int32_t Stride) {
+  int64_t i = 0;
+  for (; i + 8 <= Size; i += 8) {
+    const float *Elmt = &Stream[i * Stride];
+    __m256 P0 = _mm256_loadu_ps(Elmt);
+    __m256 P1 = _mm256_loadu_ps(Elmt + 8);
+    __m256 P2 = _mm256_loadu_ps(Elmt + 16);
+    __m256 P3 = _mm256_loadu_ps(Elmt + 24);
+    /* elements (j, j + 4) in the two lanes */
+    __m256 U0 = _mm256_permute2f128_ps(P0, P2, 0x20);
+    __m256 U1 = _mm256_permute2f128_ps(P0, P2, 0x31);
+    __m256 U2 = _mm256_permute2f128_ps(P1, P3, 0x20);
+    __m256 U3 = _mm256_permute2f128_ps(P1, P3, 0x31);
+    __m256 T0 = _mm256_unpacklo_ps(U0, U1);
+    __m256 T1 = _mm256_unpackhi_ps(U0, U1);
+    __m256 T2 = _mm256_unpacklo_ps(U2, U3);
+    __m256 T3 = _mm256_unpackhi_ps(U2, U3);
+
+    __m256 Rows[4] = {_mm256_shuffle_ps(T0, T2, 0x44),
+                      _mm256_shuffle_ps(T0, T2, 0xEE),
+                      _mm256_shuffle_ps(T1, T3, 0x44),
+                      _mm256_shuffle_ps(T1, T3, 0xEE)};
+    for (int32_t k = 0; k < NumArrays; k++)
+      _mm256_storeu_ps(&Arrays[k][i], Rows[k]);
+  }
+
+  return i;
+}
+
+SPD_TARGET("avx2")
+static int64_t unpackAVX2Gather(float *const *Arrays, int32_t NumArrays,
+                                int64_t Size, const float *Stream,
+                                int32_t Stride) {
+  __m256i Index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                     _mm256_set1_epi32(Stride));
+  int64_t i = 0;
+  for (; i + 8 <= Size; i += 8) {
+    const float *Elmt = &Stream[i * Stride];
+    for (int32_t k = 0; k < NumArrays; k++)
+      _mm256_storeu_ps(&Arrays[k][i],
+                       _mm256_i32gather_ps(Elmt + k, Index, 4));
+  }
+
+  return i;
+}
+
+/*** AVX-512: scatter/gather for the strides without a transpose ***/
+
+SPD_TARGET("avx512f")
+static int64_t packAVX512Scatter(float *Stream, int32_t Stride,
+                                 float *const *Arrays, int32_t NumArrays,
+                                 int64_t Size) {
+  __m512i Index = _mm512_mullo_epi32(
+      _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+      _mm512_set1_epi32(Stride));
+  int64_t i = 0;
+  for (; i + 16 <= Size; i += 16) {
+    float *Elmt = &Stream[i * Stride];
+    for (int32_t k = 0; k < Stride; k++) {
+      __m512 V = (k < NumArrays) ? _mm512_loadu_ps(&Arrays[k][i])
+                                 : _mm512_setzero_ps();
+      _mm512_i32scatter_ps(Elmt + k, Index, V, 4);
+    }
+  }
+
+  return i;
+}
+
+SPD_TARGET("avx512f")
+static int64_t unpackAVX512Gather(float *const *Arrays, int32_t NumArrays,
+                                  int64_t Size, const float *Stream,
+                                  int32_t Stride) {
+  __m512i Index = _mm512_mullo_epi32(
+      _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+      _mm512_set1_epi32(Stride));
+  int64_t i = 0;
+  for (; i + 16 <= Size; i += 16) {
+    const float *Elmt = &Stream[i * Stride];
+    for (int32_t k = 0; k < NumArrays; k++)
+      _mm512_storeu_ps(&Arrays[k][i],
+                       _mm512_i32gather_ps(Index, Elmt + k, 4));
+  }
+
+  return i;
+}
+#endif /* SPD_X86 */
+
+void initPackKernels(void) {
+  HostISA = ISA_SCALAR;
+#ifdef SPD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    HostISA = ISA_AVX512;
+  else if (__builtin_cpu_supports("avx2"))
+    HostISA = ISA_AVX2;
+  else if (__builtin_cpu_supports("sse2"))
+    HostISA = ISA_SSE;
+#endif
+
+  /* SPD_SIMD caps the instruction set, mainly for testing */
+  const char *Env = getenv("SPD_SIMD");
+  int Cap = ISA_AVX512;
+  if (Env && (strcmp(Env, "0") == 0 || strcmp(Env, "scalar") == 0))
+    Cap = ISA_SCALAR;
+  else if (Env && strcmp(Env, "sse") == 0)
+    Cap = ISA_SSE;
+  else if (Env && strcmp(Env, "avx2") == 0)
+    Cap = ISA_AVX2;
+
+  if (HostISA > Cap)
+    HostISA = Cap;
+}
+
+/* Transposes are preferred over scatter/gather, which are only used for the
+ * strides without a transpose. */
+static PackKernel selectPackKernel(int32_t Stride, int32_t NumArrays) {
+  if (HostISA < 0)
+    initPackKernels();
+
+#ifdef SPD_X86
+  int ISA = HostISA;
+  if (Stride == 2 && ISA >= ISA_AVX2)
+    return packAVX2Stride2;
+  if (Stride == 4 && ISA >= ISA_AVX2)
+    return packAVX2Stride4;
+  if (Stride > 5 && ISA >= ISA_AVX512)
+    return packAVX512Scatter;
+  if (Stride == 2 && ISA >= ISA_SSE)
+    return packSSE2;
+  if ((Stride == 3 || Stride == 5) && ISA >= ISA_AVX512)
+    return packAVX512Scatter;
+  if (Stride >= 3 && Stride <= 5 && NumArrays <= 4 && ISA >= ISA_SSE)
+    return packSSETranspose;
+#endif
+
+  return NULL;
+}
+
+static UnpackKernel selectUnpackKernel(int32_t Stride, int32_t NumArrays) {
+  if (HostISA < 0)
+    initPackKernels();
+
+#ifdef SPD_X86
+  int ISA = HostISA;
+  if (Stride == 2 && ISA >= ISA_AVX2)
+    return unpackAVX2Stride2;
+  if (Stride == 4 && ISA >= ISA_AVX2)
+    return unpackAVX2Stride4;
+  if (Stride > 1 && ISA >= ISA_AVX512)
+    return unpackAVX512Gather;
+  if (Stride > 1 && ISA >= ISA_AVX2)
+    return unpackAVX2Gather;
+  if (Stride == 2 && ISA >= ISA_SSE)
+    return unpackSSE2;
+  if (Stride >= 3 && Stride <= 5 && NumArrays <= 4 && ISA >= ISA_SSE)
+    return unpackSSETranspose;
+#endif
+
+  return NULL;
+}
+
+void packInterleaved(float *Stream, int32_t Stride, float *const *Arrays,
+                     int32_t NumArrays, int64_t Size) {
+  if (Stride == 1 && NumArrays == 1) {
+    memcpy(Stream, Arrays[0], Size * sizeof(float));
+    return;
+  }
+
+  int64_t Done = 0;
+  PackKernel Kernel = selectPackKernel(Stride, NumArrays);
+  if (Kernel)
+    Done = Kernel(Stream, Stride, Arrays, NumArrays, Size);
+
+  packScalar(Stream, Stride, Arrays, NumArrays, Done, Size);
+}
+
+void unpackInterleaved(float *const *Arrays, int32_t NumArrays, int64_t Size,
+                       const float *Stream, int32_t Stride) {
+  if (Stride == 1 && NumArrays == 1) {
+    memcpy(Arrays[0], Stream, Size * sizeof(float));
+    return;
+  }
+
+  int64_t Done = 0;
+  UnpackKernel Kernel = selectUnpackKernel(Stride, NumArrays);
+  if (Kernel)
+    Done = Kernel(Arrays, NumArrays, Size, Stream, Stride);
+
+  unpackScalar(Arrays, NumArrays, Done, Size, Stream, Stride);
+}
@@ -0,0 +1,33 @@
+/******************************************************************************/
+/*                                                                            */
+/*                     The LLVM Compiler Infrastructure                       */
+/*                                                                            */
+/* This file is dual licensed under the MIT and the University of Illinois    */
+/* Open Source License. See LICENSE.TXT for details.                          */
+/*                                                                            */
+/******************************************************************************/
+/*                                                                            */
+/*  Interleave/deinterleave kernels used by the SPD runtime to pack arrays    */
+/*  into streams and to unpack them.                                          */
+/*                                                                            */
+/******************************************************************************/
+
+#ifndef SPDPACKKERNELS_H_
+#define SPDPACKKERNELS_H_
+
+#include <stdint.h>
+
+/* Selects the kernels for the host CPU. SPD_SIMD=scalar|sse|avx2 limits the
+ * instruction set used. */
+void initPackKernels(void);
+
+/* Stream[i * Stride + k] = Arrays[k][i] for k < NumArrays and i < Size, the
+ * words k >= NumArrays of every element are set to 0. */
+void packInterleaved(float *Stream, int32_t Stride, float *const *Arrays,
+                     int32_t NumArrays, int64_t Size);
+
+/* Arrays[k][i] = Stream[i * Stride + k] for k < NumArrays and i < Size. */
+void unpackInterleaved(float *const *Arrays, int32_t NumArrays, int64_t Size,
+                       const float *Stream, int32_t Stride);
+
+#endif /* SPDPACKKERNELS_H_ */
@@ -0,0 +1,581 @@
+/******************** SPDRuntime.c - SPD Runtime (CPU backend) ****************/
+/*                                                                            */
+/*                     The LLVM Compiler Infrastructure                       */
+/*                                                                            */
+/* This file is dual licensed under the MIT and the University of Illinois    */
+/* Open Source License. See LICENSE.TXT for details.                          */
+/*                                                                            */
+/******************************************************************************/
+/*                                                                            */
+/*  This file implements the SPD runtime on the host CPU. Each device is      */
+/*  emulated by a thread running the kernel emulator generated by Polly.      */
+/*                                                                            */
+/******************************************************************************/
+
+#include "SPDRuntime.h"
+#include "SPDPackKernels.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SPD_MAX_DEVICES 64
+#define SPD_MAX_PARAMS 256
+#define SPD_MAX_DIMS 4
+
+static int DebugMode;
+
+static void debug_print(const char *format, ...) {
+  if (!DebugMode)
+    return;
+
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+}
+#define dump_function() debug_print("-> %s\n", __func__)
+
+/* SPD_PROFILE=1 accumulates the time spent in every phase of the host code
+ * and prints it at exit, one "SPD profile: <phase> <calls> <seconds>" line
+ * per phase. The kernel phase is the time the devices compute. */
+enum {
+  SPD_PHASE_PACK,
+  SPD_PHASE_DOMAIN,
+  SPD_PHASE_DMA_IN,
+  SPD_PHASE_KERNEL,
+  SPD_PHASE_DMA_OUT,
+  SPD_PHASE_UNPACK,
+  SPD_NUM_PHASES
+};
+
+static const char *PhaseNames[SPD_NUM_PHASES] = {
+  "pack", "domain", "dma_in", "kernel", "dma_out", "unpack"
+};
+
+static int ProfileMode;
+static pthread_mutex_t ProfileLock = PTHREAD_MUTEX_INITIALIZER;
+static double PhaseTime[SPD_NUM_PHASES];
+static int64_t PhaseCalls[SPD_NUM_PHASES];
+
+static double getTime(void) {
+  struct timespec TS;
+  clock_gettime(CLOCK_MONOTONIC, &TS);
+  return TS.tv_sec + TS.tv_nsec * 1e-9;
+}
+
+static double profileStart(void) { return ProfileMode ? getTime() : 0; }
+
+static void profileEnd(int Phase, double Start) {
+  if (!ProfileMode)
+    return;
+
+  double Time = getTime() - Start;
+  pthread_mutex_lock(&ProfileLock);
+  PhaseTime[Phase] += Time;
+  PhaseCalls[Phase]++;
+  pthread_mutex_unlock(&ProfileLock);
+}
+
+/* words of the run-length encoded channels before and after encoding */
+static int64_t RLERawWords;
+static int64_t RLESentWords;
+
+static void printProfile(void) {
+  for (int i = 0; i < SPD_NUM_PHASES; i++)
+    fprintf(stderr, "SPD profile: %s %lld %.9f\n", PhaseNames[i],
+            (long long)PhaseCalls[i], PhaseTime[i]);
+  if (RLERawWords)
+    fprintf(stderr, "SPD profile: rle_words %lld %lld\n",
+            (long long)RLERawWords, (long long)RLESentWords);
+}
+
+static void err_runtime(const char *Msg) __attribute__((noreturn));
+static void err_runtime(const char *Msg) {
+  fprintf(stderr, "SPD runtime: %s\n", Msg);
+  exit(-1);
+}
+
+typedef struct SPDDeviceT {
+  float *InBuffer;
+  float *OutBuffer;
+  float *BcastBuffer;
+  float *RLEBuffer;
+  int64_t InCapacity;
+  int64_t OutCapacity;
+  int64_t RLECapacity;
+  int64_t BcastSize;
+  int64_t InSize;
+  int64_t OutSize;
+  int64_t ChannelSize;
+  float Params[SPD_MAX_PARAMS];
+  int64_t Domain[3 * SPD_MAX_DIMS];
+  pthread_t Thread;
+  int Running;
+  /* the output buffer holds the result of a run */
+  int HasOutput;
+  /* the input buffer was written since the last run */
+  int HasNewInput;
+  /* SwitchInOut of the last run, its output is read with the same ports */
+  int32_t SwitchInOut;
+} SPDDevice;
+
+static SPDDevice Devices[SPD_MAX_DEVICES];
+static SPDEmulatorFn Emulator;
+
+static SPDDevice *getDevice(int32_t Dev) {
+  if (Dev < 0)
+    err_runtime("invalid device number");
+
+  return &Devices[Dev % SPD_MAX_DEVICES];
+}
+
+static void resizeBuffer(float **Buffer, int64_t *Capacity, int64_t Size) {
+  if (*Capacity >= Size)
+    return;
+
+  free(*Buffer);
+  *Buffer = (float *)malloc(Size * sizeof(float));
+  if (!*Buffer)
+    err_runtime("cannot allocate device memory");
+
+  *Capacity = Size;
+}
+
+/* The emulator walks the input stream, the output stream of a chain may be
+ * wider than it. */
+static void *runEmulator(void *Arg) {
+  SPDDevice *D = (SPDDevice *)Arg;
+  double Start = profileStart();
+  Emulator(D->InBuffer, D->OutBuffer, D->BcastBuffer, D->Params, D->Domain,
+           D->InSize);
+  profileEnd(SPD_PHASE_KERNEL, Start);
+  return NULL;
+}
+
+static void waitDevice(SPDDevice *D) {
+  if (!D->Running)
+    return;
+
+  pthread_join(D->Thread, NULL);
+  D->Running = 0;
+}
+
+void __spd_initialize(void) {
+  DebugMode = getenv("SPD_DEBUG") != 0;
+  dump_function();
+  initPackKernels();
+
+  if (!ProfileMode && getenv("SPD_PROFILE") != 0) {
+    ProfileMode = 1;
+    atexit(printProfile);
+  }
+}
+
+void __spd_finalize(void) {
+  dump_function();
+
+  for (int i = 0; i < SPD_MAX_DEVICES; i++) {
+    waitDevice(&Devices[i]);
+    free(Devices[i].InBuffer);
+    free(Devices[i].OutBuffer);
+    free(Devices[i].BcastBuffer);
+    free(Devices[i].RLEBuffer);
+    memset(&Devices[i], 0, sizeof(SPDDevice));
+  }
+}
+
+void __spd_set_emulator(SPDEmulatorFn Fn) {
+  dump_function();
+  Emulator = Fn;
+}
+
+float *__spd_alloc_stream(int64_t Size) {
+  dump_function();
+
+  float *Stream = (float *)calloc(Size, sizeof(float));
+  if (!Stream)
+    err_runtime("cannot allocate a stream");
+
+  return Stream;
+}
+
+void __spd_free_stream(float *Stream) {
+  dump_function();
+  free(Stream);
+}
+
+void __spd_pack_contiguous(float *Stream, int32_t Offset, int32_t Stride,
+                           float *Array, int64_t Size) {
+  dump_function();
+
+  double Start = profileStart();
+  if (Stride == 1)
+    memcpy(&Stream[Offset], Array, Size * sizeof(float));
+  else
+    for (int64_t i = 0; i < Size; i++)
+      Stream[i * Stride + Offset] = Array[i];
+  profileEnd(SPD_PHASE_PACK, Start);
+}
+
+void __spd_unpack_contiguous(float *Array, int64_t Size, float *Stream,
+                             int32_t Offset, int32_t Stride) {
+  dump_function();
+
+  double Start = profileStart();
+  if (Stride == 1)
+    memcpy(Array, &Stream[Offset], Size * sizeof(float));
+  else
+    for (int64_t i = 0; i < Size; i++)
+      Array[i] = Stream[i * Stride + Offset];
+  profileEnd(SPD_PHASE_UNPACK, Start);
+}
+
+void __spd_pack_2d(float *Stream, int32_t Offset, int32_t Stride,
+                   int64_t StreamRowSize, float *Array, int64_t RowSize,
+                   int64_t NumRows, int64_t ColBegin) {
+  dump_function();
+
+  double Start = profileStart();
+  for (int64_t j = 0; j < NumRows; j++) {
+    for (int64_t i = 0; i < StreamRowSize; i++) {
+      int64_t Col = ColBegin + i;
+      float Value = (0 <= Col && Col < RowSize) ? Array[j * RowSize + Col] : 0;
+      Stream[(j * StreamRowSize + i) * Stride + Offset] = Value;
+    }
+  }
+  profileEnd(SPD_PHASE_PACK, Start);
+}
+
+void __spd_unpack_2d(float *Array, int64_t RowSize, int64_t NumRows,
+                     int64_t NumCols, float *Stream, int32_t Offset,
+                     int32_t Stride, int64_t StreamRowSize) {
+  dump_function();
+
+  double Start = profileStart();
+  for (int64_t j = 0; j < NumRows; j++) {
+    float *Row = &Stream[j * StreamRowSize * Stride + Offset];
+    for (int64_t i = 0; i < NumCols; i++)
+      Array[j * RowSize + i] = Row[i * Stride];
+  }
+  profileEnd(SPD_PHASE_UNPACK, Start);
+}
+
+void __spd_pack_interleaved(float *Stream, int32_t Stride, float **Arrays,
+                            int32_t NumArrays, int64_t Size) {
+  dump_function();
+
+  if (NumArrays > Stride)
+    err_runtime("more arrays than words per stream element");
+
+  double Start = profileStart();
+  packInterleaved(Stream, Stride, Arrays, NumArrays, Size);
+  profileEnd(SPD_PHASE_PACK, Start);
+}
+
+void __spd_unpack_interleaved(float **Arrays, int32_t NumArrays, int64_t Size,
+                              float *Stream, int32_t Stride) {
+  dump_function();
+
+  if (NumArrays > Stride)
+    err_runtime("more arrays than words per stream element");
+
+  double Start = profileStart();
+  unpackInterleaved(Arrays, NumArrays, Size, Stream, Stride);
+  profileEnd(SPD_PHASE_UNPACK, Start);
+}
+
+void __spd_create_domain_2(float *Stream, int32_t Stride, int64_t Start0,
+                           int64_t End0, int64_t Size0, int64_t Start1,
+                           int64_t End1, int64_t Size1) {
+  dump_function();
+
+  double Start = profileStart();
+  for (int64_t j = 0; j < Size1; j++) {
+    for (int64_t i = 0; i < Size0; i++) {
+      uint32_t Attr = (Start0 <= i && i <= End0 && Start1 <= j && j <= End1);
+      memcpy(&Stream[(j * Size0 + i) * Stride + Stride - 1], &Attr,
+             sizeof(float));
+    }
+  }
+  profileEnd(SPD_PHASE_DOMAIN, Start);
+}
+
+void __spd_set_domain_2_dev(int64_t Start0, int64_t End0, int64_t Size0,
+                            int64_t Start1, int64_t End1, int64_t Size1,
+                            int32_t Dev) {
+  dump_function();
+
+  SPDDevice *D = getDevice(Dev);
+  waitDevice(D);
+  int64_t Domain[6] = {Start0, End0, Size0, Start1, End1, Size1};
+  memcpy(D->Domain, Domain, sizeof(Domain));
+}
+
+void __spd_pci_dma_to_FPGA_dev(float *Stream, int64_t Size, int32_t Dev) {
+  dump_function();
+
+  SPDDevice *D = getDevice(Dev);
+  waitDevice(D);
+  double Start = profileStart();
+  resizeBuffer(&D->InBuffer, &D->InCapacity, Size);
+  memcpy(D->InBuffer, Stream, Size * sizeof(float));
+  D->InSize = Size;
+  D->HasNewInput = 1;
+  profileEnd(SPD_PHASE_DMA_IN, Start);
+}
+
+void __spd_pci_dma_bcast_to_FPGA_dev(float *Stream, int64_t Size,
+                                     int32_t Dev) {
+  dump_function();
+
+  SPDDevice *D = getDevice(Dev);
+  waitDevice(D);
+  double Start = profileStart();
+  if (D->BcastSize < Size) {
+    free(D->BcastBuffer);
+    D->BcastBuffer = (float *)malloc(Size * sizeof(float));
+    if (!D->BcastBuffer)
+      err_runtime("cannot allocate device memory");
+
+    D->BcastSize = Size;
+  }
+
+  memcpy(D->BcastBuffer, Stream, Size * sizeof(float));
+  profileEnd(SPD_PHASE_DMA_IN, Start);
+}
+
+void __spd_set_param_dev(int32_t Idx, float Value, int32_t Dev) {
+  dump_function();
+
+  if (Idx < 0 || Idx >= SPD_MAX_PARAMS)
+    err_runtime("invalid parameter index");
+
+  SPDDevice *D = getDevice(Dev);
+  waitDevice(D);
+  D->Params[Idx] = Value;
+}
+
+/* Size is the larger of the input and the output stream. With SwitchInOut
+ * the in and out ports of the board are switched after a run: a run that
+ * got no new input since the previous run of the device reads the output of
+ * that run. */
+void __spd_run_kernel_dev(int64_t Size, int32_t SwitchInOut, int32_t Dev) {
+  dump_function();
+
+  if (!Emulator)
+    err_runtime("no kernel emulator registered, compile with "
+                "-polly-spd-emulate");
+
+  SPDDevice *D = getDevice(Dev);
+  if (D->InSize > Size)
+    err_runtime("transferred data is larger than the kernel stream");
+
+  waitDevice(D);
+  if (SwitchInOut && D->HasOutput && !D->HasNewInput) {
+    float *Buffer = D->InBuffer;
+    int64_t Capacity = D->InCapacity;
+    D->InBuffer = D->OutBuffer;
+    D->InCapacity = D->OutCapacity;
+    D->OutBuffer = Buffer;
+    D->OutCapacity = Capacity;
+    debug_print("   device %d: input and output switched\n", Dev);
+  }
+
+  resizeBuffer(&D->OutBuffer, &D->OutCapacity, Size);
+  D->OutSize = Size;
+  D->HasOutput = 1;
+  D->HasNewInput = 0;
+  D->SwitchInOut = SwitchInOut;
+  if (pthread_create(&D->Thread, NULL, runEmulator, D))
+    err_runtime("cannot start a device thread");
+
+  D->Running = 1;
+}
+
+/* The board reads the output back from the port the run wrote to, which
+ * the host names with the SwitchInOut of the run. */
+static void checkOutputPorts(SPDDevice *D, int32_t SwitchInOut) {
+  if (!D->HasOutput)
+    err_runtime("the device has no output to read back");
+  if (!SwitchInOut != !D->SwitchInOut)
+    err_runtime("the output is read back with other ports than the run");
+}
+
+void __spd_pci_dma_from_FPGA_dev(float *Stream, int64_t Size,
+                                 int32_t SwitchInOut, int32_t Dev) {
+  dump_function();
+
+  SPDDevice *D = getDevice(Dev);
+  waitDevice(D);
+  checkOutputPorts(D, SwitchInOut);
+  if (D->OutSize < Size)
+    err_runtime("requested more data than the kernel produced");
+
+  double Start = profileStart();
+  memcpy(Stream, D->OutBuffer, Size * sizeof(float));
+  profileEnd(SPD_PHASE_DMA_OUT, Start);
+}
+
+/* The channels of a device are consecutive planes of its input buffer, all
+ * of Size elements. The buffer is only reallocated by the first channel of a
+ * larger transfer. */
+void __spd_pci_dma_channel_to_FPGA_dev(float *Src, int64_t Size,
+                                       int32_t Channel, int32_t NumChannels,
+                                       int32_t Dev) {
+  dump_function();
+
+  if (Channel < 0 || Channel >= NumChannels)
+    err_runtime("invalid channel number");
+
+  SPDDevice *D = getDevice(Dev);
+  waitDevice(D);
+  double Start = profileStart();
+  resizeBuffer(&D->InBuffer, &D->InCapacity, Size * NumChannels);
+  memcpy(&D->InBuffer[Channel * Size], Src, Size * sizeof(float));
+  D->InSize = Size * NumChannels;
+  D->ChannelSize = Size;
+  D->HasNewInput = 1;
+  profileEnd(SPD_PHASE_DMA_IN, Start);
+}
+
+/* A run of equal words is encoded as the word followed by the bit pattern
+ * of its uint32_t length. Words are compared bitwise, so that -0.0 and NaNs
+ * are kept. Returns the number of encoded words, at most 2 * Size. */
+static int64_t encodeRLE(float *Dst, const float *Src, int64_t Size) {
+  int64_t N = 0;
+  int64_t i = 0;
+  while (i < Size) {
+    uint32_t Run = 1;
+    while (i + Run < Size && Run != UINT32_MAX &&
+           memcmp(&Src[i + Run], &Src[i], sizeof(float)) == 0)
+      Run++;
+
+    Dst[N++] = Src[i];
+    memcpy(&Dst[N++], &Run, sizeof(uint32_t));
+    i += Run;
+  }
+
+  return N;
+}
+
+/* the front-end module of the kernel expanding the runs of a channel */
+static void decodeRLE(float *Dst, int64_t Size, const float *Src,
+                      int64_t EncodedSize) {
+  int64_t i = 0;
+  for (int64_t j = 0; j + 1 < EncodedSize; j += 2) {
+    uint32_t Run;
+    memcpy(&Run, &Src[j + 1], sizeof(uint32_t));
+    if (i + Run > Size)
+      err_runtime("run-length encoded channel overflows its plane");
+
+    for (uint32_t k = 0; k < Run; k++)
+      Dst[i + k] = Src[j];
+    i += Run;
+  }
+
+  if (i != Size)
+    err_runtime("run-length encoded channel does not fill its plane");
+}
+
+/* The host encodes the channel while packing, only the encoded words cross
+ * the bus and are expanded on the device. */
+void __spd_pci_dma_channel_rle_to_FPGA_dev(float *Src, int64_t Size,
+                                           int32_t Channel,
+                                           int32_t NumChannels,
+                                           int32_t Dev) {
+  dump_function();
+
+  if (Channel < 0 || Channel >= NumChannels)
+    err_runtime("invalid channel number");
+
+  SPDDevice *D = getDevice(Dev);
+  waitDevice(D);
+  double Start = profileStart();
+  resizeBuffer(&D->RLEBuffer, &D->RLECapacity, 2 * Size);
+  int64_t EncodedSize = encodeRLE(D->RLEBuffer, Src, Size);
+  profileEnd(SPD_PHASE_PACK, Start);
+  debug_print("   channel %d: %lld words encoded into %lld\n", Channel,
+              (long long)Size, (long long)EncodedSize);
+
+  Start = profileStart();
+  resizeBuffer(&D->InBuffer, &D->InCapacity, Size * NumChannels);
+  decodeRLE(&D->InBuffer[Channel * Size], Size, D->RLEBuffer, EncodedSize);
+  D->InSize = Size * NumChannels;
+  D->ChannelSize = Size;
+  D->HasNewInput = 1;
+  profileEnd(SPD_PHASE_DMA_IN, Start);
+
+  if (ProfileMode) {
+    pthread_mutex_lock(&ProfileLock);
+    RLERawWords += Size;
+    RLESentWords += EncodedSize;
+    pthread_mutex_unlock(&ProfileLock);
+  }
+}
+
+/* output channels have as many elements as the input channels */
+void __spd_pci_dma_channel_from_FPGA_dev(float *Dst, int64_t Size,
+                                         int64_t Offset, int32_t Channel,
+                                         int32_t SwitchInOut, int32_t Dev) {
+  dump_function();
+
+  SPDDevice *D = getDevice(Dev);
+  waitDevice(D);
+  checkOutputPorts(D, SwitchInOut);
+  if (Channel < 0 || Offset < 0 || Offset + Size > D->ChannelSize ||
+      (Channel + 1) * D->ChannelSize > D->OutSize)
+    err_runtime("requested more data than the channel produced");
+
+  double Start = profileStart();
+  memcpy(Dst, &D->OutBuffer[Channel * D->ChannelSize + Offset],
+         Size * sizeof(float));
+  profileEnd(SPD_PHASE_DMA_OUT, Start);
+}
+
+void __spd_set_domain_2(int64_t Start0, int64_t End0, int64_t Size0,
+                        int64_t Start1, int64_t End1, int64_t Size1) {
+  __spd_set_domain_2_dev(Start0, End0, Size0, Start1, End1, Size1, 0);
+}
+
+void __spd_pci_dma_to_FPGA(float *Stream, int64_t Size) {
+  __spd_pci_dma_to_FPGA_dev(Stream, Size, 0);
+}
+
+void __spd_pci_dma_bcast_to_FPGA(float *Stream, int64_t Size) {
+  __spd_pci_dma_bcast_to_FPGA_dev(Stream, Size, 0);
+}
+
+void __spd_set_param(int32_t Idx, float Value) {
+  __spd_set_param_dev(Idx, Value, 0);
+}
+
+void __spd_run_kernel(int64_t Size, int32_t SwitchInOut) {
+  __spd_run_kernel_dev(Size, SwitchInOut, 0);
+  waitDevice(getDevice(0));
+}
+
+void __spd_pci_dma_from_FPGA(float *Stream, int64_t Size,
+                             int32_t SwitchInOut) {
+  __spd_pci_dma_from_FPGA_dev(Stream, Size, SwitchInOut, 0);
+}
+
+void __spd_pci_dma_channel_to_FPGA(float *Src, int64_t Size, int32_t Channel,
+                                   int32_t NumChannels) {
+  __spd_pci_dma_channel_to_FPGA_dev(Src, Size, Channel, NumChannels, 0);
+}
+
+void __spd_pci_dma_channel_from_FPGA(float *Dst, int64_t Size,
+                                     int64_t Offset, int32_t Channel,
+                                     int32_t SwitchInOut) {
+  __spd_pci_dma_channel_from_FPGA_dev(Dst, Size, Offset, Channel,
+                                      SwitchInOut, 0);
+}
+
+void __spd_pci_dma_channel_rle_to_FPGA(float *Src, int64_t Size,
+                                       int32_t Channel, int32_t NumChannels) {
+  __spd_pci_dma_channel_rle_to_FPGA_dev(Src, Size, Channel, NumChannels, 0);
+}
@@ -0,0 +1,179 @@
+/******************************************************************************/
+/*                                                                            */
+/*                     The LLVM Compiler Infrastructure                       */
+/*                                                                            */
+/* This file is dual licensed under the MIT and the University of Illinois    */
+/* Open Source License. See LICENSE.TXT for details.                          */
+/*                                                                            */
+/******************************************************************************/
+/*                                                                            */
+/*  This file defines the runtime interface called by the host code that      */
+/*  HostCodeGeneration emits for SPD kernels.                                 */
+/*                                                                            */
+/******************************************************************************/
+
+#ifndef SPDRUNTIME_H_
+#define SPDRUNTIME_H_
+
+#include <stdint.h>
+
+/*
+ * A stream is an interleaved buffer of floats. Element i of array k is stored
+ * at Stream[i * Stride + Offset(k)], the last word of each element holds the
+ * domain attribute (bit 0 set: the element is inside the write domain).
+ *
+ * For one offloaded loop the generated host code looks like:
+ *
+ *   __spd_initialize();
+ *   In = __spd_alloc_stream(Size);
+ *   Out = __spd_alloc_stream(Size);
+ *   __spd_pack_contiguous(In, 0, Stride, A, N);
+ *   __spd_create_domain_2(In, Stride, ...);
+ *   __spd_pci_dma_to_FPGA(In, Size);
+ *   __spd_run_kernel(Size, SwitchInOut);
+ *   __spd_pci_dma_from_FPGA(Out, Size, SwitchInOut);
+ *   __spd_unpack_contiguous(B, N, Out, 0, Stride);
+ *   __spd_free_stream(In);
+ *   __spd_free_stream(Out);
+ *   __spd_finalize();
+ *
+ * When the arrays of a stream have the same size, the host packs them in a
+ * single pass with __spd_pack_interleaved(In, Stride, Arrays, NumArrays, N),
+ * array k going to offset k. It sets the other words of each element to 0,
+ * so the attr word is created afterwards. __spd_unpack_interleaved is its
+ * counterpart. Both use SIMD kernels selected for the host CPU by
+ * __spd_initialize.
+ *
+ * Arrays of a lower rank than the kernel are packed into a separate broadcast
+ * stream (no attr word) holding a single row, which is sent with
+ * __spd_pci_dma_bcast_to_FPGA before the kernel runs.
+ *
+ * Kernels compiled with -polly-spd-device-attr generate the domain predicate
+ * themselves: the streams have no attr word (Stride = NumArrays) and the
+ * domain bounds are written with __spd_set_domain_2 instead of
+ * __spd_create_domain_2.
+ *
+ * Loop-invariant scalars of the kernel are registers, written by index with
+ * __spd_set_param before __spd_run_kernel. Every parameter is a 32-bit word,
+ * integers are passed as their bit pattern.
+ *
+ * Extracted loops sharing a region number are chained on the device: the
+ * input stream is the one of the first kernel and the output stream holds
+ * the arrays written by every kernel of the chain, so it may be wider. The
+ * Size passed to __spd_run_kernel is the larger of the two.
+ *
+ * The streams stay on the device while the kernel is called repeatedly
+ * between the region begin and the region end. With SwitchInOut a run that
+ * got no new input since the previous run reads the output of that run.
+ *
+ * When the domain is partitioned (-polly-spd-num-partitions), every slab is
+ * sent to its own device with the *_dev variants. __spd_run_kernel_dev only
+ * starts the kernel, __spd_pci_dma_from_FPGA_dev waits for its completion.
+ * With SwitchInOut the host exchanges the halo rows of the slabs after every
+ * call: it reads the output streams back, copies the rows of every input
+ * stream from the slab computing them, creates the attr words again and
+ * sends the input streams.
+ *
+ * Grids wider than -polly-spd-tile-width are streamed as column tiles of
+ * that width. __spd_pack_2d copies NumRows rows of a tile starting at column
+ * ColBegin of the array (columns outside of the array read as 0), the tile
+ * is a stream of StreamRowSize elements per row. __spd_unpack_2d copies the
+ * NumCols columns a tile writes back, Array and Stream point to its first
+ * element. The tiles are sent, run and read back at every kernel call.
+ *
+ * With -polly-spd-layout=separate every word of the stream element is a
+ * stream of its own: word k of element i is at Stream[k * N + i] for N
+ * elements, and each plane is moved through its own channel with
+ * __spd_pci_dma_channel_to_FPGA(Src, N, k, NumChannels) and
+ * __spd_pci_dma_channel_from_FPGA(Dst, Size, Offset, k, SwitchInOut), which
+ * reads Size elements of output channel k from element Offset on. Arrays
+ * covering the slab are transferred from and to their own memory without
+ * packing; the pack/unpack functions are called with Offset 0 and Stride 1
+ * on a plane otherwise.
+ *
+ * Input arrays listed in -polly-spd-compress-arrays are sent run-length
+ * encoded with __spd_pci_dma_channel_rle_to_FPGA (same arguments): a run of
+ * equal words crosses the bus as the word and the uint32_t bit pattern of
+ * its length, and a front-end module of the kernel expands it. Masks and
+ * zero-padded grids shrink to a fraction of their size.
+ *
+ * With -polly-spd-inline-pack the host code copies the arrays from and to
+ * the streams with OpenMP parallel loops of its own instead of the
+ * __spd_pack_contiguous and __spd_unpack_contiguous calls, and needs the
+ * GNU OpenMP runtime (-lgomp).
+ *
+ * This implementation is the CPU backend: devices are host threads and
+ * kernels are executed by the emulator registered with __spd_set_emulator
+ * (generated with -polly-spd-emulate). SPD_DEBUG=1 traces the runtime calls,
+ * SPD_PROFILE=1 prints the time spent in every phase at exit (see
+ * utils/spd-bench).
+ */
+
+typedef void (*SPDEmulatorFn)(float *InStream, float *OutStream,
+                              float *BroadcastStream, float *Params,
+                              int64_t *Domain, int64_t StreamSize);
+
+void __spd_initialize(void);
+void __spd_finalize(void);
+void __spd_set_emulator(SPDEmulatorFn Emulator);
+
+float *__spd_alloc_stream(int64_t Size);
+void __spd_free_stream(float *Stream);
+
+void __spd_pack_contiguous(float *Stream, int32_t Offset, int32_t Stride,
+                           float *Array, int64_t Size);
+void __spd_unpack_contiguous(float *Array, int64_t Size, float *Stream,
+                             int32_t Offset, int32_t Stride);
+void __spd_pack_interleaved(float *Stream, int32_t Stride, float **Arrays,
+                            int32_t NumArrays, int64_t Size);
+void __spd_unpack_interleaved(float **Arrays, int32_t NumArrays, int64_t Size,
+                              float *Stream, int32_t Stride);
+void __spd_pack_2d(float *Stream, int32_t Offset, int32_t Stride,
+                   int64_t StreamRowSize, float *Array, int64_t RowSize,
+                   int64_t NumRows, int64_t ColBegin);
+void __spd_unpack_2d(float *Array, int64_t RowSize, int64_t NumRows,
+                     int64_t NumCols, float *Stream, int32_t Offset,
+                     int32_t Stride, int64_t StreamRowSize);
+void __spd_create_domain_2(float *Stream, int32_t Stride, int64_t Start0,
+                           int64_t End0, int64_t Size0, int64_t Start1,
+                           int64_t End1, int64_t Size1);
+
+void __spd_set_domain_2(int64_t Start0, int64_t End0, int64_t Size0,
+                        int64_t Start1, int64_t End1, int64_t Size1);
+
+void __spd_pci_dma_to_FPGA(float *Stream, int64_t Size);
+void __spd_pci_dma_bcast_to_FPGA(float *Stream, int64_t Size);
+void __spd_set_param(int32_t Idx, float Value);
+void __spd_run_kernel(int64_t Size, int32_t SwitchInOut);
+void __spd_pci_dma_from_FPGA(float *Stream, int64_t Size,
+                             int32_t SwitchInOut);
+void __spd_pci_dma_channel_to_FPGA(float *Src, int64_t Size, int32_t Channel,
+                                   int32_t NumChannels);
+void __spd_pci_dma_channel_from_FPGA(float *Dst, int64_t Size,
+                                     int64_t Offset, int32_t Channel,
+                                     int32_t SwitchInOut);
+void __spd_pci_dma_channel_rle_to_FPGA(float *Src, int64_t Size,
+                                       int32_t Channel, int32_t NumChannels);
+
+void __spd_set_domain_2_dev(int64_t Start0, int64_t End0, int64_t Size0,
+                            int64_t Start1, int64_t End1, int64_t Size1,
+                            int32_t Dev);
+void __spd_pci_dma_to_FPGA_dev(float *Stream, int64_t Size, int32_t Dev);
+void __spd_pci_dma_bcast_to_FPGA_dev(float *Stream, int64_t Size,
+                                     int32_t Dev);
+void __spd_set_param_dev(int32_t Idx, float Value, int32_t Dev);
+void __spd_run_kernel_dev(int64_t Size, int32_t SwitchInOut, int32_t Dev);
+void __spd_pci_dma_from_FPGA_dev(float *Stream, int64_t Size,
+                                 int32_t SwitchInOut, int32_t Dev);
+void __spd_pci_dma_channel_to_FPGA_dev(float *Src, int64_t Size,
+                                       int32_t Channel, int32_t NumChannels,
+                                       int32_t Dev);
+void __spd_pci_dma_channel_from_FPGA_dev(float *Dst, int64_t Size,
+                                         int64_t Offset, int32_t Channel,
+                                         int32_t SwitchInOut, int32_t Dev);
+void __spd_pci_dma_channel_rle_to_FPGA_dev(float *Src, int64_t Size,
+                                           int32_t Channel,
+                                           int32_t NumChannels,
+                                           int32_t Dev);
+
+#endif /* SPDRUNTIME_H_ */
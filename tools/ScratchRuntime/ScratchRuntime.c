@@ -0,0 +1,166 @@
+/***************** ScratchRuntime.c - Scratch Buffer Runtime *****************/
+/*                                                                            */
+/*                     The LLVM Compiler Infrastructure                       */
+/*                                                                            */
+/* This file is dual licensed under the MIT and the University of Illinois    */
+/* Open Source License. See LICENSE.TXT for details.                          */
+/*                                                                            */
+/******************************************************************************/
+/*                                                                            */
+/*  This file implements per-thread arenas of scratch buffers, which are      */
+/*  reused by all executions of the SCoPs of a thread.                        */
+/*                                                                            */
+/******************************************************************************/
+
+#define _GNU_SOURCE
+#include "ScratchRuntime.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+static int DebugMode = -1;
+
+static void debug_print(const char *format, ...) {
+  if (DebugMode < 0) {
+    const char *Env = getenv("SCRATCH_DEBUG");
+    DebugMode = Env && atoi(Env);
+  }
+  if (!DebugMode)
+    return;
+
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+}
+
+static void err_runtime(const char *Msg) __attribute__((noreturn));
+static void err_runtime(const char *Msg) {
+  fprintf(stderr, "Scratch runtime: %s\n", Msg);
+  exit(-1);
+}
+
+typedef struct ScratchBufferT {
+  const void *Key;
+  void *Buffer;
+  int64_t Size;
+} ScratchBuffer;
+
+typedef struct ScratchArenaT {
+  ScratchBuffer *Buffers;
+  int NumBuffers;
+  int Capacity;
+} ScratchArena;
+
+static pthread_key_t ArenaKey;
+static pthread_once_t ArenaKeyOnce = PTHREAD_ONCE_INIT;
+
+static void freeArena(void *Ptr) {
+  ScratchArena *Arena = (ScratchArena *)Ptr;
+  for (int i = 0; i < Arena->NumBuffers; i++)
+    free(Arena->Buffers[i].Buffer);
+  free(Arena->Buffers);
+  free(Arena);
+}
+
+static void createArenaKey(void) {
+  if (pthread_key_create(&ArenaKey, freeArena))
+    err_runtime("Cannot create the thread-local arena key");
+}
+
+static ScratchArena *getArena(void) {
+  pthread_once(&ArenaKeyOnce, createArenaKey);
+  ScratchArena *Arena = (ScratchArena *)pthread_getspecific(ArenaKey);
+  if (Arena)
+    return Arena;
+
+  Arena = (ScratchArena *)calloc(1, sizeof(ScratchArena));
+  if (!Arena || pthread_setspecific(ArenaKey, Arena))
+    err_runtime("Cannot create the arena of the thread");
+  return Arena;
+}
+
+static int64_t roundUp(int64_t Value, int64_t Multiple) {
+  return (Value + Multiple - 1) / Multiple * Multiple;
+}
+
+/* Allocate a buffer of at least Size bytes. Large buffers are placed on
+ * huge page boundaries, which allows the kernel to back them with
+ * transparent huge pages and saves TLB misses in the packed loops. */
+static void *allocBuffer(int64_t *Size, int64_t Alignment) {
+  size_t Align = sizeof(void *);
+  while ((int64_t)Align < Alignment)
+    Align *= 2;
+
+  if (*Size >= SCRATCH_HUGE_PAGE_SIZE) {
+    Align = SCRATCH_HUGE_PAGE_SIZE;
+    *Size = roundUp(*Size, SCRATCH_HUGE_PAGE_SIZE);
+  } else {
+    *Size = roundUp(*Size, Align);
+  }
+
+  void *Buffer = NULL;
+  if (posix_memalign(&Buffer, Align, *Size))
+    err_runtime("Cannot allocate a scratch buffer");
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (Align == SCRATCH_HUGE_PAGE_SIZE)
+    madvise(Buffer, *Size, MADV_HUGEPAGE);
+#endif
+  return Buffer;
+}
+
+void *polly_getScratchBuffer(const void *Key, int64_t Size,
+                             int64_t Alignment) {
+  ScratchArena *Arena = getArena();
+
+  ScratchBuffer *Entry = NULL;
+  for (int i = 0; i < Arena->NumBuffers; i++)
+    if (Arena->Buffers[i].Key == Key) {
+      Entry = &Arena->Buffers[i];
+      break;
+    }
+
+  if (Entry && Entry->Size >= Size)
+    return Entry->Buffer;
+
+  if (!Entry) {
+    if (Arena->NumBuffers == Arena->Capacity) {
+      int Capacity = Arena->Capacity ? 2 * Arena->Capacity : 8;
+      ScratchBuffer *Buffers = (ScratchBuffer *)realloc(
+          Arena->Buffers, Capacity * sizeof(ScratchBuffer));
+      if (!Buffers)
+        err_runtime("Cannot grow the arena of the thread");
+      Arena->Buffers = Buffers;
+      Arena->Capacity = Capacity;
+    }
+    Entry = &Arena->Buffers[Arena->NumBuffers++];
+    memset(Entry, 0, sizeof(ScratchBuffer));
+    Entry->Key = Key;
+  }
+
+  /* The content of the buffer does not need to be preserved. */
+  free(Entry->Buffer);
+  Entry->Size = Size;
+  Entry->Buffer = allocBuffer(&Entry->Size, Alignment);
+  debug_print("Scratch runtime: thread %lu, key %p: %lld bytes at %p\n",
+              (unsigned long)pthread_self(), Key, (long long)Entry->Size,
+              Entry->Buffer);
+  return Entry->Buffer;
+}
+
+void polly_freeScratchBuffers(void) {
+  pthread_once(&ArenaKeyOnce, createArenaKey);
+  ScratchArena *Arena = (ScratchArena *)pthread_getspecific(ArenaKey);
+  if (!Arena)
+    return;
+
+  freeArena(Arena);
+  pthread_setspecific(ArenaKey, NULL);
+}
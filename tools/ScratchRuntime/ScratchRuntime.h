@@ -0,0 +1,53 @@
+/******************************************************************************/
+/*                                                                            */
+/*                     The LLVM Compiler Infrastructure                       */
+/*                                                                            */
+/* This file is dual licensed under the MIT and the University of Illinois    */
+/* Open Source License. See LICENSE.TXT for details.                          */
+/*                                                                            */
+/******************************************************************************/
+/*                                                                            */
+/*  This file defines the runtime interface that provides scratch buffers     */
+/*  for the arrays created by Polly, e.g., the packed operands of the matrix  */
+/*  multiplication.                                                           */
+/*                                                                            */
+/******************************************************************************/
+
+#ifndef SCRATCHRUNTIME_H_
+#define SCRATCHRUNTIME_H_
+
+#include <stdint.h>
+
+/*
+ * With -polly-scratch-buffers the code generated for a SCoP gets the arrays
+ * it creates with
+ *
+ *   Packed_A = polly_getScratchBuffer(&Key, Size, Alignment);
+ *
+ * at polly.start instead of an alloca in the entry block or a malloc/free
+ * pair around the SCoP. Key is the address of a private global variable of
+ * the generated code, which identifies the array. A buffer belongs to the
+ * calling thread and is returned again by all later calls of the thread with
+ * the same key, as long as Size does not grow. A SCoP that is executed many
+ * times, thus, neither allocates memory nor touches new pages after its first
+ * execution. The content of a buffer is not preserved between calls.
+ *
+ * Parallel subfunctions get the buffer of their own thread in their entry
+ * block, in the same way, for the arrays that are only accessed in the
+ * parallel loop. Arrays accessed outside of it, e.g., packed in a parallel
+ * loop and read after it, use the buffer of the thread that runs the SCoP.
+ *
+ * Buffers are aligned to Alignment bytes, which is the cache line size.
+ * Buffers of at least SCRATCH_HUGE_PAGE_SIZE bytes are aligned to it and
+ * advised to be backed by transparent huge pages, where this is supported.
+ *
+ * The buffers of a thread are released when the thread exits or when it
+ * calls polly_freeScratchBuffers. SCRATCH_DEBUG=1 prints every allocation.
+ */
+
+#define SCRATCH_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+void *polly_getScratchBuffer(const void *Key, int64_t Size, int64_t Alignment);
+void polly_freeScratchBuffers(void);
+
+#endif /* SCRATCHRUNTIME_H_ */
@@ -0,0 +1,108 @@
+//===- PackKernelsTest.cpp ------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include "SPDPackKernels.h"
+}
+
+namespace {
+
+// instruction sets of SPD_SIMD, the host may support fewer of them
+const char *const SIMDLevels[] = {"sse", "avx2", "all"};
+
+void selectSIMD(const char *Level) {
+  if (strcmp(Level, "all") == 0)
+    unsetenv("SPD_SIMD");
+  else
+    setenv("SPD_SIMD", Level, 1);
+  initPackKernels();
+}
+
+// arrays with a tail the SIMD kernels leave to the scalar loop, the words
+// are distinct bit patterns
+std::vector<std::vector<float>> createArrays(int NumArrays, int64_t Size) {
+  std::vector<std::vector<float>> Arrays(NumArrays);
+  for (int k = 0; k < NumArrays; k++) {
+    for (int64_t i = 0; i < Size; i++)
+      Arrays[k].push_back(k * 1000.0f + i + 0.25f);
+  }
+
+  return Arrays;
+}
+
+std::vector<float *> getPointers(std::vector<std::vector<float>> &Arrays) {
+  std::vector<float *> Ptrs;
+  for (auto &Array : Arrays)
+    Ptrs.push_back(Array.data());
+  return Ptrs;
+}
+
+// the stream is filled with garbage first, every word has to be written
+std::vector<float> pack(int Stride, std::vector<std::vector<float>> &Arrays,
+                        int64_t Size) {
+  std::vector<float> Stream(Stride * Size, -1.0f);
+  std::vector<float *> Ptrs = getPointers(Arrays);
+  packInterleaved(Stream.data(), Stride, Ptrs.data(), Ptrs.size(), Size);
+  return Stream;
+}
+
+std::vector<std::vector<float>> unpack(int NumArrays,
+                                       const std::vector<float> &Stream,
+                                       int Stride, int64_t Size) {
+  std::vector<std::vector<float>> Arrays(NumArrays,
+                                         std::vector<float>(Size, -1.0f));
+  std::vector<float *> Ptrs = getPointers(Arrays);
+  unpackInterleaved(Ptrs.data(), NumArrays, Size, Stream.data(), Stride);
+  return Arrays;
+}
+
+bool sameBytes(const std::vector<float> &A, const std::vector<float> &B) {
+  return (A.size() == B.size()) &&
+         (memcmp(A.data(), B.data(), A.size() * sizeof(float)) == 0);
+}
+
+TEST(SPDPackKernels, SIMDMatchesScalar) {
+  const int64_t Sizes[] = {1, 7, 64, 67, 1021};
+  for (int Stride = 1; Stride <= 8; Stride++) {
+    for (int NumArrays = 1; NumArrays <= Stride; NumArrays++) {
+      for (int64_t Size : Sizes) {
+        auto Arrays = createArrays(NumArrays, Size);
+
+        selectSIMD("scalar");
+        std::vector<float> ScalarStream = pack(Stride, Arrays, Size);
+        auto ScalarArrays = unpack(NumArrays, ScalarStream, Stride, Size);
+        for (int k = 0; k < NumArrays; k++)
+          ASSERT_TRUE(sameBytes(ScalarArrays[k], Arrays[k]));
+
+        for (const char *Level : SIMDLevels) {
+          selectSIMD(Level);
+          EXPECT_TRUE(sameBytes(pack(Stride, Arrays, Size), ScalarStream))
+              << "pack, SIMD " << Level << ", stride " << Stride << ", "
+              << NumArrays << " arrays, " << Size << " elements";
+
+          auto SIMDArrays = unpack(NumArrays, ScalarStream, Stride, Size);
+          for (int k = 0; k < NumArrays; k++)
+            EXPECT_TRUE(sameBytes(SIMDArrays[k], ScalarArrays[k]))
+                << "unpack, SIMD " << Level << ", stride " << Stride << ", "
+                << NumArrays << " arrays, " << Size << " elements";
+        }
+      }
+    }
+  }
+
+  unsetenv("SPD_SIMD");
+  initPackKernels();
+}
+
+} // anonymous namespace
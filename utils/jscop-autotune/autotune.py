@@ -0,0 +1,352 @@
+#!/usr/bin/env python
+"""Tunes the schedules of the SCoPs of a program empirically.
+
+The SCoPs of the program are exported as .jscop files (-polly-export) and
+candidate schedules are derived from them in two ways:
+
+  - the schedule optimizer is run with a set of option combinations (tile
+    sizes, 2nd-level tiling, the cache model, diamond tiling, the fusion
+    strategy) and the optimized schedules are exported;
+  - the loops of the original schedule of each SCoP are permuted and
+    optionally tiled in the .jscop file.
+
+Every candidate is compiled with its schedules imported (-polly-import and
+-polly-optimizer=none), exactly as a later build reuses them, and run with
+-polly-codegen-perf-monitoring, which reports the cycles spent in each SCoP
+(x86 only). Candidates whose import is rejected, e.g. because the schedule
+violates a dependence, are skipped. The fastest schedule of each SCoP is
+written to the output directory, to be imported by later builds with
+
+  -mllvm -polly-import -mllvm -polly-import-jscop-dir=<output dir>
+  -mllvm -polly-optimizer=none
+
+Only the schedule is tuned. AST build options of the optimizer, such as the
+unrolling of register tiles or the separation of full tiles, are not part of
+a .jscop file and are not reproduced by the import.
+
+  autotune.py --clang=<clang with Polly> --output-dir=<dir> <sources>
+              [--cflags=<flags>] [-- <arguments of the program>]
+"""
+
+from __future__ import print_function
+
+import argparse
+import glob
+import itertools
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+# name, options of the schedule optimizer
+OPTIMIZER_CONFIGS = [
+    ('isl-notiling', ['-polly-tiling=false']),
+    ('isl-cache-model', ['-polly-tile-sizes-from-cache-model']),
+    ('isl-cache-model-2nd', ['-polly-tile-sizes-from-cache-model',
+                             '-polly-2nd-level-tiling']),
+    ('isl-diamond', ['-polly-diamond-tiling']),
+]
+
+# messages of the JSCoP importer when a .jscop file is not imported
+IMPORT_ERRORS = [
+    'File could not be read',
+    'could not be parsed',
+    'was not parsed successfully',
+    'changes the dependences',
+    'No match for array',
+    "has no '",
+]
+
+SCHEDULE_RE = re.compile(
+    r'^(?P<head>[^{]*\{\s*\w+\[[^\]]*\]\s*->\s*)\[(?P<dims>[^\]]*)\]'
+    r'(?P<tail>.*)$', re.DOTALL)
+
+
+def polly_flags(options):
+  result = []
+  for option in ['-polly'] + options:
+    result += ['-mllvm', option]
+  return result
+
+
+def compile_program(args, options, output, workdir):
+  cmd = ([args.clang, '-O3'] + args.cflags.split() +
+         [os.path.abspath(s) for s in args.sources] + ['-o', output] +
+         polly_flags(options))
+  if args.verbose:
+    print(' '.join(cmd))
+  proc = subprocess.Popen(cmd, cwd=workdir, stdout=subprocess.PIPE,
+                          stderr=subprocess.STDOUT)
+  log = proc.communicate()[0].decode('utf-8', 'replace')
+  return proc.returncode == 0, log
+
+
+def export_schedules(args, options, jscop_dir, workdir):
+  """Compiles the program with @p options and exports its SCoPs."""
+  os.makedirs(jscop_dir)
+  ok, log = compile_program(
+      args, options + ['-polly-export', '-polly-import-jscop-dir=' + jscop_dir],
+      os.path.join(workdir, 'export'), workdir)
+  if not ok:
+    return None, log
+  return sorted(os.path.basename(f)
+                for f in glob.glob(os.path.join(jscop_dir, '*.jscop'))), log
+
+
+def rejected_imports(log):
+  """Gets the .jscop files in the import @p log that were not imported."""
+  rejected = set()
+  current = None
+  for line in log.splitlines():
+    match = re.match(r"Reading JScop '(.*)' in function '(.*)' from '(.*)'",
+                     line)
+    if match:
+      current = os.path.basename(match.group(3))
+      continue
+    if current and any(e in line for e in IMPORT_ERRORS):
+      rejected.add(current)
+  return rejected
+
+
+def run_program(args, binary):
+  """Runs @p binary and gets the cycles of each SCoP, the minimum of all
+  repetitions."""
+  cycles = {}
+  for _ in range(args.repeat):
+    proc = subprocess.Popen([binary] + args.run_args, stdout=subprocess.PIPE,
+                            stderr=subprocess.PIPE)
+    out, err = proc.communicate()
+    if proc.returncode != 0:
+      return None
+    output = out.decode('utf-8', 'replace') + err.decode('utf-8', 'replace')
+    for line in output.splitlines():
+      fields = [f.strip() for f in line.split(',')]
+      if len(fields) != 5 or not fields[3].isdigit():
+        continue
+      # the .jscop file name of the SCoP
+      name = '%s___%s---%s.jscop' % (fields[0], fields[1], fields[2])
+      value = int(fields[3])
+      cycles[name] = min(cycles.get(name, value), value)
+  return cycles
+
+
+def measure(args, jscop_dir, workdir):
+  """Compiles the program with the schedules of @p jscop_dir imported and
+  gets the cycles of each SCoP whose schedule was imported."""
+  binary = os.path.join(workdir, 'candidate')
+  ok, log = compile_program(
+      args, ['-polly-import', '-polly-import-jscop-dir=' + jscop_dir,
+             '-polly-optimizer=none', '-polly-codegen-perf-monitoring'],
+      binary, workdir)
+  if not ok:
+    return {}, log
+  cycles = run_program(args, binary)
+  if cycles is None:
+    return {}, 'the program failed'
+  imported = set(os.listdir(jscop_dir)) - rejected_imports(log)
+  return dict((n, c) for n, c in cycles.items() if n in imported), log
+
+
+def split_dims(dims):
+  """Splits the output dimensions of a schedule at the top-level commas."""
+  result = []
+  depth = 0
+  current = ''
+  for c in dims:
+    if c == ',' and depth == 0:
+      result.append(current.strip())
+      current = ''
+      continue
+    depth += {'(': 1, ')': -1}.get(c, 0)
+    current += c
+  if current.strip():
+    result.append(current.strip())
+  return result
+
+
+def is_constant(expr):
+  return re.match(r'^-?\d+$', expr) is not None
+
+
+def transform_schedules(scop, permutation, tile_size):
+  """Permutes the loop dimensions of the schedules of @p scop and tiles them
+  with @p tile_size, if it is not zero. Returns None if the schedules are not
+  of the form handled."""
+  statements = []
+  for statement in scop['statements']:
+    match = SCHEDULE_RE.match(statement['schedule'])
+    if not match:
+      return None
+    statements.append((match.group('head'), split_dims(match.group('dims')),
+                       match.group('tail')))
+
+  loops = loop_dimensions(scop)
+  result = json.loads(json.dumps(scop))
+  for statement, (head, dims, tail) in zip(result['statements'], statements):
+    new_dims = list(dims)
+    for position, source in zip(loops, permutation):
+      new_dims[position] = dims[source]
+    if tile_size:
+      new_dims = ['floor((%s)/%d)' % (new_dims[p], tile_size)
+                  for p in loops] + new_dims
+    statement['schedule'] = '%s[%s]%s' % (head, ', '.join(new_dims), tail)
+  return result
+
+
+def loop_dimensions(scop):
+  """Gets the schedule dimensions that are loops in all statements."""
+  all_dims = []
+  for statement in scop['statements']:
+    match = SCHEDULE_RE.match(statement['schedule'])
+    if not match:
+      return []
+    all_dims.append(split_dims(match.group('dims')))
+  if not all_dims or len(set(len(d) for d in all_dims)) != 1:
+    return []
+  return [p for p in range(len(all_dims[0]))
+          if not any(is_constant(d[p]) for d in all_dims)]
+
+
+def schedule_candidates(args, original_dir, workdir):
+  """Creates the candidates of the permuted and tiled original schedules,
+  one directory of a single .jscop file per candidate."""
+  candidates = []
+  for name in sorted(os.listdir(original_dir)):
+    with open(os.path.join(original_dir, name)) as f:
+      scop = json.load(f)
+    loops = loop_dimensions(scop)
+    if not loops:
+      continue
+    permutations = list(itertools.permutations(loops))
+    permutations = permutations[:args.max_permutations]
+    for permutation in permutations:
+      for tile_size in [0] + args.tile_sizes:
+        if permutation == tuple(loops) and not tile_size:
+          continue
+        transformed = transform_schedules(scop, permutation, tile_size)
+        if transformed is None:
+          continue
+        label = 'order-%s%s' % ('-'.join(str(loops.index(p))
+                                          for p in permutation),
+                                '-tile-%d' % tile_size if tile_size else '')
+        jscop_dir = tempfile.mkdtemp(prefix=label + '-', dir=workdir)
+        with open(os.path.join(jscop_dir, name), 'w') as f:
+          json.dump(transformed, f, indent=3)
+        candidates.append((label, jscop_dir))
+  return candidates
+
+
+def optimizer_candidates(args, workdir):
+  configs = list(OPTIMIZER_CONFIGS)
+  for tile_size in args.tile_sizes:
+    configs.append(('isl-tile-%d' % tile_size,
+                    ['-polly-default-tile-size=%d' % tile_size]))
+  candidates = []
+  for fusion in ['min', 'max']:
+    for label, options in configs:
+      label = '%s-fusion-%s' % (label, fusion)
+      jscop_dir = os.path.join(workdir, label)
+      names, log = export_schedules(
+          args, ['-polly-opt-fusion=' + fusion] + options, jscop_dir, workdir)
+      if names is None:
+        print('%-40s export failed' % label)
+        if args.verbose:
+          print('  ' + log.strip().replace('\n', '\n  '))
+        continue
+      candidates.append((label, jscop_dir))
+  return candidates
+
+
+def main():
+  parser = argparse.ArgumentParser(
+      description='Tune the schedules of the SCoPs of a program')
+  parser.add_argument('--clang', default='clang',
+                      help='clang with Polly linked in')
+  parser.add_argument('--cflags', default='',
+                      help='additional flags to compile the program with')
+  parser.add_argument('--output-dir', required=True,
+                      help='directory the tuned .jscop files are written to')
+  parser.add_argument('--tile-sizes', default='16,32,64,128',
+                      help='tile sizes to try (default 16,32,64,128)')
+  parser.add_argument('--max-permutations', type=int, default=24,
+                      help='loop orders to try per SCoP (default 24)')
+  parser.add_argument('--repeat', type=int, default=3,
+                      help='runs per candidate, the fastest counts '
+                           '(default 3)')
+  parser.add_argument('--keep', action='store_true',
+                      help='keep the build directory')
+  parser.add_argument('-v', '--verbose', action='store_true')
+  parser.add_argument('sources', nargs='+', help='sources of the program')
+
+  # the arguments of the program follow --
+  argv = sys.argv[1:]
+  run_args = []
+  if '--' in argv:
+    run_args = argv[argv.index('--') + 1:]
+    argv = argv[:argv.index('--')]
+  args = parser.parse_args(argv)
+  args.run_args = run_args
+  args.tile_sizes = [int(t) for t in args.tile_sizes.split(',') if t]
+
+  workdir = tempfile.mkdtemp(prefix='jscop-autotune-')
+  original_dir = os.path.join(workdir, 'original')
+  names, log = export_schedules(args, ['-polly-optimizer=none'], original_dir,
+                                workdir)
+  if names is None:
+    print('export of the original schedules failed\n' + log)
+    return 1
+  if not names:
+    print('the program has no SCoPs')
+    return 1
+
+  candidates = [('original', original_dir)]
+  candidates += optimizer_candidates(args, workdir)
+  candidates += schedule_candidates(args, original_dir, workdir)
+
+  # name of the .jscop file -> (cycles, label, directory)
+  best = {}
+  baseline = {}
+  for label, jscop_dir in candidates:
+    cycles, log = measure(args, jscop_dir, workdir)
+    if label == 'original':
+      baseline = cycles
+    print('%-40s' % label +
+          ''.join(' %s: %d' % (n, c) for n, c in sorted(cycles.items())))
+    if args.verbose and log:
+      print('  ' + log.strip().replace('\n', '\n  '))
+    for name, value in cycles.items():
+      if name not in best or value < best[name][0]:
+        best[name] = (value, label, jscop_dir)
+
+  if not os.path.isdir(args.output_dir):
+    os.makedirs(args.output_dir)
+  print()
+  for name in names:
+    if name not in best:
+      print('%s: no schedule could be measured' % name)
+      continue
+    value, label, jscop_dir = best[name]
+    shutil.copy(os.path.join(jscop_dir, name),
+                os.path.join(args.output_dir, name))
+    speedup = (float(baseline[name]) / value
+               if name in baseline and value > 0 else 0.0)
+    print('%s: %s, %d cycles, %.2fx of the original schedule' %
+          (name, label, value, speedup))
+
+  print('\nReuse the schedules with:\n  ' + ' '.join(polly_flags(
+      ['-polly-import',
+       '-polly-import-jscop-dir=' + os.path.abspath(args.output_dir),
+       '-polly-optimizer=none'])))
+
+  if args.keep:
+    print('kept %s' % workdir)
+  else:
+    shutil.rmtree(workdir, ignore_errors=True)
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
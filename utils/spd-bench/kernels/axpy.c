@@ -0,0 +1,33 @@
+/* Z = a * X + Y on a grid */
+
+#include "../spd_bench.h"
+
+float X[N][N], Y[N][N], Z[N][N];
+float Alpha = 0.75f;
+
+void bench_init(void) {
+  for (long i = 0; i < N; i++)
+    for (long j = 0; j < N; j++) {
+      X[i][j] = bench_value(i, j);
+      Y[i][j] = bench_value(j, i);
+      Z[i][j] = 0;
+    }
+}
+
+void bench_kernel(void) {
+  float a = Alpha;
+  for (long i = 0; i < N; i++) {
+    __spd_loop(0, 1, 1, 0);
+    for (long j = 0; j < N; j++)
+      Z[i][j] = a * X[i][j] + Y[i][j];
+  }
+}
+
+long bench_points(void) { return (long)N * N; }
+
+int bench_num_outputs(void) { return 1; }
+
+const float *bench_output(int Idx, long *Size) {
+  *Size = (long)N * N;
+  return &Z[0][0];
+}
@@ -0,0 +1,33 @@
+/* 3x3 box blur */
+
+#include "../spd_bench.h"
+
+float In[N][N], Out[N][N];
+
+void bench_init(void) {
+  for (long i = 0; i < N; i++)
+    for (long j = 0; j < N; j++) {
+      In[i][j] = bench_value(i, j);
+      Out[i][j] = 0;
+    }
+}
+
+void bench_kernel(void) {
+  for (long i = 1; i < N - 1; i++) {
+    __spd_loop(0, 1, 1, 0);
+    for (long j = 1; j < N - 1; j++)
+      Out[i][j] = (In[i - 1][j - 1] + In[i - 1][j] + In[i - 1][j + 1] +
+                   In[i][j - 1] + In[i][j] + In[i][j + 1] +
+                   In[i + 1][j - 1] + In[i + 1][j] + In[i + 1][j + 1]) *
+                  (1.0f / 9.0f);
+  }
+}
+
+long bench_points(void) { return (long)(N - 2) * (N - 2); }
+
+int bench_num_outputs(void) { return 1; }
+
+const float *bench_output(int Idx, long *Size) {
+  *Size = (long)N * N;
+  return &Out[0][0];
+}
@@ -0,0 +1,31 @@
+/* 5-point Jacobi relaxation */
+
+#include "../spd_bench.h"
+
+float A[N][N], B[N][N];
+
+void bench_init(void) {
+  for (long i = 0; i < N; i++)
+    for (long j = 0; j < N; j++) {
+      A[i][j] = bench_value(i, j);
+      B[i][j] = 0;
+    }
+}
+
+void bench_kernel(void) {
+  for (long i = 1; i < N - 1; i++) {
+    __spd_loop(0, 1, 1, 0);
+    for (long j = 1; j < N - 1; j++)
+      B[i][j] = 0.2f * (A[i][j] + A[i - 1][j] + A[i + 1][j] + A[i][j - 1] +
+                        A[i][j + 1]);
+  }
+}
+
+long bench_points(void) { return (long)(N - 2) * (N - 2); }
+
+int bench_num_outputs(void) { return 1; }
+
+const float *bench_output(int Idx, long *Size) {
+  *Size = (long)N * N;
+  return &B[0][0];
+}
@@ -0,0 +1,36 @@
+/* 7-point Jacobi relaxation on a cube */
+
+#include "../spd_bench.h"
+
+#define N3 (N / 8)
+
+float A[N3][N3][N3], B[N3][N3][N3];
+
+void bench_init(void) {
+  for (long k = 0; k < N3; k++)
+    for (long i = 0; i < N3; i++)
+      for (long j = 0; j < N3; j++) {
+        A[k][i][j] = bench_value(k * N3 + i, j);
+        B[k][i][j] = 0;
+      }
+}
+
+void bench_kernel(void) {
+  for (long k = 1; k < N3 - 1; k++) {
+    __spd_loop(0, 1, 1, 0);
+    for (long i = 1; i < N3 - 1; i++)
+      for (long j = 1; j < N3 - 1; j++)
+        B[k][i][j] = (A[k][i][j] + A[k - 1][i][j] + A[k + 1][i][j] +
+                      A[k][i - 1][j] + A[k][i + 1][j] + A[k][i][j - 1] +
+                      A[k][i][j + 1]) * (1.0f / 7.0f);
+  }
+}
+
+long bench_points(void) { return (long)(N3 - 2) * (N3 - 2) * (N3 - 2); }
+
+int bench_num_outputs(void) { return 1; }
+
+const float *bench_output(int Idx, long *Size) {
+  *Size = (long)N3 * N3 * N3;
+  return &B[0][0][0];
+}
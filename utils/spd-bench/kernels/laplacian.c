@@ -0,0 +1,31 @@
+/* discrete 5-point Laplacian */
+
+#include "../spd_bench.h"
+
+float U[N][N], L[N][N];
+
+void bench_init(void) {
+  for (long i = 0; i < N; i++)
+    for (long j = 0; j < N; j++) {
+      U[i][j] = bench_value(i, j);
+      L[i][j] = 0;
+    }
+}
+
+void bench_kernel(void) {
+  for (long i = 1; i < N - 1; i++) {
+    __spd_loop(0, 1, 1, 0);
+    for (long j = 1; j < N - 1; j++)
+      L[i][j] = U[i - 1][j] + U[i + 1][j] + U[i][j - 1] + U[i][j + 1] -
+                4.0f * U[i][j];
+  }
+}
+
+long bench_points(void) { return (long)(N - 2) * (N - 2); }
+
+int bench_num_outputs(void) { return 1; }
+
+const float *bench_output(int Idx, long *Size) {
+  *Size = (long)N * N;
+  return &L[0][0];
+}
@@ -0,0 +1,34 @@
+/* two independent stencils on two arrays in one loop nest */
+
+#include "../spd_bench.h"
+
+float A[N][N], B[N][N], C[N][N], D[N][N];
+
+void bench_init(void) {
+  for (long i = 0; i < N; i++)
+    for (long j = 0; j < N; j++) {
+      A[i][j] = bench_value(i, j);
+      C[i][j] = bench_value(j, i);
+      B[i][j] = 0;
+      D[i][j] = 0;
+    }
+}
+
+void bench_kernel(void) {
+  for (long i = 1; i < N - 1; i++) {
+    __spd_loop(0, 1, 1, 0);
+    for (long j = 1; j < N - 1; j++) {
+      B[i][j] = 0.5f * (A[i - 1][j] + A[i + 1][j]);
+      D[i][j] = 0.5f * (C[i][j - 1] + C[i][j + 1]);
+    }
+  }
+}
+
+long bench_points(void) { return (long)(N - 2) * (N - 2); }
+
+int bench_num_outputs(void) { return 2; }
+
+const float *bench_output(int Idx, long *Size) {
+  *Size = (long)N * N;
+  return (Idx == 0) ? &B[0][0] : &D[0][0];
+}
@@ -0,0 +1,240 @@
+#!/usr/bin/env python
+"""Runs the SPD offload benchmarks on the CPU-emulated SPD runtime.
+
+Every kernel in kernels/ is built twice: once offloaded, with Polly's
+-polly-enable-spdgen pipeline, the emulator of its kernels
+(-polly-spd-emulate) and the SPD runtime, and once as a plain host build.
+Both are run and their output arrays are compared. The offloaded run
+reports the host time of every phase (SPD_PROFILE=1 of the runtime) and the
+grid points updated per second. "total" is the time of the offloaded run,
+"ref" the time of the host build and "ovhd" the share of the host phases
+(everything but the kernel) in the offloaded run. "sent" is the share of
+the words of run-length encoded channels that crossed the bus.
+
+  run.py --clang=<clang with Polly> --runtime-dir=<dir of libSPDRuntime>
+
+The exit status is non-zero when a kernel expected to pass fails, or when a
+kernel listed as unsupported starts to pass, so that the list is updated.
+"""
+
+from __future__ import print_function
+
+import argparse
+import array
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+# name, source, extra Polly options, expected result
+BENCHMARKS = [
+    ('jacobi2d', 'jacobi2d.c', [], 'pass'),
+    ('jacobi2d-slabs', 'jacobi2d.c', ['-polly-spd-num-partitions=4'], 'pass'),
+    ('jacobi2d-tiled', 'jacobi2d.c', ['-polly-spd-tile-width=128'], 'pass'),
+    # separate streams are not tiled, their rows are streamed whole
+    ('jacobi2d-tiled-separate', 'jacobi2d.c',
+     ['-polly-spd-tile-width=128', '-polly-spd-layout=separate'], 'pass'),
+    ('jacobi2d-devattr', 'jacobi2d.c', ['-polly-spd-device-attr'], 'pass'),
+    ('laplacian', 'laplacian.c', [], 'pass'),
+    ('blur', 'blur.c', [], 'pass'),
+    ('jacobi2d-inline', 'jacobi2d.c', ['-polly-spd-inline-pack'], 'pass'),
+    ('multi-stencil', 'multi_stencil.c', [], 'pass'),
+    ('multi-stencil-separate', 'multi_stencil.c',
+     ['-polly-spd-layout=separate'], 'pass'),
+    ('padded', 'padded.c', ['-polly-spd-layout=separate'], 'pass'),
+    ('padded-rle', 'padded.c',
+     ['-polly-spd-layout=separate', '-polly-spd-compress-arrays=A'], 'pass'),
+    # the write domain is computed for 2-D grids only
+    ('jacobi3d', 'jacobi3d.c', [], 'unsupported'),
+    # a write mixing two streamed arrays has no value to keep outside of the
+    # write domain
+    ('axpy', 'axpy.c', [], 'unsupported'),
+]
+
+PHASES = ['pack', 'domain', 'dma_in', 'kernel', 'dma_out', 'unpack']
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+
+
+def polly_flags(extra):
+  flags = ['-polly', '-polly-enable-spdgen', '-polly-spd-emulate',
+           '-polly-process-unprofitable'] + extra
+  result = []
+  for flag in flags:
+    result += ['-mllvm', flag]
+  return result
+
+
+def build(args, source, flags, output, workdir):
+  cmd = [args.clang, '-O3', '-std=c99', '-D_POSIX_C_SOURCE=200809L',
+         '-DN=%d' % args.size, os.path.join(BENCH_DIR, 'kernels', source),
+         os.path.join(BENCH_DIR, 'spd_bench_main.c'), '-o', output] + flags
+  if args.verbose:
+    print(' '.join(cmd))
+  proc = subprocess.Popen(cmd, cwd=workdir, stdout=subprocess.PIPE,
+                          stderr=subprocess.STDOUT)
+  log = proc.communicate()[0].decode('utf-8', 'replace')
+  return proc.returncode == 0, log
+
+
+def run(args, binary, output, profile):
+  env = dict(os.environ)
+  if profile:
+    env['SPD_PROFILE'] = '1'
+    env['LD_LIBRARY_PATH'] = os.pathsep.join(
+        [args.runtime_dir, env.get('LD_LIBRARY_PATH', '')])
+  proc = subprocess.Popen([binary, output, str(args.iterations)], env=env,
+                          stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+  out, err = proc.communicate()
+  out = out.decode('utf-8', 'replace')
+  err = err.decode('utf-8', 'replace')
+  if proc.returncode != 0:
+    return None, err
+
+  result = {'phases': {}}
+  for line in out.splitlines():
+    fields = line.split()
+    if len(fields) == 2 and fields[0] in ('time', 'points'):
+      result[fields[0]] = float(fields[1])
+  for line in err.splitlines():
+    fields = line.split()
+    if len(fields) == 5 and line.startswith('SPD profile:'):
+      if fields[2] == 'rle_words':
+        result['rle'] = float(fields[4]) / max(1.0, float(fields[3]))
+      else:
+        result['phases'][fields[2]] = float(fields[4])
+  return result, err
+
+
+def read_floats(path):
+  data = array.array('f')
+  with open(path, 'rb') as f:
+    raw = f.read()
+  if hasattr(data, 'frombytes'):
+    data.frombytes(raw)
+  else:
+    data.fromstring(raw)
+  return data
+
+
+def max_error(ref, out):
+  if len(ref) != len(out):
+    return float('inf')
+  err = 0.0
+  for r, o in zip(ref, out):
+    err = max(err, abs(r - o) / max(1.0, abs(r)))
+  return err
+
+
+def run_benchmark(args, name, source, extra, workdir):
+  ref_bin = os.path.join(workdir, 'ref')
+  spd_bin = os.path.join(workdir, 'spd')
+  ref_out = os.path.join(workdir, 'ref.out')
+  spd_out = os.path.join(workdir, 'spd.out')
+
+  ok, log = build(args, source, ['-DSPD_REFERENCE'], ref_bin, workdir)
+  if not ok:
+    return 'ERROR', 'reference build failed\n' + log, None
+
+  flags = polly_flags(extra) + ['-L' + args.runtime_dir, '-lSPDRuntime',
+                                '-lpthread']
+  # the inline pack loops run on the GNU OpenMP runtime
+  if '-polly-spd-inline-pack' in extra:
+    flags.append('-lgomp')
+  ok, log = build(args, source, flags, spd_bin, workdir)
+  if not ok:
+    return 'FAIL', 'offload build failed\n' + log, None
+
+  ref, log = run(args, ref_bin, ref_out, False)
+  if ref is None:
+    return 'ERROR', 'reference run failed\n' + log, None
+  spd, log = run(args, spd_bin, spd_out, True)
+  if spd is None:
+    return 'FAIL', 'offloaded run failed\n' + log, None
+
+  err = max_error(read_floats(ref_out), read_floats(spd_out))
+  spd['error'] = err
+  spd['ref_time'] = ref['time']
+  if err > args.tolerance:
+    return 'FAIL', 'max relative error %g' % err, spd
+  return 'PASS', '', spd
+
+
+def report(name, status, result):
+  if result is None:
+    print('%-24s %-6s' % (name, status))
+    return
+
+  phases = result['phases']
+  total = result['time']
+  host = sum(phases.get(p, 0.0) for p in PHASES if p != 'kernel')
+  rate = result['points'] / total / 1e6 if total > 0 else 0.0
+  print('%-24s %-6s %9.2e' % (name, status, result['error']) +
+        ''.join(' %8.3f' % (phases.get(p, 0.0) * 1e3) for p in PHASES) +
+        ' %8.3f %8.3f %6.1f%% %9.2f' %
+        (total * 1e3, result['ref_time'] * 1e3,
+         100.0 * host / total if total > 0 else 0.0, rate) +
+        (' %5.1f%%' % (100.0 * result['rle']) if 'rle' in result else ''))
+
+
+def main():
+  parser = argparse.ArgumentParser(
+      description='Run the SPD offload benchmarks on the emulated runtime')
+  parser.add_argument('--clang', default='clang',
+                      help='clang with Polly linked in')
+  parser.add_argument('--runtime-dir', required=True,
+                      help='directory of libSPDRuntime')
+  parser.add_argument('--size', type=int, default=512,
+                      help='grid size N (default 512)')
+  parser.add_argument('--iterations', type=int, default=3,
+                      help='kernel calls per run (default 3)')
+  parser.add_argument('--tolerance', type=float, default=1e-5,
+                      help='largest relative error accepted')
+  parser.add_argument('--keep', action='store_true',
+                      help='keep the build directories')
+  parser.add_argument('-v', '--verbose', action='store_true')
+  parser.add_argument('benchmarks', nargs='*',
+                      help='benchmarks to run (default: all)')
+  args = parser.parse_args()
+  args.runtime_dir = os.path.abspath(args.runtime_dir)
+
+  selected = [b for b in BENCHMARKS
+              if not args.benchmarks or b[0] in args.benchmarks]
+
+  print('%-24s %-6s %9s' % ('benchmark', 'status', 'max err') +
+        ''.join(' %8s' % p for p in PHASES) +
+        ' %8s %8s %7s %9s %6s' % ('total', 'ref', 'ovhd', 'Mpoint/s',
+                                   'sent'))
+  print('%-24s %-6s %9s' % ('', '', '') + ''.join(' %8s' % 'ms'
+                                                  for p in PHASES) +
+        ' %8s %8s' % ('ms', 'ms'))
+
+  failures = 0
+  for name, source, extra, expected in selected:
+    workdir = tempfile.mkdtemp(prefix='spd-bench-%s-' % name)
+    status, log, result = run_benchmark(args, name, source, extra, workdir)
+    if expected == 'unsupported':
+      if status == 'FAIL':
+        status, log = 'UNSUP', ''
+      elif status == 'PASS':
+        status = 'XPASS'
+
+    report(name, status, result)
+    if status in ('FAIL', 'XPASS', 'ERROR'):
+      failures += 1
+      if log:
+        print('  ' + log.strip().replace('\n', '\n  '))
+    elif args.verbose and log:
+      print('  ' + log.strip().replace('\n', '\n  '))
+
+    if args.keep:
+      print('  kept %s' % workdir)
+    else:
+      shutil.rmtree(workdir, ignore_errors=True)
+
+  return 1 if failures else 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,44 @@
+/******************************************************************************/
+/*                                                                            */
+/*                     The LLVM Compiler Infrastructure                       */
+/*                                                                            */
+/* This file is dual licensed under the MIT and the University of Illinois    */
+/* Open Source License. See LICENSE.TXT for details.                          */
+/*                                                                            */
+/******************************************************************************/
+/*                                                                            */
+/*  Interface between the SPD benchmark kernels and spd_bench_main.c. Every   */
+/*  kernel file defines its arrays as globals and the functions below.        */
+/*                                                                            */
+/******************************************************************************/
+
+#ifndef SPD_BENCH_H_
+#define SPD_BENCH_H_
+
+#ifndef N
+#define N 512
+#endif
+
+/* offload marker read by -polly-loop-ext, a no-op in the host reference */
+#ifdef SPD_REFERENCE
+static inline void __spd_loop(int Region, int VL, int UC, int SwitchInOut) {}
+#else
+void __spd_loop(int Region, int VL, int UC, int SwitchInOut);
+#endif
+
+/* fills the input arrays */
+void bench_init(void);
+/* runs the offloaded loops once */
+void bench_kernel(void);
+/* number of grid points updated by one bench_kernel call */
+long bench_points(void);
+/* number of output arrays, Size elements each */
+int bench_num_outputs(void);
+const float *bench_output(int Idx, long *Size);
+
+/* deterministic input data in [-1, 1) */
+static inline float bench_value(long i, long j) {
+  return (float)((i * 7919 + j * 104729) % 2048) / 1024.0f - 1.0f;
+}
+
+#endif /* SPD_BENCH_H_ */
@@ -0,0 +1,65 @@
+/******************************************************************************/
+/*                                                                            */
+/*                     The LLVM Compiler Infrastructure                       */
+/*                                                                            */
+/* This file is dual licensed under the MIT and the University of Illinois    */
+/* Open Source License. See LICENSE.TXT for details.                          */
+/*                                                                            */
+/******************************************************************************/
+/*                                                                            */
+/*  Driver of one SPD benchmark kernel: runs it a number of times, writes     */
+/*  its output arrays to a file and prints the elapsed time.                  */
+/*                                                                            */
+/*    <binary> <output file> [iterations]                                     */
+/*                                                                            */
+/******************************************************************************/
+
+#include "spd_bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double getTime(void) {
+  struct timespec TS;
+  clock_gettime(CLOCK_MONOTONIC, &TS);
+  return TS.tv_sec + TS.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <output file> [iterations]\n", argv[0]);
+    return 1;
+  }
+
+  int Iterations = (argc > 2) ? atoi(argv[2]) : 1;
+  if (Iterations < 1)
+    Iterations = 1;
+
+  bench_init();
+
+  double Start = getTime();
+  for (int i = 0; i < Iterations; i++)
+    bench_kernel();
+  double Time = getTime() - Start;
+
+  FILE *F = fopen(argv[1], "wb");
+  if (!F) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  for (int i = 0; i < bench_num_outputs(); i++) {
+    long Size;
+    const float *Out = bench_output(i, &Size);
+    if (fwrite(Out, sizeof(float), Size, F) != (size_t)Size) {
+      perror(argv[1]);
+      return 1;
+    }
+  }
+  fclose(F);
+
+  printf("time %.9f\n", Time);
+  printf("points %ld\n", bench_points() * Iterations);
+  return 0;
+}